@@ -0,0 +1,56 @@
+#!/bin/sh
+#
+# run_nandsim.sh - run yaffs_stress on a YAFFS mount on the NAND simulator
+#
+# Copyright (C) 2026 Motorola, Inc.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation.
+#
+# usage: run_nandsim.sh [seconds] [readers]
+#
+# Needs root, nandsim and mtdblock as modules or built in, and YAFFS.
+# The defaults simulate a 32MiB small page chip mounted as "yaffs".  For a
+# 2KiB page chip mounted as "yaffs2", set for example
+#	NANDSIM_ARGS="first_id_byte=0xec second_id_byte=0xf2 fourth_id_byte=0x15" FSTYPE=yaffs2
+#
+
+SECONDS_TO_RUN=${1:-60}
+READERS=${2:-4}
+NANDSIM_ARGS=${NANDSIM_ARGS:-"first_id_byte=0x98 second_id_byte=0x75"}
+FSTYPE=${FSTYPE:-yaffs}
+MNT=${MNT:-/mnt/yaffs-stress}
+STRESS=${STRESS:-`dirname $0`/yaffs_stress}
+
+fail() {
+	echo "run_nandsim: $*" >&2
+	exit 1
+}
+
+modprobe nandsim $NANDSIM_ARGS || fail "cannot load nandsim"
+modprobe mtdblock 2>/dev/null
+
+MTD=`grep "NAND simulator" /proc/mtd | sed -e 's/^mtd\([0-9]*\):.*/\1/' | head -1`
+[ -n "$MTD" ] || fail "no NAND simulator in /proc/mtd"
+
+DEV=/dev/mtdblock$MTD
+[ -b $DEV ] || mknod $DEV b 31 $MTD || fail "cannot create $DEV"
+
+mkdir -p $MNT
+mount -t $FSTYPE $DEV $MNT || fail "cannot mount $DEV"
+
+$STRESS $MNT $SECONDS_TO_RUN $READERS
+RESULT=$?
+
+cat /proc/yaffs
+
+# a second mount checks what the stress left on the flash
+umount $MNT || fail "cannot unmount $MNT"
+mount -t $FSTYPE $DEV $MNT || fail "cannot mount $DEV again"
+ls -l $MNT > /dev/null || RESULT=1
+umount $MNT
+
+rmmod nandsim
+
+exit $RESULT
@@ -0,0 +1,277 @@
+/*
+ * yaffs_stress.c - concurrent reader/writer stress test for YAFFS
+ *
+ * Copyright (C) 2026 Motorola, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * One writer keeps replacing a set of files with new generations of
+ * themselves (write a temporary file, then rename it over the old one),
+ * creates and unlinks filler files to keep the garbage collector busy,
+ * and renames whole files around.  Several readers at the same time open,
+ * stat, read and list those files and check that every file they see
+ * holds exactly one complete generation.
+ *
+ * A reader that sees a short file, a torn file or a read error fails the
+ * test.  The longest stat() each reader saw is reported, which shows
+ * whether readers were held up behind the writer's NAND programs and
+ * erases.
+ *
+ * usage: yaffs_stress <dir> [seconds] [readers]
+ *
+ * Exits 0 when every process passed.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NFILES		16		/* files the readers check */
+#define NFILLERS	32		/* garbage files for the GC */
+#define MAX_WORDS	(64 * 1024 / 4)	/* largest file, in 32-bit words */
+#define MAX_READERS	16
+
+static volatile sig_atomic_t stop;
+static char *dir;
+static unsigned int buf[MAX_WORDS];
+
+static void on_alarm(int sig)
+{
+	stop = 1;
+}
+
+static unsigned long now_us(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+
+/*
+ * Word 0 is the generation, word 1 the length in words, every other word
+ * a function of file, generation and position.
+ */
+static unsigned int pattern(int file, unsigned int gen, int i)
+{
+	return (gen * 2654435761U) ^ (file << 24) ^ (i * 40503U);
+}
+
+static int fill(int file, unsigned int gen)
+{
+	int words = 2 + (gen * 7919U + file * 104729U) % (MAX_WORDS - 2);
+	int i;
+
+	buf[0] = gen;
+	buf[1] = words;
+	for (i = 2; i < words; i++)
+		buf[i] = pattern(file, gen, i);
+	return words;
+}
+
+static int write_file(const char *path, int words)
+{
+	int fd, len = words * 4;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+	if (write(fd, buf, len) != len) {
+		close(fd);
+		return -1;
+	}
+	return close(fd);
+}
+
+static int writer(void)
+{
+	char path[256], tmp[256];
+	unsigned int gen[NFILES];
+	unsigned long ops = 0;
+	int i;
+
+	for (i = 0; i < NFILES; i++) {
+		gen[i] = 1;
+		snprintf(path, sizeof(path), "%s/f%02d", dir, i);
+		if (write_file(path, fill(i, gen[i])) < 0) {
+			perror(path);
+			return 1;
+		}
+	}
+
+	/* the readers wait for f15 */
+	while (!stop) {
+		int file = rand() % NFILES;
+
+		/* replace a file with its next generation */
+		gen[file]++;
+		snprintf(path, sizeof(path), "%s/f%02d", dir, file);
+		snprintf(tmp, sizeof(tmp), "%s/t%02d", dir, file);
+		if (write_file(tmp, fill(file, gen[file])) < 0 || rename(tmp, path) < 0) {
+			perror(path);
+			return 1;
+		}
+
+		/* create or drop a filler so the GC has dirty blocks to collect */
+		snprintf(path, sizeof(path), "%s/junk%02d", dir, rand() % NFILLERS);
+		if (rand() & 1) {
+			if (write_file(path, fill(NFILES, ops)) < 0 && errno != ENOSPC) {
+				perror(path);
+				return 1;
+			}
+		} else if (unlink(path) < 0 && errno != ENOENT) {
+			perror(path);
+			return 1;
+		}
+
+		/* and push some of it out to the flash */
+		if (!(++ops % 64))
+			sync();
+	}
+
+	printf("writer: %lu operations\n", ops);
+	return 0;
+}
+
+static int check_file(int id, int file)
+{
+	char path[256];
+	struct stat st;
+	unsigned int gen;
+	int fd, len, words, i;
+
+	snprintf(path, sizeof(path), "%s/f%02d", dir, file);
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		/* between the unlink and rename of another writer op */
+		if (errno == ENOENT)
+			return 0;
+		perror(path);
+		return 1;
+	}
+
+	len = read(fd, buf, sizeof(buf));
+	if (len < 8 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "reader %d: %s: short read %d\n", id, path, len);
+		close(fd);
+		return 1;
+	}
+	close(fd);
+
+	gen = buf[0];
+	words = buf[1];
+	if (words < 2 || words > MAX_WORDS || len != words * 4 || st.st_size != len) {
+		fprintf(stderr, "reader %d: %s: gen %u has %d bytes, size %ld, expected %d\n",
+			id, path, gen, len, (long)st.st_size, words * 4);
+		return 1;
+	}
+	for (i = 2; i < words; i++) {
+		if (buf[i] != pattern(file, gen, i)) {
+			fprintf(stderr, "reader %d: %s: gen %u torn at word %d\n",
+				id, path, gen, i);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int reader(int id)
+{
+	char path[256];
+	struct stat st;
+	unsigned long reads = 0, start, us, max_us = 0;
+	DIR *d;
+
+	srand(id + 1);
+	snprintf(path, sizeof(path), "%s/f%02d", dir, NFILES - 1);
+	while (!stop && stat(path, &st) < 0)
+		usleep(1000);
+
+	while (!stop) {
+		int file = rand() % NFILES;
+
+		snprintf(path, sizeof(path), "%s/f%02d", dir, file);
+		start = now_us();
+		if (stat(path, &st) < 0 && errno != ENOENT) {
+			perror(path);
+			return 1;
+		}
+		us = now_us() - start;
+		if (us > max_us)
+			max_us = us;
+
+		if (check_file(id, file))
+			return 1;
+
+		if (!(++reads % 16)) {
+			d = opendir(dir);
+			if (!d) {
+				perror(dir);
+				return 1;
+			}
+			while (readdir(d))
+				;
+			closedir(d);
+		}
+	}
+
+	printf("reader %d: %lu files checked, longest stat %lu us\n", id, reads, max_us);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	pid_t pid[MAX_READERS + 1];
+	int seconds = 60, readers = 4;
+	int i, status, failed = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <dir> [seconds] [readers]\n", argv[0]);
+		return 2;
+	}
+	dir = argv[1];
+	if (argc > 2)
+		seconds = atoi(argv[2]);
+	if (argc > 3)
+		readers = atoi(argv[3]);
+	if (readers < 1 || readers > MAX_READERS) {
+		fprintf(stderr, "readers must be 1 to %d\n", MAX_READERS);
+		return 2;
+	}
+
+	signal(SIGALRM, on_alarm);
+
+	for (i = 0; i <= readers; i++) {
+		pid[i] = fork();
+		if (pid[i] < 0) {
+			perror("fork");
+			return 2;
+		}
+		if (!pid[i]) {
+			alarm(seconds);
+			exit(i ? reader(i) : writer());
+		}
+	}
+
+	for (i = 0; i <= readers; i++) {
+		if (waitpid(pid[i], &status, 0) < 0 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status)) {
+			fprintf(stderr, "%s %d failed\n", i ? "reader" : "writer", i);
+			failed = 1;
+		}
+	}
+
+	printf("%s\n", failed ? "FAIL" : "PASS");
+	return failed;
+}
@@ -26,12 +26,14 @@
  * ----------   --------  --------------------
  * 10/06/2006   Motorola  Kernel panic changes
  * 11/29/2006   Motorola  Add support for memory dump
+ * 10/17/2026   Motorola  Keep the partition tail free for the LTT flight ring
  *
  */
 
 #include <linux/types.h>
 #include <linux/string.h>
 #include <linux/kpanic.h>
+#include <linux/ltt-ring.h>
 
 #ifdef CONFIG_MOT_FEAT_MEMDUMP
 #include <linux/config.h>
@@ -74,8 +76,8 @@ void dump_kpanic(char *str) {
 		return;
 	}
 
-	/* get the size of the kpanic partition */
-	kpanic_partition_size = get_kpanic_partition_size();
+	/* get the size of the kpanic partition, less the LTT flight ring area */
+	kpanic_partition_size = get_kpanic_partition_size() - ltt_ring_kpanic_size();
 
 	/* truncate the printk buffer if it is larger than the kpanic partition */
 	if (_log_buf_len > kpanic_partition_size) {
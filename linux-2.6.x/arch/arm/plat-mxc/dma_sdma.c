@@ -21,6 +21,7 @@
  * DATE          AUTHOR         COMMMENT
  * ----          ------         --------
  * 10/04/2006    Motorola       Add mxc_dma_reset support
+ * 10/17/2026    Motorola       Add sdma_malloc_multi and sdma_free_multi stubs
  */
 
 /*!
@@ -204,6 +205,15 @@ void sdma_free(void *buf)
 {
 }
 
+int sdma_malloc_multi(size_t size, int count, void **bufs)
+{
+	return -ENODEV;
+}
+
+void sdma_free_multi(void **bufs, int count)
+{
+}
+
 void *sdma_phys_to_virt(unsigned long buf)
 {
 	return 0;
@@ -227,6 +237,8 @@ EXPORT_SYMBOL(mxc_free_dma);
 EXPORT_SYMBOL(mxc_dma_set_callback);
 EXPORT_SYMBOL(sdma_malloc);
 EXPORT_SYMBOL(sdma_free);
+EXPORT_SYMBOL(sdma_malloc_multi);
+EXPORT_SYMBOL(sdma_free_multi);
 EXPORT_SYMBOL(sdma_phys_to_virt);
 EXPORT_SYMBOL(sdma_virt_to_phys);
 
@@ -33,6 +33,10 @@ static inline void crypto_alg_put(struct crypto_alg *alg)
 	module_put(alg->cra_module);
 }
 
+/*
+ * Look up an algorithm by driver name, or by algorithm name in which case
+ * the highest priority implementation wins.
+ */
 struct crypto_alg *crypto_alg_lookup(const char *name)
 {
 	struct crypto_alg *q, *alg = NULL;
@@ -43,12 +47,17 @@ struct crypto_alg *crypto_alg_lookup(const char *name)
 	down_read(&crypto_alg_sem);
 	
 	list_for_each_entry(q, &crypto_alg_list, cra_list) {
-		if (!(strcmp(q->cra_name, name))) {
-			if (crypto_alg_get(q))
-				alg = q;
+		if (!strcmp(q->cra_driver_name, name)) {
+			alg = q;
 			break;
 		}
+		if (!strcmp(q->cra_name, name) &&
+		    (!alg || q->cra_priority > alg->cra_priority))
+			alg = q;
 	}
+
+	if (alg && !crypto_alg_get(alg))
+		alg = NULL;
 	
 	up_read(&crypto_alg_sem);
 	return alg;
@@ -142,6 +151,11 @@ struct crypto_tfm *crypto_alloc_tfm(const char *name, u32 flags)
 		goto out_free_tfm;
 	}
 
+	if (alg->cra_init && alg->cra_init(crypto_tfm_ctx(tfm))) {
+		crypto_exit_ops(tfm);
+		goto out_free_tfm;
+	}
+
 	goto out;
 
 out_free_tfm:
@@ -158,6 +172,8 @@ void crypto_free_tfm(struct crypto_tfm *tfm)
 	struct crypto_alg *alg = tfm->__crt_alg;
 	int size = sizeof(*tfm) + alg->cra_ctxsize;
 
+	if (alg->cra_exit)
+		alg->cra_exit(crypto_tfm_ctx(tfm));
 	crypto_exit_ops(tfm);
 	crypto_alg_put(alg);
 	memset(tfm, 0, size);
@@ -169,10 +185,14 @@ int crypto_register_alg(struct crypto_alg *alg)
 	int ret = 0;
 	struct crypto_alg *q;
 	
+	if (!alg->cra_driver_name[0])
+		snprintf(alg->cra_driver_name, CRYPTO_MAX_ALG_NAME,
+			 "%s-generic", alg->cra_name);
+
 	down_write(&crypto_alg_sem);
 	
 	list_for_each_entry(q, &crypto_alg_list, cra_list) {
-		if (!(strcmp(q->cra_name, alg->cra_name))) {
+		if (!(strcmp(q->cra_driver_name, alg->cra_driver_name))) {
 			ret = -EEXIST;
 			goto out;
 		}
@@ -63,6 +63,14 @@ static int crypt(struct crypto_tfm *tfm,
 		return -EINVAL;
 	}
 
+	if (tfm->__crt_alg->cra_cipher.cia_bulk) {
+		int ret = tfm->__crt_alg->cra_cipher.cia_bulk(
+				crypto_tfm_ctx(tfm), dst, src, nbytes, info,
+				tfm->crt_cipher.cit_mode, enc);
+		if (ret != -EAGAIN)
+			return ret;
+	}
+
 	scatterwalk_start(&walk_in, src);
 	scatterwalk_start(&walk_out, dst);
 
@@ -126,6 +134,27 @@ static void ecb_process(struct crypto_tfm *tfm, u8 *dst, u8 *src,
 	fn(crypto_tfm_ctx(tfm), dst, src);
 }
 
+/*
+ * Counter mode: the whole counter block is incremented as one big-endian
+ * number, and decryption is the same operation as encryption.
+ */
+static void ctr_process(struct crypto_tfm *tfm, u8 *dst, u8 *src,
+			cryptfn_t fn, int enc, void *info, int in_place)
+{
+	const unsigned int bsize = crypto_tfm_alg_blocksize(tfm);
+	u8 *ctr = info;
+	u8 stream[bsize];
+	int i;
+
+	fn(crypto_tfm_ctx(tfm), stream, ctr);
+	tfm->crt_u.cipher.cit_xor_block(stream, src);
+	memcpy(dst, stream, bsize);
+
+	for (i = bsize - 1; i >= 0; i--)
+		if (++ctr[i])
+			break;
+}
+
 static int setkey(struct crypto_tfm *tfm, const u8 *key, unsigned int keylen)
 {
 	struct cipher_alg *cia = &tfm->__crt_alg->cra_cipher;
@@ -154,7 +183,7 @@ static int ecb_decrypt(struct crypto_tfm *tfm,
 {
 	return crypt(tfm, dst, src, nbytes,
 	             tfm->__crt_alg->cra_cipher.cia_decrypt,
-	             ecb_process, 1, NULL);
+	             ecb_process, 0, NULL);
 }
 
 static int cbc_encrypt(struct crypto_tfm *tfm,
@@ -197,6 +226,46 @@ static int cbc_decrypt_iv(struct crypto_tfm *tfm,
 	             cbc_process, 0, iv);
 }
 
+static int ctr_encrypt(struct crypto_tfm *tfm,
+                       struct scatterlist *dst,
+                       struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	return crypt(tfm, dst, src, nbytes,
+	             tfm->__crt_alg->cra_cipher.cia_encrypt,
+	             ctr_process, 1, tfm->crt_cipher.cit_iv);
+}
+
+static int ctr_encrypt_iv(struct crypto_tfm *tfm,
+                          struct scatterlist *dst,
+                          struct scatterlist *src,
+                          unsigned int nbytes, u8 *iv)
+{
+	return crypt(tfm, dst, src, nbytes,
+	             tfm->__crt_alg->cra_cipher.cia_encrypt,
+	             ctr_process, 1, iv);
+}
+
+static int ctr_decrypt(struct crypto_tfm *tfm,
+                       struct scatterlist *dst,
+                       struct scatterlist *src,
+		       unsigned int nbytes)
+{
+	return crypt(tfm, dst, src, nbytes,
+	             tfm->__crt_alg->cra_cipher.cia_encrypt,
+	             ctr_process, 0, tfm->crt_cipher.cit_iv);
+}
+
+static int ctr_decrypt_iv(struct crypto_tfm *tfm,
+                          struct scatterlist *dst,
+                          struct scatterlist *src,
+                          unsigned int nbytes, u8 *iv)
+{
+	return crypt(tfm, dst, src, nbytes,
+	             tfm->__crt_alg->cra_cipher.cia_encrypt,
+	             ctr_process, 0, iv);
+}
+
 static int nocrypt(struct crypto_tfm *tfm,
                    struct scatterlist *dst,
                    struct scatterlist *src,
@@ -252,17 +321,18 @@ int crypto_init_cipher_ops(struct crypto_tfm *tfm)
 		break;
 	
 	case CRYPTO_TFM_MODE_CTR:
-		ops->cit_encrypt = nocrypt;
-		ops->cit_decrypt = nocrypt;
-		ops->cit_encrypt_iv = nocrypt_iv;
-		ops->cit_decrypt_iv = nocrypt_iv;
+		ops->cit_encrypt = ctr_encrypt;
+		ops->cit_decrypt = ctr_decrypt;
+		ops->cit_encrypt_iv = ctr_encrypt_iv;
+		ops->cit_decrypt_iv = ctr_decrypt_iv;
 		break;
 
 	default:
 		BUG();
 	}
 	
-	if (ops->cit_mode == CRYPTO_TFM_MODE_CBC) {
+	if (ops->cit_mode == CRYPTO_TFM_MODE_CBC ||
+	    ops->cit_mode == CRYPTO_TFM_MODE_CTR) {
 	    	
 	    	switch (crypto_tfm_alg_blocksize(tfm)) {
 	    	case 8:
@@ -53,6 +53,8 @@ static int c_show(struct seq_file *m, void *p)
 	struct crypto_alg *alg = (struct crypto_alg *)p;
 	
 	seq_printf(m, "name         : %s\n", alg->cra_name);
+	seq_printf(m, "driver       : %s\n", alg->cra_driver_name);
+	seq_printf(m, "priority     : %d\n", alg->cra_priority);
 	seq_printf(m, "module       : %s\n", module_name(alg->cra_module));
 	
 	switch (alg->cra_flags & CRYPTO_ALG_TYPE_MASK) {
@@ -14,6 +14,9 @@
  *
  * 14 - 09 - 2003 
  *	Rewritten by Kartikey Mahendra Bhatt
+ *
+ * 17 - 10 - 2026
+ *	Motorola: cycle counting speed tests (sec=0)
  */
 
 #include <linux/init.h>
@@ -25,6 +28,8 @@
 #include <linux/crypto.h>
 #include <linux/highmem.h>
 #include <linux/moduleparam.h>
+#include <linux/jiffies.h>
+#include <linux/timex.h>
 #include "tcrypt.h"
 
 /*
@@ -56,6 +61,7 @@
 static unsigned int IDX[8] = { IDX1, IDX2, IDX3, IDX4, IDX5, IDX6, IDX7, IDX8 };
 
 static int mode;
+static unsigned int sec = 1;
 static char *xbuf;
 static char *tvmem;
 
@@ -611,6 +617,216 @@ test_available(void)
 	}	
 }
 
+/*
+ * Speed tests: each buffer size is run for 'sec' seconds.  Asking for an
+ * algorithm by name gets the preferred implementation, while the
+ * "<name>-generic" driver name forces the software one, so running both
+ * compares an offload engine or assembler version against the C code.
+ *
+ * With sec=0 each size is instead run CYCLE_WARMUP times to warm the
+ * caches and then CYCLE_RUNS times under the cycle counter, reporting the
+ * fastest run.  Interrupts stay enabled since an offload driver may sleep;
+ * taking the minimum keeps them out of the figure.
+ */
+static unsigned int speed_sizes[] = { 16, 64, 256, 1024, 8192, 0 };
+
+#define CYCLE_WARMUP	4
+#define CYCLE_RUNS	8
+
+#ifdef CONFIG_CPU_V6
+static unsigned int cycle_shift;
+
+/* ARM11 CCNT; left as is if oprofile or someone else already runs it */
+static void tcrypt_cycles_init(void)
+{
+	u32 pmnc;
+
+	asm volatile("mrc p15, 0, %0, c15, c12, 0" : "=r" (pmnc));
+	if (!(pmnc & 1)) {
+		pmnc = (pmnc | 1) & ~8;		/* enable, no divide by 64 */
+		asm volatile("mcr p15, 0, %0, c15, c12, 0" : : "r" (pmnc));
+	}
+	cycle_shift = (pmnc & 8) ? 6 : 0;
+}
+
+static inline u32 tcrypt_cycles(void)
+{
+	u32 ccnt;
+
+	asm volatile("mrc p15, 0, %0, c15, c12, 1" : "=r" (ccnt));
+	return ccnt << cycle_shift;
+}
+#else
+/* get_cycles() resolution is whatever the platform timer gives */
+static inline void tcrypt_cycles_init(void) { }
+
+static inline u32 tcrypt_cycles(void)
+{
+	return get_cycles();
+}
+#endif
+
+static void print_cycles(unsigned int len, u32 cycles)
+{
+	printk("%5u byte blocks: %u cycles/operation, %u.%02u cycles/byte\n",
+	       len, cycles, cycles / len, (cycles % len) * 100 / len);
+}
+
+static int
+test_cipher_cycles(struct crypto_tfm *tfm, struct scatterlist *sg,
+		   unsigned int len, int enc)
+{
+	u32 start, cycles, best = ~0;
+	int i, ret;
+
+	for (i = 0; i < CYCLE_WARMUP + CYCLE_RUNS; i++) {
+		start = tcrypt_cycles();
+		if (enc)
+			ret = crypto_cipher_encrypt(tfm, sg, sg, len);
+		else
+			ret = crypto_cipher_decrypt(tfm, sg, sg, len);
+		cycles = tcrypt_cycles() - start;
+		if (ret)
+			return ret;
+		if (i >= CYCLE_WARMUP && cycles < best)
+			best = cycles;
+	}
+
+	print_cycles(len, best);
+	return 0;
+}
+
+static void
+test_cipher_speed(char *algo, u32 tfm_mode, int enc, unsigned int keylen)
+{
+	struct crypto_tfm *tfm;
+	struct scatterlist sg[1];
+	unsigned long end;
+	unsigned int *b, bcount;
+	int ret;
+
+	tfm = crypto_alloc_tfm(algo, tfm_mode);
+	if (tfm == NULL) {
+		printk("failed to load transform for %s\n", algo);
+		return;
+	}
+
+	printk("\ntesting speed of %s (%s) %s\n", algo,
+	       crypto_tfm_alg_driver_name(tfm), enc ? "encryption" : "decryption");
+
+	memset(tvmem, 0xff, keylen);
+	ret = crypto_cipher_setkey(tfm, tvmem, keylen);
+	if (ret) {
+		printk("setkey() failed flags=%x\n", tfm->crt_flags);
+		goto out;
+	}
+
+	memset(xbuf, 0, XBUFSIZE);
+	if (tfm_mode != CRYPTO_TFM_MODE_ECB)
+		crypto_cipher_set_iv(tfm, xbuf, crypto_tfm_alg_ivsize(tfm));
+
+	for (b = speed_sizes; *b; b++) {
+		sg[0].page = virt_to_page(xbuf);
+		sg[0].offset = offset_in_page(xbuf);
+		sg[0].length = *b;
+
+		if (!sec) {
+			ret = test_cipher_cycles(tfm, sg, *b, enc);
+			if (ret)
+				goto fail;
+			continue;
+		}
+
+		end = jiffies + sec * HZ;
+		for (bcount = 0; time_before(jiffies, end); bcount++) {
+			if (enc)
+				ret = crypto_cipher_encrypt(tfm, sg, sg, *b);
+			else
+				ret = crypto_cipher_decrypt(tfm, sg, sg, *b);
+			if (ret)
+				goto fail;
+		}
+
+		printk("%5u byte blocks: %u operations in %u seconds "
+		       "(%lu bytes)\n", *b, bcount, sec,
+		       (unsigned long)bcount * *b);
+	}
+	goto out;
+
+fail:
+	printk("%s() failed flags=%x\n", enc ? "encrypt" : "decrypt",
+	       tfm->crt_flags);
+out:
+	crypto_free_tfm(tfm);
+}
+
+static void
+test_hash_cycles(struct crypto_tfm *tfm, struct scatterlist *sg,
+		 unsigned int len, char *result)
+{
+	u32 start, cycles, best = ~0;
+	int i;
+
+	for (i = 0; i < CYCLE_WARMUP + CYCLE_RUNS; i++) {
+		start = tcrypt_cycles();
+		crypto_digest_digest(tfm, sg, 1, result);
+		cycles = tcrypt_cycles() - start;
+		if (i >= CYCLE_WARMUP && cycles < best)
+			best = cycles;
+	}
+
+	print_cycles(len, best);
+}
+
+static void
+test_hash_speed(char *algo)
+{
+	struct crypto_tfm *tfm;
+	struct scatterlist sg[1];
+	unsigned long end;
+	unsigned int *b, bcount;
+	char result[128];
+
+	tfm = crypto_alloc_tfm(algo, 0);
+	if (tfm == NULL) {
+		printk("failed to load transform for %s\n", algo);
+		return;
+	}
+
+	printk("\ntesting speed of %s (%s)\n", algo,
+	       crypto_tfm_alg_driver_name(tfm));
+
+	if (crypto_tfm_alg_digestsize(tfm) > sizeof(result)) {
+		printk("digestsize(%u) > outputbuffer(%u)\n",
+		       crypto_tfm_alg_digestsize(tfm),
+		       (unsigned int)sizeof(result));
+		goto out;
+	}
+
+	memset(xbuf, 0, XBUFSIZE);
+	for (b = speed_sizes; *b; b++) {
+		sg[0].page = virt_to_page(xbuf);
+		sg[0].offset = offset_in_page(xbuf);
+		sg[0].length = *b;
+
+		if (!sec) {
+			test_hash_cycles(tfm, sg, *b, result);
+			continue;
+		}
+
+		end = jiffies + sec * HZ;
+		for (bcount = 0; time_before(jiffies, end); bcount++)
+			crypto_digest_digest(tfm, sg, 1, result);
+
+		printk("%5u byte blocks: %u operations in %u seconds "
+		       "(%lu bytes)\n", *b, bcount, sec,
+		       (unsigned long)bcount * *b);
+	}
+
+out:
+	crypto_free_tfm(tfm);
+}
+
 static void
 do_test(void)
 {
@@ -847,6 +1063,27 @@ do_test(void)
 
 #endif
 
+	case 200:
+		test_cipher_speed("aes-generic", CRYPTO_TFM_MODE_CBC, ENCRYPT, 16);
+		test_cipher_speed("aes-arm", CRYPTO_TFM_MODE_CBC, ENCRYPT, 16);
+		test_cipher_speed("aes", CRYPTO_TFM_MODE_CBC, ENCRYPT, 16);
+		test_cipher_speed("aes-generic", CRYPTO_TFM_MODE_CBC, DECRYPT, 16);
+		test_cipher_speed("aes-arm", CRYPTO_TFM_MODE_CBC, DECRYPT, 16);
+		test_cipher_speed("aes", CRYPTO_TFM_MODE_CBC, DECRYPT, 16);
+		test_cipher_speed("aes-generic", CRYPTO_TFM_MODE_CTR, ENCRYPT, 16);
+		test_cipher_speed("aes-arm", CRYPTO_TFM_MODE_CTR, ENCRYPT, 16);
+		test_cipher_speed("aes", CRYPTO_TFM_MODE_CTR, ENCRYPT, 16);
+		break;
+
+	case 201:
+		test_hash_speed("sha1-generic");
+		test_hash_speed("sha1-arm");
+		test_hash_speed("sha1");
+		test_hash_speed("sha256-generic");
+		test_hash_speed("sha256-arm");
+		test_hash_speed("sha256");
+		break;
+
 	case 1000:
 		test_available();
 		break;
@@ -871,6 +1108,8 @@ init(void)
 		return -ENOMEM;
 	}
 
+	if (!sec)
+		tcrypt_cycles_init();
 	do_test();
 
 	kfree(xbuf);
@@ -888,6 +1127,9 @@ module_init(init);
 module_exit(fini);
 
 module_param(mode, int, 0);
+module_param(sec, uint, 0);
+MODULE_PARM_DESC(sec, "Length in seconds of each speed test (modes 200+), "
+		 "0 to count cycles instead");
 
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("Quick & dirty crypto testing module");
@@ -6,7 +6,7 @@
  *	Robert Love	<rml@novell.com>
  *
  * Copyright (C) 2005 John McCutchan
- * Copyright (C) 2006-2008 Motorola, Inc.
+ * Copyright (C) 2006-2008, 2026 Motorola, Inc.
  *
  * This program is free software; you can redistribute it and/or modify it
  * under the terms of the GNU General Public License as published by the
@@ -29,6 +29,12 @@
  * 23-Oct-2007  Motorola        Add spinlock protection for inode 
  * 19-Dec-2007  Motorola        Adding inode checking during umounting
  * 25-Jun-2008  Motorola        Make sure the freed wd is not used immediately
+ * 17-Oct-2026  Motorola        Queue events in a preallocated per-device ring,
+ *                              coalesce pending events, batch wakeups and reads
+ * 17-Oct-2026  Motorola        Bound the queue by event count, coalesce only
+ *                              with the newest event
+ * 17-Oct-2026  Motorola        Size the ring for the average event, overflow
+ *                              on bytes or count
  */
 
 #include <linux/module.h>
@@ -44,20 +50,44 @@
 #include <linux/miscdevice.h>
 #include <linux/init.h>
 #include <linux/list.h>
+#include <linux/vmalloc.h>
 #include <linux/writeback.h>
 #include <linux/inotify.h>
 
 #include <asm/ioctls.h>
+#include <asm/semaphore.h>
 
 static atomic_t inotify_cookie;
+static atomic_t inotify_events_dropped;
+static atomic_t inotify_events_coalesced;
 static kmem_cache_t *watch_cachep;
-static kmem_cache_t *event_cachep;
 static kmem_cache_t *inode_data_cachep;
 
 static int sysfs_attrib_max_user_devices;
 static int sysfs_attrib_max_user_watches;
 static unsigned int sysfs_attrib_max_queued_events;
 
+/* the largest single event: the header plus a padded NAME_MAX name */
+#define INOTIFY_EVENT_MAX_BYTES	\
+		(sizeof(struct inotify_event) + NAME_MAX + 1)
+
+/* a typical event: the header plus a name of up to 31 characters */
+#define INOTIFY_EVENT_AVG_BYTES	\
+		(sizeof(struct inotify_event) + 32)
+
+/*
+ * Queued events live back to back in a per-device ring, in exactly the layout
+ * read() hands to user space, so queueing an event never allocates and read()
+ * copies whole runs of events at once.  The ring holds max_events events of
+ * average length, plus the space one long event can lose at a wrap and the
+ * Q_OVERFLOW event.  The queue overflows when it runs out of either events or
+ * bytes, whichever comes first, so a device that only sees short names pays
+ * for short names.
+ */
+#define INOTIFY_RING_BYTES(max_events)	\
+		((max_events) * INOTIFY_EVENT_AVG_BYTES + \
+		 INOTIFY_EVENT_MAX_BYTES + 2 * sizeof(struct inotify_event))
+
 /*
  * struct inotify_device - represents an open instance of an inotify device
  *
@@ -83,9 +113,16 @@ static unsigned int sysfs_attrib_max_queued_events;
 struct inotify_device {
 	wait_queue_head_t 	wait;
 	struct idr		idr;
-	struct list_head 	events;
 	struct list_head 	watches;
 	spinlock_t		lock;
+	struct semaphore	read_sem;	/* serializes readers */
+	char			*ring;		/* queued events */
+	unsigned int		ring_size;
+	unsigned int		ring_head;	/* offset of the oldest event */
+	unsigned int		ring_tail;	/* offset of the first free byte */
+	unsigned int		ring_wrap;	/* end of data before a wrap or 0 */
+	unsigned int		last_off;	/* offset of the newest event */
+	int			overflow;	/* IN_Q_OVERFLOW is queued */
 	unsigned int		queue_size;
 	unsigned int		event_count;
 	unsigned int		max_events;
@@ -102,16 +139,6 @@ struct inotify_watch {
 	struct list_head	i_list; /* entry in inotify_data's list */
 };
 
-/*
- * A list of these is attached to each instance of the driver.  In read(), this
- * this list is walked and all events that can fit in the buffer are returned.
- */
-struct inotify_kernel_event {
-	struct inotify_event	event;
-	struct list_head        list;
-	char			*filename;
-};
-
 static ssize_t show_max_queued_events(struct class_device *class, char *buf)
 {
 	return sprintf(buf, "%d\n", sysfs_attrib_max_queued_events);
@@ -163,8 +190,21 @@ static ssize_t store_max_user_watches(struct class_device *class,
 	return -EINVAL;
 }
 
+static ssize_t show_dropped_events(struct class_device *class, char *buf)
+{
+	return sprintf(buf, "%d\n", atomic_read(&inotify_events_dropped));
+}
+
+static ssize_t show_coalesced_events(struct class_device *class, char *buf)
+{
+	return sprintf(buf, "%d\n", atomic_read(&inotify_events_coalesced));
+}
+
 static CLASS_DEVICE_ATTR(max_queued_events, S_IRUGO | S_IWUSR,
 	show_max_queued_events, store_max_queued_events);
+static CLASS_DEVICE_ATTR(dropped_events, S_IRUGO, show_dropped_events, NULL);
+static CLASS_DEVICE_ATTR(coalesced_events, S_IRUGO, show_coalesced_events,
+	NULL);
 static CLASS_DEVICE_ATTR(max_user_devices, S_IRUGO | S_IWUSR,
 	show_max_user_devices, store_max_user_devices);
 static CLASS_DEVICE_ATTR(max_user_watches, S_IRUGO | S_IWUSR,
@@ -223,64 +263,69 @@ static int find_inode(const char __user *dirname, struct nameidata *nd)
 	return permission(nd->dentry->d_inode, MAY_READ, NULL);
 }
 
-static struct inotify_kernel_event * kernel_event(s32 wd, u32 mask, u32 cookie,
-						  const char *filename)
+/*
+ * inotify_name_len - the padded length of 'len' bytes of filename
+ *
+ * We need to pad the filename so as to properly align an array of
+ * inotify_event structures.  Because the structure is small and the common
+ * case is a small filename, we just round up to the next multiple of the
+ * structure's sizeof.  This is simple and safe for all architectures.
+ */
+static inline size_t inotify_name_len(size_t len)
 {
-	struct inotify_kernel_event *kevent;
+	size_t event_size = sizeof(struct inotify_event);
 
-	kevent = kmem_cache_alloc(event_cachep, GFP_ATOMIC);
-	if (!kevent)
-		return NULL;
-
-	/* we hand this out to user-space, so zero it just in case */
-	memset(&kevent->event, 0, sizeof(struct inotify_event));
-
-	kevent->event.wd = wd;
-	kevent->event.mask = mask;
-	kevent->event.cookie = cookie;
-	INIT_LIST_HEAD(&kevent->list);
+	return (len + 1 + event_size - 1) / event_size * event_size;
+}
 
-	if (filename) {
-		size_t len, rem, event_size = sizeof(struct inotify_event);
+static inline struct inotify_event *inotify_ring_event(struct inotify_device *dev,
+						       unsigned int off)
+{
+	return (struct inotify_event *) (dev->ring + off);
+}
 
-		/*
-		 * We need to pad the filename so as to properly align an
-		 * array of inotify_event structures.  Because the structure is
-		 * small and the common case is a small filename, we just round
-		 * up to the next multiple of the structure's sizeof.  This is
-		 * simple and safe for all architectures.
-		 */
-		len = strlen(filename) + 1;
-		rem = event_size - len;
-		if (len > event_size) {
-			rem = event_size - (len % event_size);
-			if (len % event_size == 0)
-				rem = 0;
-		}
-		len += rem;
+/*
+ * inotify_event_is - does the queued event 'ev' refer to (wd, filename)?
+ */
+static inline int inotify_event_is(struct inotify_event *ev, s32 wd,
+				   const char *filename)
+{
+	if (ev->wd != wd)
+		return 0;
+	if (!filename)
+		return !ev->len;
+	return ev->len && !strcmp(ev->name, filename);
+}
 
-		kevent->filename = kmalloc(len, GFP_ATOMIC);
-		if (!kevent->filename) {
-			kmem_cache_free(event_cachep, kevent);
-			return NULL;
-		}
-		memset(kevent->filename, 0, len);
-		strncpy(kevent->filename, filename, strlen(filename));
-		kevent->event.len = len;
-	} else {
-		kevent->event.len = 0;
-		kevent->filename = NULL;
+/*
+ * inotify_ring_alloc - claim 'len' bytes at the tail of the ring, provided
+ * 'need' contiguous bytes are free there.  Returns the offset, or -1 if the
+ * ring is full.
+ *
+ * Events never straddle the end of the ring: when one does not fit, the tail
+ * wraps to the start and ring_wrap remembers where the older data ends.
+ *
+ * Caller must hold dev->lock.
+ */
+static int inotify_ring_alloc(struct inotify_device *dev, unsigned int len,
+			      unsigned int need)
+{
+	unsigned int off = dev->ring_tail;
+
+	if (dev->ring_wrap) {
+		if (off + need > dev->ring_head)
+			return -1;
+	} else if (off + need > dev->ring_size) {
+		if (need > dev->ring_head)
+			return -1;
+		dev->ring_wrap = off;
+		off = 0;
 	}
 
-	return kevent;
+	dev->ring_tail = off + len;
+	return off;
 }
 
-#define list_to_inotify_kernel_event(pos)	\
-		list_entry((pos), struct inotify_kernel_event, list)
-
-#define inotify_dev_get_event(dev)		\
-		(list_to_inotify_kernel_event(dev->events.next))
-
 /*
  * inotify_dev_queue_event - add a new event to the given device
  *
@@ -290,49 +335,77 @@ static void inotify_dev_queue_event(struct inotify_device *dev,
 				    struct inotify_watch *watch, u32 mask,
 				    u32 cookie, const char *filename)
 {
-	struct inotify_kernel_event *kevent, *last;
-
-	/* drop this event if it is a dupe of the previous */
-	last = inotify_dev_get_event(dev);
-	if (dev->event_count && last->event.mask == mask &&
-			last->event.wd == watch->wd) {
-		const char *lastname = last->filename;
-
-		if (!filename && !lastname)
-			return;
-		if (filename && lastname && !strcmp(lastname, filename))
-			return;
-	}
+	struct inotify_event *ev;
+	size_t len;
+	s32 wd = watch->wd;
+	int off;
 
 	/*
 	 * the queue has already overflowed and we have already sent the
 	 * Q_OVERFLOW event
 	 */
-	if (dev->event_count > dev->max_events)
+	if (dev->overflow) {
+		atomic_inc(&inotify_events_dropped);
 		return;
+	}
+
+	/*
+	 * drop this event if it is a dupe of the newest queued one; folding
+	 * into anything older would reorder it against what came between
+	 */
+	if (dev->event_count) {
+		ev = inotify_ring_event(dev, dev->last_off);
+		if (ev->mask == mask && inotify_event_is(ev, wd, filename)) {
+			atomic_inc(&inotify_events_coalesced);
+			return;
+		}
+	}
+
+	/* always leave room for the Q_OVERFLOW event behind this one */
+	len = sizeof(struct inotify_event);
+	if (filename)
+		len += inotify_name_len(strlen(filename));
+	off = -1;
+	if (dev->event_count < dev->max_events)
+		off = inotify_ring_alloc(dev, len,
+					 len + sizeof(struct inotify_event));
 
 	/* the queue has just overflowed and we need to notify user space */
-	if (dev->event_count == dev->max_events) {
-		kevent = kernel_event(-1, IN_Q_OVERFLOW, cookie, NULL);
-		goto add_event_to_queue;
+	if (off < 0) {
+		atomic_inc(&inotify_events_dropped);
+		dev->overflow = 1;
+		wd = -1;
+		mask = IN_Q_OVERFLOW;
+		filename = NULL;
+		len = sizeof(struct inotify_event);
+		off = inotify_ring_alloc(dev, len, len);
 	}
 
-	kevent = kernel_event(watch->wd, mask, cookie, filename);
+	/* we hand this out to user-space, so zero the name padding */
+	ev = inotify_ring_event(dev, off);
+	ev->wd = wd;
+	ev->mask = mask;
+	ev->cookie = cookie;
+	ev->len = len - sizeof(struct inotify_event);
+	if (filename) {
+		memset(ev->name, 0, ev->len);
+		strcpy(ev->name, filename);
+	}
 
-add_event_to_queue:
-	if (!kevent)
-		return;
+	dev->last_off = off;
+	dev->queue_size += len;
 
-	/* queue the event and wake up anyone waiting */
-	dev->event_count++;
-	dev->queue_size += sizeof(struct inotify_event) + kevent->event.len;
-	list_add_tail(&kevent->list, &dev->events);
-	wake_up_interruptible(&dev->wait);
+	/*
+	 * Readers only sleep on an empty queue and poll() reports POLLIN until
+	 * the queue drains, so only the first event needs to wake anyone up.
+	 */
+	if (!dev->event_count++)
+		wake_up_interruptible(&dev->wait);
 }
 
 static inline int inotify_dev_has_events(struct inotify_device *dev)
 {
-	return !list_empty(&dev->events);
+	return dev->event_count != 0;
 }
 
 /*
@@ -342,20 +415,25 @@ static inline int inotify_dev_has_events(struct inotify_device *dev)
  */
 static void inotify_dev_event_dequeue(struct inotify_device *dev)
 {
-	struct inotify_kernel_event *kevent;
+	struct inotify_event *ev;
+	unsigned int len;
 
 	if (!inotify_dev_has_events(dev))
 		return;
 
-	kevent = inotify_dev_get_event(dev);
-	list_del_init(&kevent->list);
-	if (kevent->filename)
-		kfree(kevent->filename);
+	ev = inotify_ring_event(dev, dev->ring_head);
+	len = sizeof(struct inotify_event) + ev->len;
+	if (ev->mask == IN_Q_OVERFLOW)
+		dev->overflow = 0;
 
 	dev->event_count--;
-	dev->queue_size -= sizeof(struct inotify_event) + kevent->event.len;	
+	dev->queue_size -= len;
 
-	kmem_cache_free(event_cachep, kevent);
+	dev->ring_head += len;
+	if (!dev->event_count)
+		dev->ring_head = dev->ring_tail = dev->ring_wrap = 0;
+	else if (dev->ring_head == dev->ring_wrap)
+		dev->ring_head = dev->ring_wrap = 0;
 }
 
 /*
@@ -780,6 +858,7 @@ static ssize_t inotify_read(struct file *file, char __user *buf,
 	size_t event_size;
 	struct inotify_device *dev;
 	char __user *start;
+	ssize_t ret = 0;
 	DECLARE_WAITQUEUE(wait, current);
 
 	start = buf;
@@ -790,73 +869,99 @@ static ssize_t inotify_read(struct file *file, char __user *buf,
 	if (count < event_size)
 		return 0;
 
+	/* the ring is copied out without dev->lock, so one reader at a time */
+	if (file->f_flags & O_NONBLOCK) {
+		if (down_trylock(&dev->read_sem))
+			return -EAGAIN;
+	} else if (down_interruptible(&dev->read_sem))
+		return -ERESTARTSYS;
+
+	/*
+	 * Only the first event wakes us up, so get on the wait queue before
+	 * looking at the queue.
+	 */
+	add_wait_queue(&dev->wait, &wait);
 	while (1) {
 		int has_events;
 
+		set_current_state(TASK_INTERRUPTIBLE);
+
 		spin_lock(&dev->lock);
 		has_events = inotify_dev_has_events(dev);
 		spin_unlock(&dev->lock);
 		if (has_events)
 			break;
 
-		if (file->f_flags & O_NONBLOCK)
-			return -EAGAIN;
-
-		if (signal_pending(current))
-			return -EINTR;
+		if (file->f_flags & O_NONBLOCK) {
+			ret = -EAGAIN;
+			break;
+		}
 
-		add_wait_queue(&dev->wait, &wait);
-		set_current_state(TASK_INTERRUPTIBLE);
+		if (signal_pending(current)) {
+			ret = -EINTR;
+			break;
+		}
 
 		schedule();
-
-		set_current_state(TASK_RUNNING);		
-		remove_wait_queue(&dev->wait, &wait);
 	}
+	set_current_state(TASK_RUNNING);
+	remove_wait_queue(&dev->wait, &wait);
+	if (ret)
+		goto out;
 
 	while (count >= event_size) {
-		struct inotify_kernel_event *kevent;
+		struct inotify_event *ev;
+		unsigned int off, end, run = 0, nr = 0, len;
 
+		/*
+		 * Gather the run of events that are contiguous in the ring and
+		 * fit in the buffer.  Writers only ever append behind them, so
+		 * they can be copied out once the lock is dropped.
+		 */
 		spin_lock(&dev->lock);
 		if (!inotify_dev_has_events(dev)) {
 			spin_unlock(&dev->lock);
 			break;
 		}
-		kevent = inotify_dev_get_event(dev);
-		spin_unlock(&dev->lock);		
+		off = dev->ring_head;
+		end = dev->ring_wrap ? dev->ring_wrap : dev->ring_tail;
+		while (off + run < end) {
+			ev = inotify_ring_event(dev, off + run);
+			len = event_size + ev->len;
+			if (run + len > count)
+				break;
+			run += len;
+			nr++;
+		}
+		spin_unlock(&dev->lock);
 
 		/* We can't send this event, not enough space in the buffer */
-		if (event_size + kevent->event.len > count)
+		if (!nr)
 			break;
 
-		/* Copy the entire event except the string to user space */
-		if (copy_to_user(buf, &kevent->event, event_size)) 
-			return -EFAULT;
-
-		buf += event_size;
-		count -= event_size;
-
-		/* Copy the filename to user space */
-		if (kevent->filename) {
-			if (copy_to_user(buf, kevent->filename,
-					 kevent->event.len))
-				return -EFAULT;
-			buf += kevent->event.len;
-			count -= kevent->event.len;
+		if (copy_to_user(buf, dev->ring + off, run)) {
+			ret = -EFAULT;
+			goto out;
 		}
+		buf += run;
+		count -= run;
 
 		spin_lock(&dev->lock);
-		inotify_dev_event_dequeue(dev);
+		while (nr--)
+			inotify_dev_event_dequeue(dev);
 		spin_unlock(&dev->lock);
 	}
-
-	return buf - start;
+	ret = buf - start;
+out:
+	up(&dev->read_sem);
+	return ret;
 }
 
 static int inotify_open(struct inode *inode, struct file *file)
 {
 	struct inotify_device *dev;
 	struct user_struct *user;
+	unsigned int max_events;
 	int ret;
 
 	user = get_uid(current->user);
@@ -866,23 +971,43 @@ static int inotify_open(struct inode *inode, struct file *file)
 		goto out_err;
 	}
 
+	max_events = sysfs_attrib_max_queued_events;
+	if (max_events >= (INT_MAX - INOTIFY_EVENT_MAX_BYTES) / INOTIFY_EVENT_AVG_BYTES - 2) {
+		ret = -ENOMEM;
+		goto out_err;
+	}
+
 	dev = kmalloc(sizeof(struct inotify_device), GFP_KERNEL);
 	if (!dev) {
 		ret = -ENOMEM;
 		goto out_err;
 	}
 
+	/* the ring is sized for max_events average events up front */
+	dev->ring_size = INOTIFY_RING_BYTES(max_events);
+	dev->ring = vmalloc(dev->ring_size);
+	if (!dev->ring) {
+		kfree(dev);
+		ret = -ENOMEM;
+		goto out_err;
+	}
+
 	atomic_inc(&current->user->inotify_devs);	
 
 	idr_init(&dev->idr);
 
-	INIT_LIST_HEAD(&dev->events);
 	INIT_LIST_HEAD(&dev->watches);
 	init_waitqueue_head(&dev->wait);
+	init_MUTEX(&dev->read_sem);
 
+	dev->ring_head = 0;
+	dev->ring_tail = 0;
+	dev->ring_wrap = 0;
+	dev->last_off = 0;
+	dev->overflow = 0;
 	dev->event_count = 0;
 	dev->queue_size = 0;
-	dev->max_events = sysfs_attrib_max_queued_events;
+	dev->max_events = max_events;
 	dev->user = user;
 	dev->last_wd = 0;
 	spin_lock_init(&dev->lock);
@@ -931,6 +1056,7 @@ static int inotify_release(struct inode *inode, struct file *file)
 	atomic_dec(&dev->user->inotify_devs);
 	free_uid(dev->user);
 
+	vfree(dev->ring);
 	kfree(dev);
 
 	return 0;
@@ -1109,19 +1235,19 @@ static int __init inotify_init(void)
 
 	class = inotify_device.class;
 	class_device_create_file(class, &class_device_attr_max_queued_events);
+	class_device_create_file(class, &class_device_attr_dropped_events);
+	class_device_create_file(class, &class_device_attr_coalesced_events);
 	class_device_create_file(class, &class_device_attr_max_user_devices);
 	class_device_create_file(class, &class_device_attr_max_user_watches);
 
 	atomic_set(&inotify_cookie, 0);
+	atomic_set(&inotify_events_dropped, 0);
+	atomic_set(&inotify_events_coalesced, 0);
 
 	watch_cachep = kmem_cache_create("inotify_watch_cache",
 			sizeof(struct inotify_watch), 0, SLAB_PANIC,
 			NULL, NULL);
 
-	event_cachep = kmem_cache_create("inotify_event_cache",
-			sizeof(struct inotify_kernel_event), 0,
-			SLAB_PANIC, NULL, NULL);
-
 	inode_data_cachep = kmem_cache_create("inotify_inode_data_cache",
 			sizeof(struct inotify_inode_data), 0, SLAB_PANIC,
 			NULL, NULL);
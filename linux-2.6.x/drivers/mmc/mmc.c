@@ -33,6 +33,7 @@
  * 03/25/2008	Motorola		Support 4bit for SDA2.0 cards
  * 07/10/2008	Motorola		Modify one typo
  * 09/23/2008   Motorola        	Support shredding card
+ * 10/17/2026   Motorola        	Add mmc_start_req for pipelined block I/O
  */
 #include <linux/config.h>
 #include <linux/module.h>
@@ -149,11 +150,22 @@ static void mmc_wait_done(struct mmc_request *mrq)
 	complete(mrq->done_data);
 }
 
-int mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
+/**
+ *	mmc_start_req - start a request without waiting for it
+ *	@host: MMC host to start the request on
+ *	@mrq: MMC request to start
+ *	@complete: completion to signal when the request is done
+ *
+ *	Start a request and return at once, so the caller can prepare
+ *	more work while it is on the bus.  Returns MMC_ERR_NONE once the
+ *	request is started.  If the request is refused, the error is also
+ *	stored in the command and @complete is never signalled.
+ */
+int mmc_start_req(struct mmc_host *host, struct mmc_request *mrq,
+		  struct completion *complete)
 {
 	struct mmc_card *card = host->card_selected;
 	u32 opcode = mrq->cmd->opcode;
-	DECLARE_COMPLETION(complete);
 
 	if (card) {
 		if (mmc_card_locked(card)) {
@@ -162,16 +174,28 @@ int mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
 					|| opcode == SD_APP_OP_COND 
 					|| opcode == MMC_LOCK_UNLOCK) ) {
 				 mrq->cmd->error = MMC_ERR_TIMEOUT;
-				 return 0;
+				 return MMC_ERR_TIMEOUT;
 			}
 		}
 	}
 
-	mrq->done_data = &complete;
+	mrq->done_data = complete;
 	mrq->done = mmc_wait_done;
 
 	mmc_start_request(host, mrq);
 
+	return MMC_ERR_NONE;
+}
+
+EXPORT_SYMBOL(mmc_start_req);
+
+int mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	DECLARE_COMPLETION(complete);
+
+	if (mmc_start_req(host, mrq, &complete) != MMC_ERR_NONE)
+		return 0;
+
 	wait_for_completion(&complete); /*	if(!wait_for_completion_timeout(&complete, 200)){
 		mrq->cmd->error = MMC_ERR_TIMEOUT; 
 
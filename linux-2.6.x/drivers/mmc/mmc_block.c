@@ -43,6 +43,7 @@
  * 03/25/2008	Motorola		Add support 4bit for SDA2.0 cards
  * 06/16/2008   Motorola  		Avoid going to DSM if there is activity
  * 09/23/2008	Motorola		Support shredding card
+ * 10/17/2026	Motorola		Pipelined request issue, ACMD23 pre-erase, statistics
  */
 #include <linux/moduleparam.h>
 #include <linux/module.h>
@@ -57,6 +58,7 @@
 #include <linux/blkdev.h>
 #include <linux/devfs_fs_kernel.h>
 #include <linux/mpm.h>
+#include <linux/time.h>
 
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
@@ -70,6 +72,15 @@
 
 static int major = MMC_BLK_DEV_NUM;
 
+struct mmc_blk_request {
+	struct mmc_request	mrq;
+	struct mmc_command	cmd;
+	struct mmc_command	stop;
+	struct mmc_data		data;
+	struct completion	complete;
+	struct timespec		start;		/* monotonic clock */
+};
+
 /*
  * There is one mmc_blk_data per slot.
  */
@@ -82,6 +93,8 @@ struct mmc_blk_data {
 	unsigned int	block_bits;
 	unsigned int	suspended;
 	int changed;
+
+	struct mmc_blk_request brq[2];	/* one per queue issue slot */
 };
 
 static DECLARE_MUTEX(open_lock);
@@ -292,13 +305,6 @@ static struct block_device_operations mmc_bdops = {
 	.owner			= THIS_MODULE,
 };
 
-struct mmc_blk_request {
-	struct mmc_request	mrq;
-	struct mmc_command	cmd;
-	struct mmc_command	stop;
-	struct mmc_data		data;
-};
-
 static int mmc_blk_prep_rq(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_blk_data *md = mq->data;
@@ -329,166 +335,332 @@ static int mmc_blk_prep_rq(struct mmc_queue *mq, struct request *req)
 	return stat;
 }
 
-static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
+/*
+ * Build the MMC request for the block request of a queue slot, map its
+ * scatterlist and let the host map it for DMA.  This runs while the
+ * request of the other slot is on the bus.
+ */
+static void mmc_blk_prep_brq(struct mmc_blk_data *md,
+			     struct mmc_queue_req *mqrq)
 {
-	struct mmc_blk_data *md = mq->data;
+	struct mmc_blk_request *brq = mqrq->brq;
+	struct request *req = mqrq->req;
 	struct mmc_card *card = md->queue.card;
-	int ret;
-DBG(2, "mmc_blk_issue_rq. req nrsects is 0x%lx \n", req->nr_sectors);
-	if (mmc_card_claim_host(card))
-		goto cmd_err;
-
-	do {
-		struct mmc_blk_request brq;
-		struct mmc_command cmd;
+	struct mmc_host *host = card->host;
 
-		memset(&brq, 0, sizeof(struct mmc_blk_request));
-		brq.mrq.cmd = &brq.cmd;
-		brq.mrq.data = &brq.data;
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+	init_completion(&brq->complete);
 
 #ifdef CONFIG_MOT_FEAT_MMCSD_HCSD
-		if (mmc_card_hcsd(card)) {
-			brq.cmd.arg = req->sector;
-			brq.cmd.flags = MMC_RSP_R1;
-			brq.data.req = req;
-			brq.data.timeout_ns = card->csd.tacc_ns * 10;
-			brq.data.timeout_clks = card->csd.tacc_clks * 10;
-			brq.data.blksz_bits = 9;
-			brq.data.blocks = req->nr_sectors;
-		} else
+	if (mmc_card_hcsd(card)) {
+		brq->cmd.arg = req->sector;
+		brq->cmd.flags = MMC_RSP_R1;
+		brq->data.req = req;
+		brq->data.timeout_ns = card->csd.tacc_ns * 10;
+		brq->data.timeout_clks = card->csd.tacc_clks * 10;
+		brq->data.blksz_bits = 9;
+		brq->data.blocks = req->nr_sectors;
+	} else
 #endif
-		{
-			brq.cmd.arg = req->sector << 9;
-			brq.cmd.flags = MMC_RSP_R1;
-			brq.data.req = req;
-			brq.data.timeout_ns = card->csd.tacc_ns * 10;
-			brq.data.timeout_clks = card->csd.tacc_clks * 10;
-			brq.data.blksz_bits = md->block_bits;
-			brq.data.blocks = req->nr_sectors >> (md->block_bits - 9);
-		}
+	{
+		brq->cmd.arg = req->sector << 9;
+		brq->cmd.flags = MMC_RSP_R1;
+		brq->data.req = req;
+		brq->data.timeout_ns = card->csd.tacc_ns * 10;
+		brq->data.timeout_clks = card->csd.tacc_clks * 10;
+		brq->data.blksz_bits = md->block_bits;
+		brq->data.blocks = req->nr_sectors >> (md->block_bits - 9);
+	}
 
-		brq.stop.opcode = MMC_STOP_TRANSMISSION;
-		brq.stop.arg = 0;
-		brq.stop.flags = MMC_RSP_R1B;
-
-		if (rq_data_dir(req) == READ) {
-			brq.cmd.opcode = brq.data.blocks > 1 ? MMC_READ_MULTIPLE_BLOCK : MMC_READ_SINGLE_BLOCK;
-			brq.data.flags |= MMC_DATA_READ;
-		} else {
-			brq.cmd.opcode = brq.data.blocks > 1 ? MMC_WRITE_MULTIPLE_BLOCK : MMC_WRITE_BLOCK;
-			brq.cmd.flags = MMC_RSP_R1B;
-			brq.data.flags |= MMC_DATA_WRITE;
-
-			/* sync the write data to all caches */
-			if (md->usage > 1)
-				md->changed = 1; 
-		}
-		brq.mrq.stop = brq.data.blocks > 1 ? &brq.stop : NULL;
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.arg = 0;
+	brq->stop.flags = MMC_RSP_R1B;
+
+	if (rq_data_dir(req) == READ) {
+		brq->cmd.opcode = brq->data.blocks > 1 ? MMC_READ_MULTIPLE_BLOCK : MMC_READ_SINGLE_BLOCK;
+		brq->data.flags |= MMC_DATA_READ;
+	} else {
+		brq->cmd.opcode = brq->data.blocks > 1 ? MMC_WRITE_MULTIPLE_BLOCK : MMC_WRITE_BLOCK;
+		brq->cmd.flags = MMC_RSP_R1B;
+		brq->data.flags |= MMC_DATA_WRITE;
+
+		/* sync the write data to all caches */
+		if (md->usage > 1)
+			md->changed = 1; 
+	}
+	brq->mrq.stop = brq->data.blocks > 1 ? &brq->stop : NULL;
 
-		brq.data.sg = mq->sg;
-		brq.data.sg_len = blk_rq_map_sg(req->q, req, brq.data.sg);
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = blk_rq_map_sg(req->q, req, brq->data.sg);
 
-		mmc_wait_for_req(card->host, &brq.mrq);
-		if (brq.cmd.error) {
-			printk(KERN_ERR "%s: error %d sending read/write command\n",
-			       req->rq_disk->disk_name, brq.cmd.error);
-			goto cmd_err;
-		}
+	if (host->ops->pre_req)
+		host->ops->pre_req(host, &brq->mrq);
+}
 
-		if (brq.data.error) {
-			printk(KERN_ERR "%s: error %d transferring data\n",
-			       req->rq_disk->disk_name, brq.data.error);
-			goto cmd_err;
-		}
+/*
+ * Put the request of a queue slot on the bus.  Large SD writes are
+ * announced with ACMD23 first so the card can pre-erase the blocks.
+ */
+static void mmc_blk_start_brq(struct mmc_blk_data *md,
+			      struct mmc_queue_req *mqrq)
+{
+	struct mmc_blk_request *brq = mqrq->brq;
+	struct mmc_card *card = md->queue.card;
 
-		if (brq.stop.error) {
-			printk(KERN_ERR "%s: error %d sending stop command\n",
-			       req->rq_disk->disk_name, brq.stop.error);
-			goto cmd_err;
-		}
+	if ((brq->data.flags & MMC_DATA_WRITE) && mmc_card_sd(card) &&
+	    card->pre_erase_sectors &&
+	    mqrq->req->nr_sectors >= card->pre_erase_sectors) {
+		struct mmc_command cmd;
 
-		do {
-			int err;
-
-			cmd.opcode = MMC_SEND_STATUS;
-			cmd.arg = card->rca << 16;
-			cmd.flags = MMC_RSP_R1;
-			err = mmc_wait_for_cmd(card->host, &cmd, 5);
-			if (err) {
-				printk(KERN_ERR "%s: error %d requesting status\n",
-				       req->rq_disk->disk_name, err);
-				goto cmd_err;
-			}
+		cmd.opcode = SD_APP_SET_WR_BLK_ERASE_COUNT;
+		cmd.arg = brq->data.blocks & 0x7fffff;
+		cmd.flags = MMC_RSP_R1;
+		if (mmc_wait_for_app_cmd(card->host, card->rca, &cmd, 0) ==
+		    MMC_ERR_NONE)
+			card->pre_erases++;
+	}
+
+	do_posix_clock_monotonic_gettime(&brq->start);
+	if (mmc_start_req(card->host, &brq->mrq, &brq->complete) !=
+	    MMC_ERR_NONE)
+		complete(&brq->complete);
+}
+
+/*
+ * Account a finished request in the card statistics.
+ */
+static void mmc_blk_account(struct mmc_card *card,
+			    struct mmc_blk_request *brq, int err)
+{
+	struct mmc_xfer_stats *st;
+	struct timespec now;
+	unsigned long usecs, ms;
+	int bucket;
+
+	st = &card->stats[(brq->data.flags & MMC_DATA_WRITE) ? 1 : 0];
+	if (err) {
+		st->errors++;
+		return;
+	}
+
+	do_posix_clock_monotonic_gettime(&now);
+	usecs = (now.tv_sec - brq->start.tv_sec) * USEC_PER_SEC +
+		(now.tv_nsec - brq->start.tv_nsec) / NSEC_PER_USEC;
+
+	bucket = 0;
+	for (ms = usecs / 1000; ms && bucket < MMC_LAT_BUCKETS - 1; ms >>= 1)
+		bucket++;
+
+	st->requests++;
+	st->bytes += brq->data.bytes_xfered;
+	st->usecs += usecs;
+	st->lat[bucket]++;
+}
+
+/*
+ * Wait for the request of a queue slot to complete and for the card to
+ * be ready for the next one.  Returns 0 if the transfer went fine.
+ */
+static int mmc_blk_finish_brq(struct mmc_blk_data *md,
+			      struct mmc_queue_req *mqrq)
+{
+	struct mmc_blk_request *brq = mqrq->brq;
+	struct request *req = mqrq->req;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_host *host = card->host;
+	struct mmc_command cmd;
+	int err = 1;
+
+	wait_for_completion(&brq->complete);
+
+	if (host->ops->post_req)
+		host->ops->post_req(host, &brq->mrq);
+
+	if (brq->cmd.error) {
+		printk(KERN_ERR "%s: error %d sending read/write command\n",
+		       req->rq_disk->disk_name, brq->cmd.error);
+		goto out;
+	}
+
+	if (brq->data.error) {
+		printk(KERN_ERR "%s: error %d transferring data\n",
+		       req->rq_disk->disk_name, brq->data.error);
+		goto out;
+	}
+
+	if (brq->stop.error) {
+		printk(KERN_ERR "%s: error %d sending stop command\n",
+		       req->rq_disk->disk_name, brq->stop.error);
+		goto out;
+	}
+
+	do {
+		int ret;
+
+		cmd.opcode = MMC_SEND_STATUS;
+		cmd.arg = card->rca << 16;
+		cmd.flags = MMC_RSP_R1;
+		ret = mmc_wait_for_cmd(host, &cmd, 5);
+		if (ret) {
+			printk(KERN_ERR "%s: error %d requesting status\n",
+			       req->rq_disk->disk_name, ret);
+			goto out;
+		}
 //#ifdef CONFIG_MMC_BLOCK_BROKEN_RFD
-			/* Work-around for broken cards setting READY_FOR_DATA
-			 * when not actually ready.
-			 */
-			/* some megasim cards have this issue,
-			 * enable this work-around.
-			 */
-			if (R1_CURRENT_STATE(cmd.resp[0]) == 7)
-				cmd.resp[0] &= ~R1_READY_FOR_DATA;
+		/* Work-around for broken cards setting READY_FOR_DATA
+		 * when not actually ready.
+		 */
+		/* some megasim cards have this issue,
+		 * enable this work-around.
+		 */
+		if (R1_CURRENT_STATE(cmd.resp[0]) == 7)
+			cmd.resp[0] &= ~R1_READY_FOR_DATA;
 //#endif
 
-                        /* in the drop test, the sdhc is in a bad status, 
-                         * that the status value bacome 0, so jump out */
-			if (cmd.resp[0] == 0)
-				goto cmd_err;
+                /* in the drop test, the sdhc is in a bad status, 
+                 * that the status value bacome 0, so jump out */
+		if (cmd.resp[0] == 0)
+			goto out;
 
-		} while (!(cmd.resp[0] & R1_READY_FOR_DATA));
+	} while (!(cmd.resp[0] & R1_READY_FOR_DATA));
 
 #if 0
-		if (cmd.resp[0] & ~0x00000900)
-			printk(KERN_ERR "%s: status = %08x\n",
-			       req->rq_disk->disk_name, cmd.resp[0]);
-		if (mmc_decode_status(cmd.resp))
-			goto cmd_err;
+	if (cmd.resp[0] & ~0x00000900)
+		printk(KERN_ERR "%s: status = %08x\n",
+		       req->rq_disk->disk_name, cmd.resp[0]);
+	if (mmc_decode_status(cmd.resp))
+		goto out;
 #endif
 
-		/*
-		 * A block was successfully transferred.
-		 */
-		spin_lock_irq(&md->lock);
-		ret = end_that_request_chunk(req, 1, brq.data.bytes_xfered);
-		if (!ret) {
-			/*
-			 * The whole request completed successfully.
-			 */
-			add_disk_randomness(req->rq_disk);
-			blkdev_dequeue_request(req);
-			end_that_request_last(req);
-		}
-		spin_unlock_irq(&md->lock);
+	/* A host that moved nothing would make us loop forever */
+	if (brq->data.bytes_xfered == 0)
+		goto out;
+
+	err = 0;
+ out:
+	mmc_blk_account(card, brq, err);
+	return err;
+}
+
+/*
+ * Complete a block request.  On success only the bytes the host moved
+ * are completed and the number of bytes still pending is returned; on
+ * failure the whole request is failed.
+ *
+ * This is a little draconian, but until we get proper error handling
+ * sorted out here, its the best we can do - especially as some hosts
+ * have no idea how much data was transferred before the error occurred.
+ */
+static int mmc_blk_end_rq(struct mmc_blk_data *md, struct request *req,
+			  unsigned int bytes, int uptodate)
+{
+	int ret;
+
+	spin_lock_irq(&md->lock);
+	if (uptodate) {
+		ret = end_that_request_chunk(req, 1, bytes);
+	} else {
+		do {
+			ret = end_that_request_chunk(req, 0,
+					req->current_nr_sectors << 9);
+		} while (ret);
+	}
+	if (!ret) {
+		add_disk_randomness(req->rq_disk);
+		end_that_request_last(req);
+	}
+	spin_unlock_irq(&md->lock);
 #ifdef CONFIG_MACH_PICO		
 //	mpm_handle_long_ioi();
 #endif
-	} while (ret);
 
-	mmc_card_release_host(card);
+	return ret;
+}
 
-	return 1;
+/*
+ * Double buffered issue.  The new request, if any, is prepared and
+ * DMA mapped while the previous one is still on the bus.  Once the
+ * previous one is done and the card is ready again the new one is
+ * started, and only then is the previous one completed towards the
+ * block layer.  Called with NULL to drain the request in flight.
+ */
+static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_queue_req *cur = mq->mqrq_cur;
+	struct mmc_queue_req *prev = mq->mqrq_prev;
+	struct mmc_blk_request *brq = prev->brq;
+	int err = 0;
 
- cmd_err:
-	mmc_card_release_host(card);
+	if (req) {
+		DBG(2, "mmc_blk_issue_rq. req nrsects is 0x%lx \n", req->nr_sectors);
+		spin_lock_irq(&md->lock);
+		blkdev_dequeue_request(req);
+		spin_unlock_irq(&md->lock);
 
-	/*
-	 * This is a little draconian, but until we get proper
-	 * error handling sorted out here, its the best we can
-	 * do - especially as some hosts have no idea how much
-	 * data was transferred before the error occurred.
-	 */
-	spin_lock_irq(&md->lock);
-	do {
-		ret = end_that_request_chunk(req, 0,
-				req->current_nr_sectors << 9);
-	} while (ret);
+		if (!prev->req && mmc_card_claim_host(card)) {
+			mmc_card_release_host(card);
+			mmc_blk_end_rq(md, req, 0, 0);
+			return 0;
+		}
 
-	add_disk_randomness(req->rq_disk);
-	blkdev_dequeue_request(req);
-	end_that_request_last(req);
-	spin_unlock_irq(&md->lock);
+		cur->req = req;
+		mmc_blk_prep_brq(md, cur);
+	}
 
-	return 0;
+	if (prev->req) {
+		err = mmc_blk_finish_brq(md, prev);
+
+		/*
+		 * The host moved only part of the request: finish the rest
+		 * before anything else goes on the bus.
+		 */
+		while (!err && brq->data.bytes_xfered <
+		       (prev->req->nr_sectors << 9)) {
+			mmc_blk_end_rq(md, prev->req, brq->data.bytes_xfered, 1);
+			mmc_blk_prep_brq(md, prev);
+			mmc_blk_start_brq(md, prev);
+			err = mmc_blk_finish_brq(md, prev);
+		}
+
+		/*
+		 * Give the card a fresh select after a failure, as a
+		 * release and claim did before requests were pipelined.
+		 */
+		if (err && req) {
+			mmc_card_release_host(card);
+			if (mmc_card_claim_host(card)) {
+				struct mmc_blk_request *cbrq = cur->brq;
+
+				if (card->host->ops->post_req)
+					card->host->ops->post_req(card->host,
+								  &cbrq->mrq);
+				mmc_blk_end_rq(md, req, 0, 0);
+				cur->req = NULL;
+				req = NULL;
+			}
+		}
+	}
+
+	if (req)
+		mmc_blk_start_brq(md, cur);
+
+	if (prev->req) {
+		mmc_blk_end_rq(md, prev->req, brq->data.bytes_xfered, !err);
+		prev->req = NULL;
+	}
+
+	mq->mqrq_cur = prev;
+	mq->mqrq_prev = cur;
+
+	/* Nothing left on the bus */
+	if (!cur->req)
+		mmc_card_release_host(card);
+
+	return !err;
 }
 
 #define MMC_NUM_MINORS	(256 >> MMC_SHIFT)
@@ -534,6 +706,8 @@ static struct mmc_blk_data *mmc_blk_alloc(struct mmc_card *card)
 		md->queue.prep_fn = mmc_blk_prep_rq;
 		md->queue.issue_fn = mmc_blk_issue_rq;
 		md->queue.data = md;
+		md->queue.mqrq[0].brq = &md->brq[0];
+		md->queue.mqrq[1].brq = &md->brq[1];
 
 		md->disk->major	= major;
 		md->disk->first_minor = devidx << MMC_SHIFT;
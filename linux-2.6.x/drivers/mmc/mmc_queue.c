@@ -13,6 +13,7 @@
  * 03/08/2007	Motorola		Turn off sdhc clock when card isn't used.
  * 07/04/2007	Motorola		Modify the sdhc clock control.
  * 09/05/2007	Motorola		Fix mmcqd thread not wakeup bug.
+ * 10/17/2026	Motorola		Double buffered request issue.
  */
 #include <linux/module.h>
 #include <linux/blkdev.h>
@@ -83,14 +84,18 @@ static int mmc_queue_thread(void *d)
 	do {
 		struct request *req = NULL;
 		
-		mq->req = NULL;
 		spin_lock_irq(q->queue_lock);
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (!blk_queue_plugged(q))
-			mq->req = req = elv_next_request(q);
+			req = elv_next_request(q);
+		/*
+		 * Stay awake while a request is still in flight, the
+		 * issue function completes it when no new one comes.
+		 */
+		mq->req = req ? req : mq->mqrq_prev->req;
 		spin_unlock_irq(q->queue_lock);
 
-		if (!req) {
+		if (!mq->req) {
 			if (mq->flags & MMC_QUEUE_EXIT)
 				break;
 			up(&mq->thread_sem);
@@ -137,7 +142,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 {
 	struct mmc_host *host = card->host;
 	u64 limit = BLK_BOUNCE_HIGH;
-	int ret;
+	int ret, i;
 
 	if (host->dev->dma_mask && *host->dev->dma_mask)
 		limit = *host->dev->dma_mask;
@@ -158,11 +163,16 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 	mq->queue->queuedata = mq;
 	mq->req = NULL;
 
-	mq->sg = kmalloc(sizeof(struct scatterlist) * host->max_phys_segs,
-			 GFP_KERNEL);
-	if (!mq->sg) {
-		ret = -ENOMEM;
-		goto cleanup;
+	memset(mq->mqrq, 0, sizeof(mq->mqrq));
+	mq->mqrq_cur = &mq->mqrq[0];
+	mq->mqrq_prev = &mq->mqrq[1];
+	for (i = 0; i < 2; i++) {
+		mq->mqrq[i].sg = kmalloc(sizeof(struct scatterlist) *
+					 host->max_phys_segs, GFP_KERNEL);
+		if (!mq->mqrq[i].sg) {
+			ret = -ENOMEM;
+			goto cleanup;
+		}
 	}
 
 	init_completion(&mq->thread_complete);
@@ -178,8 +188,10 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 	}
 
  cleanup:
-	kfree(mq->sg);
-	mq->sg = NULL;
+	for (i = 0; i < 2; i++) {
+		kfree(mq->mqrq[i].sg);
+		mq->mqrq[i].sg = NULL;
+	}
 
 	blk_cleanup_queue(mq->queue);
  out:
@@ -193,8 +205,10 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	wake_up(&mq->thread_wq);
 	wait_for_completion(&mq->thread_complete);
 
-	kfree(mq->sg);
-	mq->sg = NULL;
+	kfree(mq->mqrq[0].sg);
+	mq->mqrq[0].sg = NULL;
+	kfree(mq->mqrq[1].sg);
+	mq->mqrq[1].sg = NULL;
 
 	blk_cleanup_queue(mq->queue);
 
@@ -4,6 +4,16 @@
 struct request;
 struct task_struct;
 
+/*
+ * One issue slot.  The queue owns two: while the request of one slot is
+ * on the bus, the next request is prepared in the other.
+ */
+struct mmc_queue_req {
+	struct request		*req;		/* NULL when the slot is free */
+	struct scatterlist	*sg;
+	void			*brq;		/* media driver request state */
+};
+
 struct mmc_queue {
 	struct mmc_card		*card;
 	struct completion	thread_complete;
@@ -12,10 +22,16 @@ struct mmc_queue {
 	unsigned int		flags;
 	struct request		*req;
 	int			(*prep_fn)(struct mmc_queue *, struct request *);
+	/*
+	 * Called with the next request, which it must dequeue, or with
+	 * NULL to complete the request still in flight.
+	 */
 	int			(*issue_fn)(struct mmc_queue *, struct request *);
 	void			*data;
 	struct request_queue	*queue;
-	struct scatterlist	*sg;
+	struct mmc_queue_req	mqrq[2];
+	struct mmc_queue_req	*mqrq_cur;	/* slot for the next request */
+	struct mmc_queue_req	*mqrq_prev;	/* slot in flight */
 };
 
 struct mmc_io_request {
@@ -18,6 +18,7 @@
  * 2008-02-15   Motorola                redesign repair fat calback, run once when many fat panic
  * 2008-02-16   Motorola                Tracing FAT panic
  * 2008-06-25	Motorola		Fix 4bit issue
+ * 2026-10-17	Motorola		Add card transfer statistics and pre_erase_sectors
  */
 #include <linux/module.h>
 #include <linux/init.h>
@@ -33,6 +34,7 @@
 #include <linux/kernel.h>
 #include <linux/proc_fs.h>
 #include <asm/uaccess.h>
+#include <asm/div64.h>
 
 #include <linux/jiffies.h>
 #include <linux/poll.h>
@@ -200,6 +202,90 @@ MMC_ATTR(name, "%s\n", card->cid.prod_name);
 MMC_ATTR(oemid, "0x%04x\n", card->cid.oemid);
 MMC_ATTR(serial, "0x%08x\n", card->cid.serial);
 
+/*
+ * Transfer statistics kept by the block driver.  Writing anything
+ * clears them.
+ */
+static ssize_t mmc_dev_show_stats(struct device *dev, char *buf)
+{
+	static const char *dir_name[2] = { "read", "write" };
+	struct mmc_card *card = dev_to_mmc_card(dev);
+	struct mmc_xfer_stats *st;
+	unsigned long long kb, rate, usecs;
+	char *p = buf;
+	int dir, i;
+
+	p += sprintf(p, "dir    requests   errors         KB    KB/s  "
+		     "<1 <2 <4 <8 <16 <32 <64 <128 <256 >=256 ms\n");
+
+	for (dir = 0; dir < 2; dir++) {
+		st = &card->stats[dir];
+
+		/*
+		 * KB/s over the time requests were outstanding.  do_div()
+		 * takes a 32 bit divisor, so scale both down if needed.
+		 */
+		kb = st->bytes >> 10;
+		rate = kb * 1000000;
+		usecs = st->usecs;
+		while (usecs > 0xffffffffULL) {
+			usecs >>= 1;
+			rate >>= 1;
+		}
+		if (usecs != 0)
+			do_div(rate, (unsigned long)usecs);
+		else
+			rate = 0;
+
+		p += sprintf(p, "%-5s %9lu %8lu %10llu %7llu ", dir_name[dir],
+			     st->requests, st->errors, kb, rate);
+		for (i = 0; i < MMC_LAT_BUCKETS; i++)
+			p += sprintf(p, " %lu", st->lat[i]);
+		p += sprintf(p, "\n");
+	}
+	p += sprintf(p, "pre-erase %lu\n", card->pre_erases);
+
+	return p - buf;
+}
+
+static ssize_t mmc_dev_store_stats(struct device *dev, const char *buf,
+				   size_t size)
+{
+	struct mmc_card *card = dev_to_mmc_card(dev);
+
+	memset(card->stats, 0, sizeof(card->stats));
+	card->pre_erases = 0;
+
+	return size;
+}
+
+static DEVICE_ATTR(stats, S_IRUGO | S_IWUSR, mmc_dev_show_stats,
+		   mmc_dev_store_stats);
+
+/*
+ * Smallest SD write, in sectors, that is announced to the card with
+ * ACMD23 first.  0 turns the pre-erase off.
+ */
+static ssize_t mmc_dev_show_pre_erase(struct device *dev, char *buf)
+{
+	struct mmc_card *card = dev_to_mmc_card(dev);
+
+	return sprintf(buf, "%u\n", card->pre_erase_sectors);
+}
+
+static ssize_t mmc_dev_store_pre_erase(struct device *dev, const char *buf,
+				       size_t size)
+{
+	struct mmc_card *card = dev_to_mmc_card(dev);
+
+	card->pre_erase_sectors = simple_strtoul(buf, NULL, 0);
+
+	return size;
+}
+
+static DEVICE_ATTR(pre_erase_sectors, S_IRUGO | S_IWUSR,
+		   mmc_dev_show_pre_erase, mmc_dev_store_pre_erase);
+
 static struct device_attribute *mmc_dev_attributes[] = {
 	&dev_attr_cid,
 	&dev_attr_csd,
@@ -211,6 +297,8 @@ static struct device_attribute *mmc_dev_attributes[] = {
 	&dev_attr_name,
 	&dev_attr_oemid,
 	&dev_attr_serial,
+	&dev_attr_stats,
+	&dev_attr_pre_erase_sectors,
 };
 
 /*
@@ -220,6 +308,7 @@ void mmc_init_card(struct mmc_card *card, struct mmc_host *host)
 {
 	memset(card, 0, sizeof(struct mmc_card));
 	card->host = host;
+	card->pre_erase_sectors = MMC_PRE_ERASE_SECTORS;
 	device_initialize(&card->dev);
 	card->dev.parent = card->host->dev;
 	card->dev.bus = &mmc_bus_type;
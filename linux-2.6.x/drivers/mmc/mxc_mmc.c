@@ -53,6 +53,8 @@
  * 04/28/2008   Motorola                Change sd clock rate back to 12Mhz from 16Hz for desense issue
  * 09/23/2008   Motorola                Add shredding support
  * 11/03/2008	Motorola		Modify start/stop clock loop jiff
+ * 10/17/2026   Motorola                Map scatterlists for SDMA in place, raise request size
+ * 10/17/2026   Motorola                Add pre_req/post_req for pipelined block I/O
  */
 
 
@@ -75,8 +77,11 @@
 #include <linux/power_ic_kernel.h>
 #include <linux/mpm.h>
 #include <linux/sched.h>
+#include <linux/proc_fs.h>
+#include <linux/time.h>
 
 #include <asm/dma.h>
+#include <asm/div64.h>
 #include <asm/io.h>
 #include <asm/irq.h>
 #include <asm/sizes.h>
@@ -104,10 +109,21 @@
  */
 
 /*!
- * Maxumum length of s/g list, only length of 1 is currently supported
+ * Maximum length of s/g list, each segment takes one SDMA buffer descriptor
 */
 #define NR_SG   128
 
+/*!
+ * Largest byte count carried by one SDMA buffer descriptor. The descriptor
+ * count field is 16 bits wide, so keep it a block multiple below 64K.
+ */
+#define MXC_MMC_BD_LEN		0x8000
+
+/*!
+ * Largest request handed to the SDHC, in 512 byte sectors
+ */
+#define MXC_MMC_MAX_SECTORS	256
+
 #define MXC_MMC_DMA_ENABLE
 
 static unsigned int card_selected[2] = {0,0};
@@ -208,6 +224,17 @@ static void dump_status(const char *func, int sts)
 
 #endif
 
+/*!
+ * Data transfer statistics of one direction, reported in /proc/driver/mxcmci
+ */
+struct mxcmci_xfer_stats {
+	unsigned long direct;		/*!< transfers mapped in place */
+	unsigned long bounce;		/*!< transfers copied through dma_buffer */
+	unsigned long errors;		/*!< transfers that failed */
+	unsigned long long bytes;	/*!< bytes moved by good transfers */
+	unsigned long long usecs;	/*!< time spent in good transfers */
+};
+
 /*!
  * This structure is a way for the low level driver to define their own
  * \b mmc_host structure. This structure includes the core \b mmc_host
@@ -308,7 +335,28 @@ struct mxcmci_host {
 	 * Length of the dma list
 	 */
 	unsigned int dma_len;
-	#define DMA_BUF_LEN 65536
+	#define DMA_BUF_LEN (MXC_MMC_MAX_SECTORS << 9)
+
+	/*!
+	 * Number of SDMA buffer descriptors used by the current transfer
+	 */
+	unsigned int dma_nbd;
+
+	/*!
+	 * Set when the current transfer is copied through \b dma_buffer
+	 * instead of being mapped in place
+	 */
+	unsigned int dma_bounce;
+
+	/*!
+	 * Time the current data transfer was set up, monotonic clock
+	 */
+	struct timespec xfer_start;
+
+	/*!
+	 * Transfer statistics, index 0 for reads and 1 for writes
+	 */
+	struct mxcmci_xfer_stats stats[2];
 
 	/*!
 	 * Holds the direction of data transfer.
@@ -360,6 +408,13 @@ struct mxcmci_host {
 	int sdhc_err;
 };
 
+#ifdef MXC_MMC_DMA_ENABLE
+/*!
+ * Probed hosts, indexed by SDHC module id, for /proc/driver/mxcmci
+ */
+static struct mxcmci_host *mxcmci_hosts[2];
+#endif
+
 #ifdef CONFIG_MMC_DEBUG
 static void dump_sdhc(struct mxcmci_host *host)
 {
@@ -594,6 +649,138 @@ static inline void mxcmci_dma_to_sg(struct mxcmci_host* host, struct mmc_data* d
         host->dma_size -= size;
 }
 
+#ifdef MXC_MMC_DMA_ENABLE
+/*!
+ * Check whether the scatterlist of \b data can be given to the SDMA in
+ * place. Each segment takes one buffer descriptor, so it has to be word
+ * aligned and fit in a descriptor. Reads also need whole cache lines:
+ * mapping for DMA_FROM_DEVICE invalidates every line the segment touches.
+ *
+ * @param data  Pointer to MMC/SD data structure
+ *
+ * @return number of segments to map, 0 if the transfer has to bounce
+ */
+static int mxcmci_sg_direct(struct mmc_data *data)
+{
+#ifdef CONFIG_MOT_FEAT_MMC_SG_DMA
+	struct scatterlist *sg = data->sg;
+	unsigned int size = data->blocks << data->blksz_bits;
+	unsigned int mask = 3;
+	int i;
+
+	if (data->flags & MMC_DATA_READ)
+		mask = L1_CACHE_BYTES - 1;
+
+	for (i = 0; i < data->sg_len && size != 0; i++) {
+		if (i == NR_SG || sg[i].length > MXC_MMC_BD_LEN ||
+		    ((sg[i].offset | sg[i].length) & mask) ||
+		    PageHighMem(sg[i].page))
+			return 0;
+
+		size -= min(size, sg[i].length);
+	}
+
+	return size ? 0 : i;
+#else
+	return 0;
+#endif
+}
+
+/*!
+ * Account a finished data transfer in the host statistics. Called with
+ * the host lock held or from the SDHC interrupt.
+ *
+ * @param host  Pointer to MMC/SD host structure
+ * @param data  Pointer to MMC/SD data structure
+ */
+static void mxcmci_xfer_account(struct mxcmci_host *host,
+				struct mmc_data *data)
+{
+	struct mxcmci_xfer_stats *st;
+	struct timespec now;
+	long usecs;
+
+	st = &host->stats[(data->flags & MMC_DATA_WRITE) ? 1 : 0];
+	if (data->error != MMC_ERR_NONE) {
+		st->errors++;
+		return;
+	}
+
+	do_posix_clock_monotonic_gettime(&now);
+	usecs = (now.tv_sec - host->xfer_start.tv_sec) * USEC_PER_SEC +
+		(now.tv_nsec - host->xfer_start.tv_nsec) / NSEC_PER_USEC;
+
+	if (host->dma_bounce)
+		st->bounce++;
+	else
+		st->direct++;
+	st->bytes += host->dma_size;
+	if (usecs > 0)
+		st->usecs += usecs;
+}
+
+/*!
+ * Read function for /proc/driver/mxcmci. For each host and direction it
+ * reports how many transfers were mapped in place and how many were copied
+ * through the bounce buffer, and the data rate seen by the requests.
+ */
+static int mxcmci_proc_read(char *page, char **start, off_t off, int count,
+			    int *eof, void *data)
+{
+	static const char *dir_name[2] = { "read", "write" };
+	struct mxcmci_xfer_stats st;
+	unsigned long long kb, rate, usecs;
+	unsigned long xfers, flags;
+	unsigned int tenths;
+	char *p = page;
+	int id, dir;
+
+	p += sprintf(p, "host dir     direct   bounce  errors direct%%"
+		     "         KB    MB/s\n");
+
+	for (id = 0; id < 2; id++) {
+		struct mxcmci_host *host = mxcmci_hosts[id];
+
+		if (host == NULL)
+			continue;
+
+		for (dir = 0; dir < 2; dir++) {
+			spin_lock_irqsave(&host->lock, flags);
+			st = host->stats[dir];
+			spin_unlock_irqrestore(&host->lock, flags);
+
+			xfers = st.direct + st.bounce;
+			kb = st.bytes >> 10;
+
+			/*
+			 * Bytes per microsecond is MB/s, keep one decimal.
+			 * do_div() takes a 32 bit divisor, scale both down.
+			 */
+			rate = st.bytes * 10;
+			usecs = st.usecs;
+			while (usecs > 0xffffffffULL) {
+				usecs >>= 1;
+				rate >>= 1;
+			}
+			if (usecs != 0)
+				do_div(rate, (unsigned long)usecs);
+			else
+				rate = 0;
+			tenths = do_div(rate, 10);
+
+			p += sprintf(p, "%4d %-5s %8lu %8lu %7lu %6lu%% %10llu %5llu.%u\n",
+				     id, dir_name[dir], st.direct, st.bounce,
+				     st.errors,
+				     xfers ? st.direct * 100 / xfers : 0,
+				     kb, rate, tenths);
+		}
+	}
+
+	*eof = 1;
+	return p - page;
+}
+#endif
+
 /*
  * This function init the MMC/SD power supply
  */
@@ -750,6 +937,9 @@ static void mxcmci_setup_data(struct mxcmci_host *host, struct mmc_data *data)
 #ifdef MXC_MMC_DMA_ENABLE
 	dma_request_t sdma_request;
 	dma_channel_params params;
+	dma_addr_t addr = 0;
+	unsigned int size, len;
+	int i, nsg;
 #endif
 	if (data->flags & MMC_DATA_STREAM) {
 		nob = 0xffff;
@@ -765,19 +955,35 @@ static void mxcmci_setup_data(struct mxcmci_host *host, struct mmc_data *data)
 #ifdef MXC_MMC_DMA_ENABLE
 	if (data->flags & MMC_DATA_READ) {
 		host->dma_dir = DMA_FROM_DEVICE;
+		params.transfer_type = per_2_emi;
 	} else {
-		mxcmci_sg_to_dma(host, data);
 		host->dma_dir = DMA_TO_DEVICE;
+		params.transfer_type = emi_2_per;
 	}
-	host->dma_addr = dma_map_single(mmc_dev(host->mmc), host->dma_buffer, 
-				host->dma_len, host->dma_dir);
-	
-	if (data->flags & MMC_DATA_READ) {
-		sdma_request.destAddr = (__u8 *)host->dma_addr;
-		params.transfer_type = per_2_emi;
+
+	/*
+	 * Map the request pages in place when every segment suits the SDMA,
+	 * otherwise copy through dma_buffer.
+	 */
+	nsg = data->host_cookie;
+	if (nsg == 0) {
+		nsg = mxcmci_sg_direct(data);
+		if (nsg)
+			dma_map_sg(mmc_dev(host->mmc), data->sg, nsg,
+				   host->dma_dir);
+	}
+	if (nsg) {
+		host->dma_bounce = 0;
+		host->dma_nbd = nsg;
 	} else {
-		sdma_request.sourceAddr = (__u8 *)host->dma_addr;
-		params.transfer_type = emi_2_per;
+		if (data->flags & MMC_DATA_WRITE)
+			mxcmci_sg_to_dma(host, data);
+		host->dma_addr = dma_map_single(mmc_dev(host->mmc),
+				host->dma_buffer, host->dma_size, host->dma_dir);
+		addr = host->dma_addr;
+		host->dma_bounce = 1;
+		host->dma_nbd = (host->dma_size + MXC_MMC_BD_LEN - 1) /
+				MXC_MMC_BD_LEN;
 	}
 
 	/*
@@ -788,14 +994,42 @@ static void mxcmci_setup_data(struct mxcmci_host *host, struct mmc_data *data)
 	params.peripheral_type = MMC;
 	params.per_address = host->res->start + MMC_BUFFER_ACCESS;
 	params.event_id = host->event_id;
-	params.bd_number = 1 /* host->dma_size / 256 */ ;
+	params.bd_number = host->dma_nbd;
 	params.word_size = TRANSFER_32BIT;
 	params.callback = mxcmci_dma_irq;
 	params.arg = host;
 	mxc_dma_setup_channel(host->dma, &params);
 
-	sdma_request.count = data->blocks << data->blksz_bits;
-	mxc_dma_set_config(host->dma, &sdma_request, 0);
+	/*
+	 * Chain one buffer descriptor per mapped segment, or per
+	 * MXC_MMC_BD_LEN bytes of the bounce buffer. The last one
+	 * ends the chain.
+	 */
+	size = host->dma_size;
+	for (i = 0; i < host->dma_nbd; i++) {
+		if (nsg) {
+			addr = sg_dma_address(&data->sg[i]);
+			len = sg_dma_len(&data->sg[i]);
+		} else {
+			len = MXC_MMC_BD_LEN;
+		}
+		if (len > size)
+			len = size;
+
+		memset(&sdma_request, 0, sizeof(sdma_request));
+		if (data->flags & MMC_DATA_READ)
+			sdma_request.destAddr = (__u8 *)addr;
+		else
+			sdma_request.sourceAddr = (__u8 *)addr;
+		sdma_request.count = len;
+		sdma_request.bd_cont = (i < host->dma_nbd - 1);
+		mxc_dma_set_config(host->dma, &sdma_request, i);
+
+		addr += len;
+		size -= len;
+	}
+
+	do_posix_clock_monotonic_gettime(&host->xfer_start);
 
 	/* mxc_dma_start(host->dma); */
 #endif
@@ -1108,17 +1342,26 @@ static int mxcmci_data_done(struct mxcmci_host *host, unsigned int stat)
 		return 0;
 	}
 #ifdef MXC_MMC_DMA_ENABLE
-	dma_unmap_single(mmc_dev(host->mmc), host->dma_addr,
-                                host->dma_len, host->dma_dir);
+	if (host->dma_bounce) {
+		dma_unmap_single(mmc_dev(host->mmc), host->dma_addr,
+				 host->dma_size, host->dma_dir);
+	} else if (data->host_cookie == 0) {
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, host->dma_nbd,
+			     host->dma_dir);
+	}
 #endif
 	if (__raw_readl(host->base + MMC_STATUS) & STATUS_ERR_MASK) {
 		DBG(3,"%s: request failed. status: 0x%08x\n",
 		    DRIVER_NAME, __raw_readl(host->base + MMC_STATUS));
 	}
 
-	if(data->flags & MMC_DATA_READ)
+#ifdef MXC_MMC_DMA_ENABLE
+	if (host->dma_bounce && (data->flags & MMC_DATA_READ))
 		mxcmci_dma_to_sg(host, data);
 
+	mxcmci_xfer_account(host, data);
+#endif
+
 	host->data = NULL;
 	data->bytes_xfered = host->dma_size;
 
@@ -1546,9 +1789,61 @@ static void mxcmci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
  * MMC/SD host operations structure.
  * These functions are registered with MMC/SD Bus protocol driver.
  */
+#ifdef MXC_MMC_DMA_ENABLE
+/*!
+ * This function is called by the MMC/SD block driver to map the data of a
+ * request while the previous request is still on the bus. When the pages
+ * can be used in place, \b mxcmci_setup_data() then only has to program
+ * the buffer descriptors.
+ *
+ * @param  mmc  Pointer to MMC/SD host structure
+ * @param  req  Pointer to MMC/SD request structure
+ */
+static void mxcmci_pre_req(struct mmc_host *mmc, struct mmc_request *req)
+{
+	struct mmc_data *data = req->data;
+	int nsg;
+
+	if (!data)
+		return;
+
+	data->host_cookie = 0;
+	nsg = mxcmci_sg_direct(data);
+	if (nsg) {
+		dma_map_sg(mmc_dev(mmc), data->sg, nsg,
+			   (data->flags & MMC_DATA_READ) ?
+			   DMA_FROM_DEVICE : DMA_TO_DEVICE);
+		data->host_cookie = nsg;
+	}
+}
+
+/*!
+ * This function undoes \b mxcmci_pre_req() once the request is done.
+ *
+ * @param  mmc  Pointer to MMC/SD host structure
+ * @param  req  Pointer to MMC/SD request structure
+ */
+static void mxcmci_post_req(struct mmc_host *mmc, struct mmc_request *req)
+{
+	struct mmc_data *data = req->data;
+
+	if (!data || data->host_cookie == 0)
+		return;
+
+	dma_unmap_sg(mmc_dev(mmc), data->sg, data->host_cookie,
+		     (data->flags & MMC_DATA_READ) ?
+		     DMA_FROM_DEVICE : DMA_TO_DEVICE);
+	data->host_cookie = 0;
+}
+#endif
+
 static struct mmc_host_ops mxcmci_ops = {
 	.request = mxcmci_request,
-	.set_ios = mxcmci_set_ios
+	.set_ios = mxcmci_set_ios,
+#ifdef MXC_MMC_DMA_ENABLE
+	.pre_req = mxcmci_pre_req,
+	.post_req = mxcmci_post_req,
+#endif
 };
 
 #ifdef MXC_MMC_DMA_ENABLE
@@ -1567,21 +1862,34 @@ static void mxcmci_dma_irq(void *devid)
 #endif
 	/* This variable holds DMA configuration parameters */
 	dma_request_t sdma_request;
+	int i;
 
 	DBG(2,"In.. %s\n", __FUNCTION__);
-	mxc_dma_stop(host->dma);
 
-	mxc_dma_get_config(host->dma, &sdma_request, 0);
-	if (sdma_request.bd_error) {
-		printk("Error in SDMA transfer\n");
-		status = __raw_readl(host->base + MMC_STATUS);
+	/*
+	 * Every descriptor of a chain raises the interrupt. Leave the
+	 * channel running until the SDMA has closed the last one.
+	 */
+	for (i = 0; i < host->dma_nbd; i++) {
+		mxc_dma_get_config(host->dma, &sdma_request, i);
+		if (sdma_request.bd_error) {
+			mxc_dma_stop(host->dma);
+			printk("Error in SDMA transfer\n");
+			if (host->data)
+				host->data->error = MMC_ERR_FAILED;
+			status = __raw_readl(host->base + MMC_STATUS);
 #ifdef CONFIG_MMC_DEBUG
-		dump_status(__FUNCTION__, status);
+			dump_status(__FUNCTION__, status);
 #endif
-		mxcmci_data_done(host, status);
-		return;
+			mxcmci_data_done(host, status);
+			return;
+		}
+		if (sdma_request.bd_done)
+			return;
 	}
 
+	mxc_dma_stop(host->dma);
+
 	DBG(2,"%s: Transfered bytes:%d\n", DRIVER_NAME, sdma_request.count);
 #ifdef CONFIG_MMC_DEBUG
 	nob = __raw_readl(host->base + MMC_REM_NOB);
@@ -1696,8 +2004,8 @@ DBG(2,"mxcmci_probe: invalid controller selected \n");
 	mmc->ocr_avail = MMC_VDD_32_33 | MMC_VDD_33_34;
 	mmc->max_phys_segs = NR_SG;
  	mmc->max_hw_segs = NR_SG; 
-	mmc->max_sectors = 127;
-	mmc->max_seg_size = 128 * 512; 
+	mmc->max_sectors = MXC_MMC_MAX_SECTORS;
+	mmc->max_seg_size = MXC_MMC_BD_LEN;
 
 #ifdef CONFIG_MOT_FEAT_MEGASIM
 	if (pdev->id == 0) 
@@ -1791,6 +2099,9 @@ DBG(2,"mxcmci_probe: invalid controller selected \n");
 	if (ret) {
 		goto out3;
 	}
+#ifdef MXC_MMC_DMA_ENABLE
+	mxcmci_hosts[pdev->id] = host;
+#endif
 
 /*	if( pdev->id == 0 ){
 #ifndef CONFIG_MACH_MXC91131EVB
@@ -1873,6 +2184,11 @@ static int mxcmci_remove(struct device *dev)
 		mmc_remove_host(mmc);
 		free_irq(host->irq, host);
 		mxc_free_dma(host->dma);
+#ifdef MXC_MMC_DMA_ENABLE
+		mxcmci_hosts[pdev->id] = NULL;
+		kfree(host->dma_buffer);
+		host->dma_buffer = NULL;
+#endif
 		release_mem_region(pdev->resource[0].start,
 				   pdev->resource[0].end -
 				   pdev->resource[0].start + 1);
@@ -2068,6 +2384,11 @@ static int __init mxcmci_init(void)
 
 	ret = driver_register(&mxcmci_driver);
 DBG(2,"MXC MMC/SD driver. ret = 0x%x \n",ret);
+#ifdef MXC_MMC_DMA_ENABLE
+	if (ret == 0)
+		create_proc_read_entry("driver/mxcmci", 0, NULL,
+				       mxcmci_proc_read, NULL);
+#endif
 	return ret;
 }
 
@@ -2076,6 +2397,9 @@ DBG(2,"MXC MMC/SD driver. ret = 0x%x \n",ret);
  */
 static void __exit mxcmci_exit(void)
 {
+#ifdef MXC_MMC_DMA_ENABLE
+	remove_proc_entry("driver/mxcmci", NULL);
+#endif
 	driver_unregister(&mxcmci_driver);
 
 /*#ifndef CONFIG_MACH_MXC91131EVB
@@ -32,6 +32,9 @@
  *		feature
  * 01-03-2008	initialize rsvdblock_offset to avoid this variable being used without initialization. 
  * 02-26-2008   change flash rsvblock address for xpixl
+ *
+ * 10-17-2026   feature CONFIG_MOT_FEAT_NAND_ASYNC_ERASE added by Motorola, Inc.
+ *		partitions pass erase_async through to the master.
  */	
 
 #include <linux/module.h>
@@ -348,6 +351,24 @@ static int part_erase (struct mtd_info *mtd, struct erase_info *instr)
 	return ret;
 }
 
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+static int part_erase_async (struct mtd_info *mtd, struct erase_info *instr)
+{
+	struct mtd_part *part = PART(mtd);
+	int ret;
+	if (!(mtd->flags & MTD_WRITEABLE))
+		return -EROFS;
+	if (instr->addr >= mtd->size)
+		return -EINVAL;
+	instr->addr += part->offset;
+	ret = part->master->erase_async(part->master, instr);
+	/* no callback will undo the offset */
+	if (ret)
+		instr->addr -= part->offset;
+	return ret;
+}
+#endif
+
 void mtd_erase_callback(struct erase_info *instr)
 {
 	if (instr->mtd->erase == part_erase) {
@@ -545,6 +566,10 @@ int add_mtd_partitions(struct mtd_info *master,
 		if (master->block_markbad)
 			slave->mtd.block_markbad = part_block_markbad;
 		slave->mtd.erase = part_erase;
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+		if (master->erase_async)
+			slave->mtd.erase_async = part_erase_async;
+#endif
 		slave->master = master;
 		slave->offset = parts[i].offset;
 		slave->index = i;
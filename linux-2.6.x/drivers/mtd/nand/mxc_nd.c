@@ -51,6 +51,9 @@
  * 02-26-2008  Motorola  Remove mpm_handle_ioi.
  *                       Add busy flag for suspend rejection and mpm advise interface.
  * 11-13-2008  Motorola  update NFC_CLK divisors to be 4 for Hynix part.
+ * 10-17-2026  Motorola  implemented CONFIG_MOT_FEAT_NAND_STREAM feature.
+ *                       pipelined multi-page read/program and SDMA copies
+ *                       between memory and the NFC RAM buffer.
  */
 
 
@@ -99,6 +102,31 @@
  *             
  */
 
+/*
+ * Notes on streaming (CONFIG_MOT_FEAT_NAND_STREAM):
+ *
+ * Multi-page reads: nand_do_read_ecc() calls mxc_nand_read_ahead() with the
+ * next page once the current one is in the NFC RAM buffer. The READ0 command
+ * and address of the next page go out right away and, on large page, the
+ * READSTART completion is left to the interrupt. The array read (tR) then
+ * overlaps the copy of the current page out of the NFC RAM buffer, and the
+ * READ0 for the next page only has to start the data output.
+ *
+ * Multi-page programs: nand_write_page() asks for NAND_CMD_CACHEDPROG on all
+ * but the last page of a write. The program command is issued and its
+ * completion left to the interrupt. The SEQIN of the next page is deferred,
+ * so its data is copied into the NFC RAM buffer during tPROG of the previous
+ * page; the status of that page is collected before the deferred SEQIN goes
+ * out. A failed pipelined page is reported by the status read after the
+ * last page.
+ *
+ * Any other command first waits for the pending operation. A read ahead
+ * that is not followed by its READ0 is waited for (or the chip is reset)
+ * and dropped. Full main area copies use an SDMA memory to memory channel
+ * when the buffer allows it.
+ * None of this is used while a kernel panic is being written out.
+ */
+
 #include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/init.h>
@@ -113,6 +141,11 @@
 #include <asm/mach/flash.h>
 #include <asm/arch/clock.h>
 #include <asm/io.h>
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+#include <linux/completion.h>
+#include <linux/dma-mapping.h>
+#include <asm/dma.h>
+#endif
 #include "mxc_nd.h"
 
 #ifdef CONFIG_MOT_FEAT_STM90NM
@@ -175,6 +208,17 @@ struct nand_info {
 	u16 eccStatus[4];
 	u16 subpage;
 #endif
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	bool bReadPending;	/* READSTART of a read ahead not completed */
+	bool bProgPending;	/* page program not completed */
+	bool bProgFailed;	/* a pipelined page program failed */
+	bool bProgStream;	/* last program was NAND_CMD_CACHEDPROG */
+	bool bEccLatched;	/* eccResult holds the ECC status of the page */
+	u16 eccResult;
+	int nextPage;		/* page started by read ahead, or -1 */
+	int seqinPage;		/* page of a deferred SEQIN, or -1 */
+	int seqinCol;
+#endif
 };
 
 static struct nand_info g_nandfc_info;
@@ -451,6 +495,60 @@ static void send_addr(u16 addr)
 	wait_op_done(TROP_US_DELAY, addr, false);
 }
 
+/*!
+ * This function sends the column and page address cycles of a command.
+ *
+ * @param       mtd             MTD structure for the NAND Flash
+ * @param       column          column offset, or -1 for none
+ * @param       page_addr       page address, or -1 for none
+ */
+static void send_page_addr(struct mtd_info *mtd, int column, int page_addr)
+{
+	/*
+	 * Write out column address, if necessary
+	 */
+	if (column != -1) {
+		/*
+		 * MXC NANDFC can only perform full page+spare or
+		 * spare-only read/write.  When the upper layers
+		 * layers perform a read/write buf operation,
+		 * we will used the saved column adress to index into
+		 * the full page.
+		 */
+#ifdef CONFIG_MOT_FEAT_LPNAND_SUPPORT
+		if (IS_LPNAND(mtd)) {
+			/* 1st column address cycle for large_page nand */
+			send_addr(column);  /* coladdr_0 - coladdr_7 */
+			/* 2nd column address cycle for large_page nand */
+			send_addr((column>>8)&0x0f);  /* coladd_8 - coladdr_11 */
+		}
+		else
+#endif			/* only one column address cycle for small_page nand */
+			send_addr(0);
+	}
+
+	/*
+	 * Write out page address, if necessary
+	 */
+	if (page_addr != -1) {
+		send_addr(page_addr & 0xff); /* paddr_0 - paddr_7 */
+                send_addr((page_addr >> 8) & 0xff); /* paddr_8 - paddr_15 */
+
+		/* One more address cycle for higher density devices */
+#ifdef CONFIG_MOT_FEAT_LPNAND_SUPPORT
+		/*  - LargePage: 256MB (0x10000000)
+		 *  - SmallPage: 64MB (0x4000000)
+		 */
+		if ((mtd->size >= 0x10000000) ||
+		    ((mtd->size >= 0x4000000) && !(IS_LPNAND(mtd))))
+#else
+		if (mtd->size >= 0x4000000)
+
+#endif
+		   	send_addr((page_addr >> 16) & 0xff);
+	}
+}
+
 #ifdef CONFIG_MOT_FEAT_LPNAND_SUPPORT
 /*!
  * This function requests the NANDFC to initate the transfer
@@ -793,6 +891,257 @@ static u16 get_dev_status(void)
 	return mainBuf[0];
 }
 
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+/*!
+ * SDMA channel used for NFC RAM buffer copies, or -1 for CPU copies.
+ */
+static int mxc_nand_dma_chan = -1;
+
+static DECLARE_COMPLETION(mxc_nand_dma_done);
+
+/*!
+ * This function tells whether operations may be left to complete in the
+ * background. A kernel panic dump only polls.
+ *
+ * @return  true if streaming can be used
+ */
+static inline bool mxc_nand_can_stream(void)
+{
+#ifdef CONFIG_MOT_FEAT_KPANIC
+	return !kpanic_in_progress;
+#else
+	return true;
+#endif
+}
+
+/*!
+ * This function issues the specified command to the NAND device and
+ * returns without waiting. The completion is collected by
+ * wait_async_done().
+ *
+ * @param       cmd     command for NAND Flash
+ */
+static void send_cmd_async(u16 cmd)
+{
+	if (nand_debug)
+		DEBUG(MTD_DEBUG_LEVEL3, "send_cmd_async(0x%x)\n", cmd);
+
+	nfc_active = 1;
+#ifdef CONFIG_MOT_FEAT_PM
+	mpm_driver_advise(mxc_nand_mpm_advice_id, MPM_ADVICE_DRIVER_IS_BUSY);
+#endif
+	g_nandfc_info.bTransComplete = 0;
+	NFC_FLASH_CMD = cmd;
+	NFC_CONFIG2 = NFC_CMD;
+	wmb();
+	NFC_CONFIG1 &= ~NFC_INT_MSK; /* Enable interrupt */
+}
+
+/*!
+ * This function waits for the completion interrupt of a command issued
+ * by send_cmd_async().
+ */
+static void wait_async_done(void)
+{
+	wait_event(irq_waitq, g_nandfc_info.bTransComplete);
+	NFC_CONFIG2 &= ~NFC_INT;
+
+	nfc_active = -1;
+#ifdef CONFIG_MOT_FEAT_PM
+	mpm_driver_advise(mxc_nand_mpm_advice_id, MPM_ADVICE_DRIVER_IS_NOT_BUSY);
+#endif
+}
+
+/*!
+ * This function polls the NAND device until a page program is done and
+ * records a failure for the status read that ends the write.
+ */
+static void mxc_nand_check_prog(void)
+{
+	volatile u16 *mainBuf = MAIN_AREA1;
+	u16 saved = mainBuf[0];
+	u16 status = 0;
+	int i;
+
+	for (i = 0; i < TROP_US_DELAY; i++) {
+		status = get_dev_status();
+		if (status & NAND_STATUS_READY)
+			break;
+		udelay(1);
+	}
+
+	/*
+	 * The status went through NFC buffer 1, which holds part of the
+	 * next large page if it is already staged.
+	 */
+	mainBuf[0] = saved;
+
+	if (status & NAND_STATUS_FAIL)
+		g_nandfc_info.bProgFailed = true;
+}
+
+/*!
+ * This function waits for the read ahead or page program left running
+ * by the previous command.
+ */
+static void mxc_nand_stream_sync(void)
+{
+	if (g_nandfc_info.bReadPending) {
+		wait_async_done();
+		g_nandfc_info.bReadPending = false;
+	}
+	if (g_nandfc_info.bProgPending) {
+		wait_async_done();
+		g_nandfc_info.bProgPending = false;
+		mxc_nand_check_prog();
+	}
+}
+
+/*!
+ * This function drops a read ahead that the upper layer did not follow
+ * with the matching READ0. On large page the READSTART interrupt tells
+ * when the chip is ready again. On small page nothing has waited for tR,
+ * so the chip is polled until it is ready, and reset if it never gets
+ * there, before any other command goes out.
+ */
+static void mxc_nand_drop_read_ahead(void)
+{
+	int i;
+
+	g_nandfc_info.nextPage = -1;
+
+	if (g_nandfc_info.bReadPending) {
+		wait_async_done();
+		g_nandfc_info.bReadPending = false;
+		return;
+	}
+
+	for (i = 0; i < TROP_US_DELAY; i++) {
+		if (get_dev_status() & NAND_STATUS_READY)
+			return;
+		udelay(1);
+	}
+
+	DEBUG(MTD_DEBUG_LEVEL0, "MXC_NAND: busy after read ahead, resetting\n");
+	send_cmd(NAND_CMD_RESET, false);
+}
+
+/*!
+ * This function starts the array read of the next page of a multi-page
+ * read, while the current page is still in the NFC RAM buffer.
+ * mxc_nand_command() only starts the data output when the upper layer
+ * asks for that page.
+ *
+ * @param       mtd     MTD structure for the NAND Flash
+ * @param       page    page the read continues with
+ */
+static void mxc_nand_read_ahead(struct mtd_info *mtd, int page)
+{
+	if (!mxc_nand_can_stream())
+		return;
+
+	/* Keep the ECC status of the page still to be copied out */
+	g_nandfc_info.eccResult = NFC_ECC_STATUS_RESULT;
+	g_nandfc_info.bEccLatched = true;
+
+	send_cmd(NAND_CMD_READ0, false);
+	send_page_addr(mtd, 0, page);
+#ifdef CONFIG_MOT_FEAT_LPNAND_SUPPORT
+	if (IS_LPNAND(mtd)) {
+		send_cmd_async(NAND_CMD_READSTART);
+		g_nandfc_info.bReadPending = true;
+	}
+#endif
+	g_nandfc_info.nextPage = page;
+}
+
+/*!
+ * SDMA completion callback.
+ *
+ * @param       arg     not used
+ */
+static void mxc_nand_dma_callback(void *arg)
+{
+	complete(&mxc_nand_dma_done);
+}
+
+/*!
+ * This function copies a full main area between memory and the NFC RAM
+ * buffer with SDMA.
+ *
+ * @param       buf     buffer in memory
+ * @param       len     number of bytes, the main area size
+ * @param       toNfc   true to copy from \b buf into the NFC RAM buffer
+ *
+ * @return  0 on success, -1 if the caller has to copy with the CPU
+ */
+static int mxc_nand_dma_copy(u_char * buf, int len, bool toNfc)
+{
+	enum dma_data_direction dir = toNfc ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	dma_request_t req;
+	dma_addr_t phys;
+
+	if (mxc_nand_dma_chan < 0 || !mxc_nand_can_stream() ||
+	    ((unsigned long)buf & 3) || !virt_addr_valid(buf) ||
+	    !virt_addr_valid(buf + len - 1))
+		return -1;
+
+	phys = dma_map_single(NULL, buf, len, dir);
+
+	memset(&req, 0, sizeof(req));
+	if (toNfc) {
+		req.sourceAddr = (__u8 *) phys;
+		req.destAddr = (__u8 *) NFC_BASE_ADDR;
+	} else {
+		req.sourceAddr = (__u8 *) NFC_BASE_ADDR;
+		req.destAddr = (__u8 *) phys;
+	}
+	req.count = len;
+
+	INIT_COMPLETION(mxc_nand_dma_done);
+	mxc_dma_set_config(mxc_nand_dma_chan, &req, 0);
+	mxc_dma_start(mxc_nand_dma_chan);
+	wait_for_completion(&mxc_nand_dma_done);
+
+	dma_unmap_single(NULL, phys, len, dir);
+
+	mxc_dma_get_config(mxc_nand_dma_chan, &req, 0);
+	if (req.bd_error) {
+		DEBUG(MTD_DEBUG_LEVEL0, "MXC_NAND: SDMA copy failed\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*!
+ * This function sets up the SDMA channel for NFC RAM buffer copies. The
+ * CPU copies are kept if no channel is available.
+ */
+static void mxc_nand_dma_init(void)
+{
+	dma_channel_params params;
+	int chan = 0;
+
+	if (mxc_request_dma(&chan, "MXC NAND") < 0) {
+		printk(KERN_INFO "MXC_NAND: no SDMA channel, using CPU copies\n");
+		return;
+	}
+
+	memset(&params, 0, sizeof(params));
+	params.peripheral_type = MEMORY;
+	params.transfer_type = emi_2_emi;
+	params.callback = mxc_nand_dma_callback;
+	params.bd_number = 1;
+	params.word_size = TRANSFER_32BIT;
+	if (mxc_dma_setup_channel(chan, &params) < 0) {
+		printk(KERN_INFO "MXC_NAND: SDMA setup failed, using CPU copies\n");
+		mxc_free_dma(chan);
+		return;
+	}
+	mxc_nand_dma_chan = chan;
+}
+#endif /* CONFIG_MOT_FEAT_NAND_STREAM */
+
 /*!
  * This functions is used by upper layer to checks if device is ready
  *
@@ -807,6 +1156,11 @@ static int mxc_nand_dev_ready(struct mtd_info *mtd)
 	/* After mxc_nand_command(), the device is in ready state */
 	return 1;
 #else
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	/* A status read would end the array read started by read ahead */
+	if (g_nandfc_info.nextPage != -1)
+		return 1;
+#endif
 	if (get_dev_status() & NAND_STATUS_READY) {
 		return 1;
 	}
@@ -861,6 +1215,11 @@ static int mxc_nand_correct_data(struct mtd_info * mtd, u_char * dat, u_char * r
 	 */
 	u16 ecc_status = NFC_ECC_STATUS_RESULT;
 
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	/* The next page may already be on its way in */
+	if (g_nandfc_info.bEccLatched)
+		ecc_status = g_nandfc_info.eccResult;
+#endif
 	if (((ecc_status & 0x3) == 2) || ((ecc_status >> 2) == 2)) {
 		DEBUG(MTD_DEBUG_LEVEL0,
 		      "MXC_NAND: HWECC uncorrectable 2-bit ECC error\n");
@@ -902,7 +1261,18 @@ static u_char mxc_nand_read_byte(struct mtd_info *mtd)
 
 	/* Check for status request */
 	if (g_nandfc_info.bStatusRequest) {
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+		u16 status = get_dev_status();
+
+		/* Report a failed pipelined program once */
+		if (g_nandfc_info.bProgFailed) {
+			status |= NAND_STATUS_FAIL;
+			g_nandfc_info.bProgFailed = false;
+		}
+		return (status & 0xFF);
+#else
 		return (get_dev_status() & 0xFF);
+#endif
 	}
 
 	/* Get column for 16-bit access */
@@ -1101,6 +1471,10 @@ static void mxc_nand_write_buf(struct mtd_info *mtd,
 				      "%s:%d: n = %d, m = %d, i = %d, col = %d\n",
 				      __FUNCTION__, __LINE__, n, m, i, col);
 
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+			if (col || m != mtd->oobblock ||
+			    mxc_nand_dma_copy((u_char *) &buf[i], m, true))
+#endif
 			memcpy((void *)(p), &buf[i], m);
 			col += m;
 			i += m;
@@ -1201,6 +1575,10 @@ static void mxc_nand_read_buf(struct mtd_info *mtd, u_char * buf, int len)
 				m += mtd->oobsize;
 
 			m = min(n, m) & ~3;
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+			if (col || m != mtd->oobblock ||
+			    mxc_nand_dma_copy(&buf[i], m, false))
+#endif
 			memcpy(&buf[i], (void *)(p), m);
 			col += m;
 			i += m;
@@ -1262,6 +1640,9 @@ static void mxc_nand_select_chip(struct mtd_info *mtd, int chip)
 	 */
 
 	if (chip == -1) {
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+		mxc_nand_stream_sync();
+#endif
                 if(likely(jiffies > 6000)) {
                         /* Disable the NFC clock */
                         mxc_clks_disable(NFC_CLK);
@@ -1298,6 +1679,66 @@ static void mxc_nand_command(struct mtd_info *mtd, unsigned command,
 		      "mxc_nand_command (cmd = 0x%x, col = 0x%x, page = 0x%x)\n",
 		      command, column, page_addr);
 
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	g_nandfc_info.bEccLatched = false;
+
+	if (command == NAND_CMD_READ0 && column == 0 && page_addr != -1 &&
+	    page_addr == g_nandfc_info.nextPage) {
+		/* The array read was started by mxc_nand_read_ahead() */
+		g_nandfc_info.nextPage = -1;
+		mxc_nand_stream_sync();
+		g_nandfc_info.bStatusRequest = false;
+		g_nandfc_info.colAddr = 0;
+		g_nandfc_info.bSpareOnly = false;
+#ifdef CONFIG_MOT_FEAT_LPNAND_SUPPORT
+		if (IS_LPNAND(mtd))
+			send_read_page_lp(false);
+		else
+#endif
+			send_read_page(false);
+		return;
+	}
+	if (g_nandfc_info.nextPage != -1)
+		mxc_nand_drop_read_ahead();
+
+	if (command == NAND_CMD_SEQIN && g_nandfc_info.bProgPending) {
+		/*
+		 * Stage the data while the previous page programs. The
+		 * command and address go out with the program command.
+		 */
+		g_nandfc_info.seqinPage = page_addr;
+		g_nandfc_info.seqinCol = column;
+		g_nandfc_info.bStatusRequest = false;
+		if (column >= mtd->oobblock) {
+			g_nandfc_info.colAddr = column - mtd->oobblock;
+			g_nandfc_info.bSpareOnly = true;
+		} else {
+			g_nandfc_info.colAddr = column;
+			g_nandfc_info.bSpareOnly = false;
+		}
+		return;
+	}
+
+	mxc_nand_stream_sync();
+
+	/*
+	 * A failure belongs to the write or erase it was found in. A SEQIN
+	 * that does not follow a cached program starts a new write.
+	 */
+	if (command == NAND_CMD_ERASE1 ||
+	    (command == NAND_CMD_SEQIN && !g_nandfc_info.bProgStream))
+		g_nandfc_info.bProgFailed = false;
+
+	if ((command == NAND_CMD_PAGEPROG || command == NAND_CMD_CACHEDPROG) &&
+	    g_nandfc_info.seqinPage != -1) {
+		int page = g_nandfc_info.seqinPage;
+
+		g_nandfc_info.seqinPage = -1;
+		mxc_nand_command(mtd, NAND_CMD_SEQIN,
+				 g_nandfc_info.seqinCol, page);
+	}
+#endif
+
 	/*
 	 * Reset command state information
 	 */
@@ -1351,6 +1792,9 @@ static void mxc_nand_command(struct mtd_info *mtd, unsigned command,
 		useirq = false;
 		break;
 
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	case NAND_CMD_CACHEDPROG:
+#endif
 	case NAND_CMD_PAGEPROG:
 #ifndef CONFIG_MTD_NAND_MXC_ECC_CORRECTION_OPTION2
 		if (Ecc_disabled) {
@@ -1385,51 +1829,27 @@ static void mxc_nand_command(struct mtd_info *mtd, unsigned command,
 		break;
 	}
 
-        send_cmd(command, useirq);
-
-	/*
-	 * Write out column address, if necessary
-	 */
-	if (column != -1) {
-		/*
-		 * MXC NANDFC can only perform full page+spare or
-		 * spare-only read/write.  When the upper layers
-		 * layers perform a read/write buf operation,
-		 * we will used the saved column adress to index into
-		 * the full page.
-		 */
-#ifdef CONFIG_MOT_FEAT_LPNAND_SUPPORT
-		if (IS_LPNAND(mtd)) {
-			/* 1st column address cycle for large_page nand */
-			send_addr(column);  /* coladdr_0 - coladdr_7 */
-			/* 2nd column address cycle for large_page nand */
-			send_addr((column>>8)&0x0f);  /* coladd_8 - coladdr_11 */
-		}
-		else
-#endif			/* only one column address cycle for small_page nand */
-			send_addr(0);
-	}
-
-	/*
-	 * Write out page address, if necessary
-	 */
-	if (page_addr != -1) {
-		send_addr(page_addr & 0xff); /* paddr_0 - paddr_7 */
-                send_addr((page_addr >> 8) & 0xff); /* paddr_8 - paddr_15 */
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	if (command == NAND_CMD_PAGEPROG)
+		g_nandfc_info.bProgStream = false;
 
-		/* One more address cycle for higher density devices */
-#ifdef CONFIG_MOT_FEAT_LPNAND_SUPPORT
-		/*  - LargePage: 256MB (0x10000000)
-		 *  - SmallPage: 64MB (0x4000000)
-		 */
-		if ((mtd->size >= 0x10000000) ||
-		    ((mtd->size >= 0x4000000) && !(IS_LPNAND(mtd))))
-#else
-		if (mtd->size >= 0x4000000)
+	if (command == NAND_CMD_CACHEDPROG) {
+		g_nandfc_info.bProgStream = true;
 
+		/* Let the page program while the next one is staged */
+		if (mxc_nand_can_stream()) {
+			send_cmd_async(NAND_CMD_PAGEPROG);
+			g_nandfc_info.bProgPending = true;
+		} else {
+			send_cmd(NAND_CMD_PAGEPROG, false);
+			mxc_nand_check_prog();
+		}
+		command = NAND_CMD_PAGEPROG;
+	} else
 #endif
-		   	send_addr((page_addr >> 16) & 0xff);
-	}
+        send_cmd(command, useirq);
+
+	send_page_addr(mtd, column, page_addr);
 
 	/*
 	 * Command post-processing step
@@ -1534,6 +1954,10 @@ static int __init mxcnd_probe(struct device *dev)
 	this->priv = mxc_nand_data;
 
 	memset((char *)&g_nandfc_info, 0, sizeof(g_nandfc_info));
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	g_nandfc_info.nextPage = -1;
+	g_nandfc_info.seqinPage = -1;
+#endif
 
 	/* 5 us command delay time */
 	this->chip_delay = 5;
@@ -1689,6 +2113,11 @@ static int __init mxcnd_probe(struct device *dev)
 		err = -ENXIO;
 		goto out_1;
 	}
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	this->read_ahead = mxc_nand_read_ahead;
+	this->options |= NAND_STREAM_PROG;
+	mxc_nand_dma_init();
+#endif
 	/*
 	 * Enable nand_debug only after nand_scan(), otherwise you might be
 	 * flooded with debug messages.
@@ -1742,6 +2171,12 @@ static int __exit mxcnd_remove(struct device *dev)
 	if (mxc_nand_data) {
 		nand_release(mtd);
 		free_irq(INT_NANDFC, NULL);
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+		if (mxc_nand_dma_chan >= 0) {
+			mxc_free_dma(mxc_nand_dma_chan);
+			mxc_nand_dma_chan = -1;
+		}
+#endif
 		kfree(mxc_nand_data);
 	}
 
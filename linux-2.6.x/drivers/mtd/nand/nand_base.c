@@ -87,6 +87,21 @@
  *
  * 06-15-2007   Motorola: update read disturb max value for threshold from 2^8 to 2^16.
  *
+ * 10-17-2026   feature CONFIG_MOT_FEAT_NAND_STREAM added by Motorola, Inc.
+ *		multi-page reads tell the board driver about the next page through
+ *		read_ahead(), and board drivers setting NAND_STREAM_PROG get the
+ *		cached programming hint for all but the last page of a write.
+ *
+ * 10-17-2026   Motorola: CONFIG_MOT_FEAT_NAND_RDDIST blocks with a corrected
+ *		bit error are queued to the nand_rddistd thread (nand_rddist.c)
+ *		instead of being fixed in the reader's context; read and erase
+ *		counts saturate at 2^16-1.
+ *
+ * 10-17-2026   feature CONFIG_MOT_FEAT_NAND_ASYNC_ERASE added by Motorola, Inc.
+ *		mtd->erase_async queues block erases to a per-chip nand_erased
+ *		thread and reports completion through the erase callback;
+ *		nand_sync() waits for the queue to drain.
+ *
  * Credits:
  *	David Woodhouse for adding multichip support  
  *	
@@ -121,6 +136,11 @@
 #include <linux/bitops.h>
 #include <asm/io.h>
 
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+#include <linux/kthread.h>
+#include <linux/suspend.h>
+#endif
+
 #ifdef CONFIG_MTD_PARTITIONS
 #include <linux/mtd/partitions.h>
 #endif
@@ -266,6 +286,7 @@ static void nand_release_device (struct mtd_info *mtd)
 	 * do not release the locked device while read disturb fix in progress */
 	if (rddist_in_progress && this->state == FL_RDDIST_FIXING)
 		return;
+	nand_rddist_touch();
 #endif
 	/* De-select the NAND device */
 	this->select_chip(mtd, -1);
@@ -1192,6 +1213,10 @@ static int nand_write_page (struct mtd_info *mtd, struct nand_chip *this, int pa
 	int	datidx = 0, eccidx = 0, eccsteps = this->eccsteps;
 	int	eccbytes = 0;
 	
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	/* Board drivers which pipeline programs take the cached hint */
+	if (!(this->options & NAND_STREAM_PROG))
+#endif
 	/* FIXME: Enable cached programming */
 	cached = 0;
 
@@ -1455,8 +1480,9 @@ static int nand_read (struct mtd_info *mtd, loff_t from, size_t len, size_t * re
 	{
 		int ret, read_dist_block = 0;
 		ret = nand_do_read_ecc(mtd, from, len, retlen, buf, NULL, &mtd->oobinfo, 0xff, &read_dist_block);
-		if (read_dist_block != 0) 
-			mtd->read_distfix(mtd, read_dist_block, RDDIST_BITERR);
+		/* fixed by nand_rddistd once the device is idle */
+		if (read_dist_block != 0)
+			nand_rddist_queue(read_dist_block, RDDIST_BITERR);
 		return ret;
 	}
 #else
@@ -1487,8 +1513,9 @@ static int nand_read_ecc (struct mtd_info *mtd, loff_t from, size_t len,
 	{
 		int ret, read_dist_block = 0;
 		ret = nand_do_read_ecc(mtd, from, len, retlen, buf, oob_buf, oobsel, 0xff, &read_dist_block);
-		if (read_dist_block != 0) 
-			mtd->read_distfix(mtd, read_dist_block, RDDIST_BITERR);
+		/* fixed by nand_rddistd once the device is idle */
+		if (read_dist_block != 0)
+			nand_rddist_queue(read_dist_block, RDDIST_BITERR);
 		return ret;
 	}
 #else
@@ -1634,6 +1661,16 @@ int nand_do_read_ecc (struct mtd_info *mtd, loff_t from, size_t len,
 			sndcmd = 0;
 		}	
 
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+		/* Let the board driver start the array read of the next page
+		 * while this one is transferred. Stay inside the block, the
+		 * next block may be remapped. */
+		if (this->read_ahead && !NAND_CANAUTOINCR(this) &&
+		    (read + end - col) < len && ((page + 1) & blockcheck) &&
+		    (realpage + 1) != this->pagebuf)
+			this->read_ahead(mtd, page + 1);
+#endif
+
 		/* get oob area, if we have no oob buffer from fs-driver */
 		if (!oob_buf || oobsel->useecc == MTD_NANDECC_AUTOPLACE ||
 			oobsel->useecc == MTD_NANDECC_AUTOPL_USR)
@@ -2060,6 +2097,7 @@ static int nand_read_distfix (struct mtd_info *mtd, int rd_dist_block, int reaso
 		nand_do_block_mark(mtd, to, 0x01);
 		goto done;
 	}
+	nand_increment_erasecnt(this, to >> this->page_shift);
 	/* step 4.2 - writing the data to reserved block ... */
 	ret = nand_write_ecc(mtd, to, mtd->erasesize, &rlen, mainbuf, oobbuf, &mtd->oobinfo);
 	if (ret < 0) {
@@ -2143,6 +2181,7 @@ static int nand_read_distfix (struct mtd_info *mtd, int rd_dist_block, int reaso
 		 * replaced with a good block from reserved pool */
 		goto done;
 	}
+	nand_increment_erasecnt(this, from >> this->page_shift);
 
 	/*++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 	 * step 9 - re-write back to the recovered read disturb block 
@@ -3459,6 +3498,111 @@ static int nand_erase (struct mtd_info *mtd, struct erase_info *instr)
 {
 	return nand_erase_nand (mtd, instr, 0);
 }
+
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+/**
+ * nand_erase_async - [MTD Interface] queue block erase(s)
+ * @mtd:	MTD device structure
+ * @instr:	erase instruction
+ *
+ * Queue the erase to the erase thread and return. A zero return means the
+ * callback will be called with the state set to MTD_ERASE_DONE or
+ * MTD_ERASE_FAILED; if the request is rejected here it is not called.
+ * Without an erase thread the erase is done in the caller's context.
+ */
+static int nand_erase_async (struct mtd_info *mtd, struct erase_info *instr)
+{
+	struct nand_chip *this = mtd->priv;
+
+	/* Reject now what nand_erase_nand would reject later */
+	if ((instr->addr | instr->len) & ((1 << this->phys_erase_shift) - 1))
+		return -EINVAL;
+	if ((instr->len + instr->addr) > mtd->size)
+		return -EINVAL;
+
+	if (!this->erase_thread)
+		return nand_erase_nand (mtd, instr, 0);
+
+	instr->state = MTD_ERASE_PENDING;
+	instr->next = NULL;
+
+	spin_lock (&this->erase_lock);
+	if (this->erase_tail)
+		this->erase_tail->next = instr;
+	else
+		this->erase_head = instr;
+	this->erase_tail = instr;
+	spin_unlock (&this->erase_lock);
+
+	wake_up (&this->erase_wq);
+	return 0;
+}
+
+/**
+ * nand_erase_idle - [GENERIC] check for an empty erase queue
+ * @this:	NAND chip structure
+ */
+static int nand_erase_idle (struct nand_chip *this)
+{
+	int idle;
+
+	spin_lock (&this->erase_lock);
+	idle = !this->erase_head && !this->erase_busy;
+	spin_unlock (&this->erase_lock);
+
+	return idle;
+}
+
+/**
+ * nand_erase_thread - [GENERIC] erase queued blocks
+ * @data:	MTD device structure
+ *
+ * Runs the queued requests in order through nand_erase_nand(), which calls
+ * the callback on success. Failed requests get their callback here. The
+ * queue is drained before the thread stops.
+ */
+static int nand_erase_thread (void *data)
+{
+	struct mtd_info *mtd = data;
+	struct nand_chip *this = mtd->priv;
+	struct erase_info *instr;
+
+	while (1) {
+		if (current->flags & PF_FREEZE)
+			refrigerator(PF_FREEZE);
+
+		spin_lock (&this->erase_lock);
+		instr = this->erase_head;
+		if (instr) {
+			this->erase_head = instr->next;
+			if (!this->erase_head)
+				this->erase_tail = NULL;
+			this->erase_busy = 1;
+		}
+		spin_unlock (&this->erase_lock);
+
+		if (!instr) {
+			if (kthread_should_stop())
+				break;
+			wait_event_interruptible (this->erase_wq,
+				this->erase_head || kthread_should_stop());
+			continue;
+		}
+
+		if (nand_erase_nand (mtd, instr, 0)) {
+			instr->state = MTD_ERASE_FAILED;
+			mtd_erase_callback (instr);
+		}
+
+		spin_lock (&this->erase_lock);
+		this->erase_busy = 0;
+		spin_unlock (&this->erase_lock);
+		wake_up (&this->erase_wq);
+	}
+
+	return 0;
+}
+#endif /* CONFIG_MOT_FEAT_NAND_ASYNC_ERASE */
  
 #define BBT_PAGE_MASK	0xffffff3f
 /**
@@ -3708,6 +3852,10 @@ static void nand_sync (struct mtd_info *mtd)
 
 	DEBUG (MTD_DEBUG_LEVEL3, "nand_sync: called\n");
 
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+	/* Queued erases have to be finished too */
+	wait_event (this->erase_wq, nand_erase_idle (this));
+#endif
 	/* Grab the lock and see if the device is available */
 	nand_get_device (this, mtd, FL_SYNCING);
 	/* Release it and go back */
@@ -4217,6 +4365,9 @@ int nand_scan (struct mtd_info *mtd, int maxchips)
 	mtd->flags = MTD_CAP_NANDFLASH | MTD_ECC;
 	mtd->ecctype = MTD_ECC_SW;
 	mtd->erase = nand_erase;
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+	mtd->erase_async = nand_erase_async;
+#endif
 	mtd->point = NULL;
 	mtd->unpoint = NULL;
 	mtd->read = nand_read;
@@ -4268,6 +4419,9 @@ int nand_scan (struct mtd_info *mtd, int maxchips)
         }
 	memset(g_read_dist_info.blk_tbl[RDCNT_TBL], 0x0, g_read_dist_info.numblocks * sizeof(block_cnt_type));
 	memset(g_read_dist_info.blk_tbl[ERASECNT_TBL], 0x0, g_read_dist_info.numblocks * sizeof(block_cnt_type));
+
+	/* background refresh and block count table, see nand_rddist.c */
+	nand_rddist_register(mtd);
 #ifdef CONFIG_MOT_FEAT_NAND_BLKCNT_TEST
 	/* allocate memory for g_write_test_info.blk_tbl - (1 byte per block) */
 	if (!(g_write_test_info.blk_tbl = kmalloc(g_read_dist_info.numblocks*sizeof(block_cnt_type), GFP_KERNEL))) {
@@ -4283,6 +4437,18 @@ int nand_scan (struct mtd_info *mtd, int maxchips)
 	memset(g_erase_test_info.blk_tbl, 0x0, g_read_dist_info.numblocks*sizeof(block_cnt_type));
 #endif /*CONFIG_MOT_FEAT_NAND_BLKCNT_TEST*/
 #endif /*CONFIG_MOT_FEAT_NAND_RDDIST*/
+
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+	spin_lock_init (&this->erase_lock);
+	init_waitqueue_head (&this->erase_wq);
+	this->erase_head = this->erase_tail = NULL;
+	this->erase_busy = 0;
+	this->erase_thread = kthread_run (nand_erase_thread, mtd, "nand_erased");
+	if (IS_ERR (this->erase_thread)) {
+		printk (KERN_WARNING "nand_scan: no erase thread, queued erases run inline\n");
+		this->erase_thread = NULL;
+	}
+#endif
 	
 	/* Check, if we should skip the bad block table scan */
 	if (this->options & NAND_SKIP_BBTSCAN)
@@ -4300,6 +4466,12 @@ void nand_release (struct mtd_info *mtd)
 {
 	struct nand_chip *this = mtd->priv;
 
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+	/* The erase thread drains its queue before it exits */
+	if (this->erase_thread)
+		kthread_stop (this->erase_thread);
+#endif
+
 #ifdef CONFIG_MTD_PARTITIONS
 	/* Deregister partitions */
 	del_mtd_partitions (mtd);
@@ -4346,8 +4518,10 @@ static void nand_increment_rdcnt (struct nand_chip *this, int page)
 	/* Calculate block based on page */
 	block = (page<<this->page_shift)>>this->phys_erase_shift;
 
-        /* keep tracking the g_read_dist_info.blk_tbl */
-        g_read_dist_info.blk_tbl[RDCNT_TBL][block]++; 
+        /* keep tracking the g_read_dist_info.blk_tbl, saturating at 2^16-1 */
+	if (g_read_dist_info.blk_tbl[RDCNT_TBL][block] != 0xffff)
+		g_read_dist_info.blk_tbl[RDCNT_TBL][block]++;
+	nand_rddist_check_rdcnt(block, g_read_dist_info.blk_tbl[RDCNT_TBL][block]);
 
         if ((g_read_dist_info.threshold)&&
            ((g_read_dist_info.blk_tbl[RDCNT_TBL][block])>=g_read_dist_info.threshold)) {
@@ -4368,7 +4542,8 @@ static void nand_increment_erasecnt (struct nand_chip *this, int page)
 	/* reset the g_read_dist_info.blk_tbl's RDCNT_TBL */
 	g_read_dist_info.blk_tbl[RDCNT_TBL][block]=0;
 	/* keep tracking the g_read_dist_info.blk_tbl's ERASECNT_TBL */
-        g_read_dist_info.blk_tbl[ERASECNT_TBL][block]++;
+	if (g_read_dist_info.blk_tbl[ERASECNT_TBL][block] != 0xffff)
+		g_read_dist_info.blk_tbl[ERASECNT_TBL][block]++;
 
 #ifdef CONFIG_MOT_FEAT_NAND_BLKCNT_TEST
         g_erase_test_info.blk_tbl[(page<<this->page_shift)>>this->phys_erase_shift]++;
@@ -0,0 +1,591 @@
+/*
+ *  drivers/mtd/nand/nand_rddist.c
+ *
+ *  Overview:
+ *   Background read disturb refresh and block count persistence
+ *
+ *  Copyright (C) 2026 Motorola, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Description:
+ *
+ * Blocks reported by nand_do_read_ecc() with a corrected bit error, and
+ * blocks whose read count reaches refresh_reads, are queued here instead
+ * of being fixed in the reader's context.  The nand_rddistd thread runs
+ * nand_read_distfix() on them once the device has seen no other access
+ * for idle_ms.
+ *
+ * The per block read and erase counters of g_read_dist_info are saved to
+ * the optional "blkcnt" partition, one byte per counter, and added back
+ * into the RAM tables at boot.  Records are appended page aligned across
+ * the partition blocks; the newest record with a valid crc wins, so the
+ * previous record survives while the next block is erased.
+ *
+ * Histograms of both counters and the tunables are in /sys/nand_rddist.
+ *
+ * ChangeLog:
+ * (mm-dd-yyyy) Author    Comment
+ * 10-17-2026   Motorola  initial version for CONFIG_MOT_FEAT_NAND_RDDIST.
+ *
+ */
+
+#include <linux/config.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/suspend.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/crc32.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/mtd/mtd.h>
+#include <linux/mtd/nand.h>
+#include <mtd/mtd-abi.h>
+
+#define RDDIST_QUEUE_LEN	16
+#define RDDIST_PART_NAME	"blkcnt"
+#define RDDIST_TBL_MAGIC	0x74634452	/* "RDct" */
+#define RDDIST_TBL_VERSION	1
+
+extern struct nand_rddist_info g_read_dist_info;
+
+/* on-flash record header, followed by one read and one erase code per block */
+struct rddist_tbl_hdr {
+	u32 magic;
+	u32 seq;
+	u16 version;
+	u16 numblocks;
+	u32 crc;			/* crc32 of the code bytes */
+};
+
+static struct {
+	spinlock_t lock;
+	u16 block[RDDIST_QUEUE_LEN];
+	u8 reason[RDDIST_QUEUE_LEN];
+	int head;
+	int count;
+} rddist_queue = {
+	.lock = SPIN_LOCK_UNLOCKED,
+};
+
+static DECLARE_WAIT_QUEUE_HEAD(rddist_waitq);
+static struct mtd_info *rddist_master;
+static struct task_struct *rddist_task;
+
+/* jiffies of the last device release not issued by nand_rddistd */
+static unsigned long rddist_last_io;
+
+/* tunables */
+static unsigned int rddist_refresh_reads;
+static unsigned int rddist_idle_ms = 2000;
+static unsigned int rddist_save_interval = 3600;
+
+/* statistics */
+static unsigned int rddist_fixed, rddist_failed, rddist_dropped, rddist_saves;
+
+/* table partition state */
+static struct mtd_info *rddist_part;
+static u_char *rddist_buf;		/* record being written */
+static u_char *rddist_saved;		/* codes of the last record on flash */
+static size_t rddist_recsize;
+static int rddist_slot = -1;		/* slot of the last record on flash */
+static u32 rddist_seq;
+static unsigned long rddist_last_save;
+
+/*
+ * Counters are stored as 8 bit codes: values below 16 exactly, larger
+ * values with a 3 bit exponent and the top 4 significant bits (rounded
+ * down, at most 12.5% low).  0xffff encodes as 111.
+ */
+static u8 rddist_encode(unsigned int v)
+{
+	int k;
+
+	if (v < 16)
+		return v;
+	k = fls(v) - 1;
+	return 16 + ((k - 4) << 3) + ((v >> (k - 3)) & 7);
+}
+
+static unsigned int rddist_decode(u8 c)
+{
+	if (c < 16)
+		return c;
+	c -= 16;
+	return ((c & 7) | 8) << ((c >> 3) + 1);
+}
+
+/**
+ * nand_rddist_touch - note a device access for the idle detection
+ *
+ * Called from nand_release_device(); accesses made by nand_rddistd itself
+ * do not count.
+ */
+void nand_rddist_touch(void)
+{
+	if (current != rddist_task)
+		rddist_last_io = jiffies;
+}
+
+/**
+ * nand_rddist_queue - queue a block for background refresh
+ * @block:		physical block number on the master device
+ * @reason_code:	RDDIST_BITERR or RDDIST_CNTFIX
+ *
+ * Safe from any context.  A block already queued is not added twice; when
+ * the queue is full the request is dropped and counted.
+ */
+void nand_rddist_queue(int block, int reason_code)
+{
+	unsigned long flags;
+	int i, n;
+
+	spin_lock_irqsave(&rddist_queue.lock, flags);
+	for (i = 0; i < rddist_queue.count; i++) {
+		n = (rddist_queue.head + i) % RDDIST_QUEUE_LEN;
+		if (rddist_queue.block[n] == block) {
+			/* a bit error takes priority over a count fix */
+			if (reason_code == RDDIST_BITERR)
+				rddist_queue.reason[n] = RDDIST_BITERR;
+			spin_unlock_irqrestore(&rddist_queue.lock, flags);
+			return;
+		}
+	}
+	if (rddist_queue.count == RDDIST_QUEUE_LEN) {
+		rddist_dropped++;
+		spin_unlock_irqrestore(&rddist_queue.lock, flags);
+		return;
+	}
+	n = (rddist_queue.head + rddist_queue.count) % RDDIST_QUEUE_LEN;
+	rddist_queue.block[n] = block;
+	rddist_queue.reason[n] = reason_code;
+	rddist_queue.count++;
+	spin_unlock_irqrestore(&rddist_queue.lock, flags);
+
+	wake_up_interruptible(&rddist_waitq);
+}
+
+/**
+ * nand_rddist_check_rdcnt - queue a block whose read count hit refresh_reads
+ * @block:	physical block number
+ * @count:	read count after the increment
+ */
+void nand_rddist_check_rdcnt(int block, unsigned int count)
+{
+	if (rddist_refresh_reads && count == rddist_refresh_reads)
+		nand_rddist_queue(block, RDDIST_CNTFIX);
+}
+
+/**
+ * nand_rddist_register - hand the master device to the refresh thread
+ * @mtd:	master MTD device, with g_read_dist_info already allocated
+ */
+void nand_rddist_register(struct mtd_info *mtd)
+{
+	if (!rddist_master)
+		rddist_master = mtd;
+}
+
+static int rddist_dequeue(int *block, int *reason_code)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&rddist_queue.lock, flags);
+	if (rddist_queue.count) {
+		*block = rddist_queue.block[rddist_queue.head];
+		*reason_code = rddist_queue.reason[rddist_queue.head];
+		rddist_queue.head = (rddist_queue.head + 1) % RDDIST_QUEUE_LEN;
+		rddist_queue.count--;
+		ret = 1;
+	}
+	spin_unlock_irqrestore(&rddist_queue.lock, flags);
+	return ret;
+}
+
+static void rddist_fix(int block, int reason_code)
+{
+	u16 *rdcnt = g_read_dist_info.blk_tbl[RDCNT_TBL];
+
+	if (rddist_master->read_distfix(rddist_master, block, reason_code) < 0) {
+		rddist_failed++;
+		return;
+	}
+	rddist_fixed++;
+
+	/*
+	 * The block was either erased and rewritten or remapped to a reserved
+	 * block, so its read disturb history starts over.  Erase counts are
+	 * kept by nand_read_distfix() for the blocks it actually erased.
+	 */
+	if (block < g_read_dist_info.numblocks)
+		rdcnt[block] = 0;
+}
+
+/*
+ * Table partition handling
+ */
+
+static int rddist_slots_per_block(void)
+{
+	return rddist_part->erasesize / rddist_recsize;
+}
+
+static int rddist_nslots(void)
+{
+	return (rddist_part->size / rddist_part->erasesize) * rddist_slots_per_block();
+}
+
+static loff_t rddist_slot_ofs(int slot)
+{
+	int spb = rddist_slots_per_block();
+
+	return (loff_t)(slot / spb) * rddist_part->erasesize +
+		(slot % spb) * rddist_recsize;
+}
+
+static int rddist_slot_bad(int slot)
+{
+	loff_t ofs = rddist_slot_ofs(slot);
+
+	if (!rddist_part->block_isbad)
+		return 0;
+	return rddist_part->block_isbad(rddist_part, ofs & ~(loff_t)(rddist_part->erasesize - 1));
+}
+
+static int rddist_read_slot(int slot)
+{
+	struct rddist_tbl_hdr *hdr = (struct rddist_tbl_hdr *)rddist_buf;
+	size_t retlen;
+	int n = g_read_dist_info.numblocks;
+
+	if (rddist_slot_bad(slot))
+		return -EIO;
+	if (MTD_READ(rddist_part, rddist_slot_ofs(slot), rddist_recsize,
+		     &retlen, rddist_buf) < 0 || retlen != rddist_recsize)
+		return -EIO;
+	if (hdr->magic != RDDIST_TBL_MAGIC || hdr->version != RDDIST_TBL_VERSION ||
+	    hdr->numblocks != n)
+		return -ENOENT;
+	if (crc32_le(~0, rddist_buf + sizeof(*hdr), 2 * n) != hdr->crc)
+		return -EBADMSG;
+	return 0;
+}
+
+/*
+ * Find the newest record and add its counts into the RAM tables, which
+ * have been counting since nand_scan().
+ */
+static void rddist_restore(void)
+{
+	struct rddist_tbl_hdr *hdr = (struct rddist_tbl_hdr *)rddist_buf;
+	int slot, n = g_read_dist_info.numblocks;
+	int i, best = -1;
+	u32 seq = 0;
+
+	for (slot = 0; slot < rddist_nslots(); slot++) {
+		if (rddist_read_slot(slot))
+			continue;
+		if (best < 0 || (s32)(hdr->seq - seq) > 0) {
+			best = slot;
+			seq = hdr->seq;
+		}
+	}
+	if (best < 0) {
+		printk(KERN_INFO "nand_rddist: no block count table found\n");
+		return;
+	}
+
+	rddist_read_slot(best);
+	for (i = 0; i < 2 * n; i++) {
+		u16 *cnt = &g_read_dist_info.blk_tbl[i < n ? RDCNT_TBL : ERASECNT_TBL][i % n];
+		unsigned int v = *cnt + rddist_decode(rddist_buf[sizeof(*hdr) + i]);
+
+		*cnt = v > 0xffff ? 0xffff : v;
+	}
+	memcpy(rddist_saved, rddist_buf + sizeof(*hdr), 2 * n);
+	rddist_slot = best;
+	rddist_seq = seq;
+	printk(KERN_INFO "nand_rddist: block counts restored from record %u\n", seq);
+}
+
+static int rddist_erase(loff_t ofs)
+{
+	struct erase_info erase;
+
+	memset(&erase, 0, sizeof(erase));
+	erase.mtd = rddist_part;
+	erase.addr = ofs;
+	erase.len = rddist_part->erasesize;
+
+	/* nand_erase() completes before it returns */
+	if (MTD_ERASE(rddist_part, &erase) || erase.state == MTD_ERASE_FAILED)
+		return -EIO;
+	return 0;
+}
+
+/*
+ * Write the current counts into the slot after the last record, unless
+ * their codes are unchanged.
+ */
+static void rddist_save(void)
+{
+	struct rddist_tbl_hdr *hdr = (struct rddist_tbl_hdr *)rddist_buf;
+	u_char *codes = rddist_buf + sizeof(*hdr);
+	int i, n = g_read_dist_info.numblocks;
+	int slot, tries;
+	size_t retlen;
+
+	rddist_last_save = jiffies;
+
+	for (i = 0; i < n; i++) {
+		codes[i] = rddist_encode(g_read_dist_info.blk_tbl[RDCNT_TBL][i]);
+		codes[n + i] = rddist_encode(g_read_dist_info.blk_tbl[ERASECNT_TBL][i]);
+	}
+	if (rddist_slot >= 0 && !memcmp(codes, rddist_saved, 2 * n))
+		return;
+
+	memset(codes + 2 * n, 0xff, rddist_recsize - sizeof(*hdr) - 2 * n);
+	hdr->magic = RDDIST_TBL_MAGIC;
+	hdr->seq = rddist_seq + 1;
+	hdr->version = RDDIST_TBL_VERSION;
+	hdr->numblocks = n;
+	hdr->crc = crc32_le(~0, codes, 2 * n);
+
+	slot = rddist_slot;
+	for (tries = 0; tries < rddist_nslots(); tries++) {
+		slot = (slot + 1) % rddist_nslots();
+		if (rddist_slot_bad(slot))
+			continue;
+		if (slot % rddist_slots_per_block() == 0 &&
+		    rddist_erase(rddist_slot_ofs(slot)))
+			continue;
+		if (MTD_WRITE(rddist_part, rddist_slot_ofs(slot), rddist_recsize,
+			      &retlen, rddist_buf) < 0 || retlen != rddist_recsize)
+			continue;
+
+		memcpy(rddist_saved, codes, 2 * n);
+		rddist_slot = slot;
+		rddist_seq = hdr->seq;
+		rddist_saves++;
+		return;
+	}
+	printk(KERN_ERR "nand_rddist: block count table write failed\n");
+}
+
+static void rddist_part_init(void)
+{
+	struct mtd_info *mtd;
+	int i, n = g_read_dist_info.numblocks;
+
+	for (i = 0; i < MAX_MTD_DEVICES; i++) {
+		mtd = get_mtd_device(NULL, i);
+		if (!mtd)
+			continue;
+		if (!strcmp(mtd->name, RDDIST_PART_NAME))
+			break;
+		put_mtd_device(mtd);
+	}
+	if (i == MAX_MTD_DEVICES) {
+		printk(KERN_INFO "nand_rddist: no \"%s\" partition, block counts not saved\n",
+		       RDDIST_PART_NAME);
+		return;
+	}
+
+	rddist_recsize = sizeof(struct rddist_tbl_hdr) + 2 * n;
+	rddist_recsize = (rddist_recsize + mtd->oobblock - 1) & ~(mtd->oobblock - 1);
+	if (!(mtd->flags & MTD_WRITEABLE) || rddist_recsize > mtd->erasesize)
+		goto out;
+
+	rddist_buf = vmalloc(rddist_recsize);
+	rddist_saved = vmalloc(2 * n);
+	if (!rddist_buf || !rddist_saved)
+		goto out;
+
+	rddist_part = mtd;
+	rddist_restore();
+	return;
+
+out:
+	printk(KERN_ERR "nand_rddist: \"%s\" partition unusable, block counts not saved\n",
+	       RDDIST_PART_NAME);
+	if (rddist_buf)
+		vfree(rddist_buf);
+	if (rddist_saved)
+		vfree(rddist_saved);
+	rddist_buf = rddist_saved = NULL;
+	put_mtd_device(mtd);
+}
+
+/*
+ * nand_rddistd - refresh queued blocks and save the counts while idle
+ */
+static int nand_rddistd(void *unused)
+{
+	long idle, timeout;
+	int block, reason_code;
+
+	rddist_part_init();
+	rddist_last_save = jiffies;
+
+	while (!kthread_should_stop()) {
+		if (current->flags & PF_FREEZE)
+			refrigerator(PF_FREEZE);
+
+		/* back off until nobody else has used the device for idle_ms */
+		idle = (long)(jiffies - rddist_last_io);
+		timeout = msecs_to_jiffies(rddist_idle_ms);
+		if (idle < timeout) {
+			set_current_state(TASK_INTERRUPTIBLE);
+			schedule_timeout(timeout - idle);
+			continue;
+		}
+
+		if (rddist_dequeue(&block, &reason_code)) {
+			rddist_fix(block, reason_code);
+			continue;
+		}
+
+		timeout = (long)rddist_save_interval * HZ;
+		if (rddist_part && rddist_save_interval &&
+		    (long)(jiffies - rddist_last_save) >= timeout) {
+			rddist_save();
+			continue;
+		}
+
+		if (!rddist_part || !rddist_save_interval)
+			timeout = MAX_SCHEDULE_TIMEOUT;
+		else
+			timeout -= (long)(jiffies - rddist_last_save);
+		wait_event_interruptible_timeout(rddist_waitq,
+			rddist_queue.count || kthread_should_stop(), timeout);
+	}
+	return 0;
+}
+
+/*
+ * sysfs interface - /sys/nand_rddist
+ */
+
+static decl_subsys(nand_rddist, NULL, NULL);
+
+#define RDDIST_ATTR_RO(_name) \
+static struct subsys_attribute _name##_attr = __ATTR_RO(_name)
+
+#define RDDIST_ATTR_RW(_name) \
+static struct subsys_attribute _name##_attr = \
+	__ATTR(_name, 0644, _name##_show, _name##_store)
+
+/* log2 buckets: 0, 1, 2-3, 4-7 ... 32768-65535 */
+static ssize_t rddist_hist_show(int tbl, char *page)
+{
+	unsigned int hist[17];
+	u16 *cnt = g_read_dist_info.blk_tbl[tbl];
+	char *s = page;
+	int i;
+
+	if (!cnt)
+		return -ENODEV;
+
+	memset(hist, 0, sizeof(hist));
+	for (i = 0; i < g_read_dist_info.numblocks; i++)
+		hist[cnt[i] ? fls(cnt[i]) : 0]++;
+
+	s += sprintf(s, "0 %u\n", hist[0]);
+	for (i = 1; i < 17; i++)
+		s += sprintf(s, "%u-%u %u\n", 1 << (i - 1), (1 << i) - 1, hist[i]);
+	return s - page;
+}
+
+static ssize_t read_hist_show(struct subsystem *subsys, char *page)
+{
+	return rddist_hist_show(RDCNT_TBL, page);
+}
+RDDIST_ATTR_RO(read_hist);
+
+static ssize_t erase_hist_show(struct subsystem *subsys, char *page)
+{
+	return rddist_hist_show(ERASECNT_TBL, page);
+}
+RDDIST_ATTR_RO(erase_hist);
+
+static ssize_t stats_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "queued %d\nfixed %u\nfailed %u\ndropped %u\nsaves %u\nrecord %u\n",
+		       rddist_queue.count, rddist_fixed, rddist_failed, rddist_dropped,
+		       rddist_saves, rddist_seq);
+}
+RDDIST_ATTR_RO(stats);
+
+#define RDDIST_TUNABLE(_name, _var, _max)					\
+static ssize_t _name##_show(struct subsystem *subsys, char *page)		\
+{										\
+	return sprintf(page, "%u\n", _var);					\
+}										\
+static ssize_t _name##_store(struct subsystem *subsys, const char *buf,	\
+			     size_t n)						\
+{										\
+	char *end;								\
+	unsigned long v = simple_strtoul(buf, &end, 0);				\
+										\
+	if (end == buf || v > (_max))						\
+		return -EINVAL;							\
+	_var = v;								\
+	wake_up_interruptible(&rddist_waitq);					\
+	return n;								\
+}										\
+RDDIST_ATTR_RW(_name)
+
+RDDIST_TUNABLE(refresh_reads, rddist_refresh_reads, 0xffff);
+RDDIST_TUNABLE(idle_ms, rddist_idle_ms, 60 * 1000);
+RDDIST_TUNABLE(save_interval, rddist_save_interval, 7 * 24 * 3600);
+
+static struct attribute *rddist_attrs[] = {
+	&read_hist_attr.attr,
+	&erase_hist_attr.attr,
+	&stats_attr.attr,
+	&refresh_reads_attr.attr,
+	&idle_ms_attr.attr,
+	&save_interval_attr.attr,
+	NULL
+};
+
+static struct attribute_group rddist_attr_group = {
+	.attrs = rddist_attrs,
+};
+
+/*
+ * Runs after the board driver has scanned the chip and added its
+ * partitions; g_read_dist_info is shared with mtdchar, so the NAND core
+ * is built in whenever CONFIG_MOT_FEAT_NAND_RDDIST is set.
+ */
+static int __init nand_rddist_init(void)
+{
+	struct task_struct *task;
+	int error;
+
+	if (!rddist_master)
+		return 0;
+
+	error = subsystem_register(&nand_rddist_subsys);
+	if (!error)
+		error = sysfs_create_group(&nand_rddist_subsys.kset.kobj,
+					   &rddist_attr_group);
+	if (error)
+		printk(KERN_WARNING "nand_rddist: sysfs registration failed\n");
+
+	task = kthread_run(nand_rddistd, NULL, "nand_rddistd");
+	if (IS_ERR(task)) {
+		printk(KERN_ERR "nand_rddist: cannot start nand_rddistd\n");
+		return PTR_ERR(task);
+	}
+	rddist_task = task;
+	return 0;
+}
+
+late_initcall(nand_rddist_init);
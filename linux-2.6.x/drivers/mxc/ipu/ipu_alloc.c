@@ -1,5 +1,6 @@
 /*
  * Copyright 2005-2006 Freescale Semiconductor, Inc. All Rights Reserved.
+ * Copyright (C) 2026 Motorola, Inc.
  */
 
 /*
@@ -9,6 +10,13 @@
  *
  * http://www.opensource.org/licenses/gpl-license.html
  * http://www.gnu.org/copyleft/gpl.html
+ *
+ * Date     Author      Comment
+ * 10/2026  Motorola    Replace the sorted descriptor list with a
+ *                      segregated-fit allocator, add /proc statistics
+ *                      and turn ipu_malloc_test into a stress harness
+ * 10/2026  Motorola    Keep free extents in a size ordered rbtree so
+ *                      allocation is O(log n)
  */
 
 /*!
@@ -16,6 +24,19 @@
  *
  * @brief simple ipu allocation driver for linux
  *
+ * The pool is split into pages of the pool alignment. Free extents are
+ * kept in an rbtree ordered by length and then by address, and every
+ * extent is described by boundary tags in a page descriptor array that
+ * is allocated once, so neither ipu_malloc() nor ipu_free() allocates
+ * memory. ipu_malloc() takes the shortest extent that fits, lowest
+ * address first, in O(log n); ipu_free() finds its free neighbours in
+ * constant time and re-inserts the merged extent in O(log n).
+ *
+ * Small requests are carved from the bottom of the chosen extent.
+ * Requests of IPU_POOL_LARGE_PAGES or more (frame buffers) are carved
+ * from its top, so long lived frame buffers stay clear of the space the
+ * small buffers churn through at the bottom of the extent.
+ *
  * @ingroup IPU
  */
 
@@ -23,132 +44,249 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/ctype.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/proc_fs.h>
 #include <asm/semaphore.h>
 #include "ipu.h"
 #include "ipu_prv.h"
 
 /* #define IPU_MALLOC_TEST 1 */
-static u32 gIPUPoolStart = 0;
-static u32 gTotalPages = 0;
-static u32 gAlignment = IPU_PAGE_ALIGN;
-static memDesc *gAllocatedDesc = NULL;
-static struct semaphore gIPUSema;
+static ipuPool gIPUPool;
 
-/*!
- * ipu_pool_initialize
- *
- * @param       memPool         start address of the pool
- * @param       poolSize        memory pool size
- * @param       alignment       alignment for example page alignmnet will be 4K
- *
- * @return      0 for success  -1 for errors
- */
-int ipu_pool_initialize(u32 memPool, u32 poolSize, u32 alignment)
+static void ipu_pool_insert(ipuPool * pool, u32 start, u32 pages)
 {
-	gAlignment = alignment;
-	if (gAlignment == 0) {
-		printk("ipu_pool_initialize : gAlignment can not be zero.\n");
-		gAlignment = IPU_PAGE_ALIGN;
+	ipuPageDesc *pd = &pool->page[start], *cur;
+	struct rb_node **link = &pool->free_tree.rb_node, *parent = NULL;
+
+	pd->pages = pages;
+	pd->free = 1;
+	pool->page[start + pages - 1].head = start;
+
+	while (*link) {
+		parent = *link;
+		cur = rb_entry(parent, ipuPageDesc, node);
+		if (pages < cur->pages || (pages == cur->pages && pd < cur))
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
 	}
+	rb_link_node(&pd->node, parent, link);
+	rb_insert_color(&pd->node, &pool->free_tree);
+	pool->free_extents++;
+}
+
+static void ipu_pool_remove(ipuPool * pool, u32 start)
+{
+	ipuPageDesc *pd = &pool->page[start];
+
+	rb_erase(&pd->node, &pool->free_tree);
+	pd->free = 0;
+	pd->pages = 0;
+	pool->free_extents--;
+}
 
-	gTotalPages = poolSize / gAlignment;
-	gIPUPoolStart = (u32) memPool;
+static int _ipu_pool_init(ipuPool * pool, u32 memPool, u32 poolSize,
+			  u32 alignment)
+{
+	pool->alignment = alignment;
+	if (pool->alignment == 0) {
+		printk("ipu_pool_initialize : gAlignment can not be zero.\n");
+		pool->alignment = IPU_PAGE_ALIGN;
+	}
 
-	gAllocatedDesc = (memDesc *) kmalloc(sizeof(memDesc), GFP_KERNEL);
-	if (!gAllocatedDesc) {
-		printk("ipu_pool_initialize : kmalloc failed \n");
+	pool->start = memPool;
+	pool->total_pages = poolSize / pool->alignment;
+	pool->free_pages = pool->total_pages;
+	pool->free_extents = 0;
+	pool->high_water = 0;
+	pool->allocs = 0;
+	pool->failures = 0;
+
+	vfree(pool->page);
+	pool->page = vmalloc(pool->total_pages * sizeof(ipuPageDesc));
+	if (!pool->page) {
+		printk("ipu_pool_initialize : vmalloc failed \n");
+		pool->total_pages = 0;
 		return (-1);
 	}
+	memset(pool->page, 0, pool->total_pages * sizeof(ipuPageDesc));
 
-	gAllocatedDesc->start = 0;
-	gAllocatedDesc->end = 0;
-	gAllocatedDesc->next = NULL;
+	pool->free_tree = RB_ROOT;
+	if (pool->total_pages)
+		ipu_pool_insert(pool, 0, pool->total_pages);
 
-	init_MUTEX(&gIPUSema);
+	init_MUTEX(&pool->sema);
 	return (0);
 }
 
-/*!
- * ipu_malloc
- *
- * @param       size        memory pool size
- *
- * @return      physical address, 0 for error
- */
-u32 ipu_malloc(u32 size)
+static u32 _ipu_malloc(ipuPool * pool, u32 size)
 {
-	memDesc *prevDesc = NULL;
-	memDesc *nextDesc = NULL;
-	memDesc *currentDesc = NULL;
-	u32 pages = (size + gAlignment - 1) / gAlignment;
+	ipuPageDesc *pd, *best = NULL;
+	struct rb_node *n;
+	u32 pages = (size + pool->alignment - 1) / pool->alignment;
+	u32 start, found;
+	int large = pages >= IPU_POOL_LARGE_PAGES;
 
-	FUNC_START;
 	DPRINTK("ipu_malloc alloacte page %x  gTotalPages %x\n", pages,
-		gTotalPages);
+		pool->total_pages);
 
-	if ((size == 0) || (pages > gTotalPages))
+	if ((size == 0) || (pages > pool->total_pages))
 		return 0;
 
-	down(&gIPUSema);
+	down(&pool->sema);
+
+	/* find the leftmost, i.e. shortest and lowest, extent that fits */
+	n = pool->free_tree.rb_node;
+	while (n) {
+		pd = rb_entry(n, ipuPageDesc, node);
+		if (pd->pages >= pages) {
+			best = pd;
+			n = n->rb_left;
+		} else
+			n = n->rb_right;
+	}
 
-	currentDesc = (memDesc *) kmalloc(sizeof(memDesc), GFP_KERNEL);
-	if (!currentDesc) {
-		printk("ipu_malloc: kmalloc failed \n");
-		up(&gIPUSema);
+	if (!best) {
+		pool->failures++;
+		up(&pool->sema);
+		DPRINTK("page %x gTotalPages %x free %x\n", pages,
+			pool->total_pages, pool->free_pages);
 		return 0;
 	}
 
-	/* Create the first Allocated descriptor */
-	if (!gAllocatedDesc->next) {
-		gAllocatedDesc->next = currentDesc;
-		currentDesc->start = 0;
-		currentDesc->end = pages;
-		currentDesc->next = NULL;
-		up(&gIPUSema);
-		DPRINTK("ipu_malloc 1st current->start %x current->end %x\n",
-			currentDesc->start, currentDesc->end);
-		return (gIPUPoolStart + currentDesc->start * gAlignment);
+	start = best - pool->page;
+	found = best->pages;
+	ipu_pool_remove(pool, start);
+
+	if (large) {
+		if (found > pages)
+			ipu_pool_insert(pool, start, found - pages);
+		start += found - pages;
+	} else if (found > pages) {
+		ipu_pool_insert(pool, start + pages, found - pages);
 	}
 
-	/* Find the free spot */
-	prevDesc = gAllocatedDesc;
-	while (prevDesc->next) {
-		nextDesc = prevDesc->next;
-		if (pages <= nextDesc->start - prevDesc->end) {
-			currentDesc->start = prevDesc->end;
-			currentDesc->end = currentDesc->start + pages;
-			currentDesc->next = nextDesc;
-			prevDesc->next = currentDesc;
-			DPRINTK("find middle cur->start %x cur->end %x\n",
-				currentDesc->start, currentDesc->end);
-			break;
-		}
-		prevDesc = nextDesc;
+	pool->page[start].pages = pages;
+	pool->free_pages -= pages;
+	pool->allocs++;
+	if (pool->total_pages - pool->free_pages > pool->high_water)
+		pool->high_water = pool->total_pages - pool->free_pages;
+
+	up(&pool->sema);
+
+	DPRINTK("ipu_malloc: return %x\n",
+		pool->start + start * pool->alignment);
+	return (pool->start + start * pool->alignment);
+}
+
+static void _ipu_free(ipuPool * pool, u32 physical)
+{
+	ipuPageDesc *pd;
+	u32 start = (physical - pool->start) / pool->alignment;
+	u32 pages, head;
+
+	DPRINTK("ipu_free alloacte page %x \n", start);
+
+	if (!pool->page)
+		return;
+
+	/* Protect the memory pool data structures. */
+	down(&pool->sema);
+
+	if (start >= pool->total_pages || pool->page[start].free ||
+	    !pool->page[start].pages) {
+		up(&pool->sema);
+		printk(KERN_WARNING "ipu_free: 0x%08x was not allocated\n",
+		       physical);
+		return;
 	}
 
-	/* Do not find the free spot inside the chain, append to the end */
-	if (!prevDesc->next) {
-		if (pages > (gTotalPages - prevDesc->end)) {
-			up(&gIPUSema);
-			DPRINTK("page %x gTotalPages %x prevDesc->end %x",
-				pages, gTotalPages, prevDesc->end);
-			return 0;
-		} else {
-			currentDesc->start = prevDesc->end;
-			currentDesc->end = currentDesc->start + pages;
-			currentDesc->next = NULL;
-			prevDesc->next = currentDesc;
-			DPRINTK("append end:cur->start %x cur->end %x\n",
-				currentDesc->start, currentDesc->end);
+	pd = &pool->page[start];
+	pages = pd->pages;
+	pd->pages = 0;
+	pool->free_pages += pages;
+
+	/* merge with the free extent that follows */
+	if (start + pages < pool->total_pages &&
+	    pool->page[start + pages].free) {
+		u32 next = start + pages;
+
+		pages += pool->page[next].pages;
+		ipu_pool_remove(pool, next);
+	}
+
+	/* and with the one that ends just before */
+	if (start > 0) {
+		head = pool->page[start - 1].head;
+		if (head < start && pool->page[head].free &&
+		    head + pool->page[head].pages == start) {
+			pages += pool->page[head].pages;
+			ipu_pool_remove(pool, head);
+			start = head;
 		}
 	}
 
-	up(&gIPUSema);
+	ipu_pool_insert(pool, start, pages);
 
-	DPRINTK("ipu_malloc: return %x\n",
-		gIPUPoolStart + currentDesc->start * gAlignment);
+	/* All done with memory pool data structures. */
+	up(&pool->sema);
+}
+
+static void _ipu_pool_get_stats(ipuPool * pool, ipu_pool_stats_t * stats)
+{
+	struct rb_node *n;
+	u32 largest = 0;
+
+	down(&pool->sema);
+
+	/* the longest extent is the rightmost in the tree */
+	n = rb_last(&pool->free_tree);
+	if (n)
+		largest = rb_entry(n, ipuPageDesc, node)->pages;
+
+	stats->total = pool->total_pages * pool->alignment;
+	stats->free = pool->free_pages * pool->alignment;
+	stats->largest_free = largest * pool->alignment;
+	stats->free_extents = pool->free_extents;
+	stats->high_water = pool->high_water * pool->alignment;
+	stats->allocs = pool->allocs;
+	stats->failures = pool->failures;
+	stats->fragmentation = pool->free_pages ?
+	    100 - largest * 100 / pool->free_pages : 0;
+
+	up(&pool->sema);
+}
+
+/*!
+ * ipu_pool_initialize
+ *
+ * @param       memPool         start address of the pool
+ * @param       poolSize        memory pool size
+ * @param       alignment       alignment for example page alignmnet will be 4K
+ *
+ * @return      0 for success  -1 for errors
+ */
+int ipu_pool_initialize(u32 memPool, u32 poolSize, u32 alignment)
+{
+	return _ipu_pool_init(&gIPUPool, memPool, poolSize, alignment);
+}
+
+/*!
+ * ipu_malloc
+ *
+ * @param       size        memory pool size
+ *
+ * @return      physical address, 0 for error
+ */
+u32 ipu_malloc(u32 size)
+{
+	u32 addr;
+
+	FUNC_START;
+	addr = _ipu_malloc(&gIPUPool, size);
 	FUNC_END;
-	return (gIPUPoolStart + currentDesc->start * gAlignment);
+	return addr;
 }
 
 /*!
@@ -159,124 +297,194 @@ u32 ipu_malloc(u32 size)
  */
 void ipu_free(u32 physical)
 {
-	memDesc *prevDesc = NULL;
-	memDesc *nextDesc = NULL;
-	u32 pages = (physical - gIPUPoolStart) / gAlignment;
-
 	FUNC_START;
-	DPRINTK("ipu_free alloacte page %x \n", pages);
-	/* Protect the memory pool data structures. */
-	down(&gIPUSema);
-
-	prevDesc = gAllocatedDesc;
-	while (prevDesc->next) {
-		nextDesc = prevDesc->next;
-		if (nextDesc->start == pages) {
-			prevDesc->next = nextDesc->next;
-			DPRINTK("ipu_free next->start %x next->end %x \n",
-				nextDesc->start, nextDesc->end);
-			DPRINTK("ipu_free prev->start %x prev->end %x \n",
-				prevDesc->start, prevDesc->end);
-			kfree(nextDesc);
-			break;
+	_ipu_free(&gIPUPool, physical);
+	FUNC_END;
+}
+
+/*!
+ * ipu_pool_get_stats
+ *
+ * @param       stats       filled with the current pool statistics
+ *
+ */
+void ipu_pool_get_stats(ipu_pool_stats_t * stats)
+{
+	_ipu_pool_get_stats(&gIPUPool, stats);
+}
+
+#ifdef CONFIG_PROC_FS
+static int ipu_pool_proc_read(char *page, char **start, off_t off,
+			      int count, int *eof, void *data)
+{
+	ipu_pool_stats_t stats;
+	char *p = page;
+
+	if (!gIPUPool.page) {
+		*eof = 1;
+		return 0;
+	}
+
+	ipu_pool_get_stats(&stats);
+	p += sprintf(p, "total          %u\n", stats.total);
+	p += sprintf(p, "free           %u\n", stats.free);
+	p += sprintf(p, "largest free   %u\n", stats.largest_free);
+	p += sprintf(p, "free extents   %u\n", stats.free_extents);
+	p += sprintf(p, "fragmentation  %u%%\n", stats.fragmentation);
+	p += sprintf(p, "high water     %u\n", stats.high_water);
+	p += sprintf(p, "allocations    %u\n", stats.allocs);
+	p += sprintf(p, "failures       %u\n", stats.failures);
+
+	*eof = 1;
+	return p - page;
+}
+#endif
+
+#ifdef IPU_MALLOC_TEST
+#define IPU_TEST_POOL_BASE	0x80000000
+#define IPU_TEST_POOL_SIZE	(SZ_1M * 8)
+#define IPU_TEST_SLOTS		64
+#define IPU_TEST_ROUNDS		20000
+
+/*
+ * Sizes seen on the phone: rotation and post filter buffers, QVGA and
+ * VGA preview frames in RGB565 and YUV420, and a few small tables.
+ */
+static const u32 ipu_test_sizes[] = {
+	0x100, 0x1000, 0x3000, 320 * 240 * 2, 320 * 240 * 3 / 2,
+	176 * 220 * 2, 640 * 480 * 3 / 2, 640 * 480 * 2,
+};
+
+static u32 ipu_test_seed = 1;
+
+static u32 ipu_test_rand(void)
+{
+	ipu_test_seed = ipu_test_seed * 1103515245 + 12345;
+	return ipu_test_seed >> 8;
+}
+
+/*
+ * Checks the pool against the list of live buffers: no two buffers may
+ * overlap and the free page count must match.
+ */
+static int ipu_test_check(ipuPool * pool, u32 * addr, u32 * size)
+{
+	u32 used = 0, i, j;
+
+	for (i = 0; i < IPU_TEST_SLOTS; i++) {
+		if (!addr[i])
+			continue;
+		used += (size[i] + pool->alignment - 1) / pool->alignment;
+		for (j = i + 1; j < IPU_TEST_SLOTS; j++) {
+			if (addr[j] && addr[i] < addr[j] + size[j] &&
+			    addr[j] < addr[i] + size[i]) {
+				printk(KERN_ERR "ipu_malloc_test: %x+%x "
+				       "overlaps %x+%x\n", addr[i], size[i],
+				       addr[j], size[j]);
+				return -1;
+			}
 		}
-		prevDesc = prevDesc->next;
 	}
-	/* All done with memory pool data structures. */
-	up(&gIPUSema);
-	FUNC_END;
+	if (used != pool->total_pages - pool->free_pages) {
+		printk(KERN_ERR "ipu_malloc_test: %u pages live, pool says "
+		       "%u\n", used, pool->total_pages - pool->free_pages);
+		return -1;
+	}
+	return 0;
 }
 
 /*
  * ipu_malloc_test	 debug only
  *
+ * Runs a private pool through random allocations and frees of typical
+ * IPU buffer sizes, checking it for overlaps and leaks every round, and
+ * prints the time taken and the fragmentation seen.
  */
-static __init int ipu_malloc_test(void)
+static __init void ipu_malloc_test(void)
 {
+	static ipuPool pool;
+	static u32 addr[IPU_TEST_SLOTS], size[IPU_TEST_SLOTS];
+	ipu_pool_stats_t stats;
+	unsigned long t0, ops = 0, fails = 0, worst = 0;
+	int round, i;
+
+	if (_ipu_pool_init(&pool, IPU_TEST_POOL_BASE, IPU_TEST_POOL_SIZE,
+			   IPU_PAGE_ALIGN))
+		return;
+
+	/* an exact fit must come back at the bottom, the rest at the top */
+	addr[0] = _ipu_malloc(&pool, 0x100);
+	addr[1] = _ipu_malloc(&pool, 640 * 480 * 2);
+	if (addr[0] != IPU_TEST_POOL_BASE ||
+	    addr[1] != IPU_TEST_POOL_BASE + IPU_TEST_POOL_SIZE -
+	    PAGE_ALIGN(640 * 480 * 2))
+		printk(KERN_ERR "ipu_malloc_test: placement %x %x\n",
+		       addr[0], addr[1]);
+	_ipu_free(&pool, addr[0]);
+	_ipu_free(&pool, addr[1]);
+	addr[0] = addr[1] = 0;
+	if (pool.free_extents != 1 || pool.free_pages != pool.total_pages)
+		printk(KERN_ERR "ipu_malloc_test: free did not merge\n");
+	if (_ipu_malloc(&pool, IPU_TEST_POOL_SIZE + 1) != 0)
+		printk(KERN_ERR "ipu_malloc_test: oversize allocation\n");
+
+	t0 = jiffies;
+	for (round = 0; round < IPU_TEST_ROUNDS; round++) {
+		i = ipu_test_rand() % IPU_TEST_SLOTS;
+		if (addr[i]) {
+			_ipu_free(&pool, addr[i]);
+			addr[i] = 0;
+		} else {
+			size[i] = ipu_test_sizes[ipu_test_rand() %
+						 ARRAY_SIZE(ipu_test_sizes)];
+			if (!(addr[i] = _ipu_malloc(&pool, size[i])))
+				fails++;
+		}
+		ops++;
+
+		if ((round & 255) == 0) {
+			if (ipu_test_check(&pool, addr, size))
+				break;
+			_ipu_pool_get_stats(&pool, &stats);
+			if (stats.fragmentation > worst)
+				worst = stats.fragmentation;
+		}
+	}
+	t0 = jiffies - t0;
+
+	_ipu_pool_get_stats(&pool, &stats);
+	printk(KERN_INFO "ipu_malloc_test: %lu ops in %u ms, %lu failed, "
+	       "high water %uK, worst fragmentation %lu%%\n", ops,
+	       jiffies_to_msecs(t0), fails, stats.high_water >> 10, worst);
+
+	for (i = 0; i < IPU_TEST_SLOTS; i++)
+		if (addr[i])
+			_ipu_free(&pool, addr[i]);
+	if (pool.free_extents != 1 || pool.free_pages != pool.total_pages)
+		printk(KERN_ERR "ipu_malloc_test: pool not empty at exit\n");
+	vfree(pool.page);
+}
+#endif
+
+static __init int ipu_alloc_init(void)
+{
+#ifdef CONFIG_PROC_FS
+	create_proc_read_entry("driver/ipu_pool", 0, NULL,
+			       ipu_pool_proc_read, NULL);
+#endif
 #ifdef IPU_MALLOC_TEST
-	u32 address1, address2, address3, address4;
-	ipu_pool_initialize(MXCIPU_MEM_ADDRESS, MXCIPU_MEM_SIZE, IPU_PAGE_ALIGN);
-	address1 = ipu_malloc(0x100);
-	if (address1 != MXCIPU_MEM_ADDRESS)
-		printk("expect %x addess1 = %x\n",
-		       MXCIPU_MEM_ADDRESS, address1);
-
-	address2 = ipu_malloc(0x10000);
-	if (address2 != MXCIPU_MEM_ADDRESS + 0x1000)
-		printk("expect %x addess2 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0x1000, address2);
-
-	address3 = ipu_malloc(0x200);
-	if (address3 != MXCIPU_MEM_ADDRESS + 0x11000)
-		printk("expect %x addess3 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0x11000, address3);
-
-	address4 = ipu_malloc(0x20000);
-	if (address4 != MXCIPU_MEM_ADDRESS + 0x12000)
-		printk("expect %x addess4 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0x12000, address4);
-
-	ipu_free(address2);
-	address2 = ipu_malloc(0x1000);
-	if (address2 != MXCIPU_MEM_ADDRESS + 0x1000)
-		printk("expect %x addess2 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0x1000, address2);
-
-	ipu_free(address3);
-	address3 = ipu_malloc(0x2000);
-	if (address3 != MXCIPU_MEM_ADDRESS + 0x2000)
-		printk("expect %x addess3 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0x2000, address3);
-
-	ipu_free(address4);
-	address4 = ipu_malloc(0xc000);
-	if (address4 != MXCIPU_MEM_ADDRESS + 0x4000)
-		printk("expect %x addess4 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0x4000, address4);
-
-	ipu_free(address2);
-	address2 = ipu_malloc(0x20000);
-	if (address2 != MXCIPU_MEM_ADDRESS + 0x10000)
-		printk("expect %x addess2 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0x10000, address2);
-
-	ipu_free(address1);
-	address1 = ipu_malloc(0x40000);
-	if (address1 != MXCIPU_MEM_ADDRESS + 0x30000)
-		printk("expect %x addess1 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0x30000, address1);
-
-	ipu_free(address2);
-	address2 = ipu_malloc(0x40000);
-	if (address2 != MXCIPU_MEM_ADDRESS + 0x70000)
-		printk("expect %x addess2 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0x70000, address2);
-
-	ipu_free(address3);
-	address3 = ipu_malloc(0x50000);
-	if (address3 != MXCIPU_MEM_ADDRESS + 0xb0000)
-		printk("expect %x addess3 = %x \n",
-		       MXCIPU_MEM_ADDRESS + 0xb0000, address3);
-
-	ipu_free(address3);
-	address3 = ipu_malloc(0x50001);
-	if (address3 != 0)
-		printk("expect %x addess3 = %x \n", 0, address3);
-
-	ipu_free(address1);
-	ipu_free(address2);
-	ipu_free(address3);
-	ipu_free(address4);
+	ipu_malloc_test();
 #endif
 	return 0;
 }
 
-module_init(ipu_malloc_test);
+module_init(ipu_alloc_init);
 
 /* Exported symbols for modules. */
 EXPORT_SYMBOL(ipu_pool_initialize);
 EXPORT_SYMBOL(ipu_malloc);
 EXPORT_SYMBOL(ipu_free);
+EXPORT_SYMBOL(ipu_pool_get_stats);
 
 MODULE_PARM(video_nr, "i");
 MODULE_AUTHOR("Freescale Semiconductor, Inc.");
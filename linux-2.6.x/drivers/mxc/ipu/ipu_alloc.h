@@ -1,5 +1,6 @@
 /*
  * Copyright 2005-2006 Freescale Semiconductor, Inc. All Rights Reserved.
+ * Copyright (C) 2026 Motorola, Inc.
  */
 
 /*
@@ -9,6 +10,10 @@
  *
  * http://www.opensource.org/licenses/lgpl-license.html
  * http://www.gnu.org/copyleft/lgpl.html
+ *
+ * Date     Author      Comment
+ * 10/2026  Motorola    Segregated-fit pool allocator and pool statistics
+ * 10/2026  Motorola    Free extents kept in a size ordered rbtree
  */
 
 /*!
@@ -21,13 +26,65 @@
 #ifndef _IPU_ALLOC_H_
 #define _IPU_ALLOC_H_
 
+#include <linux/rbtree.h>
+#include <asm/semaphore.h>
+
 #define IPU_PAGE_ALIGN   ((u32) 0x00001000)
 
-typedef struct _memDesc {
+/*!
+ * Requests of at least this many pages are placed at the top of the free
+ * extent they are taken from, away from the small buffers that come and
+ * go at the bottom.
+ */
+#define IPU_POOL_LARGE_PAGES	16
+
+/*!
+ * Per page descriptor. Only the first page of an extent, and the last
+ * page of a free extent, carry information.
+ */
+typedef struct {
+	/*! Free tree node, first page of a free extent */
+	struct rb_node node;
+	/*! Extent length in pages, first page of an extent, 0 elsewhere */
+	u32 pages;
+	/*! First page of the extent, last page of a free extent */
+	u32 head;
+	/*! Nonzero if the extent starting here is free */
+	u32 free;
+} ipuPageDesc;
+
+/*!
+ * IPU memory pool
+ */
+typedef struct {
 	u32 start;
-	u32 end;
-	struct _memDesc *next;
-} memDesc;
+	u32 alignment;
+	u32 total_pages;
+	u32 free_pages;
+	u32 free_extents;
+	u32 high_water;
+	u32 allocs;
+	u32 failures;
+	ipuPageDesc *page;
+	/*! Free extents ordered by length, then by address */
+	struct rb_root free_tree;
+	struct semaphore sema;
+} ipuPool;
+
+/*!
+ * IPU memory pool statistics, all sizes in bytes
+ */
+typedef struct {
+	u32 total;
+	u32 free;
+	u32 largest_free;
+	u32 free_extents;
+	u32 high_water;
+	u32 allocs;
+	u32 failures;
+	/*! 0 when all free memory is one extent, up to 100 */
+	u32 fragmentation;
+} ipu_pool_stats_t;
 
 /*!
  * ipu_pool_initialize
@@ -57,4 +114,12 @@ u32 ipu_malloc(u32 size);
  */
 void ipu_free(u32 physical);
 
+/*!
+ * ipu_pool_get_stats
+ *
+ * @param       stats       filled with the current pool statistics
+ *
+ */
+void ipu_pool_get_stats(ipu_pool_stats_t * stats);
+
 #endif
@@ -24,6 +24,7 @@
  *                              using sdma channel at the same time.
  * 08/01/2008    Motorola       Add protection for channel 0 to fix dropped WiFi call issue.
  * 08/11/2008    Motorola       Protect variable ipai_SDMAintr with spin lock to fix MMC log stop issue. 
+ * 10/17/2026    Motorola       Added /proc/sdma/pool buffers pool occupancy.
  *
  */
 
@@ -93,6 +94,8 @@ static struct semaphore sdma_synch_mutex[MAX_DMA_CHANNELS];
  * SDMA buffers pool initialization function
  */
 extern void init_sdma_pool(void);
+extern int sdma_pool_proc_read(char *buf, char **start, off_t offset,
+			       int count, int *eof, void *data);
 
 #ifdef CONFIG_MOT_FEAT_MXC_IPC_SDMA_STATS
 static unsigned long rxcnt;
@@ -1156,6 +1159,8 @@ static int __init init_proc_fs(void)
 	sdma_proc_dir = proc_mkdir("sdma", NULL);
 	create_proc_read_entry("channels", 0, sdma_proc_dir,
 			       proc_read_channels, NULL);
+	create_proc_read_entry("pool", 0, sdma_proc_dir,
+			       sdma_pool_proc_read, NULL);
 
 	if (res < 0) {
 		printk(KERN_WARNING "Failed create SDMA proc entry\n");
@@ -20,6 +20,9 @@
  * 19/03/2008    Motorola       Protect hashtable to avoid race condition
  *                              (For SMP, pls use spin_lock_irq() instead of local_irq_save_nort()). 
  *                              Is there a protect solution without disable irq? disable preemption,... 
+ * 10/17/2026    Motorola       Replace the hash tables with size classes carved
+ *                              from coherent arenas; translation is arithmetic.
+ *                              Add multi-buffer allocation and /proc/sdma/pool.
  */
 
 /*!
@@ -35,6 +38,9 @@
 #include <linux/init.h>
 #include <linux/types.h>
 #include <linux/mm.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <asm/semaphore.h>
 #include <asm/dma.h>
 #include <asm/mach/dma.h>
 #include <asm/arch/hardware.h>
@@ -42,7 +48,6 @@
 
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
-#include <linux/dmapool.h>
 
 #define DEBUG 0
 
@@ -52,132 +57,314 @@
 #define DPRINTK(fmt, args...)
 #endif
 
+/*
+ * SDMA buffers are carved out of a few large coherent arenas.  Each arena
+ * is contiguous in both virtual and physical space, so translating an
+ * address is a range check and an add.  Arenas are only ever added, and
+ * a new one is published before the count is bumped, so translation
+ * needs no lock.
+ *
+ * Every page of an arena belongs to one size class while it holds any
+ * buffers, and keeps its free buffers on a list threaded through the
+ * buffers themselves.  A page whose last buffer is freed goes back to
+ * the arena for any class to reuse.
+ */
+
+/*!
+ * Defines the smallest SDMA buffer, as a power of 2
+ */
+#define SDMA_MIN_SHIFT		5
+
+/*!
+ * Number of size classes, from 32 bytes up to a page
+ */
+#define SDMA_CLASSES		(PAGE_SHIFT - SDMA_MIN_SHIFT + 1)
+
 /*!
- * Defines SDMA non-cacheable buffers pool
+ * Defines the number of pages in each arena
  */
-static struct dma_pool *pool;
+#define SDMA_ARENA_PAGES	16
 
 /*!
- * SDMA memory conversion hashing structure
+ * Defines the largest number of arenas
+ */
+#define SDMA_MAX_ARENAS		16
+
+/*!
+ * Marks an arena page that is not given to any size class
+ */
+#define SDMA_PAGE_FREE		0xff
+
+/*!
+ * SDMA arena page descriptor
+ */
+typedef struct {
+	/*! Link in the class list of pages with free buffers */
+	struct list_head list;
+	/*! First free buffer in this page */
+	void *free;
+	/*! Buffers handed out from this page */
+	unsigned short inuse;
+	/*! Size class of this page, or SDMA_PAGE_FREE */
+	unsigned char class;
+} sdma_page;
+
+/*!
+ * SDMA coherent arena
  */
 typedef struct {
 	/*! Virtual address */
 	void *virt;
 	/*! Physical address */
-	unsigned long phys;
-} virt_phys_struct;
+	dma_addr_t phys;
+	/*! Page descriptors */
+	sdma_page page[SDMA_ARENA_PAGES];
+} sdma_arena;
 
 /*!
- * Defines SDMA hash table size
+ * SDMA size class
  */
-#define HASH_SIZE 512
+typedef struct {
+	/*! Pages of this class that have free buffers */
+	struct list_head partial;
+	/*! Pages given to this class */
+	unsigned int pages;
+	/*! Buffers handed out */
+	unsigned int inuse;
+	/*! Largest number of buffers handed out at once */
+	unsigned int peak;
+	/*! Total number of allocations */
+	unsigned long allocs;
+} sdma_class;
+
+static sdma_arena sdma_arenas[SDMA_MAX_ARENAS];
+static int sdma_arena_count;
+static sdma_class sdma_classes[SDMA_CLASSES];
+static unsigned long sdma_alloc_failed;
+
+static spinlock_t sdma_pool_lock = SPIN_LOCK_UNLOCKED;
+static DECLARE_MUTEX(sdma_grow_mutex);
+
+#define SDMA_ARENA_SIZE		(SDMA_ARENA_PAGES << PAGE_SHIFT)
 
 /*!
- * Virtual to physical address conversion hash table
+ * Finds the arena holding a virtual address
+ *
+ * @param   buf  virtual address
+ *
+ * @return       arena, or NULL if buf is not an SDMA buffer
  */
-static virt_phys_struct *virt_to_phys_hash[HASH_SIZE];
+static inline sdma_arena *sdma_find_virt(void *buf)
+{
+	int i, count = sdma_arena_count;
+
+	smp_rmb();
+	for (i = 0; i < count; i++) {
+		if ((unsigned long)buf - (unsigned long)sdma_arenas[i].virt <
+		    SDMA_ARENA_SIZE) {
+			return &sdma_arenas[i];
+		}
+	}
+	return NULL;
+}
+
 /*!
- * Physical to virtual address conversion hash table
+ * Finds the arena holding a physical address
+ *
+ * @param   buf  physical address
+ *
+ * @return       arena, or NULL if buf is not an SDMA buffer
  */
-static virt_phys_struct *phys_to_virt_hash[HASH_SIZE];
+static inline sdma_arena *sdma_find_phys(unsigned long buf)
+{
+	int i, count = sdma_arena_count;
+
+	smp_rmb();
+	for (i = 0; i < count; i++) {
+		if (buf - sdma_arenas[i].phys < SDMA_ARENA_SIZE) {
+			return &sdma_arenas[i];
+		}
+	}
+	return NULL;
+}
 
 /*!
- * Defines the size of each buffer in SDMA pool.
- * The size must be at least 512 bytes, because
- * sdma channel control blocks array size is 512 bytes
+ * Returns the size class for a request
+ *
+ * @param   size  requested size in bytes
+ *
+ * @return        class index, or -1 if size is bigger than a page
  */
-#define SDMA_POOL_SIZE 512
+static inline int sdma_size_class(size_t size)
+{
+	int class = 0;
+
+	if (size > PAGE_SIZE) {
+		return -1;
+	}
+	while ((1UL << (class + SDMA_MIN_SHIFT)) < size) {
+		class++;
+	}
+	return class;
+}
 
 /*!
- * Adds new buffer structure into conversion hash tables
+ * Gives a free arena page to a size class and threads its free list.
+ * Called with sdma_pool_lock held.
  *
- * @param   vf   SDMA memory conversion hashing structure
+ * @param   class  size class index
  *
- * @return       1 on success, 0 on fail
+ * @return         0 on success, -ENOMEM if every arena page is in use
  */
-static int add_entry(virt_phys_struct * vf)
+static int sdma_grab_page(int class)
 {
-	int i, offset;
-	int added;
-	int res;
-	unsigned long flags;
-
-	res = 0;
-	added = 0;
-	offset = (((unsigned long)vf->virt) / SDMA_POOL_SIZE) % HASH_SIZE;
+	int i, j, off, size = 1 << (class + SDMA_MIN_SHIFT);
+	sdma_arena *a;
+	sdma_page *pg;
+	char *buf;
+
+	for (i = 0; i < sdma_arena_count; i++) {
+		a = &sdma_arenas[i];
+		for (j = 0; j < SDMA_ARENA_PAGES; j++) {
+			pg = &a->page[j];
+			if (pg->class != SDMA_PAGE_FREE) {
+				continue;
+			}
 
-	local_irq_save(flags);	
-	for (i = 0; !added && i < HASH_SIZE; i++) {
-		if (virt_to_phys_hash[(i + offset) % HASH_SIZE] == 0) {
-			added = 1;
-			virt_to_phys_hash[(i + offset) % HASH_SIZE] = vf;
-		}
-	}
-	if (added) {
-		added = 0;
-		offset = (vf->phys / SDMA_POOL_SIZE) % HASH_SIZE;
-		for (i = 0; !added && i < HASH_SIZE; i++) {
-			if (phys_to_virt_hash[(i + offset) % HASH_SIZE] == 0) {
-				added = 1;
-				phys_to_virt_hash[(i + offset) % HASH_SIZE] =
-				    vf;
+			pg->class = class;
+			pg->inuse = 0;
+			pg->free = NULL;
+			buf = (char *)a->virt + (j << PAGE_SHIFT);
+			for (off = PAGE_SIZE - size; off >= 0; off -= size) {
+				*(void **)(buf + off) = pg->free;
+				pg->free = buf + off;
 			}
+			list_add(&pg->list, &sdma_classes[class].partial);
+			sdma_classes[class].pages++;
+			return 0;
 		}
-	} else {
-		res = -ENOMEM;
 	}
-	local_irq_restore(flags);
-	return res;
+	return -ENOMEM;
 }
 
 /*!
- * Deletes buffer stracture from conversion hash tables
- *
- * @param   vf   SDMA memory conversion hashing structure
+ * Adds a new coherent arena to the pool
  *
- * @return       1 on success, 0 on fail
+ * @return       0 on success, -ENOMEM on fail
  */
-static int delete_entry(virt_phys_struct * vf)
+static int sdma_grow(void)
 {
-	int i, offset, elem;
-	int deleted;
-	int res;
+	sdma_arena *a;
+	void *virt;
+	dma_addr_t phys;
 	unsigned long flags;
+	int i, count, res = 0;
 
-	res = 0;
-	deleted = 0;
-	offset = (((unsigned long)vf->virt) / SDMA_POOL_SIZE) % HASH_SIZE;
-
-	local_irq_save(flags);	
-	for (i = 0; !deleted && i < HASH_SIZE; i++) {
-		elem = (i + offset) % HASH_SIZE;
-		if (virt_to_phys_hash[elem] != 0 &&
-		    virt_to_phys_hash[elem]->virt == vf->virt) {
-			deleted = 1;
-			virt_to_phys_hash[elem] = 0;
-		}
+	down(&sdma_grow_mutex);
+	count = sdma_arena_count;
+	if (count == SDMA_MAX_ARENAS) {
+		res = -ENOMEM;
+		goto out;
 	}
-	if (deleted) {
-		deleted = 0;
-		offset = (vf->phys / SDMA_POOL_SIZE) % HASH_SIZE;
-		for (i = 0; !deleted && i < HASH_SIZE; i++) {
-			elem = (i + offset) % HASH_SIZE;
-			if (phys_to_virt_hash[elem] != 0 &&
-			    phys_to_virt_hash[elem]->phys == vf->phys) {
-				deleted = 1;
-				kfree(phys_to_virt_hash[elem]);
-				phys_to_virt_hash[elem] = 0;
-			}
-		}
-	} else {
+
+	virt = dma_alloc_coherent(NULL, SDMA_ARENA_SIZE, &phys, GFP_KERNEL);
+	if (virt == NULL) {
 		res = -ENOMEM;
+		goto out;
 	}
-	local_irq_restore(flags);
+
+	a = &sdma_arenas[count];
+	a->virt = virt;
+	a->phys = phys;
+	for (i = 0; i < SDMA_ARENA_PAGES; i++) {
+		a->page[i].class = SDMA_PAGE_FREE;
+	}
+
+	/* publish the arena before anyone can look it up */
+	spin_lock_irqsave(&sdma_pool_lock, flags);
+	smp_wmb();
+	sdma_arena_count = count + 1;
+	spin_unlock_irqrestore(&sdma_pool_lock, flags);
+
+	DPRINTK("arena %d at %p (0x%08x)\n", count, virt, phys);
+      out:
+	up(&sdma_grow_mutex);
 	return res;
 }
 
 /*!
- * Virtual to physical address conversion functio
+ * Takes a buffer from a size class. Called with sdma_pool_lock held.
+ *
+ * @param   class  size class index
+ *
+ * @return         buffer, or NULL if the class has no free buffer
+ */
+static void *sdma_get_buf(int class)
+{
+	sdma_class *c = &sdma_classes[class];
+	sdma_page *pg;
+	void *buf;
+
+	if (list_empty(&c->partial) && sdma_grab_page(class) < 0) {
+		return NULL;
+	}
+
+	pg = list_entry(c->partial.next, sdma_page, list);
+	buf = pg->free;
+	pg->free = *(void **)buf;
+	pg->inuse++;
+	if (pg->free == NULL) {
+		list_del(&pg->list);
+	}
+
+	c->allocs++;
+	if (++c->inuse > c->peak) {
+		c->peak = c->inuse;
+	}
+	return buf;
+}
+
+/*!
+ * Returns a buffer to its page. Called with sdma_pool_lock held.
+ *
+ * @param   buf  buffer pointer
+ */
+static void sdma_put_buf(void *buf)
+{
+	sdma_arena *a = sdma_find_virt(buf);
+	sdma_page *pg;
+	sdma_class *c;
+
+	if (a == NULL) {
+		printk(KERN_WARNING "sdma_free: %p is not an SDMA buffer\n",
+		       buf);
+		return;
+	}
+
+	pg = &a->page[((char *)buf - (char *)a->virt) >> PAGE_SHIFT];
+	if (pg->class == SDMA_PAGE_FREE || pg->inuse == 0) {
+		printk(KERN_WARNING "sdma_free: %p is already free\n", buf);
+		return;
+	}
+	c = &sdma_classes[pg->class];
+
+	if (pg->free == NULL) {
+		list_add(&pg->list, &c->partial);
+	}
+	*(void **)buf = pg->free;
+	pg->free = buf;
+	c->inuse--;
+
+	if (--pg->inuse == 0) {
+		/* the whole page is free, give it back to the arena */
+		list_del(&pg->list);
+		pg->class = SDMA_PAGE_FREE;
+		c->pages--;
+	}
+}
+
+/*!
+ * Virtual to physical address conversion function
  *
  * @param   buf  pointer to virtual address
  *
@@ -185,35 +372,16 @@ static int delete_entry(virt_phys_struct * vf)
  */
 unsigned long sdma_virt_to_phys(void *buf)
 {
-	int i, offset, elem;
-	int found;
-	unsigned long res;
-
-	found = 0;
-	res = 0;
-	offset = (((unsigned long)buf) / SDMA_POOL_SIZE) % HASH_SIZE;
-
-	for (i = 0; !found && i < HASH_SIZE; i++) {
-		elem = (i + offset) % HASH_SIZE;
-		if (virt_to_phys_hash[elem] != 0 &&
-		    ((unsigned long)(virt_to_phys_hash[elem]->virt)) /
-		    SDMA_POOL_SIZE == ((unsigned long)buf) / SDMA_POOL_SIZE) {
-			found = 1;
-			res = ((unsigned long)(virt_to_phys_hash[elem]->phys)) +
-			    (unsigned long)((unsigned long)buf %
-					    SDMA_POOL_SIZE);
-		}
-	}
+	sdma_arena *a = sdma_find_virt(buf);
 
-	if (!found) {
-		res = virt_to_phys(buf);
+	if (a == NULL) {
+		return virt_to_phys(buf);
 	}
-
-	return res;
+	return a->phys + ((char *)buf - (char *)a->virt);
 }
 
 /*!
- * Physical to virtual address conversion functio
+ * Physical to virtual address conversion function
  *
  * @param   buf  pointer to physical address
  *
@@ -221,31 +389,83 @@ unsigned long sdma_virt_to_phys(void *buf)
  */
 void *sdma_phys_to_virt(unsigned long buf)
 {
-	int i, offset, elem;
-	int found;
-	void *res;
-
-	found = 0;
-	res = 0;
-	offset = (buf / SDMA_POOL_SIZE) % HASH_SIZE;
-
-	for (i = 0; !found && i < HASH_SIZE; i++) {
-		elem = (i + offset) % HASH_SIZE;
-		if (phys_to_virt_hash[elem] != 0 &&
-		    ((unsigned long)phys_to_virt_hash[elem]->phys) /
-		    HASH_SIZE == (unsigned long)buf / HASH_SIZE) {
-			found = 1;
-			res = (void *)(((unsigned long)
-					(phys_to_virt_hash[elem]->virt)) +
-				       buf % HASH_SIZE);
+	sdma_arena *a = sdma_find_phys(buf);
+
+	if (a == NULL) {
+		return phys_to_virt(buf);
+	}
+	return (char *)a->virt + (buf - a->phys);
+}
+
+/*!
+ * Allocates several uncacheable buffers of the same size. Either all of
+ * them are allocated or none is.
+ *
+ * @param   size    size of each buffer
+ * @param   count   number of buffers
+ * @param   bufs    array that receives the buffer pointers
+ *
+ * @return  0 on success, -EINVAL or -ENOMEM on fail
+ */
+int sdma_malloc_multi(size_t size, int count, void **bufs)
+{
+	int class = sdma_size_class(size);
+	unsigned long flags;
+	int i = 0;
+
+	if (class < 0) {
+		printk(KERN_WARNING
+		       "size in sdma_malloc is more than %lu bytes\n",
+		       PAGE_SIZE);
+		return -EINVAL;
+	}
+
+	for (;;) {
+		spin_lock_irqsave(&sdma_pool_lock, flags);
+		for (; i < count; i++) {
+			if ((bufs[i] = sdma_get_buf(class)) == NULL) {
+				break;
+			}
+		}
+		spin_unlock_irqrestore(&sdma_pool_lock, flags);
+
+		if (i == count) {
+			return 0;
+		}
+		if (sdma_grow() < 0) {
+			break;
 		}
 	}
 
-	if (!found) {
-		res = phys_to_virt(buf);
+	spin_lock_irqsave(&sdma_pool_lock, flags);
+	sdma_alloc_failed++;
+	while (--i >= 0) {
+		sdma_put_buf(bufs[i]);
+		bufs[i] = NULL;
 	}
+	spin_unlock_irqrestore(&sdma_pool_lock, flags);
 
-	return res;
+	return -ENOMEM;
+}
+
+/*!
+ * Frees buffers allocated by sdma_malloc_multi
+ *
+ * @param   bufs    array of buffer pointers
+ * @param   count   number of buffers
+ */
+void sdma_free_multi(void **bufs, int count)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&sdma_pool_lock, flags);
+	for (i = 0; i < count; i++) {
+		if (bufs[i] != NULL) {
+			sdma_put_buf(bufs[i]);
+		}
+	}
+	spin_unlock_irqrestore(&sdma_pool_lock, flags);
 }
 
 /*!
@@ -257,29 +477,10 @@ void *sdma_phys_to_virt(unsigned long buf)
 void *sdma_malloc(size_t size)
 {
 	void *buf;
-	dma_addr_t dma_addr;
-	virt_phys_struct *vf;
 
-	if (size > SDMA_POOL_SIZE) {
-		printk(KERN_WARNING
-		       "size in sdma_malloc is more than %d bytes\n",
-		       SDMA_POOL_SIZE);
-		buf = 0;
-	} else {
-		buf = dma_pool_alloc(pool, GFP_KERNEL, &dma_addr);
-		if (buf > 0) {
-			vf = kmalloc(sizeof(virt_phys_struct), GFP_KERNEL);
-			vf->virt = buf;
-			vf->phys = dma_addr;
-
-			if (add_entry(vf) < 0) {
-				dma_pool_free(pool, buf, dma_addr);
-				kfree(vf);
-				buf = 0;
-			}
-		}
+	if (sdma_malloc_multi(size, 1, &buf) < 0) {
+		return NULL;
 	}
-
 	return buf;
 }
 
@@ -290,17 +491,55 @@ void *sdma_malloc(size_t size)
  */
 void sdma_free(void *buf)
 {
-	virt_phys_struct vf;
-	unsigned long phys;
-	
-	/* we will remove unnecessary temp variable "phys" next time*/
-	vf.virt = buf;
-	vf.phys = phys= sdma_virt_to_phys(buf);
+	sdma_free_multi(&buf, 1);
+}
 
-	delete_entry(&vf);
+/*!
+ * SDMA buffers pool occupancy proc file system read function
+ *
+ * @param    buf	pointer to the buffer the data shuld be written to.
+ * @param    start	pointer to the pointer where the new data is
+ *                      written to.
+ * @param    offset	offset from start of the file
+ * @param    count	number of bytes to read.
+ * @param    eof	pointer to eof flag. sould be set to 1 when
+ *                      reaching eof.
+ * @param    data	driver specific data pointer.
+ *
+ * @return   number byte read from the log buffer.
+ */
+int sdma_pool_proc_read(char *buf, char **start, off_t offset, int count,
+			int *eof, void *data)
+{
+	char *p = buf;
+	unsigned long flags;
+	int i, free_pages = 0, j;
+
+	spin_lock_irqsave(&sdma_pool_lock, flags);
+	for (i = 0; i < sdma_arena_count; i++) {
+		for (j = 0; j < SDMA_ARENA_PAGES; j++) {
+			if (sdma_arenas[i].page[j].class == SDMA_PAGE_FREE) {
+				free_pages++;
+			}
+		}
+	}
 
-	dma_pool_free(pool, buf, phys);
+	p += sprintf(p, "arenas: %d of %d, %d pages each, %d pages free\n",
+		     sdma_arena_count, SDMA_MAX_ARENAS, SDMA_ARENA_PAGES,
+		     free_pages);
+	p += sprintf(p, "failed allocations: %lu\n", sdma_alloc_failed);
+	p += sprintf(p, "  size pages  inuse   peak     allocs\n");
+	for (i = 0; i < SDMA_CLASSES; i++) {
+		sdma_class *c = &sdma_classes[i];
+
+		p += sprintf(p, "%6d %5u %6u %6u %10lu\n",
+			     1 << (i + SDMA_MIN_SHIFT), c->pages, c->inuse,
+			     c->peak, c->allocs);
+	}
+	spin_unlock_irqrestore(&sdma_pool_lock, flags);
 
+	*eof = 1;
+	return p - buf;
 }
 
 /*!
@@ -309,15 +548,19 @@ void sdma_free(void *buf)
 void __init init_sdma_pool(void)
 {
 	int i;
-	pool = dma_pool_create("SDMA", NULL, SDMA_POOL_SIZE, 0, 0);
 
-	for (i = 0; i < HASH_SIZE; i++) {
-		virt_to_phys_hash[i] = 0;
-		phys_to_virt_hash[i] = 0;
+	for (i = 0; i < SDMA_CLASSES; i++) {
+		INIT_LIST_HEAD(&sdma_classes[i].partial);
+	}
+
+	if (sdma_grow() < 0) {
+		printk(KERN_ERR "Failed to allocate SDMA buffers arena\n");
 	}
 }
 
 EXPORT_SYMBOL(init_sdma_pool);
+EXPORT_SYMBOL(sdma_malloc_multi);
+EXPORT_SYMBOL(sdma_free_multi);
 
 MODULE_AUTHOR("Freescale Semiconductor, Inc.");
 MODULE_DESCRIPTION("MXC Linux SDMA API");
@@ -1,5 +1,6 @@
 /*
  * Copyright 2005-2006 Freescale Semiconductor, Inc. All Rights Reserved.
+ * Copyright 2026 Motorola, Inc.
  */
 
 /*
@@ -22,6 +23,11 @@
 * @ingroup MXCSAHARA2
 */
 
+/* Date         Author          Comment
+ * ===========  ==============  ==============================================
+ * 17-Oct-2026  Motorola        Add Set_State and Prepend_Entry.
+ */
+
 #ifndef SAH_QUEUE_MANAGER_H
 #define SAH_QUEUE_MANAGER_H
 
@@ -37,6 +43,8 @@ void             sah_Queue_Manager_Close(void);
 void             sah_Queue_Manager_Reset_Entries(void);
 void             sah_Queue_Manager_Append_Entry(sah_Head_Desc *entry);
 void             sah_Queue_Manager_Remove_Entry(sah_Head_Desc *entry);
+void             sah_Queue_Manager_Set_State(sah_Head_Desc *entry,
+                                             sah_Queue_Status state);
 
 
 /*************************
@@ -45,6 +53,7 @@ void             sah_Queue_Manager_Remove_Entry(sah_Head_Desc *entry);
 sah_Queue *sah_Queue_Construct(void);
 void      sah_Queue_Destroy(sah_Queue *this);
 void      sah_Queue_Append_Entry(sah_Queue *this, sah_Head_Desc *entry);
+void      sah_Queue_Prepend_Entry(sah_Queue *this, sah_Head_Desc *entry);
 void      sah_Queue_Remove_Entry(sah_Queue *this);
 void      sah_Queue_Remove_Any_Entry(sah_Queue *this, sah_Head_Desc *entry);
 void      sah_postprocess_queue(unsigned long reset_flag);
@@ -0,0 +1,906 @@
+/*
+ * Copyright (C) 2026 Motorola, Inc.
+ */
+
+/*
+ * The code contained herein is licensed under the GNU General Public
+ * License. You may obtain a copy of the GNU General Public License
+ * Version 2 or later at the following locations:
+ *
+ * http://www.opensource.org/licenses/gpl-license.html
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+/*!
+ * @file sah_crypto.c
+ *
+ * @brief Registers SAHARA with the kernel crypto API.
+ *
+ * AES (ECB, CBC and CTR), SHA-1 and SHA-256 are registered above the generic
+ * software implementations, so users asking for "aes", "sha1" or "sha256" -
+ * including HMAC through crypto/hmac.c - are offloaded.
+ *
+ * A cipher request is cut into the runs that are contiguous in both its
+ * source and destination scatterlists, and up to #SAH_CRYPTO_MAX_SEGS runs go
+ * to SAHARA as one descriptor chain: a single key/IV descriptor, one data
+ * descriptor per run and a context read-back.  Hash updates are gathered into
+ * #SAH_HASH_BATCH octet batches, each of which is one chain.  Chains are run
+ * through sah_Descriptor_Chain_Execute(), which hands them to
+ * sah_Queue_Manager_Append_Entry() and sleeps until they complete.
+ *
+ * Each batch is hashed as soon as it fills, so a message never holds more
+ * than one page.  If the engine fails, or a later call cannot sleep, the
+ * software implementation takes over the engine's running context and still
+ * produces the digest; a digest is never made up.
+ *
+ * Requests shorter than the @c threshold module parameter, and any request
+ * made where we cannot sleep, are done by the software implementation.
+ *
+ * With CONFIG_MXC_SAHARA_CRYPTO_SOFT the chains are executed by a software
+ * stand-in for the descriptor engine instead, so that the whole path can be
+ * exercised (e.g. with tcrypt) on parts without SAHARA.
+ *
+ * @ingroup MXCSAHARA2
+ */
+
+/* Date         Author          Comment
+ * ===========  ==============  ==============================================
+ * 17-Oct-2026  Motorola        Initial version.
+ */
+
+#include "sahara.h"
+#include "sf_util.h"
+
+#include <linux/crypto.h>
+#include <linux/interrupt.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/proc_fs.h>
+#include <asm/scatterlist.h>
+
+/*! Priority over the generic software implementations */
+#define SAH_CRYPTO_PRIORITY     300
+
+/*! Data descriptors in one cipher chain */
+#define SAH_CRYPTO_MAX_SEGS     16
+
+/*! Message octets per hash chain, one page; a multiple of the hash block */
+#define SAH_HASH_BATCH          PAGE_SIZE
+
+#define SAH_AES_BLOCK_SIZE      16
+
+static unsigned int threshold = 256;
+module_param(threshold, uint, 0644);
+MODULE_PARM_DESC(threshold,
+                 "Requests shorter than this (octets) are done in software");
+
+static struct {
+    atomic_t requests;          /*!< requests run on the engine */
+    atomic_t chains;            /*!< descriptor chains run */
+    atomic_t soft;              /*!< requests left to software */
+    atomic_t errors;            /*!< chains the engine failed */
+} sah_crypto_stats;
+
+/*! One data descriptor's worth of a cipher request */
+struct sah_crypto_seg {
+    const uint8_t *in;
+    uint8_t *out;
+    unsigned int len;
+};
+
+struct sah_cipher_ctx {
+    struct crypto_tfm *soft;    /*!< "aes-generic", for short requests */
+    fsl_shw_sko_t key;
+};
+
+struct sah_hash_ctx {
+    struct crypto_tfm *soft;    /*!< software implementation */
+    fsl_shw_hco_t hco;
+    struct page *page;          /*!< page holding @a buf */
+    uint8_t *buf;               /*!< message not yet hashed */
+    unsigned int fill;
+    u64 hashed;                 /*!< octets the engine has hashed */
+    int started;                /*!< engine holds the running context */
+    int soft_only;              /*!< message is being hashed in software */
+};
+
+/*! Block of zeroes, the IV for ECB */
+static uint8_t block_zeros[SAH_AES_BLOCK_SIZE];
+
+static inline int sah_crypto_can_sleep(void)
+{
+    return !in_atomic() && !irqs_disabled();
+}
+
+/*!
+ * Point a one-entry scatterlist at a buffer in the linear map.  MXC has no
+ * highmem, so this also holds for the kmapped data handed to dia_update().
+ */
+static inline void sah_crypto_sg(struct scatterlist *sg, const void *buf,
+                                 unsigned int len)
+{
+    sg->page = virt_to_page(buf);
+    sg->offset = offset_in_page(buf);
+    sg->length = len;
+}
+
+#ifndef SAHARA_CRYPTO_SOFT_ENGINE
+
+/*! Kernel user context all chains are run under, in blocking mode */
+static fsl_shw_uco_t sah_crypto_uco;
+
+/*!
+ * Run one cipher chain on SAHARA.
+ *
+ * @param ctx   Cipher context holding the key
+ * @param seg   Data segments, each a multiple of the block size
+ * @param nseg  Number of segments
+ * @param iv    IV (CBC) or counter (CTR), updated on return
+ * @param mode  CRYPTO_TFM_MODE_*
+ * @param enc   Non-zero to encrypt
+ *
+ * @return 0, or a negative errno.
+ */
+static int sah_engine_cipher(struct sah_cipher_ctx *ctx,
+                             struct sah_crypto_seg *seg, int nseg,
+                             uint8_t *iv, u32 mode, int enc)
+{
+    const sah_Mem_Util *mu = sah_crypto_uco.mem_util;
+    sah_Head_Desc *desc_chain = NULL;
+    fsl_shw_return_t status;
+    uint32_t header;
+    int i;
+
+    /* Desc. #1 with algorithm and mode */
+    header = SAH_HDR_SKHA_SET_MODE_IV_KEY
+        ^ insert_skha_algorithm[FSL_KEY_ALG_AES];
+
+    switch (mode) {
+    case CRYPTO_TFM_MODE_CBC:
+        header ^= insert_skha_mode[FSL_SYM_MODE_CBC];
+        break;
+    case CRYPTO_TFM_MODE_CTR:
+        header ^= insert_skha_mode[FSL_SYM_MODE_CTR]
+            ^ insert_skha_modulus[FSL_CTR_MOD_128];
+        break;
+    default:
+        header ^= insert_skha_mode[FSL_SYM_MODE_ECB];
+        iv = NULL;
+        break;
+    }
+
+    /* Header by default is decrypting, so... */
+    if (enc) {
+        header ^= insert_skha_encrypt;
+    }
+
+    status = add_in_key_desc(header, iv ? iv : block_zeros,
+                             SAH_AES_BLOCK_SIZE, &ctx->key, mu, &desc_chain);
+
+    /* One in-out data descriptor per segment */
+    for (i = 0; (i < nseg) && (status == FSL_RETURN_OK_S); i++) {
+        status = add_in_out_desc(SAH_HDR_SKHA_ENC_DEC,
+                                 seg[i].in, seg[i].len,
+                                 seg[i].out, seg[i].len, mu, &desc_chain);
+    }
+
+    /* Read back the IV/counter for the next request */
+    if ((iv != NULL) && (status == FSL_RETURN_OK_S)) {
+        status = add_two_out_desc(SAH_HDR_SKHA_READ_CONTEXT_IV, NULL, 0,
+                                  iv, SAH_AES_BLOCK_SIZE, mu, &desc_chain);
+    }
+
+    if (status != FSL_RETURN_OK_S) {
+        sah_Descriptor_Chain_Destroy(mu, &desc_chain);
+        return -ENOMEM;
+    }
+
+    status = sah_Descriptor_Chain_Execute(desc_chain, &sah_crypto_uco);
+
+    return (status == FSL_RETURN_OK_S) ? 0 : -EIO;
+}
+
+/*!
+ * Run one hash chain on SAHARA.
+ *
+ * @param ctx    Hash context
+ * @param msg    Message octets; a multiple of 64 unless finalizing
+ * @param len    Number of octets at @a msg
+ * @param flags  FSL_HASH_FLAGS_*
+ * @param out    Digest, when finalizing
+ *
+ * @return 0, or a negative errno.
+ */
+static int sah_engine_hash(struct sah_hash_ctx *ctx, const uint8_t *msg,
+                           unsigned int len, uint32_t flags, uint8_t *out)
+{
+    fsl_shw_return_t status;
+
+    fsl_shw_hco_clear_flags(&ctx->hco, FSL_HASH_FLAGS_INIT
+                            | FSL_HASH_FLAGS_LOAD | FSL_HASH_FLAGS_SAVE
+                            | FSL_HASH_FLAGS_FINALIZE);
+    fsl_shw_hco_set_flags(&ctx->hco, flags);
+
+    status = fsl_shw_hash(&sah_crypto_uco, &ctx->hco, msg, len, out,
+                          out ? ctx->hco.digest_length : 0);
+
+    return (status == FSL_RETURN_OK_S) ? 0 : -EIO;
+}
+
+/*!
+ * Running state of the generic transforms, as laid out in crypto/sha1.c and
+ * crypto/sha256.c; sah_engine_hash_check() makes sure they still agree.
+ */
+struct sah_sha1_state {
+    u64 count;                  /*!< bits */
+    u32 state[5];
+    u8 buffer[64];
+};
+
+struct sah_sha256_state {
+    u32 count[2];               /*!< bits, low word first */
+    u32 state[8];
+    u8 buf[128];
+};
+
+static int sah_engine_hash_check(struct sah_hash_ctx *ctx)
+{
+    unsigned int size = (ctx->hco.algorithm == FSL_HASH_ALG_SHA1)
+        ? sizeof(struct sah_sha1_state) : sizeof(struct sah_sha256_state);
+
+    return (ctx->soft->__crt_alg->cra_ctxsize == size) ? 0 : -EINVAL;
+}
+
+/*!
+ * Load the engine's running context into the software transform.  The saved
+ * context starts with the digest so far, in digest byte order; the message
+ * hashed so far is always a whole number of blocks, so the generic
+ * transform's block buffer stays empty.
+ */
+static void sah_engine_hash_to_soft(struct sah_hash_ctx *ctx)
+{
+    const uint8_t *digest = (const uint8_t *)ctx->hco.context;
+    void *soft = crypto_tfm_ctx(ctx->soft);
+    u64 bits = ctx->hashed << 3;
+    u32 *state;
+    int i;
+
+    crypto_digest_init(ctx->soft);
+
+    if (ctx->hco.algorithm == FSL_HASH_ALG_SHA1) {
+        ((struct sah_sha1_state *)soft)->count = bits;
+        state = ((struct sah_sha1_state *)soft)->state;
+    } else {
+        ((struct sah_sha256_state *)soft)->count[0] = (u32)bits;
+        ((struct sah_sha256_state *)soft)->count[1] = (u32)(bits >> 32);
+        state = ((struct sah_sha256_state *)soft)->state;
+    }
+
+    for (i = 0; i < ctx->hco.digest_length / 4; i++, digest += 4) {
+        state[i] = (digest[0] << 24) | (digest[1] << 16) | (digest[2] << 8)
+            | digest[3];
+    }
+}
+
+static int sah_engine_init(void)
+{
+    fsl_shw_uco_init(&sah_crypto_uco, SAH_CRYPTO_MAX_SEGS);
+
+    if (fsl_shw_register_user(&sah_crypto_uco) != FSL_RETURN_OK_S) {
+        return -ENODEV;
+    }
+
+    return 0;
+}
+
+static void sah_engine_exit(void)
+{
+    fsl_shw_deregister_user(&sah_crypto_uco);
+}
+
+#define SAH_ENGINE_NAME "SAHARA"
+
+#else /* SAHARA_CRYPTO_SOFT_ENGINE */
+
+static inline void sah_xor_block(uint8_t *dst, const uint8_t *src)
+{
+    int i;
+
+    for (i = 0; i < SAH_AES_BLOCK_SIZE; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+/*!
+ * Software stand-in for a SAHARA cipher chain.  Like SKHA, the chaining value
+ * runs on from one data descriptor to the next and is read back at the end.
+ */
+static int sah_engine_cipher(struct sah_cipher_ctx *ctx,
+                             struct sah_crypto_seg *seg, int nseg,
+                             uint8_t *iv, u32 mode, int enc)
+{
+    struct cipher_alg *cia = &ctx->soft->__crt_alg->cra_cipher;
+    void *key = crypto_tfm_ctx(ctx->soft);
+    uint8_t buf[SAH_AES_BLOCK_SIZE];
+    const uint8_t *in;
+    uint8_t *out;
+    unsigned int n;
+    int i, j;
+
+    for (i = 0; i < nseg; i++) {
+        in = seg[i].in;
+        out = seg[i].out;
+
+        for (n = 0; n < seg[i].len; n += SAH_AES_BLOCK_SIZE) {
+            switch (mode) {
+            case CRYPTO_TFM_MODE_CBC:
+                if (enc) {
+                    sah_xor_block(iv, in);
+                    cia->cia_encrypt(key, out, iv);
+                    memcpy(iv, out, SAH_AES_BLOCK_SIZE);
+                } else {
+                    memcpy(buf, in, SAH_AES_BLOCK_SIZE);
+                    cia->cia_decrypt(key, out, in);
+                    sah_xor_block(out, iv);
+                    memcpy(iv, buf, SAH_AES_BLOCK_SIZE);
+                }
+                break;
+
+            case CRYPTO_TFM_MODE_CTR:
+                cia->cia_encrypt(key, buf, iv);
+                sah_xor_block(buf, in);
+                memcpy(out, buf, SAH_AES_BLOCK_SIZE);
+                for (j = SAH_AES_BLOCK_SIZE - 1; j >= 0; j--) {
+                    if (++iv[j]) {
+                        break;
+                    }
+                }
+                break;
+
+            default:
+                if (enc) {
+                    cia->cia_encrypt(key, out, in);
+                } else {
+                    cia->cia_decrypt(key, out, in);
+                }
+                break;
+            }
+
+            in += SAH_AES_BLOCK_SIZE;
+            out += SAH_AES_BLOCK_SIZE;
+        }
+    }
+
+    return 0;
+}
+
+/*!
+ * Software stand-in for a SAHARA hash chain; the running context is kept in
+ * the software transform rather than saved to and loaded from @a hco.
+ */
+static int sah_engine_hash(struct sah_hash_ctx *ctx, const uint8_t *msg,
+                           unsigned int len, uint32_t flags, uint8_t *out)
+{
+    struct scatterlist sg[1];
+
+    if (flags & FSL_HASH_FLAGS_INIT) {
+        crypto_digest_init(ctx->soft);
+    }
+
+    if (len != 0) {
+        sah_crypto_sg(sg, msg, len);
+        crypto_digest_update(ctx->soft, sg, 1);
+    }
+
+    if (flags & FSL_HASH_FLAGS_FINALIZE) {
+        crypto_digest_final(ctx->soft, out);
+    }
+
+    return 0;
+}
+
+static int sah_engine_hash_check(struct sah_hash_ctx *ctx)
+{
+    return 0;
+}
+
+/*! The stand-in's running context already is the software transform */
+static void sah_engine_hash_to_soft(struct sah_hash_ctx *ctx)
+{
+}
+
+static int sah_engine_init(void)
+{
+    return 0;
+}
+
+static void sah_engine_exit(void)
+{
+}
+
+#define SAH_ENGINE_NAME "software stand-in"
+
+#endif /* SAHARA_CRYPTO_SOFT_ENGINE */
+
+/******************************************************************************
+ * AES
+ *****************************************************************************/
+
+/*! Position in a scatterlist */
+struct sah_walk {
+    struct scatterlist *sg;
+    unsigned int off;
+};
+
+/*!
+ * Carve the next segment off a request: the longest run which is contiguous
+ * in both the source and the destination.
+ *
+ * @return the length of the segment.
+ */
+static unsigned int sah_walk_next(struct sah_walk *in, struct sah_walk *out,
+                                  unsigned int left,
+                                  struct sah_crypto_seg *seg)
+{
+    unsigned int len;
+
+    while (in->off == in->sg->length) {
+        in->sg++;
+        in->off = 0;
+    }
+    while (out->off == out->sg->length) {
+        out->sg++;
+        out->off = 0;
+    }
+
+    len = min(left, min(in->sg->length - in->off,
+                        out->sg->length - out->off));
+
+    seg->in = (uint8_t *)page_address(in->sg->page) + in->sg->offset
+        + in->off;
+    seg->out = (uint8_t *)page_address(out->sg->page) + out->sg->offset
+        + out->off;
+    seg->len = len;
+
+    in->off += len;
+    out->off += len;
+
+    return len;
+}
+
+static int sah_aes_bulk(void *ctx_arg, struct scatterlist *dst,
+                        struct scatterlist *src, unsigned int nbytes,
+                        u8 *iv, u32 mode, int enc)
+{
+    struct sah_cipher_ctx *ctx = ctx_arg;
+    struct sah_crypto_seg seg[SAH_CRYPTO_MAX_SEGS];
+    struct sah_walk in, out;
+    unsigned int left, len;
+    int nseg, ret;
+
+    if ((nbytes < threshold) || !sah_crypto_can_sleep()) {
+        goto soft;
+    }
+
+    /* Data descriptors must hold whole blocks; check before starting */
+    in.sg = src;
+    in.off = 0;
+    out.sg = dst;
+    out.off = 0;
+    for (left = nbytes; left != 0; left -= len) {
+        len = sah_walk_next(&in, &out, left, &seg[0]);
+        if (len % SAH_AES_BLOCK_SIZE) {
+            goto soft;
+        }
+    }
+
+    in.sg = src;
+    in.off = 0;
+    out.sg = dst;
+    out.off = 0;
+    left = nbytes;
+    while (left != 0) {
+        for (nseg = 0; (nseg < SAH_CRYPTO_MAX_SEGS) && (left != 0); nseg++) {
+            left -= sah_walk_next(&in, &out, left, &seg[nseg]);
+        }
+
+        ret = sah_engine_cipher(ctx, seg, nseg, iv, mode, enc);
+        if (ret != 0) {
+            atomic_inc(&sah_crypto_stats.errors);
+            return ret;
+        }
+        atomic_inc(&sah_crypto_stats.chains);
+    }
+
+    atomic_inc(&sah_crypto_stats.requests);
+    return 0;
+
+soft:
+    atomic_inc(&sah_crypto_stats.soft);
+    return -EAGAIN;
+}
+
+static void sah_aes_encrypt(void *ctx_arg, u8 *dst, const u8 *src)
+{
+    struct sah_cipher_ctx *ctx = ctx_arg;
+    struct crypto_tfm *soft = ctx->soft;
+
+    soft->__crt_alg->cra_cipher.cia_encrypt(crypto_tfm_ctx(soft), dst, src);
+}
+
+static void sah_aes_decrypt(void *ctx_arg, u8 *dst, const u8 *src)
+{
+    struct sah_cipher_ctx *ctx = ctx_arg;
+    struct crypto_tfm *soft = ctx->soft;
+
+    soft->__crt_alg->cra_cipher.cia_decrypt(crypto_tfm_ctx(soft), dst, src);
+}
+
+static int sah_aes_setkey(void *ctx_arg, const u8 *key, unsigned int keylen,
+                          u32 *flags)
+{
+    struct sah_cipher_ctx *ctx = ctx_arg;
+    int ret;
+
+    ret = crypto_cipher_setkey(ctx->soft, key, keylen);
+    *flags |= ctx->soft->crt_flags & CRYPTO_TFM_RES_MASK;
+    if (ret != 0) {
+        return ret;
+    }
+
+    fsl_shw_sko_init(&ctx->key, FSL_KEY_ALG_AES);
+    fsl_shw_sko_set_key(&ctx->key, key, keylen);
+
+    return 0;
+}
+
+static int sah_aes_init_tfm(void *ctx_arg)
+{
+    struct sah_cipher_ctx *ctx = ctx_arg;
+
+    ctx->soft = crypto_alloc_tfm("aes-generic", 0);
+
+    return ctx->soft ? 0 : -ENOMEM;
+}
+
+static void sah_aes_exit_tfm(void *ctx_arg)
+{
+    struct sah_cipher_ctx *ctx = ctx_arg;
+
+    crypto_free_tfm(ctx->soft);
+    memset(&ctx->key, 0, sizeof(ctx->key));
+}
+
+static struct crypto_alg sah_aes_alg = {
+    .cra_name           = "aes",
+    .cra_driver_name    = "aes-sahara",
+    .cra_priority       = SAH_CRYPTO_PRIORITY,
+    .cra_flags          = CRYPTO_ALG_TYPE_CIPHER,
+    .cra_blocksize      = SAH_AES_BLOCK_SIZE,
+    .cra_ctxsize        = sizeof(struct sah_cipher_ctx),
+    .cra_module         = THIS_MODULE,
+    .cra_list           = LIST_HEAD_INIT(sah_aes_alg.cra_list),
+    .cra_init           = sah_aes_init_tfm,
+    .cra_exit           = sah_aes_exit_tfm,
+    .cra_u              = {
+        .cipher = {
+            .cia_min_keysize    = 16,
+            .cia_max_keysize    = 32,
+            .cia_setkey         = sah_aes_setkey,
+            .cia_encrypt        = sah_aes_encrypt,
+            .cia_decrypt        = sah_aes_decrypt,
+            .cia_bulk           = sah_aes_bulk
+        }
+    }
+};
+
+/******************************************************************************
+ * SHA-1 and SHA-256
+ *****************************************************************************/
+
+static void sah_hash_soft(struct sah_hash_ctx *ctx, const uint8_t *data,
+                          unsigned int len)
+{
+    struct scatterlist sg[1];
+
+    if (len != 0) {
+        sah_crypto_sg(sg, data, len);
+        crypto_digest_update(ctx->soft, sg, 1);
+    }
+}
+
+/*!
+ * Give up on the engine for this message and hash it in software from here
+ * on.  The software transform picks up where the engine's saved context left
+ * off, so this never sleeps and always yields the right digest.
+ */
+static void sah_hash_go_soft(struct sah_hash_ctx *ctx)
+{
+    if (ctx->started) {
+        sah_engine_hash_to_soft(ctx);
+    } else {
+        crypto_digest_init(ctx->soft);
+    }
+    sah_hash_soft(ctx, ctx->buf, ctx->fill);
+
+    ctx->fill = 0;
+    ctx->started = 0;
+    ctx->soft_only = 1;
+    atomic_inc(&sah_crypto_stats.soft);
+}
+
+/*!
+ * Hash the full batch buffer and make it free for the next batch.  Only
+ * called when more of the message follows, so the final chain is never
+ * empty.
+ */
+static void sah_hash_flush(struct sah_hash_ctx *ctx)
+{
+    uint32_t flags = FSL_HASH_FLAGS_SAVE;
+    uint32_t context[ARRAY_SIZE(ctx->hco.context)];
+
+    /* The engine sleeps */
+    if (!sah_crypto_can_sleep()) {
+        sah_hash_go_soft(ctx);
+        return;
+    }
+
+    /* A failed chain may leave the saved context half written */
+    memcpy(context, ctx->hco.context, sizeof(context));
+
+    flags |= ctx->started ? FSL_HASH_FLAGS_LOAD : FSL_HASH_FLAGS_INIT;
+    if (sah_engine_hash(ctx, ctx->buf, ctx->fill, flags, NULL) != 0) {
+        atomic_inc(&sah_crypto_stats.errors);
+        memcpy(ctx->hco.context, context, sizeof(context));
+        sah_hash_go_soft(ctx);
+        return;
+    }
+    atomic_inc(&sah_crypto_stats.chains);
+
+    ctx->hashed += ctx->fill;
+    ctx->started = 1;
+    ctx->fill = 0;
+}
+
+/*!
+ * Start a message.  Where the caller cannot sleep the engine is ruled out
+ * before any data arrives, and the whole message is hashed in software.
+ */
+static void sah_hash_init(void *ctx_arg)
+{
+    struct sah_hash_ctx *ctx = ctx_arg;
+
+    ctx->fill = 0;
+    ctx->hashed = 0;
+    ctx->started = 0;
+    ctx->soft_only = 0;
+    crypto_digest_init(ctx->soft);
+
+    if (!sah_crypto_can_sleep()) {
+        ctx->soft_only = 1;
+        atomic_inc(&sah_crypto_stats.soft);
+    }
+}
+
+static void sah_hash_update(void *ctx_arg, const u8 *data, unsigned int len)
+{
+    struct sah_hash_ctx *ctx = ctx_arg;
+    unsigned int n;
+
+    while ((len != 0) && !ctx->soft_only) {
+        if (ctx->fill == SAH_HASH_BATCH) {
+            sah_hash_flush(ctx);
+            continue;
+        }
+
+        n = min(len, SAH_HASH_BATCH - ctx->fill);
+        memcpy(ctx->buf + ctx->fill, data, n);
+        ctx->fill += n;
+        data += n;
+        len -= n;
+    }
+
+    if (ctx->soft_only) {
+        sah_hash_soft(ctx, data, len);
+    }
+}
+
+static void sah_hash_final(void *ctx_arg, u8 *out)
+{
+    struct sah_hash_ctx *ctx = ctx_arg;
+    uint32_t flags = FSL_HASH_FLAGS_FINALIZE;
+
+    if (!ctx->soft_only
+        && ((!ctx->started && (ctx->fill < threshold))
+            || !sah_crypto_can_sleep())) {
+        sah_hash_go_soft(ctx);
+    }
+
+    if (!ctx->soft_only) {
+        flags |= ctx->started ? FSL_HASH_FLAGS_LOAD : FSL_HASH_FLAGS_INIT;
+        if (sah_engine_hash(ctx, ctx->buf, ctx->fill, flags, out) == 0) {
+            atomic_inc(&sah_crypto_stats.chains);
+            atomic_inc(&sah_crypto_stats.requests);
+            ctx->started = 0;
+            ctx->fill = 0;
+            return;
+        }
+
+        /* The engine failed; software finishes from the saved context */
+        atomic_inc(&sah_crypto_stats.errors);
+        sah_hash_go_soft(ctx);
+    }
+
+    crypto_digest_final(ctx->soft, out);
+}
+
+static int sah_hash_init_tfm(struct sah_hash_ctx *ctx, const char *soft,
+                             fsl_shw_hash_alg_t algorithm)
+{
+    ctx->page = alloc_page(GFP_KERNEL);
+    if (ctx->page == NULL) {
+        return -ENOMEM;
+    }
+    ctx->buf = page_address(ctx->page);
+
+    ctx->soft = crypto_alloc_tfm(soft, 0);
+    if (ctx->soft == NULL) {
+        __free_page(ctx->page);
+        return -ENOMEM;
+    }
+
+    fsl_shw_hco_init(&ctx->hco, algorithm);
+
+    /* The software takeover writes the generic transform's state */
+    if (sah_engine_hash_check(ctx) != 0) {
+        printk(KERN_ERR "sahara: %s state layout changed\n", soft);
+        crypto_free_tfm(ctx->soft);
+        __free_page(ctx->page);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static void sah_hash_exit_tfm(void *ctx_arg)
+{
+    struct sah_hash_ctx *ctx = ctx_arg;
+
+    crypto_free_tfm(ctx->soft);
+    __free_page(ctx->page);
+}
+
+static int sah_sha1_init_tfm(void *ctx_arg)
+{
+    return sah_hash_init_tfm(ctx_arg, "sha1-generic", FSL_HASH_ALG_SHA1);
+}
+
+static int sah_sha256_init_tfm(void *ctx_arg)
+{
+    return sah_hash_init_tfm(ctx_arg, "sha256-generic", FSL_HASH_ALG_SHA256);
+}
+
+static struct crypto_alg sah_sha1_alg = {
+    .cra_name           = "sha1",
+    .cra_driver_name    = "sha1-sahara",
+    .cra_priority       = SAH_CRYPTO_PRIORITY,
+    .cra_flags          = CRYPTO_ALG_TYPE_DIGEST,
+    .cra_blocksize      = 64,
+    .cra_ctxsize        = sizeof(struct sah_hash_ctx),
+    .cra_module         = THIS_MODULE,
+    .cra_list           = LIST_HEAD_INIT(sah_sha1_alg.cra_list),
+    .cra_init           = sah_sha1_init_tfm,
+    .cra_exit           = sah_hash_exit_tfm,
+    .cra_u              = {
+        .digest = {
+            .dia_digestsize     = 20,
+            .dia_init           = sah_hash_init,
+            .dia_update         = sah_hash_update,
+            .dia_final          = sah_hash_final
+        }
+    }
+};
+
+static struct crypto_alg sah_sha256_alg = {
+    .cra_name           = "sha256",
+    .cra_driver_name    = "sha256-sahara",
+    .cra_priority       = SAH_CRYPTO_PRIORITY,
+    .cra_flags          = CRYPTO_ALG_TYPE_DIGEST,
+    .cra_blocksize      = 64,
+    .cra_ctxsize        = sizeof(struct sah_hash_ctx),
+    .cra_module         = THIS_MODULE,
+    .cra_list           = LIST_HEAD_INIT(sah_sha256_alg.cra_list),
+    .cra_init           = sah_sha256_init_tfm,
+    .cra_exit           = sah_hash_exit_tfm,
+    .cra_u              = {
+        .digest = {
+            .dia_digestsize     = 32,
+            .dia_init           = sah_hash_init,
+            .dia_update         = sah_hash_update,
+            .dia_final          = sah_hash_final
+        }
+    }
+};
+
+/******************************************************************************
+ * Module glue
+ *****************************************************************************/
+
+static struct crypto_alg *sah_crypto_algs[] = {
+    &sah_aes_alg,
+    &sah_sha1_alg,
+    &sah_sha256_alg,
+};
+
+#define SAH_CRYPTO_NUM_ALGS \
+    (sizeof(sah_crypto_algs) / sizeof(sah_crypto_algs[0]))
+
+static int sah_crypto_proc_read(char *page, char **start, off_t off,
+                                int count, int *eof, void *data)
+{
+    int len;
+
+    len = sprintf(page,
+                  "engine:    %s\n"
+                  "threshold: %u\n"
+                  "requests:  %u\n"
+                  "chains:    %u\n"
+                  "software:  %u\n"
+                  "errors:    %u\n",
+                  SAH_ENGINE_NAME, threshold,
+                  atomic_read(&sah_crypto_stats.requests),
+                  atomic_read(&sah_crypto_stats.chains),
+                  atomic_read(&sah_crypto_stats.soft),
+                  atomic_read(&sah_crypto_stats.errors));
+
+    *eof = 1;
+    return len;
+}
+
+static void sah_crypto_unregister(int count)
+{
+    while (count-- > 0) {
+        crypto_unregister_alg(sah_crypto_algs[count]);
+    }
+}
+
+static int __init sah_crypto_init(void)
+{
+    int ret;
+    int i;
+
+    ret = sah_engine_init();
+    if (ret != 0) {
+        printk(KERN_ERR "sahara: crypto API provider not registered\n");
+        return ret;
+    }
+
+    for (i = 0; i < SAH_CRYPTO_NUM_ALGS; i++) {
+        ret = crypto_register_alg(sah_crypto_algs[i]);
+        if (ret != 0) {
+            sah_crypto_unregister(i);
+            sah_engine_exit();
+            return ret;
+        }
+    }
+
+    create_proc_read_entry("driver/sahara_crypto", 0, NULL,
+                           sah_crypto_proc_read, NULL);
+
+    printk(KERN_INFO "sahara: crypto API provider on %s\n", SAH_ENGINE_NAME);
+
+    return 0;
+}
+
+static void __exit sah_crypto_exit(void)
+{
+    remove_proc_entry("driver/sahara_crypto", NULL);
+    sah_crypto_unregister(SAH_CRYPTO_NUM_ALGS);
+    sah_engine_exit();
+}
+
+module_init(sah_crypto_init);
+module_exit(sah_crypto_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("SAHARA2 kernel crypto API provider");
+MODULE_AUTHOR("Motorola");
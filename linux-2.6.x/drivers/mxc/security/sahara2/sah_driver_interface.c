@@ -1,6 +1,6 @@
 /*
  * Copyright 2005-2006 Freescale Semiconductor, Inc. All Rights Reserved.
- * Copyright 2005-2006 Motorola, Inc.
+ * Copyright 2005-2006, 2026 Motorola, Inc.
  */
 
 /*
@@ -22,6 +22,7 @@
 /* Date         Author          Comment
  * ===========  ==============  ==============================================
  * 04-Oct-2006  Motorola        Add check for SCM-A11 Pass 1 revision.
+ * 17-Oct-2026  Motorola        Use per-state queues of the Queue Manager.
  */
 
 
@@ -1212,9 +1213,6 @@ int sah_blocking_mode(sah_Head_Desc *entry)
     status = ((volatile sah_Head_Desc*)entry)->status;
 
     while (!SAH_DESC_PROCESSED(status)) {
-        extern sah_Queue *main_queue;
-
-
         DEFINE_WAIT(sahara_wait); /* create a wait queue entry. Linux */
 
         /* enter the wait queue entry into the queue */
@@ -1239,7 +1237,7 @@ int sah_blocking_mode(sah_Head_Desc *entry)
             os_lock_save_context(desc_queue_lock, lock_flags);
             status = ((volatile sah_Head_Desc*)entry)->status;
             if (status == SAH_STATE_PENDING) {
-                sah_Queue_Remove_Any_Entry(main_queue, entry);
+                sah_Queue_Manager_Remove_Entry(entry);
             }
             os_unlock_restore_context(desc_queue_lock, lock_flags);
 
@@ -1,5 +1,6 @@
 /*
  * Copyright 2005-2006 Freescale Semiconductor, Inc. All Rights Reserved.
+ * Copyright 2026 Motorola, Inc.
  */
 
 /*
@@ -17,6 +18,11 @@
 *
 * @ingroup MXCSAHARA2
 */
+
+/* Date         Author          Comment
+ * ===========  ==============  ==============================================
+ * 17-Oct-2026  Motorola        Add sah_Queue_Prepend_Entry().
+ */
 /******************************************************************************
 *
 * CAUTION:
@@ -149,6 +155,46 @@ void sah_Queue_Append_Entry (sah_Queue *q, sah_Head_Desc *entry)
     q->count++;
 }
 
+/*!
+*******************************************************************************
+* This function inserts a sah_Head_Desc at the head of a sah_Queue.
+*
+* @brief     Prepends a sah_Head_Desc to a sah_Queue.
+*
+* @param    q       A pointer to a sah_Queue to prepend to.
+* @param    entry   A pointer to a sah_Head_Desc to prepend.
+*
+* @pre   The #desc_queue_lock must be held before calling this function.
+*
+* @return   void
+*/
+/******************************************************************************
+*
+* CAUTION: NONE
+******************************************************************************/
+void sah_Queue_Prepend_Entry (sah_Queue *q, sah_Head_Desc *entry)
+{
+    if ((q == NULL) || (entry == NULL)) {
+#ifdef DIAG_DRV_QUEUE
+        LOG_KDIAG ("Null pointer input.");
+#endif
+        return;
+    }
+
+    entry->prev = NULL;
+    entry->next = q->head;
+    if (q->count == 0) {
+        /* The queue is empty */
+        q->tail = entry;
+    }
+    else {
+        /* The queue is not empty */
+        q->head->prev = entry;
+    }
+    q->head = entry;
+    q->count++;
+}
+
 /*!
 *******************************************************************************
 * This function a removes a sah_Head_Desc from the head of a sah_Queue.
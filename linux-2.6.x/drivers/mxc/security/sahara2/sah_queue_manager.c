@@ -1,5 +1,6 @@
 /*
  * Copyright 2005-2006 Freescale Semiconductor, Inc. All Rights Reserved.
+ * Copyright 2026 Motorola, Inc.
  */
 
 /*
@@ -22,6 +23,11 @@
  * @ingroup MXCSAHARA2
 */
 
+/* Date         Author          Comment
+ * ===========  ==============  ==============================================
+ * 17-Oct-2026  Motorola        Per-state queues; batched completion.
+ */
+
 
 #include "portable_os.h"
 
@@ -132,12 +138,18 @@ char sah_return_text[FSL_INVALID_RETURN][MAX_RETURN_STRING_LEN] = {
  */
 os_lock_t desc_queue_lock;
 
-/*! This is the main queue for the driver. This is shared between all threads
- * and is not protected by mutexes since the kernel is non-preemptable. */
-sah_Queue *main_queue = NULL;
+/*!
+ * The queues for the driver, one per state an entry can have while the
+ * driver is responsible for it: waiting for SAHARA, on SAHARA, and finished
+ * but not yet post-processed.  Each is kept in FIFO order, so the entry to
+ * act on next is always at the head of its list.  An entry is on the list for
+ * its status, or on none once its status is past #SAH_STATE_OFF_SAHARA.
+ * These are protected by #desc_queue_lock.
+ */
+static sah_Queue state_queue[SAH_STATE_OFF_SAHARA + 1];
 
-/* Internal Prototypes */
-sah_Head_Desc *sah_Find_With_State(sah_Queue_Status state);
+/*! True if entries with status @a state are kept on a list */
+#define SAH_STATE_QUEUED(state) ((state) <= SAH_STATE_OFF_SAHARA)
 
 #ifdef DIAG_DRV_STATUS
 static void sah_Log_Error(uint32_t descriptor, uint32_t error,
@@ -157,21 +169,15 @@ extern wait_queue_head_t *int_queue;
 fsl_shw_return_t sah_Queue_Manager_Init(void)
 {
     fsl_shw_return_t ret_val = FSL_RETURN_OK_S;
+    int i;
 
 
     desc_queue_lock = os_lock_alloc_init();
 
-    if (main_queue == NULL) {
-        /* Construct the main queue. */
-        main_queue = sah_Queue_Construct();
-
-        if (main_queue == NULL) {
-            ret_val = FSL_RETURN_MEMORY_ERROR_S;
-        }
-    } else {
-#ifdef DIAG_DRV_QUEUE
-        LOG_KDIAG("Trying to initialise the queue manager more than once.");
-#endif
+    for (i = 0; i <= SAH_STATE_OFF_SAHARA; i++) {
+        state_queue[i].head = NULL;
+        state_queue[i].tail = NULL;
+        state_queue[i].count = 0;
     }
 
     return ret_val;
@@ -188,17 +194,10 @@ fsl_shw_return_t sah_Queue_Manager_Init(void)
 void sah_Queue_Manager_Close(void)
 {
 #ifdef DIAG_DRV_QUEUE
-    if (main_queue && main_queue->count != 0 ) {
+    if (sah_Queue_Manager_Count_Entries(TRUE, 0) != 0) {
         LOG_KDIAG("Trying to close the main queue when it is not empty.");
     }
 #endif
-
-    if (main_queue) {
-        /* There is no error checking here because there is no way to handle
-           it. */
-        sah_Queue_Destroy(main_queue);
-        main_queue = NULL;
-    }
 }
 
 
@@ -209,21 +208,21 @@ void sah_Queue_Manager_Close(void)
  *                      If zero, only entries matching @a state are counted.
  * @param state         State of entry to match for counting.
  *
+ * @pre   The #desc_queue_lock must be held before calling this function.
+ *
  * @return        Number of entries which matched criteria
  */
 int sah_Queue_Manager_Count_Entries(int ignore_state, sah_Queue_Status state)
 {
     int count = 0;
-    sah_Head_Desc *current_entry;
+    int i;
 
-    /* Start at the head */
-    current_entry = main_queue->head;
-    while (current_entry != NULL) {
-        if (ignore_state || (current_entry->status == state)) {
-            count++;
+    if (ignore_state) {
+        for (i = 0; i <= SAH_STATE_OFF_SAHARA; i++) {
+            count += state_queue[i].count;
         }
-        /* Jump to the next entry. */
-        current_entry = current_entry->next;
+    } else if (SAH_STATE_QUEUED(state)) {
+        count = state_queue[state].count;
     }
 
     return count;
@@ -250,8 +249,40 @@ void sah_Queue_Manager_Remove_Entry(sah_Head_Desc *entry)
         LOG_KDIAG("NULL pointer input.");
 #endif
     }
-    else {
-        sah_Queue_Remove_Any_Entry(main_queue, entry);
+    else if (SAH_STATE_QUEUED(entry->status)) {
+        sah_Queue_Remove_Any_Entry(&state_queue[entry->status], entry);
+    }
+}
+
+
+/*!
+ * This function moves an entry to a new state, and from the list for its old
+ * state to the tail of the list for the new one.  An entry moved back to
+ * SAH_STATE_PENDING goes to the head of that list instead, as it was due to
+ * run before anything still waiting.
+ *
+ * @brief     Change the state of an entry.
+ *
+ * @param    entry   A pointer to a sah_Head_Desc on one of the Queue
+ *                   Manager's queues.
+ * @param    state   The new state.
+ *
+ * @pre   The #desc_queue_lock must be held before calling this function.
+ *
+ * @return   void
+ */
+void sah_Queue_Manager_Set_State(sah_Head_Desc *entry, sah_Queue_Status state)
+{
+    if (SAH_STATE_QUEUED(entry->status)) {
+        sah_Queue_Remove_Any_Entry(&state_queue[entry->status], entry);
+    }
+
+    entry->status = state;
+
+    if (state == SAH_STATE_PENDING) {
+        sah_Queue_Prepend_Entry(&state_queue[state], entry);
+    } else if (SAH_STATE_QUEUED(state)) {
+        sah_Queue_Append_Entry(&state_queue[state], entry);
     }
 }
 
@@ -271,7 +302,6 @@ void sah_Queue_Manager_Remove_Entry(sah_Head_Desc *entry)
  */
 void sah_Queue_Manager_Append_Entry(sah_Head_Desc *entry)
 {
-    sah_Head_Desc *current_entry;
     os_lock_context_t int_flags;
 
 #ifdef DIAG_DRV_QUEUE
@@ -281,16 +311,13 @@ void sah_Queue_Manager_Append_Entry(sah_Head_Desc *entry)
 #endif
     entry->status = SAH_STATE_PENDING;
     os_lock_save_context(desc_queue_lock, int_flags);
-    sah_Queue_Append_Entry(main_queue, entry);
+    sah_Queue_Append_Entry(&state_queue[SAH_STATE_PENDING], entry);
 
     /* Prime SAHARA if the operation that was just appended is the only PENDING
      * operation in the queue.
      */
-    current_entry = sah_Find_With_State (SAH_STATE_PENDING);
-    if (current_entry != NULL) {
-        if (current_entry == entry) {
-            sah_Queue_Manager_Prime(entry);
-        }
+    if (state_queue[SAH_STATE_PENDING].head == entry) {
+        sah_Queue_Manager_Prime(entry);
     }
 
     os_unlock_restore_context(desc_queue_lock, int_flags);
@@ -298,11 +325,13 @@ void sah_Queue_Manager_Append_Entry(sah_Head_Desc *entry)
 
 
 /*!
- * This function marks all entries in the Queue Manager's queue with state
- * SAH_STATE_RESET.
+ * This function marks all entries in the Queue Manager's queues with state
+ * SAH_STATE_RESET, and so takes them off the queues.
  *
  * @brief     Mark all entries with state SAH_STATE_RESET
  *
+ * @pre   The #desc_queue_lock may not be held when calling this function.
+ *
  * @return   void
  *
  * @note This feature needs re-visiting
@@ -310,16 +339,32 @@ void sah_Queue_Manager_Append_Entry(sah_Head_Desc *entry)
 void sah_Queue_Manager_Reset_Entries(void)
 {
     sah_Head_Desc *current_entry =  NULL;
+    sah_Head_Desc *next_entry;
+    os_lock_context_t lock_flags;
+    int i;
+
+    os_lock_save_context(desc_queue_lock, lock_flags);
 
-    /* Start at the head */
-    current_entry = main_queue->head;
+    for (i = 0; i <= SAH_STATE_OFF_SAHARA; i++) {
+        /* Start at the head */
+        current_entry = state_queue[i].head;
+
+        while (current_entry != NULL) {
+            next_entry = current_entry->next;
+            current_entry->next = NULL;
+            current_entry->prev = NULL;
+            /* Set the state. */
+            current_entry->status = SAH_STATE_RESET;
+            /* Jump to the next entry. */
+            current_entry = next_entry;
+        }
 
-    while (current_entry != NULL) {
-        /* Set the state. */
-        current_entry->status = SAH_STATE_RESET;
-        /* Jump to the next entry. */
-        current_entry = current_entry->next;
+        state_queue[i].head = NULL;
+        state_queue[i].tail = NULL;
+        state_queue[i].count = 0;
     }
+
+    os_unlock_restore_context(desc_queue_lock, lock_flags);
 }
 
 
@@ -362,7 +407,7 @@ void sah_Queue_Manager_Prime(sah_Head_Desc *entry)
 #endif /* DIAG_DRV_IF */
 
             sah_HW_Write_DAR((entry->desc.dma_addr));
-            entry->status = SAH_STATE_ON_SAHARA;
+            sah_Queue_Manager_Set_State(entry, SAH_STATE_ON_SAHARA);
         }
 #ifdef DIAG_DRV_QUEUE
         else {
@@ -409,10 +454,14 @@ void sah_reset_sahara_request(void)
  * @param     error       A boolean to mark whether hardware reported error
  *
  * @pre   The #desc_queue_lock may not be held when calling this function.
+ *
+ * @return    Non-zero if a blocked caller is waiting for @a desc_head, which
+ *            the caller must wake with #int_queue.
  */
-void sah_process_finished_request(sah_Head_Desc* desc_head, unsigned error)
+int sah_process_finished_request(sah_Head_Desc* desc_head, unsigned error)
 {
     os_lock_context_t lock_flags;
+    uint32_t uco_flags = desc_head->uco_flags;
 
     if (!error) {
         desc_head->result = FSL_RETURN_OK_S;
@@ -432,31 +481,40 @@ void sah_process_finished_request(sah_Head_Desc* desc_head, unsigned error)
      * if they are from user mode, and release the page cache for user pages
      */
     desc_head = sah_DePhysicalise_Descriptors(desc_head);
-    desc_head->status = error ? SAH_STATE_FAILED : SAH_STATE_COMPLETE;
 
-    if (desc_head->uco_flags & FSL_UCO_BLOCKING_MODE) {
+    /* A blocked caller may free the entry as soon as it sees this */
+    desc_head->status = error ? SAH_STATE_FAILED : SAH_STATE_COMPLETE;
 
-        /* Wake up all processes on Sahara queue */
-        wake_up_interruptible(int_queue);
+    if (uco_flags & FSL_UCO_BLOCKING_MODE) {
+        return 1;
+    }
 
-    } else {
-        os_lock_save_context(desc_queue_lock, lock_flags);
-        sah_Queue_Append_Entry(&desc_head->user_info->result_pool, desc_head);
-        os_unlock_restore_context(desc_queue_lock, lock_flags);
+    os_lock_save_context(desc_queue_lock, lock_flags);
+    sah_Queue_Append_Entry(&desc_head->user_info->result_pool, desc_head);
+    os_unlock_restore_context(desc_queue_lock, lock_flags);
 
-        /* perform callback */
-        if (desc_head->uco_flags & FSL_UCO_CALLBACK_MODE) {
-            desc_head->user_info->callback(desc_head->user_info);
-        }
+    /* perform callback */
+    if (uco_flags & FSL_UCO_CALLBACK_MODE) {
+        desc_head->user_info->callback(desc_head->user_info);
     }
+
+    return 0;
 } /* sah_process_finished_request */
 
 
 /*! Called from bottom half.
+ *
+ * All the chains SAHARA has finished with are taken off the queue at once,
+ * and blocked callers are woken once for the whole batch.
  *
  * @pre   The #desc_queue_lock may not be held when calling this function.
  */
 void sah_postprocess_queue(unsigned long reset_flag) {
+    sah_Queue *done_queue = &state_queue[SAH_STATE_OFF_SAHARA];
+    sah_Head_Desc *entry;
+    sah_Head_Desc *next_entry;
+    os_lock_context_t lock_flags;
+    int wake = 0;
 
     /* if SAHARA needs to be reset, do it here. This starts a descriptor chain
      * if one is ready also */
@@ -465,25 +523,27 @@ void sah_postprocess_queue(unsigned long reset_flag) {
     }
 
     /* now handle the descriptor chain(s) that has/have completed */
-    do {
-        sah_Head_Desc *first_entry;
-        os_lock_context_t lock_flags;
-
-        os_lock_save_context(desc_queue_lock, lock_flags);
-
-        first_entry = main_queue->head;
-        if ( (first_entry != NULL) &&
-             (first_entry->status == SAH_STATE_OFF_SAHARA) ) {
-            sah_Queue_Remove_Entry (main_queue);
-            os_unlock_restore_context(desc_queue_lock, lock_flags);
-
-            sah_process_finished_request(first_entry,
-                                         (first_entry->error_status != 0));
-        } else {
-            os_unlock_restore_context(desc_queue_lock, lock_flags);
-            break;
-        }
-    } while (1);
+    os_lock_save_context(desc_queue_lock, lock_flags);
+    entry = done_queue->head;
+    done_queue->head = NULL;
+    done_queue->tail = NULL;
+    done_queue->count = 0;
+    os_unlock_restore_context(desc_queue_lock, lock_flags);
+
+    while (entry != NULL) {
+        next_entry = entry->next;
+        entry->next = NULL;
+        entry->prev = NULL;
+
+        wake |= sah_process_finished_request(entry, (entry->error_status != 0));
+
+        entry = next_entry;
+    }
+
+    if (wake) {
+        /* Wake up all processes on Sahara queue */
+        wake_up_interruptible(int_queue);
+    }
 
     return;
 }
@@ -493,11 +553,10 @@ void sah_postprocess_queue(unsigned long reset_flag) {
 
 /*!
  * This is a helper function for Queue Manager. This function finds the first
- * entry in the Queue Manager's queue whose state matches the given input
- * state. This function starts at the head of the queue and works towards the
- * tail. If a matching entry was found, the address of the entry is returned.
+ * (oldest) entry in the Queue Manager's queues whose state matches the given
+ * input state, which is the head of the list for that state.
  *
- * @brief     Handle the IDLE state.
+ * @brief     Find the first entry with a given state.
  *
  * @param    state   A sah_Queue_Status value.
  *
@@ -508,24 +567,8 @@ void sah_postprocess_queue(unsigned long reset_flag) {
  */
 sah_Head_Desc *sah_Find_With_State(sah_Queue_Status state)
 {
-    sah_Head_Desc *current_entry =  NULL;
-    sah_Head_Desc *ret_val =  NULL;
-    int done_looping =          FALSE;
-
-    /* Start at the head */
-    current_entry = main_queue->head;
-
-    while ((current_entry != NULL) && (done_looping == FALSE)) {
-        if (current_entry->status == state) {
-            done_looping = TRUE;
-            ret_val = current_entry;
-        }
-        /* Jump to the next entry. */
-        current_entry = current_entry->next;
-    }
-
-    return ret_val;
-} /* sah_postprocess_queue */
+    return SAH_STATE_QUEUED(state) ? state_queue[state].head : NULL;
+} /* sah_Find_With_State */
 
 
 /*!
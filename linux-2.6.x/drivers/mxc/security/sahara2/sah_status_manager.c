@@ -1,5 +1,6 @@
 /*
  * Copyright 2005-2006 Freescale Semiconductor, Inc. All Rights Reserved.
+ * Copyright 2026 Motorola, Inc.
  */
 
 /*
@@ -23,6 +24,11 @@
 * @ingroup MXCSAHARA2
 */
 
+/* Date         Author          Comment
+ * ===========  ==============  ==============================================
+ * 17-Oct-2026  Motorola        Change entry states under the queue lock.
+ */
+
 #include "portable_os.h"
 
 #include <sah_status_manager.h>
@@ -110,10 +116,9 @@ unsigned long sah_Handle_Interrupt(
         /* if the first entry on sahara has completed... */
         if ( (hw_status & SAH_EXEC_DONE1_BIT ) ||
              (hw_status == SAH_EXEC_ERROR1) ) {
-            /* lock queue while searching */
+            /* lock queue while searching and moving entries */
             os_lock_save_context(desc_queue_lock, lock_flags);
             current_entry = sah_Find_With_State(SAH_STATE_ON_SAHARA);
-            os_unlock_restore_context(desc_queue_lock, lock_flags);
 
             /* an active descriptor was not found */
             if (current_entry == NULL) {
@@ -124,9 +129,6 @@ unsigned long sah_Handle_Interrupt(
                 LOG_KDIAG("Interrupt received with nothing on queue.");
 #endif
             } else {
-                /* SAHARA has completed its work on this descriptor chain */
-                current_entry->status = SAH_STATE_OFF_SAHARA;
-
                 /* SAHARA is reporting an error with descriptor chain 1 */
                 if (hw_status == SAH_EXEC_ERROR1) {
                     /* Gather extra diagnostic information */
@@ -134,18 +136,23 @@ unsigned long sah_Handle_Interrupt(
                     current_entry->current_dar = sah_HW_Read_CDAR();
                     /* Read this last - it clears the error */
                     current_entry->error_status = sah_HW_Read_Error_Status();
+
+                    /* SAHARA has completed its work on this descriptor
+                     * chain */
+                    sah_Queue_Manager_Set_State(current_entry,
+                                                SAH_STATE_OFF_SAHARA);
                 } else {
                     /* indicate that no errors were found with descriptor
                      * chain 1 */
                     current_entry->error_status = 0;
+                    sah_Queue_Manager_Set_State(current_entry,
+                                                SAH_STATE_OFF_SAHARA);
 
                     /* is there a second, successfully, completed descriptor
                      * chain? (done1/error2 processing is handled later) */
                     if (hw_status == SAH_EXEC_DONE1_DONE2) {
-                        os_lock_save_context(desc_queue_lock, lock_flags);
                         current_entry =
                                   sah_Find_With_State(SAH_STATE_ON_SAHARA);
-                        os_unlock_restore_context(desc_queue_lock, lock_flags);
 
                         if (current_entry == NULL) {
 #if defined(DIAG_DRV_INTERRUPT) && defined(DIAG_DURING_INTERRUPT)
@@ -155,18 +162,20 @@ unsigned long sah_Handle_Interrupt(
                         } else {
                             /* indicate no errors in descriptor chain 2 */
                             current_entry->error_status = 0;
-                            current_entry->status = SAH_STATE_OFF_SAHARA;
+                            sah_Queue_Manager_Set_State(current_entry,
+                                                        SAH_STATE_OFF_SAHARA);
                         }
                     }
                 }
             }
+            os_unlock_restore_context(desc_queue_lock, lock_flags);
 
 #ifdef SAHARA_POWER_MANAGEMENT
             /* check dynamic power management is not asserted */
             if (!sah_dpm_flag) {
 #endif
                 do {
-                    /* protect DAR and main_queue */
+                    /* protect DAR and queues */
                     os_lock_save_context(desc_queue_lock, lock_flags);
                     dar = sah_HW_Read_DAR();
                     /* check if SAHARA has space for another descriptor. SAHARA
@@ -189,7 +198,8 @@ unsigned long sah_Handle_Interrupt(
                                 sah_Dump_Chain(&entry->desc);
 #endif /* DIAG_DRV_IF */
                                 sah_HW_Write_DAR(current_entry->desc.dma_addr);
-                                current_entry->status = SAH_STATE_ON_SAHARA;
+                                sah_Queue_Manager_Set_State(current_entry,
+                                                         SAH_STATE_ON_SAHARA);
 #ifndef SUBMIT_MULTIPLE_DARS
                             }
                             current_entry = NULL; /* exit loop */
@@ -213,24 +223,23 @@ unsigned long sah_Handle_Interrupt(
                  * on SAHARA */
                 os_lock_save_context(desc_queue_lock, lock_flags);
                 previous_entry = sah_Find_With_State(SAH_STATE_ON_SAHARA);
-                os_unlock_restore_context(desc_queue_lock, lock_flags);
 
                 /* if it exists, continue processing the fault */
                 if (previous_entry) {
                     /* assume this chain didn't complete correctly */
                     previous_entry->error_status = -1;
-                    previous_entry->status = SAH_STATE_OFF_SAHARA;
+                    sah_Queue_Manager_Set_State(previous_entry,
+                                                SAH_STATE_OFF_SAHARA);
 
                     /* get the second descriptor chain */
-                    os_lock_save_context(desc_queue_lock, lock_flags);
                     current_entry = sah_Find_With_State(SAH_STATE_ON_SAHARA);
-                    os_unlock_restore_context(desc_queue_lock, lock_flags);
 
                     /* if it exists, continue processing both chains */
                     if (current_entry) {
                         /* assume this chain didn't complete correctly */
                         current_entry->error_status = -1;
-                        current_entry->status = SAH_STATE_OFF_SAHARA;
+                        sah_Queue_Manager_Set_State(current_entry,
+                                                    SAH_STATE_OFF_SAHARA);
 
                         /* now see if either can be identified as the one
                          * in progress when the fault occured */
@@ -244,11 +253,13 @@ unsigned long sah_Handle_Interrupt(
                                 /* if the first chain was in progress when the
                                  * fault occured, the second has not yet been
                                  * touched, so reset it to PENDING */
-                                current_entry->status = SAH_STATE_PENDING;
+                                sah_Queue_Manager_Set_State(current_entry,
+                                                          SAH_STATE_PENDING);
                             }
                         }
                     }
                 }
+                os_unlock_restore_context(desc_queue_lock, lock_flags);
 #if defined(DIAG_DRV_INTERRUPT) && defined(DIAG_DURING_INTERRUPT)
             } else {
                 /* shouldn't ever get here */
@@ -498,12 +509,13 @@ static int sah_dpm_suspend(
             /* hopefully between the DISABLE call and this one, the outstanding
              * work Sahara was doing complete. this checks (and waits) for
              * those entries that were already active on Sahara to complete */
-            /* lock queue while searching */
-            os_lock_save_context(desc_queue_lock, lock_flags);
+            /* lock queue while searching, but not while waiting, as the
+             * interrupt handler needs it to retire the entries */
             do {
+                os_lock_save_context(desc_queue_lock, lock_flags);
                 entry = sah_Find_With_State(SAH_STATE_ON_SAHARA);
+                os_unlock_restore_context(desc_queue_lock, lock_flags);
             } while (entry != NULL);
-            os_unlock_restore_context(desc_queue_lock, lock_flags);
 
             /* now we kill the clock so the control circuitry isn't sucking
              * any power */
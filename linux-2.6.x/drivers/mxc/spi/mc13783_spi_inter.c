@@ -1,7 +1,7 @@
 /*
  * Copyright 2006 Freescale Semiconductor, Inc. All Rights Reserved.
  *
- * Copyright 2006 Motorola, Inc.
+ * Copyright 2006, 2026 Motorola, Inc.
  */
 
 /* 
@@ -23,6 +23,7 @@
  * Date     Author    Comment
  * 10/2006  Motorola  Added support for power_ic drivers
  *                    Added SPI timing work-arounds for hardware issues
+ * 10/2026  Motorola  Added burst transfers of several frames
  */
 
 /*!
@@ -43,6 +44,13 @@
 static spi_config the_config;
 static void *spi_id;
 
+/*!
+ * Same as the_config, but with SS pulsed between 32-bit words, so that a
+ * burst of several frames is seen by mc13783 as separate accesses.
+ */
+static spi_config the_burst_config;
+static void *spi_burst_id;
+
 extern int gpio_mc13783_get_spi(void);
 extern int gpio_mc13783_get_ss(void);
 
@@ -74,6 +82,10 @@ int spi_init(void)
         the_config.tx_delay = 0;
 	spi_id = spi_get_device_id((spi_config *) & the_config);
 
+	the_burst_config = the_config;
+	the_burst_config.ss_low_between_bursts = 0;
+	spi_burst_id = spi_get_device_id((spi_config *) & the_burst_config);
+
         return ERROR_NONE;
 };
 
@@ -159,3 +171,62 @@ int spi_send_frame_to_spi(int num_reg, unsigned int *reg_value, int rw)
 
 	return ERROR_NONE;
 };
+
+/*!
+ * This function is used to send several frames on SPI bus.  Up to
+ * SPI_MC13783_BURST_FRAMES frames are loaded into the FIFO and exchanged
+ * at once.  They are sent with the_burst_config, which releases SS between
+ * frames, so mc13783 sees each one as a separate access.
+ *
+ * @param        num_reg    mc13783 register number of each frame
+ * @param        reg_value  value of each frame, replaced by the value read
+ * @param        rw         read (0) or write (1) for each frame
+ * @param        count      number of frames
+ *
+ * @return       This function returns 0 if successful, -1 otherwise.
+ */
+int spi_send_frames_to_spi(const int *num_reg, unsigned int *reg_value,
+			   const int *rw, int count)
+{
+	unsigned int send_val[SPI_MC13783_BURST_FRAMES];
+	unsigned int frame;
+	int i, n;
+
+	if (mxc_spi_is_active(the_config.module_number) == 0) {
+		return -1;
+	}
+
+	while (count > 0) {
+		n = min(count, SPI_MC13783_BURST_FRAMES);
+
+		for (i = 0; i < n; i++) {
+			frame = rw[i] ? 0x80000000 : 0;
+			frame |= (reg_value[i] & 0x0ffffff);
+			frame |= ((unsigned int)num_reg[i] & 0x3f) << 0x19;
+			send_val[i] = (((frame & 0x000000ff) << 0x18) |
+				       ((frame & 0x0000ff00) << 0x08) |
+				       ((frame & 0x00ff0000) >> 0x08) |
+				       ((frame & 0xff000000) >> 0x18));
+		}
+
+		if (spi_send_frame((unsigned char *)send_val,
+				   (unsigned long)(n * 4), spi_burst_id) != 0) {
+			return -1;
+		}
+
+		for (i = 0; i < n; i++) {
+			frame = (((send_val[i] & 0x000000ff) << 0x18) |
+				 ((send_val[i] & 0x0000ff00) << 0x08) |
+				 ((send_val[i] & 0x00ff0000) >> 0x08) |
+				 ((send_val[i] & 0xff000000) >> 0x18));
+			reg_value[i] = frame & 0x00ffffff;
+		}
+
+		num_reg += n;
+		reg_value += n;
+		rw += n;
+		count -= n;
+	}
+
+	return ERROR_NONE;
+}
@@ -7,7 +7,7 @@
  *      Stuart Lynne <sl@belcarra.com>,
  *      Bruce Balden <balden@belcarra.com>
  * 
- * Copyright (c) 2005-2008 Motorola, Inc.
+ * Copyright (c) 2005-2008, 2026 Motorola, Inc.
  *
  * Changelog:
  * Date               Author           Comment
@@ -33,6 +33,8 @@
  * 07/29/2008         Motorola         Ensure msc does start receiving the next urb until the
                                        previous one is received.This is to fix the panic when 
                                        connected to a MAC PC which sleeps and wakes up 
+ * 10/17/2026         Motorola         Added msc_recv_urb_for_pipe, allocate the pipeline
+                                       ring in msc_function_enable.
                                         
  *
  *
@@ -1325,6 +1327,35 @@ static int msc_recv_urb_for_write (struct usbd_urb *rcv_urb, int rc)
     return msc_recv_urb (rcv_urb,rc);
 }
 
+#ifdef CONFIG_OTG_MSC_PIPELINE
+/*! msc_recv_urb_for_pipe - process a received urb whose buffer is a pipeline buffer
+ *
+ * The buffer belongs to the pipeline ring and must never reach usbd_free_urb(),
+ * so anything other than WRITE(10) data is handed back to the pipeline here.
+ *
+ * Return non-zero if urb was not disposed of.
+ */
+int msc_recv_urb_for_pipe (struct usbd_urb *rcv_urb, int rc)
+{
+    struct usbd_function_instance *function_instance = rcv_urb->function_privdata;
+    struct msc_private *msc = ((struct msc_private *) function_instance->privdata) + msc_cmdlun;
+
+    switch (msc->command_state) {
+    case MSC_DATA_OUT_WRITE:
+    case MSC_DATA_OUT_WRITE_FINISHED:
+    case MSC_DATA_OUT_WRITE_ERROR:
+        if (msc->connected && !rc)
+            return msc_recv_urb (rcv_urb, rc);
+    default:
+        break;
+    }
+
+    TRACE_MSG2(MSC, "PIPE RECV DROPPED rc: %d state: %d", rc, msc->command_state);
+    msc_pipe_recv_failed(rcv_urb);
+    return -EINVAL;
+}
+#endif /* CONFIG_OTG_MSC_PIPELINE */
+
 /* USB Device Functions ************************************************************************ */
 
 /*! msc_device_request - called to indicate urb has been received
@@ -1414,6 +1445,13 @@ static int msc_function_enable (struct usbd_function_instance *function_instance
       
       RETURN_EINVAL_UNLESS((msc = CKMALLOC((msc_maxluns * sizeof(struct msc_private)), GFP_KERNEL)));
       
+#ifdef CONFIG_OTG_MSC_PIPELINE
+      if (msc_pipe_init()) {
+	  LKFREE(msc);
+	  return -ENOMEM;
+      }
+#endif
+
       // XXX MODULE LOCK HERE
       msc_recv_urb_already = 0;   
       
@@ -1464,6 +1502,11 @@ static void msc_function_disable (struct usbd_function_instance *function_instan
       // destroy control io interface
       msc_io_exit_l24(function_instance);
       
+#ifdef CONFIG_OTG_MSC_PIPELINE
+      // pipeline i/o still running uses msc, finish it first
+      msc_pipe_exit();
+#endif
+
       LKFREE(msc);          // Free memory used by the msc device
       
       // Set the private data to NULL.
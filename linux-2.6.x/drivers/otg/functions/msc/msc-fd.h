@@ -8,7 +8,7 @@
  *      Stuart Lynne <sl@belcarra.com>
  *      Bruce Balden <balden@belcarra.com>
  *
- * Copyright (c) 2005-2007 Motorola, Inc.
+ * Copyright (c) 2005-2007, 2026 Motorola, Inc.
  *
  * Changelog:
  * Date               Author           Comment
@@ -19,6 +19,7 @@
  * 10/18/2006         Motorola         Add Open Src Software language
  * 12/11/2006         Motorola         Changes for Open src compliance.
  * 03/07/2007         Motorola         Added function msc_start_recv_urb_for_write.
+ * 10/17/2026         Motorola         Added msc_recv_urb_for_pipe.
  *
  * This Program is distributed in the hope that it will
  * be useful, but WITHOUT ANY WARRANTY;
@@ -48,6 +49,10 @@ extern int msc_dispatch_query_urb_zlp(struct usbd_function_instance *, u32 sense
 extern int msc_start_sending_csw_failed(struct usbd_function_instance *, u32 sensedata, u32 info, int status);
 extern int msc_start_recv_urb(struct usbd_function_instance *, int size);
 extern int msc_start_recv_urb_for_write(struct usbd_function_instance *, int size);
+extern int msc_urb_sent (struct usbd_urb *tx_urb, int rc);
+#ifdef CONFIG_OTG_MSC_PIPELINE
+extern int msc_recv_urb_for_pipe (struct usbd_urb *rcv_urb, int rc);
+#endif
 
 
 #define NOCHK 0
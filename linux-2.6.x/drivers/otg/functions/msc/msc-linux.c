@@ -8,7 +8,7 @@
  *      Tony Tang <tt@belcarra.com>,
  *      Bruce Balden <balden@belcarra.com>
  *
- * Copyright (c) 2005-2008 Motorola, Inc.
+ * Copyright (c) 2005-2008, 2026 Motorola, Inc.
  *
  * Changelog:
  * Date               Author           Comment
@@ -23,6 +23,7 @@
  * 05/25/2007         Motorola         Adjust bdev capacity
  * 11/23/2007	      Motorola	       Changes for wait for msc read write 
  * 08/08/2008         Motorola         Commented out OTG debug from dmesg
+ * 10/17/2026         Motorola         Hand READ(10)/WRITE(10) to msc-pipe.c, add RAM LUN
  *
  * This Program is distributed in the hope that it will
  * be useful, but WITHOUT ANY WARRANTY;
@@ -84,6 +85,10 @@
  * CRC as read or written with LBA. These can be compared by user programs to
  * ensure that the correct data was read and/or written.
  *
+ * 8. With CONFIG_OTG_MSC_PIPELINE the READ(10) and WRITE(10) data phases are
+ * handled by msc-pipe.c instead, which keeps several multi-page bios in
+ * flight (see the notes there). Points 1 to 5 then do not apply.
+ *
  * 
  * TODO
  *
@@ -137,6 +142,8 @@
 #include <linux/fcntl.h>
 #include <linux/bio.h>
 #include <linux/buffer_head.h>
+#include <linux/vmalloc.h>
+#include <asm/div64.h>
 
 #define CONFIG_OTG_MSC_BLOCK_TRACE 1
 #include <linux/blkdev.h>
@@ -164,6 +171,9 @@ MOD_PARM_INT (product_id, "Device Product ID", 0);
 MOD_PARM_INT (major, "Device Major", 0);
 MOD_PARM_INT (minor, "Device Minor", 0);
 MOD_PARM_INT (param_maxluns, "Number of LUNS", 1);
+#ifdef CONFIG_OTG_MSC_PIPELINE
+MOD_PARM_INT (ramdisk_kb, "RAM LUN size in KB, mounted with major 0", 0);
+#endif
 
 
 /*------------------------------*/
@@ -217,6 +227,23 @@ extern void msc_global_init(void);
 
 /* Block Device ************************************************************* */
 
+#ifdef CONFIG_OTG_MSC_PIPELINE
+/*! msc_kb_per_sec - throughput in KB/s for the close time report
+ */
+static u32 msc_kb_per_sec(u64 bytes, u64 us)
+{
+        u64 rate = (bytes >> 10) * 1000000;
+
+        while (us >> 32) {
+                us >>= 1;
+                rate >>= 1;
+        }
+        RETURN_ZERO_UNLESS(us);
+        do_div(rate, (u32) us);
+        return (u32) rate;
+}
+#endif /* CONFIG_OTG_MSC_PIPELINE */
+
 /*! msc_open_blockdev - open the block device specified in msc->major, msc->minor
  *
  * Sets appropriate fields to show current status of block device.
@@ -235,6 +262,28 @@ void msc_open_blockdev(struct usbd_function_instance *function_instance, int lun
         msc->block_dev_state = DEVICE_EJECTED;
         TRACE_MSG2(MSC, "OPEN BLOCKDEV: Major: %x Minor: %x", msc->major, msc->minor);
 
+#ifdef CONFIG_OTG_MSC_PIPELINE
+        msc->read_bytes = msc->read_us = msc->write_bytes = msc->write_us = 0;
+
+        /* Benchmark mode: major 0 mounts a RAM disk, no block device is involved. */
+        if (!msc->major && MODPARM(ramdisk_kb)) {
+                THROW_UNLESS((msc->ramdisk = vmalloc(MODPARM(ramdisk_kb) * 1024)), ejected);
+                memset(msc->ramdisk, 0, MODPARM(ramdisk_kb) * 1024);
+
+                msc->bdev = NULL;
+                msc->io_state = MSC_INACTIVE;
+                msc->block_dev_state &= ~DEVICE_EJECTED;
+                msc->block_dev_state |= DEVICE_INSERTED | DEVICE_CHANGE_ON;
+                msc->block_size = 512;
+                msc->capacity = MODPARM(ramdisk_kb) * 2 - 1;
+                msc->max_blocks = PAGE_SIZE / msc->block_size;
+                msc->write_pending = msc->read_pending = 0;
+
+                printk(KERN_INFO"%s: RAM disk %d KB\n", __FUNCTION__, MODPARM(ramdisk_kb));
+                up(&msc_sem);
+                return ;
+        }
+#endif /* CONFIG_OTG_MSC_PIPELINE */
 
 	// Ensure non-zero major number; then make the device node.
         THROW_UNLESS(msc->major, ejected);
@@ -313,6 +362,17 @@ void msc_close_blockdev(struct usbd_function_instance *function_instance, int lu
         down(&msc_sem);
 	msc->block_dev_state = DEVICE_EJECTED;
 
+#ifdef CONFIG_OTG_MSC_PIPELINE
+        printk(KERN_INFO"%s: lun %d read %u KB at %u KB/s, wrote %u KB at %u KB/s\n", __FUNCTION__, lunNumber,
+                        (u32) (msc->read_bytes >> 10), msc_kb_per_sec(msc->read_bytes, msc->read_us),
+                        (u32) (msc->write_bytes >> 10), msc_kb_per_sec(msc->write_bytes, msc->write_us));
+
+        if (msc->ramdisk) {
+                vfree(msc->ramdisk);
+                msc->ramdisk = NULL;
+        }
+#endif /* CONFIG_OTG_MSC_PIPELINE */
+
 	if (msc->bdev)
             blkdev_put(msc->bdev);         /* Unregister the block device */
 
@@ -350,8 +410,13 @@ int msc_scsi_read_10(struct usbd_function_instance *function_instance, char *nam
          * Start reading blocks to send or simply send the CSW if the host
          * didn't actually ask for a non-zero length.
          */
+#ifdef CONFIG_OTG_MSC_PIPELINE
+        return (msc->TransferLength_in_blocks) ?  msc_pipe_start_read(function_instance) :
+                msc_start_sending_csw(function_instance, USB_MSC_PASSED);
+#else
         return (msc->TransferLength_in_blocks) ?  msc_start_reading_block_data(function_instance) :
                 msc_start_sending_csw(function_instance, USB_MSC_PASSED);
+#endif
 }
 
 
@@ -607,6 +672,10 @@ int msc_in_read_10_urb_sent(struct usbd_urb *tx_urb)
 
         TRACE_MSG0(MSC,"URB SENT DATA IN");
 
+#ifdef CONFIG_OTG_MSC_PIPELINE
+        return msc_pipe_read_sent(tx_urb);
+#endif
+
         /*
          * Potential race condition here, we may need to restart blockio.
          */
@@ -676,9 +745,15 @@ int msc_scsi_write_10(struct usbd_function_instance *function_instance, char *na
         TRACE_MSG2(MSC,"RECV WRITE lba: %x, lun: %d", msc->lba, msc_cmdlun); 
         TRACE_MSG1(MSC,"RECV WRITE blocks: %d", msc->TransferLength_in_blocks); 
 
+#ifdef CONFIG_OTG_MSC_PIPELINE
+        return (msc->TransferLength_in_blocks) ?
+                msc_pipe_start_write(function_instance) :
+                msc_start_sending_csw(function_instance, USB_MSC_PASSED);
+#else
         return (msc->TransferLength_in_blocks) ?
                 msc_start_receiving_data(function_instance) :
                 msc_start_sending_csw(function_instance, USB_MSC_PASSED);
+#endif
 }
  
 
@@ -741,6 +816,11 @@ void msc_recv_out_blocks(struct usbd_urb *rcv_urb)
 	TRACE_MSG4(MSC,"bytes: %d, lun: %d, iostate: 0x%x, TXed (bytes) %d", TransferLength_in_bytes, msc_cmdlun, msc->io_state, msc->data_transferred_in_bytes);
         TRACE_MSG3(MSC,"lba: 0x%x, left: %d, blocks current: %d", msc->lba, msc->TransferLength_in_blocks, TransferLength_in_blocks); 
 
+#ifdef CONFIG_OTG_MSC_PIPELINE
+        msc_pipe_recv_out(rcv_urb);
+        return;
+#endif
+
         /*
          * Race condition here, we may get to here before the previous block
          * write completed. If so just exit and the msc_data_written()
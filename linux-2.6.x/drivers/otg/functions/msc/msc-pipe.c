@@ -0,0 +1,865 @@
+/*
+ * otg/function/msc/msc-pipe.c
+ *
+ * Copyright (c) 2026 Motorola, Inc.
+ *
+ * Changelog:
+ * Date               Author           Comment
+ * -----------------------------------------------------------------------------
+ * 10/17/2026         Motorola         Initial distribution
+ *
+ * This Program is distributed in the hope that it will
+ * be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of
+ * MERCHANTIBILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * This program is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at
+ * your option) any later version.  You should have
+ * received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave,
+ * Cambridge, MA 02139, USA
+ *
+ */
+/*!
+ * @file otg/functions/msc/msc-pipe.c
+ * @brief Mass Storage Driver pipelined READ(10)/WRITE(10) data phase
+ *
+ * Notes:
+ *
+ * 1. A ring of CONFIG_OTG_MSC_PIPE_DEPTH buffers of CONFIG_OTG_MSC_PIPE_KB
+ * each is allocated when the function is enabled. Each buffer is the target
+ * of one multi-page bio and is handed to the bus interface driver as the urb
+ * buffer, so data is never copied.
+ *
+ * 2. READ(10): every free buffer gets a read bio. Buffers are sent in ring
+ * (LBA) order as soon as they and all earlier buffers have been read, so
+ * several tx urbs may be queued. A buffer is reused for the next read as soon
+ * as its urb has been sent.
+ *
+ * 3. WRITE(10): one receive urb is kept queued into the next free buffer.
+ * A received buffer becomes a write bio and the next receive is started at
+ * once, so up to DEPTH - 1 writes are in flight while the host is sending.
+ * The CSW is sent when the last bio has completed.
+ *
+ * 4. Each command bumps msc_pipe.gen. Buffers still owned by bios or urbs of
+ * an aborted command are left alone and freed when those complete.
+ * msc_pipe_exit() waits for all of them before freeing the ring.
+ *
+ * 5. bi_end_io may be called with the request queue lock held, so it only
+ * records the completion; the next bios, urbs or the CSW are started from
+ * kick_work. A buffer whose pages the queue will not take in one bio is
+ * split over several, and completes when the last of them does.
+ *
+ * 6. A LUN opened with major 0 while ramdisk_kb is set is served from a
+ * vmalloc'd RAM disk (see msc_open_blockdev()), which measures the USB and
+ * pipeline overhead without the media. msc_close_blockdev() prints the
+ * throughput seen by each LUN.
+ *
+ * @ingroup MSCFunction
+ */
+
+/*------------------------------*/
+/*     Included Files           */
+/*------------------------------*/
+#include <otg/otg-compat.h>
+#include <otg/usbp-chap9.h>
+#include <otg/usbp-func.h>
+#include <otg/otg-trace.h>
+
+#include <linux/config.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+
+#include <otg/otg-linux.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/time.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <public/otg-node.h>
+
+#include "msc-scsi.h"
+#include "msc.h"
+#include "msc-fd.h"
+
+
+/*------------------------------*/
+/*     Global Variables         */
+/*------------------------------*/
+static struct msc_pipe msc_pipe;
+
+#define MSC_PIPE_NEXT(i)        (((i) + 1) % CONFIG_OTG_MSC_PIPE_DEPTH)
+
+
+/*------------------------------*/
+/*     Function Prototypes      */
+/*------------------------------*/
+static void msc_pipe_kick(struct msc_pipe *pipe);
+static void msc_pipe_kick_work(void *data);
+
+
+/*------------------------------*/
+/*     Function Definitions     */
+/*------------------------------*/
+
+/*! msc_pipe_init - allocate the buffer ring, called from msc_function_enable()
+ */
+int msc_pipe_init(void)
+{
+        struct msc_pipe *pipe = &msc_pipe;
+        int i;
+
+        memset(pipe, 0, sizeof(*pipe));
+        pipe->done = 1;
+        PREPARE_WORK_ITEM(pipe->kick_work, msc_pipe_kick_work, pipe);
+        pipe->order = get_order(CONFIG_OTG_MSC_PIPE_KB * 1024);
+        pipe->size = PAGE_SIZE << pipe->order;
+
+        for (i = 0; i < CONFIG_OTG_MSC_PIPE_DEPTH; i++)
+                THROW_UNLESS((pipe->buf[i].data = (u8 *) __get_free_pages(GFP_KERNEL, pipe->order)), error);
+
+        TRACE_MSG2(MSC, "PIPE buffers: %d size: %d", CONFIG_OTG_MSC_PIPE_DEPTH, pipe->size);
+        return 0;
+
+        CATCH(error) {
+                printk(KERN_ERR"%s: cannot allocate %d pipeline buffers of %d bytes\n", __FUNCTION__,
+                                CONFIG_OTG_MSC_PIPE_DEPTH, pipe->size);
+                msc_pipe_exit();
+                return -ENOMEM;
+        }
+}
+
+
+/*! msc_pipe_busy - return non-zero while a bio or urb still owns a buffer
+ */
+static int msc_pipe_busy(struct msc_pipe *pipe)
+{
+        unsigned long flags;
+        int busy;
+        int i;
+
+        local_irq_save(flags);
+        busy = pipe->ending;
+        for (i = 0; i < CONFIG_OTG_MSC_PIPE_DEPTH; i++)
+                busy |= (pipe->buf[i].state == MSC_PIPE_BLOCKIO) || (pipe->buf[i].state == MSC_PIPE_URB);
+        local_irq_restore(flags);
+        return busy;
+}
+
+
+/*! msc_pipe_exit - free the buffer ring, called from msc_function_disable()
+ *
+ * Bios and urbs of this or an aborted command may still be using the buffers,
+ * so start nothing new and wait for them before the pages are freed.
+ */
+void msc_pipe_exit(void)
+{
+        struct msc_pipe *pipe = &msc_pipe;
+        unsigned long flags;
+        int i;
+
+        local_irq_save(flags);
+        pipe->stop = 1;
+        pipe->done = 1;
+        local_irq_restore(flags);
+
+        for (i = 0; msc_pipe_busy(pipe); i++) {
+                if (!i)
+                        printk(KERN_ERR"%s: waiting for MSC pipeline i/o\n", __FUNCTION__);
+                set_current_state(TASK_UNINTERRUPTIBLE);
+                schedule_timeout(HZ / 10);
+        }
+        flush_scheduled_work();
+
+        for (i = 0; i < CONFIG_OTG_MSC_PIPE_DEPTH; i++) {
+                if (pipe->buf[i].data)
+                        free_pages((unsigned long) pipe->buf[i].data, pipe->order);
+                pipe->buf[i].data = NULL;
+        }
+}
+
+
+/*! msc_pipe_find - return the buffer an urb was started with
+ */
+static struct msc_pipe_buf *msc_pipe_find(struct msc_pipe *pipe, struct usbd_urb *urb)
+{
+        int i;
+
+        for (i = 0; i < CONFIG_OTG_MSC_PIPE_DEPTH; i++)
+                if (pipe->buf[i].urb == urb)
+                        return pipe->buf + i;
+        return NULL;
+}
+
+
+/*! msc_pipe_reset - start a new command
+ *
+ * Buffers with a bio or urb outstanding are left to msc_pipe_complete() and
+ * the urb callbacks, which free them when they see the old generation.
+ */
+static void msc_pipe_reset(struct msc_pipe *pipe, struct usbd_function_instance *function_instance,
+                struct msc_private *msc, int writing)
+{
+        unsigned long flags;
+        int i;
+
+        local_irq_save(flags);
+        pipe->function_instance = function_instance;
+        pipe->msc = msc;
+        pipe->writing = writing;
+        pipe->gen++;
+        pipe->head = pipe->tail = 0;
+        pipe->bios = pipe->urbs = 0;
+        pipe->err = pipe->stop = pipe->done = 0;
+        pipe->sense = SCSI_SENSEKEY_NO_SENSE;
+        pipe->lba = msc->lba;
+        pipe->blocks = msc->TransferLength_in_blocks;
+        pipe->bytes = 0;
+
+        for (i = 0; i < CONFIG_OTG_MSC_PIPE_DEPTH; i++) {
+                if ((pipe->buf[i].state == MSC_PIPE_BLOCKIO) || (pipe->buf[i].state == MSC_PIPE_URB))
+                        continue;
+                pipe->buf[i].state = MSC_PIPE_FREE;
+                pipe->buf[i].urb = NULL;
+        }
+        local_irq_restore(flags);
+
+        do_posix_clock_monotonic_gettime(&pipe->start);
+}
+
+
+/*! msc_pipe_fail - record the first error of a command
+ */
+static void msc_pipe_fail(struct msc_pipe *pipe, int err, u32 sense)
+{
+        unsigned long flags;
+
+        local_irq_save(flags);
+        if (!pipe->err) {
+                pipe->err = err;
+                pipe->sense = sense;
+        }
+        if (pipe->writing)
+                pipe->msc->command_state = MSC_DATA_OUT_WRITE_ERROR;
+        else
+                pipe->stop = 1;
+        local_irq_restore(flags);
+}
+
+
+/*! msc_pipe_finish - all bios and urbs are done, account for and send the CSW
+ */
+static int msc_pipe_finish(struct msc_pipe *pipe)
+{
+        struct usbd_function_instance *function_instance = pipe->function_instance;
+        struct msc_private *msc = pipe->msc;
+        struct timespec now;
+        u32 us;
+
+        do_posix_clock_monotonic_gettime(&now);
+        us = (now.tv_sec - pipe->start.tv_sec) * 1000000 + (now.tv_nsec - pipe->start.tv_nsec) / 1000;
+
+        TRACE_MSG4(MSC, "PIPE DONE writing: %d bytes: %d us: %d err: %d", pipe->writing, pipe->bytes, us, pipe->err);
+
+        if (pipe->writing) {
+                msc->write_bytes += pipe->bytes;
+                msc->write_us += us;
+                msc->write_pending = 0;
+        }
+        else {
+                msc->read_bytes += pipe->bytes;
+                msc->read_us += us;
+                msc->read_pending = 0;
+        }
+        wake_up_interruptible(&msc->rdwr_wq);
+
+        if (pipe->err || (pipe->stop && msc->TransferLength_in_blocks) ||
+                        (msc->command_state == MSC_DATA_OUT_WRITE_ERROR))
+        {
+                u32 sense = pipe->sense;
+
+                if (sense == SCSI_SENSEKEY_NO_SENSE)
+                        sense = pipe->writing ? SCSI_SENSEKEY_WRITE_ERROR : SCSI_SENSEKEY_UNRECOVERED_READ_ERROR;
+                return msc_start_sending_csw_failed (function_instance, sense, msc->lba, USB_MSC_FAILED);
+        }
+
+        msc->command_state = pipe->writing ? MSC_DATA_OUT_WRITE_FINISHED : MSC_DATA_IN_READ_FINISHED;
+        return msc_start_sending_csw(function_instance, USB_MSC_PASSED);
+}
+
+
+/*! msc_pipe_check_done - send the CSW once nothing is outstanding
+ */
+static void msc_pipe_check_done(struct msc_pipe *pipe)
+{
+        unsigned long flags;
+        int done;
+
+        local_irq_save(flags);
+        done = !pipe->done && !pipe->bios && !pipe->urbs &&
+                (pipe->stop || !pipe->msc->TransferLength_in_blocks);
+        if (done)
+                pipe->done = 1;
+        local_irq_restore(flags);
+
+        if (done)
+                msc_pipe_finish(pipe);
+}
+
+
+/*! msc_pipe_complete - block i/o for a buffer has finished
+ *
+ * Only updates the buffer state, the caller calls or schedules msc_pipe_kick().
+ */
+static void msc_pipe_complete(struct msc_pipe *pipe, struct msc_pipe_buf *buf, int err)
+{
+        unsigned long flags;
+        u32 sense = SCSI_SENSEKEY_UNRECOVERED_READ_ERROR;
+
+        local_irq_save(flags);
+
+        /* left over from an aborted command */
+        if (buf->gen != pipe->gen) {
+                buf->state = MSC_PIPE_FREE;
+                local_irq_restore(flags);
+                return;
+        }
+
+        pipe->bios--;
+        buf->state = (pipe->writing || err) ? MSC_PIPE_FREE : MSC_PIPE_READY;
+        local_irq_restore(flags);
+
+        RETURN_UNLESS(err);
+
+        TRACE_MSG2(MSC, "PIPE BLOCKIO ERROR lba: 0x%x err: %d", buf->lba, err);
+        if (pipe->writing) {
+                err = ((err < 0) ? err * -1 : err);
+                sense = SCSI_SENSEKEY_WRITE_ERROR;
+                sense = ((err == ENODEV) ? SCSI_SENSEKEY_MEDIA_NOT_PRESENT : sense);
+                sense = ((err == ENOMEM) ? SCSI_SENSEKEY_MEDIA_NOT_PRESENT : sense);
+                sense = ((err == EINVAL) ? SCSI_SENSEKEY_BLOCK_ADDRESS_OUT_OF_RANGE : sense);
+        }
+        msc_pipe_fail(pipe, err, sense);
+}
+
+
+/*! msc_pipe_buf_put - drop one bio reference on a buffer
+ *
+ * Returns non-zero when that was the last one and the buffer has been completed.
+ */
+static int msc_pipe_buf_put(struct msc_pipe *pipe, struct msc_pipe_buf *buf, int err)
+{
+        unsigned long flags;
+        int last;
+
+        local_irq_save(flags);
+        if (err && !buf->err)
+                buf->err = err;
+        last = !--buf->bios;
+        local_irq_restore(flags);
+
+        if (last)
+                msc_pipe_complete(pipe, buf, buf->err);
+        return last;
+}
+
+
+/*! msc_pipe_bio_done - bi_end_io for pipeline bios
+ *
+ * May be called with the queue lock held: record the completion and leave
+ * starting more i/o to kick_work.
+ */
+static int msc_pipe_bio_done(struct bio *bio, unsigned int bytes_done, int err)
+{
+        struct msc_pipe_buf *buf = bio->bi_private;
+        unsigned long flags;
+
+        if (bio->bi_size)
+                return 1;
+
+        if (!err && !test_bit(BIO_UPTODATE, &bio->bi_flags))
+                err = -EIO;
+
+        /* msc_pipe_exit() must not see the buffer free before the work is queued */
+        local_irq_save(flags);
+        msc_pipe.ending++;
+        local_irq_restore(flags);
+
+        bio_put(bio);
+        if (msc_pipe_buf_put(&msc_pipe, buf, err))
+                SCHEDULE_WORK(msc_pipe.kick_work);
+
+        local_irq_save(flags);
+        msc_pipe.ending--;
+        local_irq_restore(flags);
+        return 0;
+}
+
+
+/*! msc_pipe_kick_work - restart the pipe after block i/o has completed
+ */
+static void msc_pipe_kick_work(void *data)
+{
+        msc_pipe_kick((struct msc_pipe *) data);
+}
+
+
+/*! msc_pipe_submit - submit one bio of a buffer
+ */
+static void msc_pipe_submit(struct msc_pipe_buf *buf, struct bio *bio, int rw)
+{
+        unsigned long flags;
+
+        local_irq_save(flags);
+        buf->bios++;
+        local_irq_restore(flags);
+        submit_bio(rw, bio);
+}
+
+
+/*! msc_pipe_start_io - start block i/o on a buffer
+ *
+ * For the RAM LUN the copy is done here and the buffer completed at once.
+ * Pages are added with bio_add_page(); when the queue refuses one the bio so
+ * far is submitted and a new one started. Returns non-zero if a bio was
+ * submitted and the queue needs unplugging.
+ */
+static int msc_pipe_start_io(struct msc_pipe *pipe, struct msc_pipe_buf *buf, int rw)
+{
+        struct msc_private *msc = pipe->msc;
+        sector_t sector = buf->lba * (msc->block_size >> 9);
+        struct bio *bio = NULL;
+        int submitted = 0;
+        int err = 0;
+        int offset;
+
+        if (msc->ramdisk) {
+                u8 *disk = msc->ramdisk + buf->lba * msc->block_size;
+
+                if (rw == WRITE)
+                        memcpy(disk, buf->data, buf->bytes);
+                else
+                        memcpy(buf->data, disk, buf->bytes);
+                msc_pipe_complete(pipe, buf, 0);
+                return 0;
+        }
+
+        /* held until every bio has been submitted */
+        buf->bios = 1;
+        buf->err = 0;
+
+        for (offset = 0; offset < buf->bytes; ) {
+                int len = MIN(buf->bytes - offset, PAGE_SIZE);
+
+                if (!bio) {
+                        int pages = (buf->bytes - offset + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+                        if (!(bio = bio_alloc(GFP_ATOMIC, pages))) {
+                                err = -ENOMEM;
+                                break;
+                        }
+                        bio->bi_bdev = msc->bdev;
+                        bio->bi_sector = sector + (offset >> 9);
+                        bio->bi_private = buf;
+                        bio->bi_end_io = msc_pipe_bio_done;
+                }
+
+                if (bio_add_page(bio, virt_to_page(buf->data + offset), len, 0) == len) {
+                        offset += len;
+                        continue;
+                }
+
+                /* the queue will not take even one page */
+                if (!bio->bi_vcnt) {
+                        err = -EIO;
+                        break;
+                }
+
+                msc_pipe_submit(buf, bio, rw);
+                submitted = 1;
+                bio = NULL;
+        }
+
+        if (bio && bio->bi_vcnt && !err) {
+                msc_pipe_submit(buf, bio, rw);
+                submitted = 1;
+        }
+        else if (bio)
+                bio_put(bio);
+
+        msc_pipe_buf_put(pipe, buf, err);
+        return submitted;
+}
+
+
+/* READ(10) ***************************************************************** */
+
+/*! msc_pipe_read_fill - start a read bio on every free buffer
+ */
+static void msc_pipe_read_fill(struct msc_pipe *pipe)
+{
+        struct msc_private *msc = pipe->msc;
+        int unplug = 0;
+
+        for (;;) {
+                struct msc_pipe_buf *buf;
+                unsigned long flags;
+                int blocks;
+
+                local_irq_save(flags);
+                buf = pipe->buf + pipe->head;
+                if (pipe->stop || !pipe->blocks || (buf->state != MSC_PIPE_FREE)) {
+                        local_irq_restore(flags);
+                        break;
+                }
+                blocks = MIN(pipe->size / msc->block_size, pipe->blocks);
+                buf->state = MSC_PIPE_BLOCKIO;
+                buf->gen = pipe->gen;
+                buf->lba = pipe->lba;
+                buf->bytes = blocks * msc->block_size;
+                pipe->lba += blocks;
+                pipe->blocks -= blocks;
+                pipe->head = MSC_PIPE_NEXT(pipe->head);
+                pipe->bios++;
+                local_irq_restore(flags);
+
+                unplug |= msc_pipe_start_io(pipe, buf, READ);
+        }
+
+        if (unplug)
+                generic_unplug_device(bdev_get_queue(msc->bdev));
+}
+
+
+/*! msc_pipe_urb_sent - tx urb callback, the buffer is never freed with the urb
+ */
+static int msc_pipe_urb_sent(struct usbd_urb *tx_urb, int rc)
+{
+        tx_urb->buffer = NULL;
+        return msc_urb_sent(tx_urb, rc);
+}
+
+
+/*! msc_pipe_send_buf - start a tx urb using a read buffer as its buffer
+ */
+static int msc_pipe_send_buf(struct msc_pipe *pipe, struct msc_pipe_buf *buf)
+{
+        struct usbd_function_instance *function_instance = pipe->function_instance;
+        struct usbd_urb *tx_urb;
+
+        RETURN_EINVAL_UNLESS((tx_urb = usbd_alloc_urb (function_instance, BULK_IN, 0, msc_pipe_urb_sent)));
+
+        tx_urb->function_privdata = function_instance;
+        tx_urb->buffer = buf->data;
+        tx_urb->actual_length = tx_urb->buffer_length = buf->bytes;
+        tx_urb->alloc_length = pipe->size;
+        buf->urb = tx_urb;
+
+        RETURN_ZERO_UNLESS(usbd_start_in_urb (tx_urb));
+
+        buf->urb = NULL;
+        tx_urb->buffer = NULL;
+        usbd_free_urb (tx_urb);
+        return -EINVAL;
+}
+
+
+/*! msc_pipe_read_send - queue tx urbs for read buffers, in order
+ */
+static void msc_pipe_read_send(struct msc_pipe *pipe)
+{
+        for (;;) {
+                struct msc_pipe_buf *buf;
+                unsigned long flags;
+
+                local_irq_save(flags);
+                buf = pipe->buf + pipe->tail;
+                if (pipe->stop || (buf->state != MSC_PIPE_READY) || (buf->gen != pipe->gen)) {
+                        local_irq_restore(flags);
+                        break;
+                }
+                buf->state = MSC_PIPE_URB;
+                pipe->tail = MSC_PIPE_NEXT(pipe->tail);
+                pipe->urbs++;
+                local_irq_restore(flags);
+
+                if (msc_pipe_send_buf(pipe, buf)) {
+                        TRACE_MSG1(MSC, "PIPE SEND FAILED lba: 0x%x", buf->lba);
+                        local_irq_save(flags);
+                        buf->state = MSC_PIPE_FREE;
+                        pipe->urbs--;
+                        local_irq_restore(flags);
+                        msc_pipe_fail(pipe, -EIO, SCSI_SENSEKEY_UNRECOVERED_READ_ERROR);
+                        break;
+                }
+        }
+}
+
+
+/*! msc_pipe_start_read - called by msc_scsi_read_10()
+ *
+ * Returns non-zero if there is an error in the USB layer.
+ */
+int msc_pipe_start_read(struct usbd_function_instance *function_instance)
+{
+        struct msc_private *msc = ((struct msc_private *)(function_instance->privdata)) + msc_cmdlun;
+        struct msc_pipe *pipe = &msc_pipe;
+        u32 sense = SCSI_SENSEKEY_NO_SENSE;
+
+        msc_pipe_reset(pipe, function_instance, msc, 0);
+
+        sense = ((msc->lba > msc->capacity) || (msc->TransferLength_in_blocks > msc->capacity - msc->lba + 1)) ?
+                SCSI_SENSEKEY_BLOCK_ADDRESS_OUT_OF_RANGE : sense;
+        sense = ((msc->block_dev_state != DEVICE_INSERTED) ? SCSI_SENSEKEY_MEDIA_NOT_PRESENT : sense);
+
+        if (sense != SCSI_SENSEKEY_NO_SENSE) {
+                TRACE_MSG4(MSC, "Error! sense_data: 0x%x block_dev_state: 0x%x lba: %d capacity: %d",
+                                sense, msc->block_dev_state, msc->lba, msc->capacity);
+                pipe->done = 1;
+                msc->read_pending = 0;
+                wake_up_interruptible(&msc->rdwr_wq);
+                return msc_start_sending_csw_failed (function_instance, sense, msc->lba, USB_MSC_FAILED);
+        }
+
+        msc_pipe_kick(pipe);
+        return 0;
+}
+
+
+/*! msc_pipe_read_sent - called by msc_in_read_10_urb_sent()
+ *
+ * The buffer is free for the next read; account for the data and restart.
+ */
+int msc_pipe_read_sent(struct usbd_urb *tx_urb)
+{
+        struct msc_pipe *pipe = &msc_pipe;
+        struct msc_private *msc = pipe->msc;
+        struct msc_pipe_buf *buf;
+        unsigned long flags;
+
+        local_irq_save(flags);
+        if ((buf = msc_pipe_find(pipe, tx_urb))) {
+                buf->urb = NULL;
+                buf->state = MSC_PIPE_FREE;
+        }
+        if (buf && (buf->gen == pipe->gen)) {
+                int blocks = buf->bytes / msc->block_size;
+
+                pipe->urbs--;
+                pipe->bytes += tx_urb->actual_length;
+                msc->data_transferred_in_bytes += tx_urb->actual_length;
+                msc->TransferLength_in_blocks -= blocks;
+                msc->TransferLength_in_bytes -= buf->bytes;
+                msc->lba += blocks;
+
+                /* nothing was sent, the host has gone away */
+                if (!tx_urb->actual_length) {
+                        msc->TransferLength_in_blocks = 0;
+                        pipe->blocks = 0;
+                        pipe->stop = 1;
+                }
+        }
+        local_irq_restore(flags);
+
+        TRACE_MSG2(MSC, "PIPE SENT: %d left: %d", tx_urb->actual_length, msc->TransferLength_in_blocks);
+
+        tx_urb->buffer = NULL;
+        usbd_free_urb (tx_urb);
+
+        msc_pipe_kick(pipe);
+        return 0;
+}
+
+
+/* WRITE(10) **************************************************************** */
+
+/*! msc_pipe_write_fill - keep one receive urb queued into the next free buffer
+ */
+static void msc_pipe_write_fill(struct msc_pipe *pipe)
+{
+        struct usbd_function_instance *function_instance = pipe->function_instance;
+        struct msc_private *msc = pipe->msc;
+        int wMaxPacketSize = usbd_endpoint_wMaxPacketSize(function_instance, BULK_OUT, usbd_high_speed(function_instance));
+        struct msc_pipe_buf *buf;
+        struct usbd_urb *rcv_urb;
+        unsigned long flags;
+        int blocks;
+        int size;
+
+        local_irq_save(flags);
+        buf = pipe->buf + pipe->head;
+        if (pipe->stop || pipe->urbs || !pipe->blocks || (buf->state != MSC_PIPE_FREE)) {
+                local_irq_restore(flags);
+                return;
+        }
+        blocks = MIN(pipe->size / msc->block_size, pipe->blocks);
+        buf->state = MSC_PIPE_URB;
+        buf->gen = pipe->gen;
+        buf->bytes = blocks * msc->block_size;
+        pipe->blocks -= blocks;
+        pipe->head = MSC_PIPE_NEXT(pipe->head);
+        pipe->urbs++;
+        local_irq_restore(flags);
+
+        size = buf->bytes;
+        if ((size % wMaxPacketSize))
+                size = MIN(((size + wMaxPacketSize) / wMaxPacketSize) * wMaxPacketSize, pipe->size);
+
+        THROW_UNLESS((rcv_urb = usbd_alloc_urb (function_instance, BULK_OUT, 0, msc_recv_urb_for_pipe)), error);
+
+        rcv_urb->function_privdata = function_instance;
+        rcv_urb->buffer = buf->data;
+        rcv_urb->buffer_length = size;
+        rcv_urb->alloc_length = pipe->size;
+        rcv_urb->actual_length = 0;
+        buf->urb = rcv_urb;
+
+        RETURN_UNLESS(usbd_start_out_urb (rcv_urb));
+
+        buf->urb = NULL;
+        rcv_urb->buffer = NULL;
+        usbd_free_urb (rcv_urb);
+        THROW(error);
+
+        CATCH(error) {
+                TRACE_MSG0(MSC, "PIPE START RECV URB ERROR");
+                local_irq_save(flags);
+                buf->state = MSC_PIPE_FREE;
+                pipe->urbs--;
+                pipe->stop = 1;
+                local_irq_restore(flags);
+                msc_pipe_fail(pipe, -EIO, SCSI_SENSEKEY_WRITE_ERROR);
+        }
+}
+
+
+/*! msc_pipe_start_write - called by msc_scsi_write_10()
+ *
+ * Errors found here still receive (and discard) the data before the CSW.
+ */
+int msc_pipe_start_write(struct usbd_function_instance *function_instance)
+{
+        struct msc_private *msc = ((struct msc_private *)(function_instance->privdata)) + msc_cmdlun;
+        struct msc_pipe *pipe = &msc_pipe;
+
+        msc_pipe_reset(pipe, function_instance, msc, 1);
+
+        if ((msc->lba > msc->capacity) || (msc->TransferLength_in_blocks > msc->capacity - msc->lba + 1))
+                msc_pipe_fail(pipe, -EINVAL, SCSI_SENSEKEY_BLOCK_ADDRESS_OUT_OF_RANGE);
+        if (msc->block_dev_state != DEVICE_INSERTED)
+                msc_pipe_fail(pipe, -ENODEV, SCSI_SENSEKEY_MEDIA_NOT_PRESENT);
+
+        msc_pipe_kick(pipe);
+        return 0;
+}
+
+
+/*! msc_pipe_recv_out - called by msc_recv_out_blocks() with WRITE(10) data
+ *
+ * Queue the next receive before submitting the write so that the host can
+ * keep sending while the block layer works.
+ */
+void msc_pipe_recv_out(struct usbd_urb *rcv_urb)
+{
+        struct msc_pipe *pipe = &msc_pipe;
+        struct msc_private *msc = pipe->msc;
+        int bytes = rcv_urb->actual_length;
+        int blocks = bytes / msc->block_size;
+        struct msc_pipe_buf *buf;
+        unsigned long flags;
+        int write = 0;
+
+        local_irq_save(flags);
+        if ((buf = msc_pipe_find(pipe, rcv_urb)))
+                buf->urb = NULL;
+        if (buf && (buf->gen == pipe->gen)) {
+                pipe->urbs--;
+
+                /* a short or oversized transfer ends the data phase */
+                if (blocks > msc->TransferLength_in_blocks)
+                        blocks = msc->TransferLength_in_blocks;
+                if (blocks * msc->block_size < buf->bytes)
+                        pipe->stop = 1;
+
+                buf->lba = msc->lba;
+                buf->bytes = blocks * msc->block_size;
+                msc->lba += blocks;
+                msc->TransferLength_in_blocks -= blocks;
+                msc->TransferLength_in_bytes -= bytes;
+                msc->data_transferred_in_bytes += bytes;
+                pipe->bytes += bytes;
+
+                write = blocks && (msc->command_state != MSC_DATA_OUT_WRITE_ERROR);
+                buf->state = write ? MSC_PIPE_BLOCKIO : MSC_PIPE_FREE;
+                if (write)
+                        pipe->bios++;
+        }
+        else if (buf)
+                buf->state = MSC_PIPE_FREE;
+        local_irq_restore(flags);
+
+        TRACE_MSG3(MSC, "PIPE RECV: %d lba: 0x%x left: %d", bytes, msc->lba, msc->TransferLength_in_blocks);
+
+        rcv_urb->buffer = NULL;
+        usbd_free_urb(rcv_urb);
+
+        if (write) {
+                msc_pipe_write_fill(pipe);
+                if (msc_pipe_start_io(pipe, buf, WRITE))
+                        generic_unplug_device(bdev_get_queue(msc->bdev));
+        }
+        msc_pipe_kick(pipe);
+}
+
+
+/*! msc_pipe_recv_failed - a pipeline receive urb was cancelled or failed
+ *
+ * Called by msc_recv_urb_for_pipe(), which lets the caller free the urb.
+ */
+void msc_pipe_recv_failed(struct usbd_urb *rcv_urb)
+{
+        struct msc_pipe *pipe = &msc_pipe;
+        struct msc_pipe_buf *buf;
+        unsigned long flags;
+        int current_gen = 0;
+
+        local_irq_save(flags);
+        if ((buf = msc_pipe_find(pipe, rcv_urb))) {
+                buf->urb = NULL;
+                buf->state = MSC_PIPE_FREE;
+                if ((current_gen = (buf->gen == pipe->gen))) {
+                        pipe->urbs--;
+                        pipe->stop = 1;
+                }
+        }
+        rcv_urb->buffer = NULL;
+        local_irq_restore(flags);
+
+        if (current_gen)
+                msc_pipe_fail(pipe, -EIO, SCSI_SENSEKEY_WRITE_ERROR);
+
+        /* a buffer left from an aborted command may be what the pipe waits for */
+        msc_pipe_kick(pipe);
+}
+
+
+/*! msc_pipe_kick - start whatever can be started, then check for the end of the command
+ */
+static void msc_pipe_kick(struct msc_pipe *pipe)
+{
+        RETURN_IF(pipe->done);
+
+        if (pipe->writing)
+                msc_pipe_write_fill(pipe);
+        else {
+                msc_pipe_read_fill(pipe);
+                msc_pipe_read_send(pipe);
+        }
+        msc_pipe_check_done(pipe);
+}
@@ -7,7 +7,7 @@
  *      Stuart Lynne <sl@belcarra.com>
  *      Bruce Balden <balden@belcarra.com>
  *
- * Copyright (c) 2005-2007 Motorola, Inc.
+ * Copyright (c) 2005-2007, 2026 Motorola, Inc.
  *
  * Changelog:
  * Date               Author           Comment
@@ -17,6 +17,7 @@
  * 10/18/2006         Motorola         Add Open Src Software language
  * 12/11/2006         Motorola         Changes for Open src compliance.
  * 03/07/2007         Motorola         Added function to use get_free_pages.
+ * 10/17/2026         Motorola         Added pipelined block I/O ring and RAM LUN.
  *
  * This Program is distributed in the hope that it will
  * be useful, but WITHOUT ANY WARRANTY;
@@ -144,9 +145,72 @@ struct msc_private {
         u32                     info;
         struct usbd_urb         *rcv_urb_bio_current;     // rcv urb for current bio (for write)
 
+#ifdef CONFIG_OTG_MSC_PIPELINE
+        u8                      *ramdisk;               // benchmark RAM LUN, NULL for a block device
+        u64                     read_bytes;             // totals since open, printed on close
+        u64                     read_us;
+        u64                     write_bytes;
+        u64                     write_us;
+#endif
+
+};
+
+
+#ifdef CONFIG_OTG_MSC_PIPELINE
+/*------------------------------*/
+/*     Pipeline                 */
+/*------------------------------*/
 
+/* msc_pipe_buf states */
+#define MSC_PIPE_FREE           0       // unused
+#define MSC_PIPE_BLOCKIO        1       // bio outstanding
+#define MSC_PIPE_READY          2       // read data waiting to be sent
+#define MSC_PIPE_URB            3       // tx or rcv urb outstanding
+
+struct msc_pipe_buf {
+        int                     state;
+        int                     gen;                    // command that owns the buffer
+        u8                      *data;                  // 2^order pages, also used as the urb buffer
+        u32                     lba;
+        int                     bytes;
+        struct usbd_urb         *urb;
+        int                     bios;                   // bios outstanding for this buffer
+        int                     err;                    // first error of those bios
 };
 
+struct msc_pipe {
+        struct usbd_function_instance *function_instance;
+        struct msc_private      *msc;                   // LUN of the current command
+        struct msc_pipe_buf     buf[CONFIG_OTG_MSC_PIPE_DEPTH];
+        int                     order;
+        int                     size;                   // bytes per buffer
+        int                     head;                   // next buffer to fill
+        int                     tail;                   // next buffer to send (READ)
+        int                     gen;                    // bumped for every command
+        int                     writing;
+        int                     bios;                   // bios outstanding
+        int                     urbs;                   // urbs outstanding
+        int                     err;                    // first block i/o error
+        int                     stop;                   // start no more i/o
+        int                     done;                   // CSW queued
+        int                     ending;                 // msc_pipe_bio_done() calls running
+        u32                     sense;
+        u32                     lba;                    // next lba to read
+        u32                     blocks;                 // blocks not yet read
+        u32                     bytes;                  // bytes moved by this command
+        struct timespec         start;                  // monotonic clock
+        WORK_ITEM               kick_work;              // restarts the pipe after block i/o
+};
+
+extern int msc_pipe_init(void);
+extern void msc_pipe_exit(void);
+extern int msc_pipe_start_read(struct usbd_function_instance *function_instance);
+extern int msc_pipe_read_sent(struct usbd_urb *tx_urb);
+extern int msc_pipe_start_write(struct usbd_function_instance *function_instance);
+extern void msc_pipe_recv_out(struct usbd_urb *rcv_urb);
+extern void msc_pipe_recv_failed(struct usbd_urb *rcv_urb);
+#endif /* CONFIG_OTG_MSC_PIPELINE */
+
 
 /*------------------------------*/
 /*     Defines                  */
@@ -9,7 +9,7 @@
  *      Stuart Lynne <sl@belcarra.com>
  *      Bruce Balden <balden@belcarra.com>
  *
- * Copyright 2005-2006 Motorola, Inc.
+ * Copyright 2005-2006, 2026 Motorola, Inc.
  *
  * Changelog:
  * Date               Author           Comment
@@ -17,6 +17,7 @@
  * 06/08/2005         Motorola         Initial distribution 
  * 10/18/2006         Motorola         Add Open Src Software language
  * 12/11/2006         Motorola         Changes for Open src compliance.
+ * 10/17/2026         Motorola         Zero copy transmit and receive, loopback benchmark
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -103,6 +104,9 @@
 #ifdef CONFIG_OTG_NETWORK_BLAN_FERMAT
 #include "fermat.h"
 #endif
+#ifdef CONFIG_OTG_NETWORK_ZEROCOPY
+#include <asm/div64.h>
+#endif
 
 
 static char ip_addr_str[32];
@@ -284,6 +288,109 @@ static u32 __inline__ crc32_pad (u8 *dst, int len, u32 val)
         return val;
 }
 
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+//_________________________________________________________________________________________________
+//                                      zero copy framing
+
+/*
+ * With CONFIG_OTG_NETWORK_ZEROCOPY the bulk urbs point directly at the
+ * network buffers. Transmit appends the CRC in the buffer's own tailroom
+ * and receive verifies the CRC where the data landed, so neither direction
+ * copies the frame. Receive still uses the copying path if pad after is
+ * configured, and transmit falls back to it whenever the OS layer cannot
+ * lend the buffer.
+ */
+#if !defined(CONFIG_OTG_NETWORK_BLAN_PADAFTER)
+#define NET_FD_RX_INPLACE 1
+#endif
+
+#if defined( CONFIG_OTG_NETWORK_BLAN_CRC ) || defined( CONFIG_OTG_NETWORK_SAFE_CRC  )
+#define NET_FD_TRAILER 4
+#else
+#define NET_FD_TRAILER 0
+#endif
+
+#if defined(CONFIG_OTG_NETWORK_BLAN_FERMAT)
+#define NET_FD_FERMAT(npd) ((npd)->fermat)
+#else
+#define NET_FD_FERMAT(npd) 0
+#endif
+
+/*! crc32_block - calculate crc32 without copying
+ *
+ * @param src   Pointer to the memory area.
+ * @param len   Number of bytes.
+ * @param val   Starting value for the CRC FCS.
+ *
+ * @return      Final value of the CRC FCS.
+ *
+ * @sa crc32_copy
+ */
+static u32 __inline__ crc32_block (u8 *src, int len, u32 val)
+{
+        for (; len-- > 0; val = COMPUTE_FCS (val, *src++));
+        return val;
+}
+
+/*! net_fd_encode_inplace - frame a buffer for sending without copying it
+ *
+ * Appends the CRC directly after the data, the caller guarantees NET_FD_TRAILER
+ * bytes of tailroom. Sets USBD_URB_SENDZLP in flags if the host needs a ZLP
+ * to see the end of the transfer.
+ *
+ * @return length to send
+ */
+STATIC int net_fd_encode_inplace (u8 *buffer, int len, int in_pkt_sz, u32 *flags)
+{
+#if defined( CONFIG_OTG_NETWORK_BLAN_CRC ) || defined( CONFIG_OTG_NETWORK_SAFE_CRC  )
+        u32 crc = ~crc32_block(buffer, len, CRC32_INIT);
+
+        if ((len % in_pkt_sz) == (in_pkt_sz - 4))
+                *flags |= USBD_URB_SENDZLP;
+
+        buffer[len++] = crc & 0xff;
+        buffer[len++] = (crc >> 8) & 0xff;
+        buffer[len++] = (crc >> 16) & 0xff;
+        buffer[len++] = (crc >> 24) & 0xff;
+#else
+        if (!(len % in_pkt_sz))
+                *flags |= USBD_URB_SENDZLP;
+#endif
+        return len;
+}
+
+/*! net_fd_decode_inplace - verify a received frame where it landed
+ *
+ * Same CRC rules as net_fd_recv_urb(): a trailing byte after a packetsize
+ * multiple may be pad, and a bad CRC is only fatal once a good one has been
+ * seen. Adds the CRC length to trim when the CRC is being used.
+ *
+ * @return non-zero for a CRC error.
+ */
+STATIC int net_fd_decode_inplace (int *crc_seen, u8 *buffer, int len, int out_pkt_sz, int *trim)
+{
+#if defined( CONFIG_OTG_NETWORK_BLAN_CRC ) || defined( CONFIG_OTG_NETWORK_SAFE_CRC  )
+        u32 crc;
+
+        if (1 == (len % out_pkt_sz)) {
+                crc = crc32_block(buffer, len - 1, CRC32_INIT);
+                if (CRC32_GOOD != crc)
+                        crc = crc32_block(buffer + len - 1, 1, crc);
+        }
+        else
+                crc = crc32_block(buffer, len, CRC32_INIT);
+
+        if (CRC32_GOOD != crc) {
+                TRACE_MSG1(NTT,"C CRC error %08x", crc);
+                return *crc_seen ? -EINVAL : 0;
+        }
+        *crc_seen = 1;
+        *trim += 4;
+#endif
+        return 0;
+}
+#endif /* CONFIG_OTG_NETWORK_ZEROCOPY */
+
 //_________________________________________________________________________________________________
 //                                      net_fd_send_int
 //
@@ -409,6 +516,11 @@ int net_fd_urb_sent_bulk (struct usbd_urb *urb, int urb_rc)
                 buf = urb->function_privdata;
                 TRACE_MSG2(NTT,"urb: %p buf: %p", urb, buf);
                 urb->function_privdata = NULL;
+                #if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+                // zero copy urbs borrow their buffer from the network layer
+                UNLESS (urb->alloc_length)
+                        urb->buffer = NULL;
+                #endif
                 net_os_xmit_done(urb->function_instance, buf, urb_rc);
                 usbd_free_urb (urb);
                 rc = 0;
@@ -418,6 +530,40 @@ int net_fd_urb_sent_bulk (struct usbd_urb *urb, int urb_rc)
         return rc;
 }
 
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+/*! net_fd_start_xmit_inplace - start sending a buffer without copying it
+ *
+ * The urb is allocated without a buffer and pointed at the caller's data,
+ * net_fd_urb_sent_bulk() detaches it again before the urb is freed.
+ *
+ * @return: 0 if all OK, -ENOMEM or rc from usbd_start_in_urb()
+ */
+STATIC int net_fd_start_xmit_inplace (struct usbd_function_instance *function_instance, u8 *buffer, int len, 
+                void *data, int in_pkt_sz)
+{
+        struct usbd_urb *urb;
+        int rc;
+
+        UNLESS ((urb = usbd_alloc_urb (function_instance, BULK_IN, 0, net_fd_urb_sent_bulk))) {
+                TRACE_MSG1(NTT,"urb alloc failed len: %d", len);
+                return -ENOMEM;
+        }
+        urb->buffer = buffer;
+        urb->actual_length = urb->buffer_length = net_fd_encode_inplace(buffer, len, in_pkt_sz, &urb->flags);
+        urb->function_privdata = data;
+
+        TRACE_MSG3(NTT,"sending urb: %p len: %d flags: %x", urb, urb->actual_length, urb->flags);
+        if ((rc = usbd_start_in_urb (urb))) {
+                TRACE_MSG1(NTT,"FAILED: %d", rc);
+                printk(KERN_ERR"%s: FAILED: %d\n", __FUNCTION__, rc);
+                urb->function_privdata = NULL;
+                urb->buffer = NULL;
+                usbd_free_urb (urb);
+        }
+        return rc;
+}
+#endif /* CONFIG_OTG_NETWORK_ZEROCOPY */
+
 /*! net_fd_start_xmit - start sending a buffer
  *
  * Called with net_os_mutex_enter()d.
@@ -474,6 +620,12 @@ int net_fd_start_xmit (struct usbd_function_instance *function_instance, u8 *buf
                 // Since we are now only really using one, just fix it.
                 npd->encapsulation = simple_crc;
         }
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+        // send straight from the network buffer if the OS layer can lend it to us
+        if ((npd->network_type != network_eem) && !NET_FD_FERMAT(npd) && 
+                        (cp = net_os_xmit_inplace(function_instance, data, len, NET_FD_TRAILER)))
+                return net_fd_start_xmit_inplace(function_instance, cp, len, data, in_pkt_sz);
+#endif
         //TRACE_MSG0(NTT,"SIMPLE_CRC");
         // allocate urb 5 bytes larger than required
         if (!(urb = usbd_alloc_urb (function_instance, BULK_IN, len + 5 + 4 + in_pkt_sz, net_fd_urb_sent_bulk ))) {
@@ -823,6 +975,103 @@ STATIC int net_fd_recv_urb_eem(struct usbd_urb *urb, int rc)
         return 0;
 }
 
+#if defined(NET_FD_RX_INPLACE)
+/*! net_fd_recv_start_inplace - attach a network buffer to a receive urb and queue it
+ *
+ * The buffer is sized to the urb alloc_length. If the urb cannot be queued the
+ * buffer is returned to the OS layer and the urb is left without one, so that
+ * it can be freed by the caller (or by the bus core when a callback fails.)
+ *
+ * @return non-zero for failure.
+ */
+STATIC int net_fd_recv_start_inplace(struct usbd_function_instance *function_instance, struct usbd_urb *urb)
+{
+        void *data;
+        int rc;
+
+        urb->buffer = NULL;
+        urb->function_privdata = NULL;
+        RETURN_ENOMEM_UNLESS((data = net_os_alloc_buffer(function_instance, &urb->buffer, urb->alloc_length)));
+        urb->function_privdata = data;
+
+        RETURN_ZERO_UNLESS((rc = usbd_start_out_urb (urb)));
+
+        TRACE_MSG2(NTT,"urb: %p restart failed: %d", urb, rc);
+        urb->buffer = NULL;
+        urb->function_privdata = NULL;
+        net_os_recycle_buffer(function_instance, data);
+        return rc;
+}
+
+/*! net_fd_recv_urb_inplace - callback to process a received zero copy URB
+ *
+ * The data was received directly into the network buffer, verify it in place,
+ * pass it up and requeue the urb with a fresh buffer.
+ *
+ * @return non-zero for failure.
+ */
+STATIC int net_fd_recv_urb_inplace(struct usbd_urb *urb, int rc)
+{
+        struct usbd_function_instance *function_instance = urb->function_instance;
+        struct usb_network_private *npd = function_instance->privdata;
+        void *data = urb->function_privdata;
+        int len = urb->actual_length;
+        int trim;
+        int out_pkt_sz;
+
+        TRACE_MSG2(NTT, "status: %d actual_length: %d", urb->status, urb->actual_length);
+
+        THROW_UNLESS(npd && data, error);
+        THROW_IF(urb->status != USBD_URB_OK, error);
+
+        out_pkt_sz = usbd_endpoint_wMaxPacketSize(function_instance, BULK_OUT, usbd_high_speed(function_instance));
+        npd->encapsulation = simple_crc;
+
+        // the buffer was sized for alloc_length, trim back to what arrived
+        trim = urb->alloc_length - len;
+
+        if (net_fd_decode_inplace(&npd->crc, urb->buffer, len, out_pkt_sz, &trim)) {
+                // count the CRC error, the buffer goes straight back to the pool
+                net_os_recv_buffer(function_instance, data, 1, 0);
+                net_os_recycle_buffer(function_instance, data);
+        }
+        else if (net_os_recv_buffer(function_instance, data, 0, trim)) {
+                TRACE_MSG0(NTT, "FAILED");
+                net_os_dealloc_buffer(function_instance, data);
+        }
+        data = NULL;
+
+        CATCH(error) {
+                if (data)
+                        net_os_recycle_buffer(function_instance, data);
+        }
+        return net_fd_recv_start_inplace(function_instance, urb);
+}
+
+/*! net_fd_start_recv_inplace - start zero copy recv urb(s)
+ */
+STATIC void net_fd_start_recv_inplace(struct usbd_function_instance *function_instance, int network_start_urbs)
+{
+        int hs = usbd_high_speed(function_instance);
+        int size = usbd_endpoint_transferSize(function_instance, BULK_OUT, hs);
+        int out_pkt_sz = usbd_endpoint_wMaxPacketSize(function_instance, BULK_OUT, hs);
+        int i;
+
+        for (i = 0; i < network_start_urbs; i++) {
+                struct usbd_urb *urb;
+                BREAK_IF(!(urb = usbd_alloc_urb(function_instance, BULK_OUT, 0, net_fd_recv_urb_inplace)));
+
+                // overallocate as usbd_alloc_urb() does for receive urbs
+                urb->buffer_length = size;
+                urb->alloc_length = ((size / out_pkt_sz) + 3) * out_pkt_sz;
+
+                TRACE_MSG3(NTT,"i: %d urb: %p alloc: %d", i, urb, urb->alloc_length);
+                if (net_fd_recv_start_inplace(function_instance, urb))
+                        usbd_free_urb(urb);
+        }
+}
+#endif /* NET_FD_RX_INPLACE */
+
 //_________________________________________________________________________________________________
 //                                      net_fd_device_request
 //
@@ -1036,7 +1285,9 @@ STATIC void net_fd_start_recv(struct usbd_function_instance *function_instance)
         if (hs)
                 network_start_urbs = NETWORK_START_URBS * 3;
 
-
+#if defined(NET_FD_RX_INPLACE)
+        net_fd_start_recv_inplace(function_instance, network_start_urbs);
+#else
         for (i = 0; i < network_start_urbs; i++) {
                 struct usbd_urb *urb;
                 BREAK_IF(!(urb = usbd_alloc_urb(function_instance, BULK_OUT, 
@@ -1051,6 +1302,7 @@ STATIC void net_fd_start_recv(struct usbd_function_instance *function_instance)
                         usbd_free_urb(urb);
                 }
         }
+#endif /* NET_FD_RX_INPLACE */
 }
 
 /*! net_fd_start_recv_eem - start recv urb(s)
@@ -1312,6 +1564,84 @@ int net_fd_resumed (struct usbd_function_instance *function_instance)
 
 
 
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+//_________________________________________________________________________________________________
+//                                      loopback benchmark
+
+#define NET_FD_BENCH_PKT 512
+
+/*! net_fd_bench_kbps - throughput between two timestamps in kbit/s
+ */
+static u32 net_fd_bench_kbps(int frames, int len, struct timeval *start, struct timeval *stop)
+{
+        u64 bits = (u64) frames * len * 8 * 1000;
+        u32 us = (stop->tv_sec - start->tv_sec) * 1000000 + stop->tv_usec - start->tv_usec;
+
+        do_div(bits, us ? us : 1);
+        return (u32) bits;
+}
+
+/*! net_fd_loopback_bench - time the frame encode and decode paths
+ *
+ * Loops frames of len bytes through transmit framing and receive checking,
+ * first with the two copies made by net_fd_start_xmit() and net_fd_recv_urb(),
+ * then in place as the zero copy paths do it, and reports both. No bus
+ * interface driver is involved so this isolates the per frame CPU cost.
+ */
+void net_fd_loopback_bench(int frames, int len)
+{
+        struct timeval start, stop;
+        u8 *frame, *urb_buf, *rx_buf;
+        int size = len + NET_FD_TRAILER;
+        int crc_seen = 1;
+        int errors = 0;
+        int i, n, trim;
+        u32 flags, crc, copy_kbps;
+
+        RETURN_UNLESS((frames > 0) && (len > 0) && network_crc32_table);
+        UNLESS ((frame = ckmalloc(3 * size, GFP_KERNEL))) {
+                printk(KERN_ERR"%s: no memory for %d byte frames\n", __FUNCTION__, len);
+                return;
+        }
+        urb_buf = frame + size;
+        rx_buf = urb_buf + size;
+        get_random_bytes(frame, len);
+
+        // copy into the urb and out again into the skb
+        do_gettimeofday(&start);
+        for (i = 0; i < frames; i++) {
+#if defined( CONFIG_OTG_NETWORK_BLAN_CRC ) || defined( CONFIG_OTG_NETWORK_SAFE_CRC  )
+                crc = ~crc32_copy(urb_buf, frame, len, CRC32_INIT);
+                n = len;
+                urb_buf[n++] = crc & 0xff;
+                urb_buf[n++] = (crc >> 8) & 0xff;
+                urb_buf[n++] = (crc >> 16) & 0xff;
+                urb_buf[n++] = (crc >> 24) & 0xff;
+                errors += BOOLEAN(CRC32_GOOD != crc32_copy(rx_buf, urb_buf, n, CRC32_INIT));
+#else
+                memcpy(urb_buf, frame, len);
+                memcpy(rx_buf, urb_buf, len);
+#endif
+        }
+        do_gettimeofday(&stop);
+        copy_kbps = net_fd_bench_kbps(frames, len, &start, &stop);
+
+        // the frame buffer is the urb buffer in both directions
+        do_gettimeofday(&start);
+        for (i = 0; i < frames; i++) {
+                flags = 0;
+                trim = 0;
+                n = net_fd_encode_inplace(frame, len, NET_FD_BENCH_PKT, &flags);
+                errors += BOOLEAN(net_fd_decode_inplace(&crc_seen, frame, n, NET_FD_BENCH_PKT, &trim));
+        }
+        do_gettimeofday(&stop);
+
+        printk(KERN_INFO"%s: %d frames of %d bytes copy: %u kbit/s in place: %u kbit/s errors: %d\n",
+                        __FUNCTION__, frames, len, copy_kbps, net_fd_bench_kbps(frames, len, &start, &stop), errors);
+        lkfree(frame);
+}
+#endif /* CONFIG_OTG_NETWORK_ZEROCOPY */
+
 //______________________________________module_init and module_exit________________________________
 
 /*! macstrtest -
@@ -8,7 +8,7 @@
  *      Stuart Lynne <sl@belcarra.com>
  *      Bruce Balden <balden@belcarra.com>
  *
- * Copyright 2005,2006,2008 Motorola, Inc.
+ * Copyright 2005,2006,2008,2026 Motorola, Inc.
  *
  * Changelog:
  * Date               Author           Comment
@@ -17,6 +17,7 @@
  * 10/18/2006         Motorola         Add Open Src Software language
  * 12/11/2006         Motorola         Changes for Open src compliance.
  * 10/19/2008         Motorola         Add a NULL check before pointer dereference
+ * 10/17/2026         Motorola         Receive skb pool, zero copy transmit, loopback benchmark
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -108,6 +109,10 @@ EMBED_USBD_INFO ("network_fd 2.0-beta");
 
 MOD_PARM_STR (local_dev_addr, "Local Device Address", NULL);
 MOD_PARM_STR (remote_dev_addr, "Remote Device Address", NULL);
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+MOD_PARM_INT (rx_pool, "Receive skbs kept in the recycling pool", CONFIG_OTG_NETWORK_RX_POOL);
+MOD_PARM_INT (loopback_bench, "Frames to run through the loopback benchmark at load", 0);
+#endif /* CONFIG_OTG_NETWORK_ZEROCOPY */
 
 int blan_mod_init(void);
 void blan_mod_exit(void);
@@ -346,6 +351,102 @@ int net_os_xmit_done(struct usbd_function_instance *function_instance, void *dat
         return 0;
 }
 
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+/* Receive skb pool *************************************************************************** */
+
+/*
+ * The receive urbs point straight at skb data, so an skb is needed for every
+ * urb requeued. These come from a pool that is refilled in one batch from
+ * process context when it drops below half, rather than one allocation per
+ * completion. Receive skbs that never reach the network layer (CRC errors,
+ * interface down, bus reset) are recycled into the pool instead of freed.
+ */
+#define NET_RX_HEADROOM (16 + 2)        /* dev_alloc_skb() headroom plus 2 to align ip */
+
+static struct sk_buff_head net_rx_pool;
+static int net_rx_pool_size;            /* data size of pool skbs */
+static WORK_ITEM net_rx_pool_bh;
+
+/*! net_os_rx_pool_alloc - allocate a receive skb with n bytes of data space
+ */
+STATIC struct sk_buff *net_os_rx_pool_alloc(int n, int gfp)
+{
+        struct sk_buff *skb;
+
+        RETURN_NULL_UNLESS ((skb = alloc_skb(n + NET_RX_HEADROOM, gfp)));
+        skb_reserve(skb, NET_RX_HEADROOM);
+        return skb;
+}
+
+/*! net_os_rx_pool_fill - top up the receive pool
+ */
+STATIC void net_os_rx_pool_fill (void *data)
+{
+        struct sk_buff *skb;
+        int n = net_rx_pool_size;
+
+        TRACE_MSG2(NTT, "pool: %d size: %d", skb_queue_len(&net_rx_pool), n);
+        while (n && (skb_queue_len(&net_rx_pool) < MODPARM(rx_pool))) {
+                BREAK_UNLESS ((skb = net_os_rx_pool_alloc(n, GFP_KERNEL)));
+                skb_queue_tail(&net_rx_pool, skb);
+        }
+}
+
+/*! net_os_rx_pool_get - take a receive skb with room for n bytes from the pool
+ *
+ * Falls back to an atomic allocation if the pool is empty.
+ */
+STATIC struct sk_buff *net_os_rx_pool_get(int n)
+{
+        struct sk_buff *skb;
+
+        // discard skbs sized for a smaller transfer (e.g. full speed)
+        while ((skb = skb_dequeue(&net_rx_pool)) && (skb_tailroom(skb) < n)) 
+                dev_kfree_skb_any(skb);
+
+        if (n > net_rx_pool_size)
+                net_rx_pool_size = n;
+
+        if ((skb_queue_len(&net_rx_pool) < (MODPARM(rx_pool) / 2)) && !PENDING_WORK_ITEM(net_rx_pool_bh))
+                SCHEDULE_WORK(net_rx_pool_bh);
+
+        return skb ? skb : net_os_rx_pool_alloc(n, GFP_ATOMIC);
+}
+
+/*! net_os_recycle_buffer - return an unused receive skb to the pool
+ */
+void net_os_recycle_buffer(struct usbd_function_instance *function_instance, void *data)
+{
+        struct sk_buff *skb = data;
+
+        RETURN_UNLESS(skb);
+        if (!skb_cloned(skb) && (atomic_read(&skb->users) == 1) && 
+                        (skb_queue_len(&net_rx_pool) < MODPARM(rx_pool))) 
+        {
+                skb->data = skb->tail = skb->head + NET_RX_HEADROOM;
+                skb->len = 0;
+                skb_queue_tail(&net_rx_pool, skb);
+                return;
+        }
+        dev_kfree_skb_any(skb);
+}
+
+/*! net_os_xmit_inplace - can an skb be sent from its own data
+ *
+ * The skb must be linear and not cloned, a clone shares the data and
+ * tailroom with the original (e.g. the TCP retransmit copy), and must have
+ * room for the trailer that is appended past skb->len.
+ */
+u8 *net_os_xmit_inplace(struct usbd_function_instance *function_instance, void *data, int len, int tailroom)
+{
+        struct sk_buff *skb = (struct sk_buff *) data;
+
+        RETURN_NULL_UNLESS(skb && (skb->len == len));
+        RETURN_NULL_IF(skb_cloned(skb) || skb_is_nonlinear(skb) || (skb_tailroom(skb) < tailroom));
+        return skb->data;
+}
+#endif /* CONFIG_OTG_NETWORK_ZEROCOPY */
+
 /*! net_os_dealloc_buffer
  */
 void net_os_dealloc_buffer(struct usbd_function_instance *function_instance, void *data)
@@ -353,7 +454,11 @@ void net_os_dealloc_buffer(struct usbd_function_instance *function_instance, voi
         struct usb_network_private *npd = (struct usb_network_private *) (function_instance ? function_instance->privdata : NULL);
         struct sk_buff *skb = data;
         RETURN_UNLESS(skb);
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+        net_os_recycle_buffer(function_instance, skb);
+#else
         dev_kfree_skb_any(skb);
+#endif
         RETURN_UNLESS(npd);
         Network_net_device_stats.rx_dropped++;
 }
@@ -365,12 +470,17 @@ void *net_os_alloc_buffer(struct usbd_function_instance *function_instance, u8 *
         struct usb_network_private *npd = (struct usb_network_private *) (function_instance ? function_instance->privdata : NULL);
         struct sk_buff *skb;
 
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+        RETURN_NULL_UNLESS ((skb = net_os_rx_pool_get(n)));
+        TRACE_MSG1(NTT, "skb: %x", skb);
+#else
         /* allocate skb of appropriate length, reserve 2 to align ip
          */
         RETURN_NULL_UNLESS ((skb = dev_alloc_skb(n+2)));
         TRACE_MSG1(NTT, "skb: %x", skb);
 
         skb_reserve(skb, 2);
+#endif
         *cp = skb_put(skb, n);
 
         TRACE_MSG7(NTT, "skb: %x head: %x data: %x tail: %x end: %x len: %d tail-data: %d", 
@@ -1320,6 +1430,13 @@ STATIC int network_modinit (void)
 	THROW_UNLESS ((blan || basic || basic2 || cdc || safe),error);
 
   	THROW_UNLESS (net_fd = BOOLEAN(!net_fd_init("network", MODPARM(local_dev_addr), MODPARM(remote_dev_addr))), error);
+
+        #if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+        skb_queue_head_init(&net_rx_pool);
+        PREPARE_WORK_ITEM(net_rx_pool_bh, net_os_rx_pool_fill, NULL);
+        if (MODPARM(loopback_bench)) 
+                net_fd_loopback_bench(MODPARM(loopback_bench), ETH_FRAME_LEN);
+        #endif /* CONFIG_OTG_NETWORK_ZEROCOPY */
 	
 
         
@@ -1367,6 +1484,14 @@ STATIC void network_modexit (void)
         network_destroy();
         net_fd_exit(); 
 
+        #if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+        while (PENDING_WORK_ITEM(net_rx_pool_bh)) {
+                printk(KERN_ERR"%s: waiting for rx pool bh\n", __FUNCTION__);
+                schedule_timeout(10 * HZ);
+        }
+        skb_queue_purge(&net_rx_pool);
+        #endif /* CONFIG_OTG_NETWORK_ZEROCOPY */
+
         #ifdef CONFIG_PROC_FS
         remove_proc_entry(NET_PROCFS_ENTRY, NULL);
         #endif /* CONFIG_PROC_FS */
@@ -8,7 +8,7 @@
  *      Stuart Lynne <sl@belcarra.com>, 
  *      Bruce Balden <balden@belcarra.com>
  *
- * Copyright 2005-2006 Motorola, Inc.
+ * Copyright 2005-2006, 2026 Motorola, Inc.
  *
  * Changelog:
  * Date               Author           Comment
@@ -16,6 +16,7 @@
  * 06/08/2005         Motorola         Initial distribution 
  * 10/18/2006         Motorola         Add Open Src Software language
  * 12/11/2006         Motorola         Changes for Open src compliance.
+ * 10/17/2026         Motorola         Zero copy buffer hooks
  *
  * This Program is distributed in the hope that it will
  * be useful, but WITHOUT ANY WARRANTY;
@@ -92,6 +93,21 @@ extern int net_os_xmit_done(struct usbd_function_instance *function, void *buff_
 extern void *net_os_alloc_buffer(struct usbd_function_instance *, u8 **cp, int n);
 extern void net_os_dealloc_buffer(struct usbd_function_instance *function_instance, void *data);
 
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+/*
+ * net_os_xmit_inplace - return the data pointer of a buffer passed to
+ *                       net_fd_start_xmit() if it may be sent as is, with
+ *                       tailroom writable bytes after len, or NULL to copy.
+ */
+extern u8 *net_os_xmit_inplace(struct usbd_function_instance *, void *buff_ctx, int len, int tailroom);
+
+/*
+ * net_os_recycle_buffer - give back an unused buffer from net_os_alloc_buffer()
+ *                         without counting it as dropped.
+ */
+extern void net_os_recycle_buffer(struct usbd_function_instance *, void *buff_ctx);
+#endif /* CONFIG_OTG_NETWORK_ZEROCOPY */
+
 /*
  * net_os_recv_buffer - forward a received URB, or clean up after a bad one.
  *      buff_ctx == NULL --> just accumulate stats (count 1 bad buff)
@@ -9,7 +9,7 @@
  *      Stuart Lynne <sl@belcarra.com>
  *      Bruce Balden <balden@belcarra.com>
  *
- * Copyright 2005-2006 Motorola, Inc.
+ * Copyright 2005-2006, 2026 Motorola, Inc.
  *
  * Changelog:
  * Date               Author           Comment
@@ -17,6 +17,7 @@
  * 06/08/2005         Motorola         Initial distribution 
  * 10/18/2006         Motorola         Add Open Src Software language
  * 12/11/2006         Motorola         Changes for Open src compliance.
+ * 10/17/2026         Motorola         Declare loopback benchmark
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -385,6 +386,9 @@ void net_fd_send_int_notification(struct usbd_function_instance *, int connected
 void net_fd_exit(void);
 int net_fd_init(char *info_str, char *, char *);
 int net_fd_urb_sent_bulk (struct usbd_urb *urb, int urb_rc);
+#if defined(CONFIG_OTG_NETWORK_ZEROCOPY)
+void net_fd_loopback_bench(int frames, int len);
+#endif /* CONFIG_OTG_NETWORK_ZEROCOPY */
 
 
 
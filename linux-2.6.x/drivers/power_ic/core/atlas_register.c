@@ -1,6 +1,6 @@
 /*
  * Copyright 2004 Freescale Semiconductor, Inc.
- * Copyright (C) 2005-2006 Motorola, Inc.
+ * Copyright (C) 2005-2006, 2026 Motorola, Inc.
  *
  * The code contained herein is licensed under the GNU General Public
  * License. You may obtain a copy of the GNU General Public License
@@ -9,6 +9,7 @@
  * http://www.opensource.org/licenses/gpl-license.html
  * http://www.gnu.org/copyleft/gpl.html
  *
+ * Motorola 2026-Oct-17 - Add burst access to several registers
  * Motorola 2006-Oct-06 - Update File
  * Motorola 2006-Jun-22 - Move location of atlas_spi_inter.h
  * Motorola 2005-Feb-21 - Redesign of the register functions for Atlas driver. 
@@ -56,3 +57,22 @@ int atlas_reg_write (int reg, unsigned int value)
 {
     return (spi_write_reg (reg, &value));
 }
+
+/*!
+ * @brief Reads and writes several ATLAS registers in SPI bursts
+ *
+ * This function sends one frame per entry, in order, packing as many frames
+ * into each SPI exchange as the FIFO holds.
+ *
+ * @param reg          ATLAS register number of each frame
+ * @param value        Value to write, replaced by the value read
+ * @param write        Non-zero for a write frame, zero for a read frame
+ * @param count        Number of frames
+ *
+ * @return 0 if successful
+ */
+
+int atlas_reg_burst (const int *reg, unsigned int *value, const int *write, int count)
+{
+    return (spi_send_frames_to_spi (reg, value, write, count));
+}
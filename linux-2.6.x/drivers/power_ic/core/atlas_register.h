@@ -1,6 +1,6 @@
 /*
  * Copyright 2004 Freescale Semiconductor, Inc.
- * Copyright (C) 2005-2006 Motorola, Inc.
+ * Copyright (C) 2005-2006, 2026 Motorola, Inc.
  *
  * The code contained herein is licensed under the GNU General Public
  * License. You may obtain a copy of the GNU General Public License
@@ -9,6 +9,7 @@
  * http://www.opensource.org/licenses/gpl-license.html
  * http://www.gnu.org/copyleft/gpl.html
  *
+ * Motorola 2026-Oct-17 - Add burst access to several registers
  * Motorola 2006-Oct-06 - Update File
  * Motorola 2005-Feb-21 - Redesign of the register functions for Atlas driver.
  */
@@ -26,5 +27,6 @@
 
 int atlas_reg_read (int reg, unsigned int *reg_value);
 int atlas_reg_write (int reg, unsigned int reg_value);
+int atlas_reg_burst (const int *reg, unsigned int *reg_value, const int *write, int count);
 
 #endif /* __ATLAS_REGISTER_H__ */
@@ -1,6 +1,6 @@
 /*
  * Copyright 2004 Freescale Semiconductor, Inc.
- * Copyright (C) 2004-2008 Motorola, Inc.
+ * Copyright (C) 2004-2008, 2026 Motorola, Inc.
  *
  * The code contained herein is licensed under the GNU General Public
  * License. You may obtain a copy of the GNU General Public License
@@ -9,6 +9,8 @@
  * http://www.opensource.org/licenses/gpl-license.html
  * http://www.gnu.org/copyleft/gpl.html
  *
+ * Motorola 2026-Oct-17 - Remove /proc/power_ic_events on exit
+ * Motorola 2026-Oct-17 - Initialize the Atlas registers in one register transfer
  * Motorola 2008-Apr-22 - Support shared led region
  * Motorola 2008-Feb-13 - Add support for Nevis.
  * Motorola 2008-Jan-29 - Add support for xPixl.
@@ -705,6 +707,8 @@ static int power_ic_free(struct inode *inode, struct file *file)
 static void __init initialize_atlas_registers (void)
 {
     const unsigned int (* init_tbl_ptr)[NUM_INIT_REGS][NUM_INIT_TABLE_COLUMNS] = NULL;
+    static POWER_IC_XFER_T __initdata xfer[NUM_INIT_REGS];
+    int count = 0;
     int i;
 
     /* Use correct register settings per product and per boardrev. */
@@ -778,19 +782,44 @@ static void __init initialize_atlas_registers (void)
             /* Remember the initial register values. */
             reg_init_tbl[(*init_tbl_ptr)[i][0]] = (*init_tbl_ptr)[i][1];
 
+            xfer[count].reg = (*init_tbl_ptr)[i][0];
+            xfer[count].value = (*init_tbl_ptr)[i][1];
+
             /* Don't set PCEN or PCCOUNTEN. */
             if ((*init_tbl_ptr)[i][0] == POWER_IC_REG_ATLAS_PWR_CONTROL_0)
             {
-                power_ic_set_reg_mask((*init_tbl_ptr)[i][0], PC0_POWERCUT_MASK, (*init_tbl_ptr)[i][1]);
+                xfer[count].op = POWER_IC_XFER_SET_MASK;
+                xfer[count].mask = PC0_POWERCUT_MASK;
             }
             else if ((*init_tbl_ptr)[i][0] == POWER_IC_REG_ATLAS_CHARGER_0)
             {
-                power_ic_set_reg_mask((*init_tbl_ptr)[i][0], CHRGR0_POWER_PATH_MASK, (*init_tbl_ptr)[i][1]);
+                xfer[count].op = POWER_IC_XFER_SET_MASK;
+                xfer[count].mask = CHRGR0_POWER_PATH_MASK;
             }
             else
             {
-                power_ic_write_reg_value ((*init_tbl_ptr)[i][0], (*init_tbl_ptr)[i][1]);
+                xfer[count].op = POWER_IC_XFER_WRITE;
             }
+            count++;
+        }
+    }
+
+    /* Send the whole table in SPI bursts rather than one frame per register. */
+    if (power_ic_transfer(xfer, count) == 0)
+    {
+        return;
+    }
+
+    /*
+     * It is not known which frames of a failed burst reached the power IC, and one
+     * bad entry fails the whole batch.  Write every register again on its own so
+     * that one failure does not keep the others from being initialized.
+     */
+    for (i = 0; i < count; i++)
+    {
+        if (power_ic_transfer(&xfer[i], 1) != 0)
+        {
+            printk("POWER_IC: Atlas register %d initialization failed\n", xfer[i].reg);
         }
     }
 }
@@ -840,6 +869,9 @@ int __init power_ic_init(void)
 
     spi_init();
     
+    /* Initialize the register access statistics */
+    power_ic_external_init();
+
     /* Initialize the ATLAS driver */
     initialize_atlas_registers();
 
@@ -907,6 +939,9 @@ static void __exit power_ic_exit(void)
 {
     unregister_chrdev(POWER_IC_MAJOR_NUM, POWER_IC_DEV_NAME);
 
+    power_ic_external_exit();
+    power_ic_event_exit();
+
     driver_unregister((struct device_driver *)&power_ic_pm_sr);
     platform_device_unregister((struct platform_device *)&power_ic_pm_sr);
 
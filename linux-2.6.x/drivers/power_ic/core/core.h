@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2007 Motorola, Inc.
+ * Copyright (C) 2007, 2026 Motorola, Inc.
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License version 2 as
@@ -15,6 +15,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
  * 02111-1307, USA
  *
+ * Motorola 2026-Oct-17 - Register access statistics
  * Motorola 2007-Aug-10 - NAND secure boot time improvement 
  * Motorola 2007-Jun-22 - Initial creation.
  */
@@ -78,4 +79,8 @@ extern int power_ic_set_reg_mask_sec(POWER_IC_REGISTER_T reg,
                                      int value,
                                      POWER_IC_BACKUP_MEMORY_ACCESS_T permission);
 
+extern void power_ic_external_init(void);
+
+extern void power_ic_external_exit(void);
+
 #endif /* __CORE_H__ */
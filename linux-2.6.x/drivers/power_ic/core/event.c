@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2004, 2006 - 2007 Motorola, Inc.
+ * Copyright (C) 2004, 2006 - 2007, 2026 Motorola, Inc.
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License version 2 as
@@ -14,6 +14,7 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA
  *
+ * Motorola 2026-Oct-17 - Burst interrupt demux, callback table and event latency
  * Motorola 2007-Mar-14 - Do not clear interrupt status bits if they are masked.
  * Motorola 2007-Jan-25 - Add support for power management
  * Motorola 2007-Jan-08 - Updated copyright
@@ -81,17 +82,22 @@
  *
  */
 
-#include <linux/list.h>
 #include <linux/power_ic.h>
 #include <linux/power_ic_kernel.h>
 #include <linux/bitops.h>
-#include <linux/slab.h>
+#include <linux/delay.h>
 #include <linux/errno.h>
 #include <linux/interrupt.h>
 #include <linux/module.h>
+#include <linux/proc_fs.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/time.h>
 
+#include <asm/div64.h>
 #include <asm/io.h>
 #include <asm/irq.h>
+#include <asm/system.h>
 #include <linux/mpm.h>
 
 #include "event.h"
@@ -115,23 +121,59 @@ EXPORT_SYMBOL(power_ic_event_sense_read);
 ******************************************************************************/
 
 /*!
- * @brief Define a type for implementing a list of callback functions.
+ * @brief Per event dispatch statistics, reported in /proc/power_ic_events.
  */
 typedef struct
 {
-    struct list_head list; /*!< the list head for the list of callbacks */
-    POWER_IC_EVENT_CALLBACK_T callback; /*!< the callback function pointer */
-} POWER_IC_EVENT_CALLBACK_LIST_T;
+    unsigned long count;          /*!< number of times the event was dispatched */
+    unsigned long max_latency_us; /*!< longest time from interrupt to callbacks */
+    unsigned long long latency_us; /*!< total time from interrupt to callbacks */
+    unsigned long long handler_us; /*!< total time spent in the callbacks */
+} POWER_IC_EVENT_STATS_T;
 
 /******************************************************************************
 * Local constants
 ******************************************************************************/
 
+/*!
+ * @brief Number of callbacks that can be subscribed to one event.
+ *
+ * The most any in-tree driver needs is three, debounce.c on MC2BI.  USBI has
+ * two.  The rest leave room for modules loaded later.
+ */
+#define POWER_IC_EVENT_MAX_CALLBACKS 8
+
+/*! @brief Time to wait before the interrupt registers are tried again after an SPI failure */
+#define POWER_IC_EVENT_RETRY_MS 10
+
+/*! @brief Returns the bit of an event in its interrupt status register */
+#define POWER_IC_EVENT_BIT(event, first) (1 << ((event) - (first)))
+
+/*! @brief Latency-sensitive events of Interrupt Status 0: touchscreen and charger detect */
+#define POWER_IC_EVENT_FAST_MASK_0 \
+    (POWER_IC_EVENT_BIT(POWER_IC_EVENT_ATLAS_TSI, POWER_IC_EVENT_ATLAS_FIRST_REG) | \
+     POWER_IC_EVENT_BIT(POWER_IC_EVENT_ATLAS_CHGDETI, POWER_IC_EVENT_ATLAS_FIRST_REG))
+
+/*! @brief Latency-sensitive events of Interrupt Status 1: headset and headset key */
+#define POWER_IC_EVENT_FAST_MASK_1 \
+    (POWER_IC_EVENT_BIT(POWER_IC_EVENT_ATLAS_MC2BI, POWER_IC_EVENT_ATLAS_SECOND_REG) | \
+     POWER_IC_EVENT_BIT(POWER_IC_EVENT_ATLAS_HSDETI, POWER_IC_EVENT_ATLAS_SECOND_REG) | \
+     POWER_IC_EVENT_BIT(POWER_IC_EVENT_ATLAS_HSLI, POWER_IC_EVENT_ATLAS_SECOND_REG))
+
 /******************************************************************************
 * Local variables
 ******************************************************************************/
-/*! Define the event lists */
-struct list_head power_ic_events[POWER_IC_EVENT_NUM_EVENTS];
+/*! Table of callbacks per event, the most recently subscribed one last */
+static POWER_IC_EVENT_CALLBACK_T power_ic_events[POWER_IC_EVENT_NUM_EVENTS][POWER_IC_EVENT_MAX_CALLBACKS];
+
+/*! Number of callbacks in each row of #power_ic_events */
+static int power_ic_event_num_callbacks[POWER_IC_EVENT_NUM_EVENTS];
+
+/*!
+ * Protects #power_ic_events and #power_ic_event_num_callbacks.  Interrupts are
+ * disabled while it is held, so a subscription can be changed from any context.
+ */
+static DEFINE_SPINLOCK(power_ic_events_lock);
 
 /* Declare a wait queue used to signal arriving interrupts to the interrupt handler thread */
 static DECLARE_WAIT_QUEUE_HEAD(interrupt_thread_wait);
@@ -139,6 +181,22 @@ static DECLARE_WAIT_QUEUE_HEAD(interrupt_thread_wait);
 /*! Flag to indicate pending interrupt conditions */ 
 static int interrupt_flag;
 
+/*! Monotonic time of the first interrupt the thread has not yet seen */
+static struct timespec interrupt_stamp;
+
+/*! Dispatch statistics of each event */
+static POWER_IC_EVENT_STATS_T power_ic_event_stats[POWER_IC_EVENT_NUM_EVENTS];
+
+/*! Number of power IC interrupts */
+static unsigned long power_ic_event_irqs;
+
+/*! Number of times the thread was woken by an interrupt */
+static unsigned long power_ic_event_wakeups;
+
+/*! Total and longest time from interrupt to thread wakeup */
+static unsigned long long power_ic_event_wake_us;
+static unsigned long power_ic_event_max_wake_us;
+
 /******************************************************************************
 * Global variables
 ******************************************************************************/
@@ -152,44 +210,102 @@ int power_ic_pm_suspend_mask_tbl[POWER_IC_PM__NUM] =
 /******************************************************************************
 * Local function prototypes
 ******************************************************************************/
-static void power_ic_bh_handler(unsigned long unused);
+static void power_ic_bh_handler(struct timespec *irq_stamp);
 
 /******************************************************************************
 * Local functions
 ******************************************************************************/
+/*!
+ * @brief Returns the microseconds from start to end, both on the monotonic clock
+ */
+static inline unsigned long elapsed_us(struct timespec *start, struct timespec *end)
+{
+    return ((end->tv_sec - start->tv_sec) * USEC_PER_SEC) +
+           (end->tv_nsec - start->tv_nsec) / NSEC_PER_USEC;
+}
+
 /*!
  * @brief Executes the registered callback functions for a given event
  *
- * Iterates over the list of registered callback functions (saved in
- * #power_ic_events[]) and calls each of the callback functions.  The
+ * Calls the callback functions registered for the event (saved in
+ * #power_ic_events[]), the most recently subscribed one first.  The
  * return value from the callback indicates if the event was handled
  * by the callback and if additional callbacks should be called.  That
  * is, if a callback function returns a non-zero value, the event is
  * considered handled and no other callbacks are called for the event.
  *
- * The list of callbacks is implemented using the Linux standard
- * doubly-linked list implementation.
+ * The callbacks are run from a copy of the table row, so that they may
+ * subscribe or unsubscribe themselves.
  *
- * @param       event    the event that occurred
+ * @param       event      the event that occurred
+ * @param       irq_stamp  time of the interrupt that reported the event
  *
  * @return      nothing
  */
 
-static void execute_handlers (POWER_IC_EVENT_T event)
+static void execute_handlers (POWER_IC_EVENT_T event, struct timespec *irq_stamp)
 {
-    struct list_head *p;
-    POWER_IC_EVENT_CALLBACK_LIST_T *t;
-
-    list_for_each (p, &(power_ic_events[event]))
+    POWER_IC_EVENT_CALLBACK_T callbacks[POWER_IC_EVENT_MAX_CALLBACKS];
+    POWER_IC_EVENT_STATS_T *stats = &power_ic_event_stats[event];
+    struct timespec start;
+    struct timespec end;
+    unsigned long latency;
+    unsigned long flags;
+    int n;
+
+    spin_lock_irqsave(&power_ic_events_lock, flags);
+    n = power_ic_event_num_callbacks[event];
+    memcpy(callbacks, power_ic_events[event], n * sizeof(callbacks[0]));
+    spin_unlock_irqrestore(&power_ic_events_lock, flags);
+
+    do_posix_clock_monotonic_gettime(&start);
+    latency = elapsed_us(irq_stamp, &start);
+
+    stats->count++;
+    stats->latency_us += latency;
+    if (latency > stats->max_latency_us)
     {
-        t = list_entry (p, POWER_IC_EVENT_CALLBACK_LIST_T, list);
+        stats->max_latency_us = latency;
+    }
 
+    while (n-- > 0)
+    {
         /* If the callback returns a non-zero value, it handled the event */
-        if (t->callback(event) != 0)
+        if (callbacks[n](event) != 0)
         {
             break;
         }
     }
+
+    do_posix_clock_monotonic_gettime(&end);
+    stats->handler_us += elapsed_us(&start, &end);
+}
+
+/*!
+ * @brief Executes the callbacks of each event set in an interrupt status bank
+ *
+ * @param       ints       the interrupt status bits to dispatch
+ * @param       first      the event of bit 0 of the bank
+ * @param       irq_stamp  time of the interrupt that reported the events
+ *
+ * @return      nothing
+ */
+
+static void dispatch_events (unsigned int ints, POWER_IC_EVENT_T first, struct timespec *irq_stamp)
+{
+    int int_vec;
+
+    while (ints != 0)
+    {
+        /* Find the interrupt number of the highest priority interrupt */
+        int_vec = ffs(ints) - 1;
+
+        /* Run the handlers for the event */
+        execute_handlers(first + int_vec, irq_stamp);
+
+        /* Clear the bit for the interrupt we just serviced */
+        ints &= ~(1 << int_vec);
+    }
 }
 
 /*!
@@ -218,6 +334,10 @@ static int interrupt_thread_loop (void *unused)
      * Loop unless an abort siganl is received.  All signals, but the abort signals are
      * masked off in the common setup.  As a result only abort signals can be pending.
      */
+    struct timespec irq_stamp;
+    struct timespec now;
+    unsigned long wake;
+
     while(!signal_pending(current))
     {
         /* Sleep if an interrupt isn't pending again */
@@ -226,11 +346,23 @@ static int interrupt_thread_loop (void *unused)
             break;
         }
 
-        /* Reset the interrupt flag */
+        /* Reset the interrupt flag and take the stamp the interrupt handler left */
+        local_irq_disable();
         interrupt_flag = 0;
+        irq_stamp = interrupt_stamp;
+        local_irq_enable();
+
+        do_posix_clock_monotonic_gettime(&now);
+        wake = elapsed_us(&irq_stamp, &now);
+        power_ic_event_wakeups++;
+        power_ic_event_wake_us += wake;
+        if (wake > power_ic_event_max_wake_us)
+        {
+            power_ic_event_max_wake_us = wake;
+        }
 
         /* Handle the interrupt */
-        power_ic_bh_handler(0);
+        power_ic_bh_handler(&irq_stamp);
     }
 
     return 0;
@@ -243,89 +375,196 @@ static int interrupt_thread_loop (void *unused)
  *
  * For interrupt handling, the function loops as long as the power IC continues to
  * assert its interrupt line to the processor.  In each iteration of the loop,
- * the interrupt status and interrupt mask registers are read from the ic to determine
- * the set of outstanding interrupts.  These interrupts are then "dispatched" to
- * the registered callback functions.  All of the pending interrupts are then
- * cleared and masked.
+ * both interrupt status registers are read from the ic in one burst.  The
+ * interrupt mask registers are then read for the banks with status bits set
+ * only, to determine the set of outstanding interrupts.  The pending interrupts
+ * are cleared and masked, again touching only the banks that have any, and
+ * "dispatched" to the registered callback functions.  The latency-sensitive
+ * events of both banks are dispatched before the rest.
+ *
+ * If the registers cannot be accessed, the pass is retried after a short delay
+ * for as long as the interrupt line stays asserted, so that the interrupt is
+ * not lost.
  *
  * @note This function normally runs in bottom-half context, meaning that interrupts
  * are enabled, but user processes are being preempted.  This needs to execute quickly
  * to allow control to return back to user-space as soon as possible, but it is not
  * absolutely time critical.
  *
- * @param unused An unused parameter
+ * @param irq_stamp Time of the interrupt that woke the thread
  *
  * @return nothing
  */
 
-static void power_ic_bh_handler(unsigned long unused)
+static void power_ic_bh_handler(struct timespec *irq_stamp)
 {
+    POWER_IC_XFER_T xfer[4];
     unsigned int isr0;
-    POWER_IC_UNUSED unsigned int isr1;
+    unsigned int isr1;
     unsigned int imr0;
-    POWER_IC_UNUSED unsigned int imr1;
+    unsigned int imr1;
     unsigned int enabled_ints0;
-    POWER_IC_UNUSED unsigned int enabled_ints1;
-    unsigned int int_vec;
+    unsigned int enabled_ints1;
+    int n;
 
     /* Loop while power IC continues to assert its interrupt line */
     while (power_ic_gpio_event_read_priint(PM_INT))
     {
-        /* Read the interrupt status and mask registers */
-        power_ic_read_reg (POWER_IC_REG_ATLAS_INT_STAT_0, &isr0);
-        power_ic_read_reg (POWER_IC_REG_ATLAS_INT_MASK_0, &imr0);
-        /* Clear the interrupt status bits of the unmasked interrupts only */
-        power_ic_write_reg_value (POWER_IC_REG_ATLAS_INT_STAT_0, (isr0 & ~imr0));
-        
-        /* Mask all interrupts that we are about to service */
-        power_ic_write_reg_value (POWER_IC_REG_ATLAS_INT_MASK_0, imr0 | isr0);
-
-        
-        /* Read the interrupt status and mask registers */
-        power_ic_read_reg (POWER_IC_REG_ATLAS_INT_STAT_1, &isr1);
-        power_ic_read_reg (POWER_IC_REG_ATLAS_INT_MASK_1, &imr1);
-        
-        /* Clear the interrupt status bits of the unmasked interrupts only */
-        power_ic_write_reg_value (POWER_IC_REG_ATLAS_INT_STAT_1, (isr1 & ~imr1));
-        
-        /* Mask all interrupts that we are about to service */
-        power_ic_write_reg_value (POWER_IC_REG_ATLAS_INT_MASK_1, imr1 | isr1);
-
-        
+        /* Read the interrupt status registers of both banks in one burst */
+        xfer[0].op = POWER_IC_XFER_READ;
+        xfer[0].reg = POWER_IC_REG_ATLAS_INT_STAT_0;
+        xfer[1].op = POWER_IC_XFER_READ;
+        xfer[1].reg = POWER_IC_REG_ATLAS_INT_STAT_1;
+
+        if (power_ic_transfer(xfer, 2) != 0)
+        {
+            tracemsg(_k_d("Event thread - unable to read the interrupt status, retrying."));
+            msleep(POWER_IC_EVENT_RETRY_MS);
+            continue;
+        }
+
+        isr0 = xfer[0].value;
+        isr1 = xfer[1].value;
+
+        /* Read the interrupt mask registers of the flagged banks only */
+        n = 0;
+        if (isr0 != 0)
+        {
+            xfer[n].op = POWER_IC_XFER_READ;
+            xfer[n++].reg = POWER_IC_REG_ATLAS_INT_MASK_0;
+        }
+        if (isr1 != 0)
+        {
+            xfer[n].op = POWER_IC_XFER_READ;
+            xfer[n++].reg = POWER_IC_REG_ATLAS_INT_MASK_1;
+        }
+
+        if ((n != 0) && (power_ic_transfer(xfer, n) != 0))
+        {
+            tracemsg(_k_d("Event thread - unable to read the interrupt masks, retrying."));
+            msleep(POWER_IC_EVENT_RETRY_MS);
+            continue;
+        }
+
+        imr0 = (isr0 != 0) ? xfer[0].value : 0;
+        imr1 = (isr1 != 0) ? xfer[n - 1].value : 0;
+
         /* Get the set of enabled interrupt bits */
         enabled_ints0 = isr0 & ~imr0;
         enabled_ints1 = isr1 & ~imr1;
 
+        /*
+         * Clear the interrupt status bits of the unmasked interrupts only and mask
+         * all interrupts that we are about to service.  A bank with nothing to
+         * service is left alone.
+         */
+        n = 0;
+        if (enabled_ints0 != 0)
+        {
+            xfer[n].op = POWER_IC_XFER_WRITE;
+            xfer[n].reg = POWER_IC_REG_ATLAS_INT_STAT_0;
+            xfer[n++].value = enabled_ints0;
+            xfer[n].op = POWER_IC_XFER_WRITE;
+            xfer[n].reg = POWER_IC_REG_ATLAS_INT_MASK_0;
+            xfer[n++].value = imr0 | enabled_ints0;
+        }
+        if (enabled_ints1 != 0)
+        {
+            xfer[n].op = POWER_IC_XFER_WRITE;
+            xfer[n].reg = POWER_IC_REG_ATLAS_INT_STAT_1;
+            xfer[n++].value = enabled_ints1;
+            xfer[n].op = POWER_IC_XFER_WRITE;
+            xfer[n].reg = POWER_IC_REG_ATLAS_INT_MASK_1;
+            xfer[n++].value = imr1 | enabled_ints1;
+        }
+
+        if ((n != 0) && (power_ic_transfer(xfer, n) != 0))
+        {
+            tracemsg(_k_d("Event thread - unable to clear the interrupts, retrying."));
+            msleep(POWER_IC_EVENT_RETRY_MS);
+            continue;
+        }
+
         /* Enable the pm suspend bit for the interrupt received */
         power_ic_pm_suspend_mask_tbl[POWER_IC_PM_INTERRUPT_1] |=
             (enabled_ints1 & (POWER_IC_ONOFF_MASK | POWER_IC_MB2_MASK | POWER_IC_HSDET_MASK));
-            
-        /* Loop to handle the interrupts */
-        while (enabled_ints0 != 0)
-        {
-            /* Find the interrupt number of the highest priority interrupt */
-            int_vec = ffs(enabled_ints0) - 1;
 
-            /* Run the handlers for the event */
-            execute_handlers(int_vec + POWER_IC_EVENT_ATLAS_FIRST_REG);
+        /* Handle the latency-sensitive events of both banks first */
+        dispatch_events(enabled_ints0 & POWER_IC_EVENT_FAST_MASK_0,
+                        POWER_IC_EVENT_ATLAS_FIRST_REG, irq_stamp);
+        dispatch_events(enabled_ints1 & POWER_IC_EVENT_FAST_MASK_1,
+                        POWER_IC_EVENT_ATLAS_SECOND_REG, irq_stamp);
+
+        /* Then the rest of Register 0 and Register 1 */
+        dispatch_events(enabled_ints0 & ~POWER_IC_EVENT_FAST_MASK_0,
+                        POWER_IC_EVENT_ATLAS_FIRST_REG, irq_stamp);
+        dispatch_events(enabled_ints1 & ~POWER_IC_EVENT_FAST_MASK_1,
+                        POWER_IC_EVENT_ATLAS_SECOND_REG, irq_stamp);
+    }
 
-            /* Clear the bit for the interrupt we just serviced */
-            enabled_ints0 &= ~(1 << int_vec);
-        }
-        /* Loop to handle the interrupts for Register 1 */
-        while (enabled_ints1 != 0)
+}
+
+/*!
+ * @brief Reports the interrupt and per-event latency statistics
+ *
+ * Latencies are measured from the power IC interrupt to the start of the
+ * callbacks of the event.  Events dispatched ahead of the others are marked
+ * with a '*'.
+ */
+static int power_ic_event_read_proc(char *page, char **start, off_t off, int count,
+                                    int *eof, void *data)
+{
+    POWER_IC_EVENT_STATS_T *stats;
+    unsigned long long avg_latency;
+    unsigned long long avg_handler;
+    unsigned long long avg_wake = power_ic_event_wake_us;
+    unsigned int fast;
+    int len;
+    int i;
+
+    if (power_ic_event_wakeups != 0)
+    {
+        do_div(avg_wake, power_ic_event_wakeups);
+    }
+
+    len = sprintf(page,
+                  "interrupts:     %lu\n"
+                  "wakeups:        %lu\n"
+                  "wake us avg:    %lu\n"
+                  "wake us max:    %lu\n"
+                  "event   count  lat_avg  lat_max  handler_avg\n",
+                  power_ic_event_irqs, power_ic_event_wakeups,
+                  (unsigned long)avg_wake, power_ic_event_max_wake_us);
+
+    for (i = 0; i < POWER_IC_EVENT_NUM_EVENTS; i++)
+    {
+        stats = &power_ic_event_stats[i];
+        if (stats->count == 0)
         {
-            /* Find the interrupt number of the highest priority interrupt */
-            int_vec = ffs(enabled_ints1) - 1;
+            continue;
+        }
 
-            /* Run the handlers for the event for Interrupt Status Register 1 */
-            execute_handlers(int_vec + POWER_IC_EVENT_ATLAS_SECOND_REG);
+        avg_latency = stats->latency_us;
+        do_div(avg_latency, stats->count);
+        avg_handler = stats->handler_us;
+        do_div(avg_handler, stats->count);
 
-            /* Clear the bit for the interrupt we just serviced */
-            enabled_ints1 &= ~(1 << int_vec);
+        if (i >= POWER_IC_EVENT_ATLAS_SECOND_REG)
+        {
+            fast = POWER_IC_EVENT_FAST_MASK_1 & (1 << (i - POWER_IC_EVENT_ATLAS_SECOND_REG));
+        }
+        else
+        {
+            fast = POWER_IC_EVENT_FAST_MASK_0 & (1 << (i - POWER_IC_EVENT_ATLAS_FIRST_REG));
         }
+
+        len += sprintf(page + len, "%3d%c %8lu %8lu %8lu %12lu\n",
+                       i, fast ? '*' : ' ', stats->count, (unsigned long)avg_latency,
+                       stats->max_latency_us, (unsigned long)avg_handler);
     }
 
+    *eof = 1;
+    return len;
 }
 
 /******************************************************************************
@@ -355,6 +594,14 @@ irqreturn_t power_ic_irq_handler (int irq, void *dev_id, struct pt_regs *regs)
 {
     /* Inform power management about interrupt of interest */
     mpm_handle_ioi();
+
+    /* Latencies are measured from the first interrupt the thread has not yet seen */
+    if (!interrupt_flag)
+    {
+        do_posix_clock_monotonic_gettime(&interrupt_stamp);
+    }
+    power_ic_event_irqs++;
+
     /* Set the interrupt flag to prevent the thread from sleeping */
     interrupt_flag = 1;
 
@@ -368,7 +615,7 @@ irqreturn_t power_ic_irq_handler (int irq, void *dev_id, struct pt_regs *regs)
  * @brief Initializes the power IC event handling
  *
  * This function initializes the power IC event handling.  This includes:
- *     - Initializing the doubly-linked lists in the #power_ic_events array
+ *     - Creating /proc/power_ic_events
  *     - Configuring the GPIO interrupt lines
  *     - Registering the GPIO interrupt handlers
  *
@@ -380,12 +627,9 @@ irqreturn_t power_ic_irq_handler (int irq, void *dev_id, struct pt_regs *regs)
  */
 void power_ic_event_initialize (void)
 {
-    int i;
-    
-    /* Initialize the lists for power IC events */
-    for (i = 0; i < POWER_IC_EVENT_NUM_EVENTS; i++)
+    if (create_proc_read_entry("power_ic_events", S_IRUGO, NULL, power_ic_event_read_proc, NULL) == NULL)
     {
-        INIT_LIST_HEAD(&(power_ic_events[i]));
+        tracemsg(_k_d(KERN_ERR "Unable to create power_ic_events proc entry in /proc.\n"));
     }
 
     /* Start our kernel thread */
@@ -395,24 +639,32 @@ void power_ic_event_initialize (void)
     power_ic_gpio_config_event_int();
 }
 
+/*!
+ * @brief Removes /proc/power_ic_events
+ */
+void power_ic_event_exit (void)
+{
+    remove_proc_entry("power_ic_events", NULL);
+}
+
 /*!
  * @brief Registers a callback function to be called when an event occurs
  *
  * This function is used to subscribe to an event.  The callback function is
- * stored in a dynamically-allocated structure and then added to a doubly-linked
- * list implemented using the standard Linux doubly-linked list implementation.
- * Multiple callbacks may be added for each event.  Duplicated callback function
- * checking is not implemented.
+ * stored in the table of callbacks for the event, which holds up to
+ * #POWER_IC_EVENT_MAX_CALLBACKS entries.  The most recently subscribed callback
+ * is called first.  Duplicated callback function checking is not implemented.
  *
  * @param        event     the event type
  * @param        callback  the function to call when event occurrs
  *
- * @return 0 when successful or -ENOMEM if memory allocation failed
+ * @return 0 when successful or -ENOMEM if the event has no free callback entry
  */
 
 int power_ic_event_subscribe (POWER_IC_EVENT_T event, POWER_IC_EVENT_CALLBACK_T callback)
 {
-    POWER_IC_EVENT_CALLBACK_LIST_T *temp;
+    unsigned long flags;
+    int retval = 0;
 
     /* Verify that the event number is not out of range */
     if (event >= POWER_IC_EVENT_NUM_EVENTS)
@@ -420,31 +672,35 @@ int power_ic_event_subscribe (POWER_IC_EVENT_T event, POWER_IC_EVENT_CALLBACK_T
         return -EINVAL;
     }
 
-    /* Create a new linked list entry */
-    temp = kmalloc(sizeof(POWER_IC_EVENT_CALLBACK_LIST_T), GFP_KERNEL);
-    if (temp == NULL)
+    spin_lock_irqsave(&power_ic_events_lock, flags);
+
+    /* Add the callback to the table for the requested event */
+    if (power_ic_event_num_callbacks[event] < POWER_IC_EVENT_MAX_CALLBACKS)
+    {
+        power_ic_events[event][power_ic_event_num_callbacks[event]++] = callback;
+    }
+    else
     {
-        return -ENOMEM;
+        retval = -ENOMEM;
     }
 
-    /* Initialize the fields of the list */
-    temp->callback = callback;
-    INIT_LIST_HEAD(&temp->list);
+    spin_unlock_irqrestore(&power_ic_events_lock, flags);
 
-    /* Add the entry to the list for the requested event */
-    list_add (&temp->list, &(power_ic_events[event]));
+    if (retval != 0)
+    {
+        printk("POWER_IC: no free callback entry for event %d\n", event);
+    }
 
-    return 0;
+    return retval;
 }
 
 /*!
  * @brief Unregisters a callback function for a given event
  *
- * The function iterates over the list of callback functions registered for the
- * given event.  If one is found matching the provided callback function pointer,
- * the callback is removed from the list.  If the callback function is included
- * in the list more than once, all instances are removed.  Memory allocated for
- * the list entry is also freed when the entry is removed.
+ * The function iterates over the callback functions registered for the given
+ * event.  If one is found matching the provided callback function pointer,
+ * the callback is removed from the table.  If the callback function is included
+ * in the table more than once, all instances are removed.
  *
  * @param        event     the event type
  * @param        callback  the callback function to unregister
@@ -454,9 +710,9 @@ int power_ic_event_subscribe (POWER_IC_EVENT_T event, POWER_IC_EVENT_CALLBACK_T
 
 int power_ic_event_unsubscribe (POWER_IC_EVENT_T event, POWER_IC_EVENT_CALLBACK_T callback)
 {
-    struct list_head *p;
-    struct list_head *n;
-    POWER_IC_EVENT_CALLBACK_LIST_T *t;
+    unsigned long flags;
+    int i;
+    int n = 0;
 
     /* Verify that the event number is not out of range */
     if (event >= POWER_IC_EVENT_NUM_EVENTS)
@@ -464,17 +720,19 @@ int power_ic_event_unsubscribe (POWER_IC_EVENT_T event, POWER_IC_EVENT_CALLBACK_
         return -EINVAL;
     }
 
-    /* Find the entry in the list */
-    list_for_each_safe (p, n, &(power_ic_events[event]))
+    spin_lock_irqsave(&power_ic_events_lock, flags);
+
+    /* Remove the matching entries, keeping the order of the others */
+    for (i = 0; i < power_ic_event_num_callbacks[event]; i++)
     {
-        t = list_entry (p, POWER_IC_EVENT_CALLBACK_LIST_T, list);
-        if (t->callback == callback)
+        if (power_ic_events[event][i] != callback)
         {
-            /* Remove the entry from the list and free the memory */
-            list_del(p);
-            kfree(t);
+            power_ic_events[event][n++] = power_ic_events[event][i];
         }
     }
+    power_ic_event_num_callbacks[event] = n;
+
+    spin_unlock_irqrestore(&power_ic_events_lock, flags);
 
     return 0;
 }
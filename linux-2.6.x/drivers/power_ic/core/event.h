@@ -1,6 +1,6 @@
 /*
  * Copyright 2004 Freescale Semiconductor, Inc.
- * Copyright (C) 2004-2008 Motorola, Inc.
+ * Copyright (C) 2004-2008, 2026 Motorola, Inc.
  *
  * The code contained herein is licensed under the GNU General Public
  * License. You may obtain a copy of the GNU General Public License
@@ -9,6 +9,7 @@
  * http://www.opensource.org/licenses/gpl-license.html
  * http://www.gnu.org/copyleft/gpl.html
  *
+ * Motorola 2026-Oct-17 - Add power_ic_event_exit
  * Motorola 2008-Nov-17 - Add new sleep mask for lighting
  * Motorola 2007-Jun-21 - Adding new sleep mask
  * Motorola 2007-Jan-25 - Add support for power management
@@ -58,4 +59,5 @@ extern int power_ic_pm_suspend_mask_tbl[];
 #define POWER_IC_LIGHTS_SLEEP            0x00000008
 
 void power_ic_event_initialize (void);
+void power_ic_event_exit (void);
 #endif /* __EVENT_H__ */
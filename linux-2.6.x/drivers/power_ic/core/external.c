@@ -1,6 +1,6 @@
 /*
  * Copyright 2004 Freescale Semiconductor, Inc.
- * Copyright (C) 2004-2008 Motorola, Inc.
+ * Copyright (C) 2004-2008, 2026 Motorola, Inc.
  * 
  * The code contained herein is licensed under the GNU General Public
  * License. You may obtain a copy of the GNU General Public License
@@ -9,6 +9,7 @@
  * http://www.opensource.org/licenses/gpl-license.html
  * http://www.gnu.org/copyleft/gpl.html
  *
+ * Motorola 2026-Oct-17 - Batched register transfers and shadow register cache
  * Motorola 2008-May-15 - Do not store AHSREN and AHLREN in RAM
  * Motorola 2007-Jun-20 - Do not write when read for Power Gate SPI Enable bits.
  * Motorola 2007-Jun-19 - NAND secure boot time improvement 
@@ -45,13 +46,26 @@
  * using the RAM copy, but the RAM copy will be updated with whatever is read.
  * The write functions use the RAM copy to get the value of the bits in the
  * register that are not being explicitly changed.
+ *
+ * Registers with no autonomous bits are also kept as a write-through shadow.
+ * Once such a register has been read or written, read-modify-write operations
+ * on it use the shadow and skip the SPI read.
+ *
+ * power_ic_transfer() runs a batch of reads, writes and read-modify-writes under
+ * a single hold of the access mutex and sends the frames in SPI bursts.  The
+ * frame and mutex statistics are reported in /proc/power_ic_spi.
  */
 
 #include <linux/power_ic.h>
 #include <linux/power_ic_kernel.h>
 #include <linux/module.h>
 #include <linux/sched.h>
+#include <linux/init.h>
+#include <linux/bitops.h>
+#include <linux/proc_fs.h>
+#include <linux/time.h>
 #include <asm/semaphore.h>
+#include <asm/arch/mc13783_spi_inter.h>
 
 #include "atlas_register.h"
 #include "core.h"
@@ -66,6 +80,7 @@ EXPORT_SYMBOL(power_ic_set_reg_bit);
 EXPORT_SYMBOL(power_ic_set_reg_value);
 EXPORT_SYMBOL(power_ic_get_reg_value);
 EXPORT_SYMBOL(power_ic_set_reg_mask);
+EXPORT_SYMBOL(power_ic_transfer);
 #endif
 
 /******************************************************************************
@@ -91,6 +106,40 @@ EXPORT_SYMBOL(power_ic_set_reg_mask);
 #define POWER_IC_REG_NUM_REGS POWER_IC_REG_NUM_REGS_ATLAS
 #define POWER_GATE_INVERT     0x18000
 
+/*! @brief Value of power_ic_register_init_only[] for a register with no init-only bits */
+#define ALL_BITS_WRITABLE     0x0FFFFFF
+
+/*! @brief Number of frames queued by power_ic_transfer() before they are sent */
+#define XFER_QUEUE_SIZE       SPI_MC13783_BURST_FRAMES
+
+/******************************************************************************
+* Local Structures
+******************************************************************************/
+
+/*! @brief Frames waiting to be sent by power_ic_transfer() */
+typedef struct
+{
+    int reg[XFER_QUEUE_SIZE];             /* Atlas register number */
+    int write[XFER_QUEUE_SIZE];           /* Non-zero for a write frame */
+    unsigned int value[XFER_QUEUE_SIZE];  /* Frame value, then the value read */
+    unsigned int sent[XFER_QUEUE_SIZE];   /* Value written by a write frame */
+    POWER_IC_XFER_T *xfer[XFER_QUEUE_SIZE]; /* Where a read is returned, or NULL */
+    int count;
+} XFER_QUEUE_T;
+
+/*! @brief SPI and access mutex statistics reported in /proc/power_ic_spi */
+typedef struct
+{
+    unsigned long frames;                 /* SPI frames sent */
+    unsigned long bursts;                 /* SPI exchanges */
+    unsigned long shadow_hits;            /* SPI reads saved by the shadow */
+    unsigned long locks;                  /* Times the access mutex was taken */
+    unsigned long long wait_us;           /* Time spent waiting for the mutex */
+    unsigned long long held_us;           /* Time the mutex was held */
+    unsigned long last_frames;            /* frames at the previous report */
+    unsigned long last_jiffies;           /* jiffies at the previous report */
+} POWER_IC_SPI_STATS_T;
+
 /******************************************************************************
 * Local Variables
 ******************************************************************************/
@@ -98,6 +147,15 @@ EXPORT_SYMBOL(power_ic_set_reg_mask);
 /*! @brief Mutex needed to protect accesses to the power IC's. */
 static DECLARE_MUTEX(power_ic_access_mutex);
 
+/*! @brief Time at which power_ic_access_mutex was last taken */
+static struct timespec power_ic_access_taken;
+
+/*! @brief Registers whose RAM copy holds the whole hardware value */
+static DECLARE_BITMAP(power_ic_shadow_valid, POWER_IC_REG_NUM_REGS);
+
+/*! @brief SPI and access mutex statistics */
+static POWER_IC_SPI_STATS_T power_ic_spi_stats;
+
 /*! @brief RAM copies of all power IC registers */
 static unsigned int power_ic_registers[POWER_IC_REG_NUM_REGS] =
 {
@@ -402,6 +460,154 @@ static const unsigned char read_before_write[POWER_IC_REG_NUM_REGS] =
 * Local Functions
 ******************************************************************************/
 
+/*!
+ * @brief Returns the microseconds from start to end, both on the monotonic clock
+ */
+static inline unsigned long elapsed_us(struct timespec *start, struct timespec *end)
+{
+    return ((end->tv_sec - start->tv_sec) * USEC_PER_SEC) +
+           (end->tv_nsec - start->tv_nsec) / NSEC_PER_USEC;
+}
+
+/*!
+ * @brief Take power_ic_access_mutex, accounting for the time spent waiting
+ *
+ * @return 0 if successful, -EINTR if a signal was received while waiting
+ */
+static int power_ic_lock(void)
+{
+    struct timespec start;
+
+    do_posix_clock_monotonic_gettime(&start);
+    if(down_interruptible(&power_ic_access_mutex) != 0)
+    {
+        tracemsg(_k_d("process received signal while waiting for postponable mutex. Exiting."));
+        return -EINTR;
+    }
+
+    do_posix_clock_monotonic_gettime(&power_ic_access_taken);
+    power_ic_spi_stats.wait_us += elapsed_us(&start, &power_ic_access_taken);
+    power_ic_spi_stats.locks++;
+
+    return 0;
+}
+
+/*!
+ * @brief Release power_ic_access_mutex, accounting for the time it was held
+ */
+static void power_ic_unlock(void)
+{
+    struct timespec now;
+
+    do_posix_clock_monotonic_gettime(&now);
+    power_ic_spi_stats.held_us += elapsed_us(&power_ic_access_taken, &now);
+
+    up(&power_ic_access_mutex);
+}
+
+/*!
+ * @brief Returns 1 if the RAM copy of a register can stand in for a read of it
+ *
+ * Only registers without autonomous bits and without init-only bits qualify.
+ * The semaphore register is excluded as it exists to be changed by others.
+ */
+static inline int shadow_cacheable(POWER_IC_REGISTER_T reg)
+{
+    return ((power_ic_register_no_write_masks[reg] == 0) &&
+            (power_ic_register_init_only[reg] == ALL_BITS_WRITABLE) &&
+            (reg != POWER_IC_REG_ATLAS_SEMAPHORE));
+}
+
+/*!
+ * @brief Returns 1 if a read-modify-write of the register must read the hardware first
+ */
+static int rmw_needs_read(POWER_IC_REGISTER_T reg)
+{
+    if (!(read_before_write[reg] & READ_BEFORE_WRITE) ||
+        (power_ic_register_init_only[reg] != ALL_BITS_WRITABLE))
+    {
+        return 0;
+    }
+
+    if (shadow_cacheable(reg) && test_bit(reg, power_ic_shadow_valid))
+    {
+        power_ic_spi_stats.shadow_hits++;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*!
+ * @brief Replaces the bits that must not change from init with their init values
+ */
+static inline unsigned int apply_init_only(POWER_IC_REGISTER_T reg, unsigned int value)
+{
+    if (power_ic_register_init_only[reg] != ALL_BITS_WRITABLE)
+    {
+        value &= power_ic_register_init_only[reg];
+        value |= (reg_init_tbl[reg] & ~(power_ic_register_init_only[reg]));
+    }
+
+    return value;
+}
+
+/*!
+ * @brief Updates the RAM copy of a register with a value read from the hardware
+ */
+static void ram_copy_read(POWER_IC_REGISTER_T reg, unsigned int value)
+{
+    if (shadow_cacheable(reg))
+    {
+        power_ic_registers[reg] = value & ALL_BITS_WRITABLE;
+        set_bit(reg, power_ic_shadow_valid);
+        return;
+    }
+
+    value &= ~power_ic_register_no_write_masks[reg];
+    power_ic_registers[reg] |= value & ~power_ic_register_init_only[reg];
+}
+
+/*!
+ * @brief Updates the RAM copy of a register with a value written to the hardware
+ */
+static void ram_copy_write(POWER_IC_REGISTER_T reg, unsigned int value)
+{
+    power_ic_registers[reg] = value & ~power_ic_register_no_write_masks[reg];
+
+    if (shadow_cacheable(reg))
+    {
+        set_bit(reg, power_ic_shadow_valid);
+    }
+}
+
+/*!
+ * @brief Writes an entire register to the hardware and its RAM copy
+ *
+ * The caller must hold power_ic_access_mutex.
+ */
+static int write_reg(POWER_IC_REGISTER_T reg, unsigned int value)
+{
+    int retval;
+
+    power_ic_spi_stats.frames++;
+    power_ic_spi_stats.bursts++;
+    retval = atlas_reg_write (reg - POWER_IC_REG_ATLAS_FIRST_REG, value);
+
+    /* If the write was successful, save the new register contents */
+    if (retval == 0)
+    {
+        ram_copy_write(reg, value);
+    }
+    else
+    {
+        /* The register may or may not have been written */
+        clear_bit(reg, power_ic_shadow_valid);
+    }
+
+    return retval;
+}
+
 /*!
  * @brief Read an entire register from the power IC
  *
@@ -436,6 +642,8 @@ static int read_reg(POWER_IC_REGISTER_T reg, unsigned int *reg_value)
     else
     {
         /* Read the register from ATLAS */
+        power_ic_spi_stats.frames++;
+        power_ic_spi_stats.bursts++;
         retval = atlas_reg_read (reg - POWER_IC_REG_ATLAS_FIRST_REG, &value);
     }
 
@@ -447,8 +655,7 @@ static int read_reg(POWER_IC_REGISTER_T reg, unsigned int *reg_value)
             *reg_value = value;
         }
         
-        value &= ~power_ic_register_no_write_masks[reg];
-        power_ic_registers[reg] |= value & ~power_ic_register_init_only[reg];
+        ram_copy_read(reg, value);
     }
     
     return retval;
@@ -474,15 +681,14 @@ int power_ic_read_reg(POWER_IC_REGISTER_T reg, unsigned int *reg_value)
 {
     int ret_val = 0;
     
-    if(down_interruptible(&power_ic_access_mutex) != 0)
+    if(power_ic_lock() != 0)
     {
-        tracemsg(_k_d("process received signal while waiting for postponable mutex. Exiting."));
         return -EINTR;
     }
 
     ret_val = read_reg(reg, reg_value);
     
-    up(&power_ic_access_mutex);
+    power_ic_unlock();
 
     return ret_val;
 }
@@ -513,7 +719,7 @@ int power_ic_write_reg_sec(POWER_IC_REGISTER_T reg,
     {
         regv = *reg_value;
 
-        if(down_interruptible(&power_ic_access_mutex) == 0)
+        if(power_ic_lock() == 0)
         {
             /* Check if we have permission to access backup memory. */
             if ((permission == BACKUP_MEMORY_ACCESS_NOT_ALLOWED) &&
@@ -526,27 +732,16 @@ int power_ic_write_reg_sec(POWER_IC_REGISTER_T reg,
                 /* For bits that must not be changed from init, set the init values before
                  * writing.
                  */
-                if (power_ic_register_init_only[reg] != 0x0FFFFFF)
-                {
-                    regv &= power_ic_register_init_only[reg];
-                    regv |= (reg_init_tbl[reg] & ~(power_ic_register_init_only[reg]));
-                }
+                regv = apply_init_only(reg, regv);
 
                 /* Write the register to ATLAS if it is an ATLAS register */
-                retval = atlas_reg_write (reg - POWER_IC_REG_ATLAS_FIRST_REG, regv);
-
-                /* If the write was successful, save the new register contents */
-                if (retval == 0)
-                {
-                    power_ic_registers[reg] = regv & ~power_ic_register_no_write_masks[reg];
-                }
+                retval = write_reg(reg, regv);
             }
 
-            up(&power_ic_access_mutex);
+            power_ic_unlock();
         }
         else
         {
-            tracemsg(_k_d("process received signal while waiting for postponable mutex. Exiting."));
             retval = -EINTR;
         }
     }
@@ -691,9 +886,8 @@ int power_ic_set_reg_mask_sec(POWER_IC_REGISTER_T reg,
         return -EINVAL;
     }
     
-    if(down_interruptible(&power_ic_access_mutex) != 0)
+    if(power_ic_lock() != 0)
     {
-        tracemsg(_k_d("process received signal while waiting for postponable mutex. Exiting."));
         return -EINTR;
     }
 
@@ -706,8 +900,7 @@ int power_ic_set_reg_mask_sec(POWER_IC_REGISTER_T reg,
     else
     {
         /* If the register needs to be read before written, read it now */
-        if ((read_before_write[reg] & READ_BEFORE_WRITE) &&
-            (power_ic_register_init_only[reg] == 0x0FFFFFF))
+        if (rmw_needs_read(reg))
         {
             /*
             * Read the register, but discard the value.  We're only interested in
@@ -729,22 +922,12 @@ int power_ic_set_reg_mask_sec(POWER_IC_REGISTER_T reg,
         old_value |= value & mask;
 
         /* For bits that must not be changed from init, set the init values before writing. */
-        if (power_ic_register_init_only[reg] != 0x0FFFFFF)
-        {
-            old_value &= power_ic_register_init_only[reg];
-            old_value |= (reg_init_tbl[reg] & ~(power_ic_register_init_only[reg]));
-        }
+        old_value = apply_init_only(reg, old_value);
         
-        retval = atlas_reg_write (reg - POWER_IC_REG_ATLAS_FIRST_REG, old_value);
-    
-        /* If the write was successful, save the new register contents */
-        if (retval == 0)
-        {
-            power_ic_registers[reg] = old_value & ~power_ic_register_no_write_masks[reg];
-        }
+        retval = write_reg(reg, old_value);
     }
     
-    up(&power_ic_access_mutex);
+    power_ic_unlock();
 
     return retval;
 }
@@ -791,3 +974,297 @@ int power_ic_set_reg_mask(POWER_IC_REGISTER_T reg, int mask, int value)
 {
     return power_ic_set_reg_mask_sec(reg, mask, value, BACKUP_MEMORY_ACCESS_NOT_ALLOWED);
 }
+
+/*!
+ * @brief Sends the frames queued by power_ic_transfer()
+ *
+ * The frames go out in order in one SPI burst.  Once they are sent, the RAM
+ * copies are updated in the same order and the values read are returned to
+ * the caller.  If the burst fails the shadow is dropped, since it is not
+ * known which of the frames reached the power IC.
+ *
+ * @param        queue      queued frames
+ *
+ * @return 0 if successful
+ */
+static int xfer_flush(XFER_QUEUE_T *queue)
+{
+    int retval;
+    int i;
+
+    if (queue->count == 0)
+    {
+        return 0;
+    }
+
+    power_ic_spi_stats.frames += queue->count;
+    power_ic_spi_stats.bursts++;
+    retval = atlas_reg_burst(queue->reg, queue->value, queue->write, queue->count);
+
+    if (retval != 0)
+    {
+        bitmap_zero(power_ic_shadow_valid, POWER_IC_REG_NUM_REGS);
+    }
+    else
+    {
+        for (i = 0; i < queue->count; i++)
+        {
+            if (queue->write[i])
+            {
+                ram_copy_write(queue->reg[i] + POWER_IC_REG_ATLAS_FIRST_REG, queue->sent[i]);
+            }
+            else
+            {
+                ram_copy_read(queue->reg[i] + POWER_IC_REG_ATLAS_FIRST_REG, queue->value[i]);
+
+                if (queue->xfer[i] != NULL)
+                {
+                    queue->xfer[i]->value = queue->value[i];
+                }
+            }
+        }
+    }
+
+    queue->count = 0;
+
+    return retval;
+}
+
+/*!
+ * @brief Adds a frame to the power_ic_transfer() queue, sending the queue first if full
+ *
+ * @param        queue      queued frames
+ * @param        reg        register number
+ * @param        write      non-zero for a write frame
+ * @param        value      value to write
+ * @param        xfer       where to return the value read, or NULL
+ *
+ * @return the queue index of the frame, or a negative error code
+ */
+static int xfer_queue(XFER_QUEUE_T *queue, POWER_IC_REGISTER_T reg, int write,
+                      unsigned int value, POWER_IC_XFER_T *xfer)
+{
+    int retval;
+    int i;
+
+    if (queue->count == XFER_QUEUE_SIZE)
+    {
+        retval = xfer_flush(queue);
+        if (retval != 0)
+        {
+            return retval;
+        }
+    }
+
+    i = queue->count++;
+    queue->reg[i] = reg - POWER_IC_REG_ATLAS_FIRST_REG;
+    queue->write[i] = write;
+    queue->value[i] = write ? value : 0;
+    queue->sent[i] = value;
+    queue->xfer[i] = xfer;
+
+    return i;
+}
+
+/*!
+ * @brief Gets the starting value for a queued read-modify-write
+ *
+ * A write to the register that is still queued is the newest value.  Otherwise
+ * the RAM copy is used unless the register has to be read first, in which case
+ * the read is queued and everything queued so far is sent.
+ *
+ * @param        queue      queued frames
+ * @param        reg        register number
+ * @param        old_value  location to store the starting value
+ *
+ * @return 0 if successful
+ */
+static int xfer_old_value(XFER_QUEUE_T *queue, POWER_IC_REGISTER_T reg, unsigned int *old_value)
+{
+    int atlas_reg = reg - POWER_IC_REG_ATLAS_FIRST_REG;
+    int pending = -1;
+    int retval;
+    int i;
+
+    for (i = queue->count - 1; i >= 0; i--)
+    {
+        if ((queue->reg[i] == atlas_reg) && queue->write[i])
+        {
+            pending = i;
+            break;
+        }
+    }
+
+    if ((pending >= 0) && shadow_cacheable(reg))
+    {
+        power_ic_spi_stats.shadow_hits++;
+        *old_value = queue->sent[pending];
+        return 0;
+    }
+
+    if (!rmw_needs_read(reg))
+    {
+        *old_value = (pending >= 0) ? queue->sent[pending] : power_ic_registers[reg];
+        return 0;
+    }
+
+    i = xfer_queue(queue, reg, 0, 0, NULL);
+    if (i < 0)
+    {
+        return i;
+    }
+
+    retval = xfer_flush(queue);
+    if (retval == 0)
+    {
+        *old_value = queue->value[i];
+    }
+
+    return retval;
+}
+
+/*!
+ * @brief Performs a batch of register operations
+ *
+ * This function performs the operations in the order given while holding the
+ * access mutex once.  Frames are collected and sent in SPI bursts; a burst is
+ * only cut short when a read-modify-write needs the current contents of a
+ * register that is not in the shadow.  The results of POWER_IC_XFER_READ
+ * operations are returned in their value field.
+ *
+ * Backup memory registers may be read but not written through this interface.
+ *
+ * @param        xfer       array of operations
+ * @param        count      number of operations
+ *
+ * @return 0 if successful
+ */
+int power_ic_transfer(POWER_IC_XFER_T *xfer, int count)
+{
+    XFER_QUEUE_T queue;
+    unsigned int new_value;
+    int retval = 0;
+    int i;
+
+    if ((xfer == NULL) || (count < 0))
+    {
+        return -EINVAL;
+    }
+
+    /* Check the whole batch before anything is sent */
+    for (i = 0; i < count; i++)
+    {
+        if (!POWER_IC_REGISTER_IS_ATLAS(xfer[i].reg) ||
+            ((xfer[i].op != POWER_IC_XFER_READ) &&
+             (xfer[i].op != POWER_IC_XFER_WRITE) &&
+             (xfer[i].op != POWER_IC_XFER_SET_MASK)))
+        {
+            printk("POWER_IC: invalid transfer %d: reg=%d, op=%d\n", i, xfer[i].reg, xfer[i].op);
+            return -EINVAL;
+        }
+
+        if ((xfer[i].op != POWER_IC_XFER_READ) &&
+            ((xfer[i].reg == POWER_IC_REG_ATLAS_MEMORY_A) || (xfer[i].reg == POWER_IC_REG_ATLAS_MEMORY_B)))
+        {
+            return -EPERM;
+        }
+    }
+
+    if(power_ic_lock() != 0)
+    {
+        return -EINTR;
+    }
+
+    queue.count = 0;
+
+    for (i = 0; (i < count) && (retval >= 0); i++)
+    {
+        switch (xfer[i].op)
+        {
+            case POWER_IC_XFER_READ:
+                retval = xfer_queue(&queue, xfer[i].reg, 0, 0, &xfer[i]);
+                break;
+
+            case POWER_IC_XFER_WRITE:
+                new_value = apply_init_only(xfer[i].reg, xfer[i].value);
+                retval = xfer_queue(&queue, xfer[i].reg, 1, new_value, NULL);
+                break;
+
+            case POWER_IC_XFER_SET_MASK:
+                retval = xfer_old_value(&queue, xfer[i].reg, &new_value);
+                if (retval == 0)
+                {
+                    new_value &= ~xfer[i].mask;
+                    new_value |= xfer[i].value & xfer[i].mask;
+                    new_value = apply_init_only(xfer[i].reg, new_value);
+                    retval = xfer_queue(&queue, xfer[i].reg, 1, new_value, NULL);
+                }
+                break;
+        }
+    }
+
+    if (retval >= 0)
+    {
+        retval = xfer_flush(&queue);
+    }
+
+    power_ic_unlock();
+
+    return retval;
+}
+
+/*!
+ * @brief Reports the SPI and access mutex statistics
+ *
+ * The frame rate is measured since the previous read of the file.
+ */
+static int power_ic_spi_read_proc(char *page, char **start, off_t off, int count,
+                                  int *eof, void *data)
+{
+    POWER_IC_SPI_STATS_T *stats = &power_ic_spi_stats;
+    unsigned long now = jiffies;
+    unsigned long rate = 0;
+    int len;
+
+    if (now != stats->last_jiffies)
+    {
+        rate = ((stats->frames - stats->last_frames) * HZ) / (now - stats->last_jiffies);
+    }
+    stats->last_frames = stats->frames;
+    stats->last_jiffies = now;
+
+    len = sprintf(page,
+                  "frames:        %lu\n"
+                  "bursts:        %lu\n"
+                  "frames/s:      %lu\n"
+                  "shadow hits:   %lu\n"
+                  "mutex taken:   %lu\n"
+                  "mutex wait us: %llu\n"
+                  "mutex held us: %llu\n",
+                  stats->frames, stats->bursts, rate, stats->shadow_hits,
+                  stats->locks, stats->wait_us, stats->held_us);
+
+    *eof = 1;
+    return len;
+}
+
+/*!
+ * @brief Initializes the register access statistics and creates /proc/power_ic_spi
+ */
+void __init power_ic_external_init(void)
+{
+    power_ic_spi_stats.last_jiffies = jiffies;
+
+    if (create_proc_read_entry("power_ic_spi", S_IRUGO, NULL, power_ic_spi_read_proc, NULL) == NULL)
+    {
+        tracemsg(_k_d(KERN_ERR "Unable to create power_ic_spi proc entry in /proc.\n"));
+    }
+}
+
+/*!
+ * @brief Removes /proc/power_ic_spi
+ */
+void power_ic_external_exit(void)
+{
+    remove_proc_entry("power_ic_spi", NULL);
+}
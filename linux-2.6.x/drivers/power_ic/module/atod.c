@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2004-2008 Motorola, Inc.
+ * Copyright (C) 2004-2008, 2026 Motorola, Inc.
  *
  * This program is free software; you can redistribute it and/or modify
  *  it under the terms of the GNU General Public License version 2 as
@@ -15,6 +15,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
  * 02111-1307, USA
  *
+ * Motorola 2026-Oct-17 - Fetch conversion results in one register transfer
  * Motorola 2008-Feb-20 - Support A2D measurements on charger current
  * Motorola 2007-Aug-08 - Fix AtoD sample indexing
  * Motorola 2007-Jul-05 - Eliminate competition on ATOD converter
@@ -1016,43 +1017,47 @@ static int set_up_hardware_exclusive_conversion(POWER_IC_ATOD_REQUEST_T * reques
  */
 static int get_results(int * results)
 {
-    int setup;
-    int mask = ADA1_MASK | ADA2_MASK;
+    POWER_IC_XFER_T xfer[SAMPLES_PER_BANK + 1];
     int error;
-    int i, j;
-    int result;
+    int i, j, n;
     
-    /* To save time and SPI traffic, fetch the results two at a time. */
-    for (i = 0; i < SAMPLES_PER_BANK; i+=2)
+    /* To save time and SPI traffic, fetch the results two at a time, and queue all
+     * of the selects and reads as one transfer. */
+    for (i = 0, n = 0; i < SAMPLES_PER_BANK; i+=2)
     {
         j = i+1;
         
-        setup = (i << ADA1_SHIFT) | (j  << ADA2_SHIFT);
- 
-        error = power_ic_set_reg_mask(POWER_IC_REG_ATLAS_ADC_1, mask, setup);
+        xfer[n].op = POWER_IC_XFER_SET_MASK;
+        xfer[n].reg = POWER_IC_REG_ATLAS_ADC_1;
+        xfer[n].mask = ADA1_MASK | ADA2_MASK;
+        xfer[n].value = (i << ADA1_SHIFT) | (j  << ADA2_SHIFT);
+        n++;
 
-        if(error != 0)
-        {
-            printk(("POWER IC:   error %d while selecting result."), error);
-            return error;
-        }
-        
         /* Get the results. This retrieves two channels at once. */
-        error = power_ic_read_reg(GET_RESULTS_ADC, &result);
-        
-        if(error != 0)
-        {
-            printk(("POWER IC:   error %d while fetching result %d."), error, i);
-            return error;
-        }
+        xfer[n].op = POWER_IC_XFER_READ;
+        xfer[n].reg = GET_RESULTS_ADC;
+        n++;
+    }
+
+    error = power_ic_transfer(xfer, n);
+
+    if(error != 0)
+    {
+        printk(("POWER IC:   error %d while fetching results."), error);
+        return error;
+    }
+
+    for (i = 0, n = 1; i < SAMPLES_PER_BANK; i+=2, n+=2)
+    {
+        j = i+1;
 
-        results[i] = (result & ADD1_MASK) >> ADD1_SHIFT;
+        results[i] = (xfer[n].value & ADD1_MASK) >> ADD1_SHIFT;
 
         /* For SCM-A11, there are two results, and the SAMPLES_PER_BANK is increased by 1,
            so the value of three still applies. */
         if(j < SAMPLES_PER_BANK)
         {
-            results[j] = (result & ADD2_MASK) >> ADD2_SHIFT;
+            results[j] = (xfer[n].value & ADD2_MASK) >> ADD2_SHIFT;
         }
     }
     
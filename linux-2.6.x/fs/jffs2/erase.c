@@ -2,6 +2,7 @@
  * JFFS2 -- Journalling Flash File System, Version 2.
  *
  * Copyright (C) 2001-2003 Red Hat, Inc.
+ * Copyright (C) 2026 Motorola, Inc.
  *
  * Created by David Woodhouse <dwmw2@infradead.org>
  *
@@ -11,6 +12,11 @@
  *
  */
 
+/* Date         Author          Comment
+ * ===========  ==============  ==============================================
+ * 17-Oct-2026  Motorola        Use mtd->erase_async when the device has it.
+ */
+
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/mtd/mtd.h>
@@ -74,6 +80,12 @@ static void jffs2_erase_block(struct jffs2_sb_info *c,
 	((struct erase_priv_struct *)instr->priv)->jeb = jeb;
 	((struct erase_priv_struct *)instr->priv)->c = c;
 
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+	/* The callback below already copes with deferred completion */
+	if (c->mtd->erase_async)
+		ret = c->mtd->erase_async(c->mtd, instr);
+	else
+#endif
 	ret = c->mtd->erase(c->mtd, instr);
 	if (!ret)
 		return;
@@ -1,7 +1,7 @@
 /*
  * JFFS2 -- Journalling Flash File System, Version 2.
  *
- * Copyright (C) 2007 Motorola Inc.
+ * Copyright (C) 2007, 2026 Motorola Inc.
  * Copyright (C) 2001-2003 Red Hat, Inc.
  *
  * Created by David Woodhouse <dwmw2@infradead.org>
@@ -15,6 +15,7 @@
 /* ChangeLog:
  * (mm-dd-yyyy)  Author    Comment
  * 08-08-2007    Motorola  Fix a bug in jffs2 to prevent a kernel panic.
+ * 10-17-2026    Motorola  Drain queued erases before freeing the blocks.
  */
 
 
@@ -283,6 +284,12 @@ static void jffs2_put_super (struct super_block *sb)
 
 	D2(printk(KERN_DEBUG "jffs2: jffs2_put_super()\n"));
 
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+	/* Queued erases complete into c->blocks, so let them finish first.
+	   The GC thread is already stopped and cannot queue any more. */
+	if (c->mtd->sync)
+		c->mtd->sync(c->mtd);
+#endif
 	down(&c->alloc_sem);
 	jffs2_flush_wbuf_pad(c);
 	up(&c->alloc_sem);
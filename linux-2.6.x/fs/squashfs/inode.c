@@ -3,6 +3,7 @@
  *
  * Copyright (c) 2002, 2003, 2004, 2005, 2006
  * Phillip Lougher <phillip@lougher.org.uk>
+ * Copyright (C) 2026 Motorola Inc.
  *
  * This program is free software; you can redistribute it and/or
  * modify it under the terms of the GNU General Public License
@@ -21,6 +22,12 @@
  * inode.c
  */
 
+/* ChangeLog:
+ * (mm-dd-yyyy) Author    Comment
+ * 10-17-2026   Motorola  zlib stream pool, LRU block and fragment caches,
+ *                        decompress data blocks into the page cache
+ */
+
 #include <linux/types.h>
 #include <linux/squashfs_fs.h>
 #include <linux/module.h>
@@ -39,6 +46,10 @@
 #include <linux/wait.h>
 #include <linux/blkdev.h>
 #include <linux/vmalloc.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+#include <linux/proc_fs.h>
+#include <linux/spinlock.h>
 #include <asm/uaccess.h>
 #include <asm/semaphore.h>
 
@@ -48,6 +59,8 @@ static void squashfs_put_super(struct super_block *);
 static int squashfs_statfs(struct super_block *, struct kstatfs *);
 static int squashfs_symlink_readpage(struct file *file, struct page *page);
 static int squashfs_readpage(struct file *file, struct page *page);
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+				struct list_head *pages, unsigned nr_pages);
 static int squashfs_readpage4K(struct file *file, struct page *page);
 static int squashfs_readdir(struct file *, void *, filldir_t);
 static struct inode *squashfs_alloc_inode(struct super_block *sb);
@@ -63,7 +76,8 @@ static long long read_blocklist(struct inode *inode, int index,
 static struct super_block *squashfs_get_sb(struct file_system_type *, int,
 				const char *, void *);
 
-//static z_stream stream;
+static LIST_HEAD(squashfs_mounts);
+static spinlock_t squashfs_mounts_lock = SPIN_LOCK_UNLOCKED;
 
 static struct file_system_type squashfs_fs_type = {
 	.owner = THIS_MODULE,
@@ -89,7 +103,8 @@ SQSH_EXTERN struct address_space_operations squashfs_symlink_aops = {
 };
 
 SQSH_EXTERN struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readpages = squashfs_readpages
 };
 
 SQSH_EXTERN struct address_space_operations squashfs_aops_4K = {
@@ -173,7 +188,46 @@ out:
 }
 
 
-SQSH_EXTERN unsigned int squashfs_read_data(struct super_block *s, char *buffer,
+static struct squashfs_stream *squashfs_get_stream(struct squashfs_sb_info
+					*msblk)
+{
+	struct squashfs_stream *stream;
+	int waited = 0;
+
+	if (down_trylock(&msblk->stream_sem)) {
+		down(&msblk->stream_sem);
+		waited = 1;
+	}
+
+	spin_lock(&msblk->stream_lock);
+	stream = list_entry(msblk->free_streams.next, struct squashfs_stream,
+					list);
+	list_del(&stream->list);
+	msblk->stream_waits += waited;
+	spin_unlock(&msblk->stream_lock);
+
+	return stream;
+}
+
+
+static void squashfs_put_stream(struct squashfs_sb_info *msblk,
+					struct squashfs_stream *stream)
+{
+	spin_lock(&msblk->stream_lock);
+	list_add(&stream->list, &msblk->free_streams);
+	spin_unlock(&msblk->stream_lock);
+	up(&msblk->stream_sem);
+}
+
+
+/*
+ * Read the block at index into buffers[0..pages - 1], each of which holds
+ * page_size bytes.  Compressed blocks are inflated straight out of the
+ * buffer heads with a stream taken from the pool, so readers of different
+ * blocks only wait for each other when every stream is busy.
+ */
+static unsigned int squashfs_read_data_pages(struct super_block *s,
+			char **buffers, int pages, int page_size,
 			long long index, unsigned int length,
 			long long *next_index)
 {
@@ -182,15 +236,16 @@ SQSH_EXTERN unsigned int squashfs_read_data(struct super_block *s, char *buffer,
 			msblk->devblksize_log2) + 2];
 	unsigned int offset = index & ((1 << msblk->devblksize_log2) - 1);
 	unsigned int cur_index = index >> msblk->devblksize_log2;
-	int bytes, avail_bytes, b = 0, k;
-	char *c_buffer;
+	int bytes, avail_bytes, b = 0, k = 0, page = 0;
 	unsigned int compressed;
 	unsigned int c_byte = length;
+	struct squashfs_stream *stream = NULL;
+	z_stream *z;
+	int zlib_err = Z_OK;
 
 	if (c_byte) {
 		bytes = msblk->devblksize - offset;
 		compressed = SQUASHFS_COMPRESSED_BLOCK(c_byte);
-		c_buffer = compressed ? msblk->read_data : buffer;
 		c_byte = SQUASHFS_COMPRESSED_SIZE_BLOCK(c_byte);
 
 		TRACE("Block @ 0x%llx, %scompressed size %d\n", index, compressed
@@ -212,7 +267,6 @@ SQSH_EXTERN unsigned int squashfs_read_data(struct super_block *s, char *buffer,
 
 		bytes = msblk->devblksize - offset;
 		compressed = SQUASHFS_COMPRESSED(c_byte);
-		c_buffer = compressed ? msblk->read_data : buffer;
 		c_byte = SQUASHFS_COMPRESSED_SIZE(c_byte);
 
 		TRACE("Block @ 0x%llx, %scompressed size %d\n", index, compressed
@@ -226,44 +280,95 @@ SQSH_EXTERN unsigned int squashfs_read_data(struct super_block *s, char *buffer,
 		ll_rw_block(READ, b - 1, bh + 1);
 	}
 
-	if (compressed)
-		down(&msblk->read_data_mutex);
+	if (compressed) {
+		stream = squashfs_get_stream(msblk);
+		z = &stream->stream;
+		z->next_out = buffers[page++];
+		z->avail_out = page_size;
+
+		if ((zlib_err = zlib_inflateInit(z)) != Z_OK) {
+			ERROR("zlib_inflateInit returned unexpected result "
+					"0x%x\n", zlib_err);
+			goto stream_release;
+		}
+	}
 
-	for (bytes = 0, k = 0; k < b; k++) {
+	for (bytes = 0; k < b; k++) {
 		avail_bytes = (c_byte - bytes) > (msblk->devblksize - offset) ?
 					msblk->devblksize - offset :
 					c_byte - bytes;
 		wait_on_buffer(bh[k]);
 		if (!buffer_uptodate(bh[k]))
-			goto block_release;
-		memcpy(c_buffer + bytes, bh[k]->b_data + offset, avail_bytes);
+			goto stream_release;
+
+		if (!compressed && pages == 1)
+			memcpy(buffers[0] + bytes, bh[k]->b_data + offset,
+					avail_bytes);
+		else if (!compressed) {
+			/* uncompressed data is split over the pages by hand */
+			int copied = 0;
+
+			while (copied < avail_bytes) {
+				int in_page = page_size - (bytes + copied) %
+							page_size;
+				int n = avail_bytes - copied < in_page ?
+							avail_bytes - copied :
+							in_page;
+
+				page = (bytes + copied) / page_size;
+				if (page >= pages) {
+					ERROR("block 0x%llx overflows "
+							"buffer\n", index);
+					goto stream_release;
+				}
+				memcpy(buffers[page] + (bytes + copied) %
+						page_size, bh[k]->b_data +
+						offset + copied, n);
+				copied += n;
+			}
+		} else if (avail_bytes) {
+			z = &stream->stream;
+			z->next_in = bh[k]->b_data + offset;
+			z->avail_in = avail_bytes;
+
+			do {
+				if (z->avail_out == 0 && page < pages) {
+					z->next_out = buffers[page++];
+					z->avail_out = page_size;
+				}
+				zlib_err = zlib_inflate(z, Z_NO_FLUSH);
+			} while (zlib_err == Z_OK && (z->avail_in ||
+					(z->avail_out == 0 && page < pages)));
+
+			/*
+			 * Z_BUF_ERROR with all the input used up only means
+			 * the stream goes on in the next buffer head.  A
+			 * stream that never ends is caught after the loop.
+			 */
+			if (zlib_err == Z_BUF_ERROR && z->avail_in == 0)
+				zlib_err = Z_OK;
+
+			if (zlib_err != Z_OK && zlib_err != Z_STREAM_END) {
+				ERROR("zlib_fs returned unexpected result "
+						"0x%x\n", zlib_err);
+				goto stream_release;
+			}
+		}
+
 		bytes += avail_bytes;
 		offset = 0;
 		brelse(bh[k]);
 	}
 
-	/*
-	 * uncompress block
-	 */
 	if (compressed) {
-		int zlib_err;
-
-		msblk->stream.next_in = c_buffer;
-		msblk->stream.avail_in = c_byte;
-		msblk->stream.next_out = buffer;
-		msblk->stream.avail_out = msblk->read_size;
-
-		if (((zlib_err = zlib_inflateInit(&msblk->stream)) != Z_OK) ||
-				((zlib_err = zlib_inflate(&msblk->stream, Z_FINISH))
-				 != Z_STREAM_END) || ((zlib_err =
-				zlib_inflateEnd(&msblk->stream)) != Z_OK)) {
-			ERROR("zlib_fs returned unexpected result 0x%x\n",
-				zlib_err);
+		z = &stream->stream;
+		if (zlib_err != Z_STREAM_END) {
+			ERROR("zlib_fs block 0x%llx is truncated\n", index);
 			bytes = 0;
 		} else
-			bytes = msblk->stream.total_out;
-		
-		up(&msblk->read_data_mutex);
+			bytes = z->total_out;
+		zlib_inflateEnd(z);
+		squashfs_put_stream(msblk, stream);
 	}
 
 	if (next_index)
@@ -272,6 +377,15 @@ SQSH_EXTERN unsigned int squashfs_read_data(struct super_block *s, char *buffer,
 				 ? 3 : 2));
 	return bytes;
 
+stream_release:
+	if (stream) {
+		zlib_inflateEnd(&stream->stream);
+		squashfs_put_stream(msblk, stream);
+	}
+	for (; k < b; k++)
+		brelse(bh[k]);
+	goto read_failure;
+
 block_release:
 	while (--b >= 0)
 		brelse(bh[b]);
@@ -282,50 +396,69 @@ read_failure:
 }
 
 
+SQSH_EXTERN unsigned int squashfs_read_data(struct super_block *s, char *buffer,
+			long long index, unsigned int length,
+			long long *next_index)
+{
+	struct squashfs_sb_info *msblk = s->s_fs_info;
+
+	return squashfs_read_data_pages(s, &buffer, 1, msblk->read_size,
+				index, length, next_index);
+}
+
+
+/*
+ * Metadata blocks are kept on an LRU list, most recently used first.  A
+ * block being read in stays on the list marked pending so that other
+ * readers of the same block wait for it rather than read it again.
+ */
 SQSH_EXTERN int squashfs_get_cached_block(struct super_block *s, char *buffer,
 				long long block, unsigned int offset,
 				int length, long long *next_block,
 				unsigned int *next_offset)
 {
 	struct squashfs_sb_info *msblk = s->s_fs_info;
-	int n, i, bytes, return_length = length;
+	struct squashfs_cache *entry, *victim;
+	int hit, bytes, return_length = length;
 	long long next_index;
 
 	TRACE("Entered squashfs_get_cached_block [%llx:%x]\n", block, offset);
 
 	while ( 1 ) {
-		for (i = 0; i < SQUASHFS_CACHED_BLKS; i++) 
-			if (msblk->block_cache[i].block == block)
-				break; 
-		
 		down(&msblk->block_cache_mutex);
 
-		if (i == SQUASHFS_CACHED_BLKS) {
-			/* read inode header block */
-			for (i = msblk->next_cache, n = SQUASHFS_CACHED_BLKS;
-					n ; n --, i = (i + 1) %
-					SQUASHFS_CACHED_BLKS)
-				if (msblk->block_cache[i].block !=
-							SQUASHFS_USED_BLK)
-					break;
-
-			if (n == 0) {
-				wait_queue_t wait;
-
-				init_waitqueue_entry(&wait, current);
-				add_wait_queue(&msblk->waitq, &wait);
-				set_current_state(TASK_UNINTERRUPTIBLE);
- 				up(&msblk->block_cache_mutex);
-				schedule();
-				set_current_state(TASK_RUNNING);
-				remove_wait_queue(&msblk->waitq, &wait);
-				continue;
-			}
-			msblk->next_cache = (i + 1) % SQUASHFS_CACHED_BLKS;
+		victim = NULL;
+		list_for_each_entry(entry, &msblk->block_cache_lru, lru) {
+			if (entry->block == block)
+				break;
+			if (!entry->pending)
+				victim = entry;
+		}
+
+		/*
+		 * Wait if the block is still being read by someone else, or
+		 * if it is missing and every slot is being filled.
+		 */
+		hit = &entry->lru != &msblk->block_cache_lru;
+		if (hit ? entry->pending : victim == NULL) {
+			wait_queue_t wait;
+
+			init_waitqueue_entry(&wait, current);
+			add_wait_queue(&msblk->waitq, &wait);
+			set_current_state(TASK_UNINTERRUPTIBLE);
+			up(&msblk->block_cache_mutex);
+			schedule();
+			set_current_state(TASK_RUNNING);
+			remove_wait_queue(&msblk->waitq, &wait);
+			continue;
+		}
 
-			if (msblk->block_cache[i].block ==
-							SQUASHFS_INVALID_BLK) {
-				if (!(msblk->block_cache[i].data =
+		if (!hit) {
+			/* read inode header block into the oldest idle slot */
+			entry = victim;
+
+			if (entry->data == NULL) {
+				if (!(entry->data =
 						kmalloc(SQUASHFS_METADATA_SIZE,
 						GFP_KERNEL))) {
 					ERROR("Failed to allocate cache"
@@ -334,37 +467,40 @@ SQSH_EXTERN int squashfs_get_cached_block(struct super_block *s, char *buffer,
 					goto out;
 				}
 			}
-	
-			msblk->block_cache[i].block = SQUASHFS_USED_BLK;
+
+			atomic_inc(&msblk->block_cache_misses);
+			entry->block = block;
+			entry->pending = 1;
+			list_move(&entry->lru, &msblk->block_cache_lru);
 			up(&msblk->block_cache_mutex);
 
-			if (!(msblk->block_cache[i].length =
-						squashfs_read_data(s,
-						msblk->block_cache[i].data,
-						block, 0, &next_index))) {
+			entry->length = squashfs_read_data(s, entry->data,
+						block, 0, &next_index);
+
+			down(&msblk->block_cache_mutex);
+			entry->pending = 0;
+			wake_up(&msblk->waitq);
+			if (!entry->length) {
 				ERROR("Unable to read cache block [%llx:%x]\n",
 						block, offset);
+				entry->block = SQUASHFS_INVALID_BLK;
+				list_move_tail(&entry->lru,
+						&msblk->block_cache_lru);
+				up(&msblk->block_cache_mutex);
 				goto out;
 			}
-
-			down(&msblk->block_cache_mutex);
-			wake_up(&msblk->waitq);
-			msblk->block_cache[i].block = block;
-			msblk->block_cache[i].next_index = next_index;
+			entry->next_index = next_index;
 			TRACE("Read cache block [%llx:%x]\n", block, offset);
+		} else {
+			atomic_inc(&msblk->block_cache_hits);
+			list_move(&entry->lru, &msblk->block_cache_lru);
 		}
 
-		if (msblk->block_cache[i].block != block) {
-			up(&msblk->block_cache_mutex);
-			continue;
-		}
-
-		if ((bytes = msblk->block_cache[i].length - offset) >= length) {
+		if ((bytes = entry->length - offset) >= length) {
 			if (buffer)
-				memcpy(buffer, msblk->block_cache[i].data +
-						offset, length);
-			if (msblk->block_cache[i].length - offset == length) {
-				*next_block = msblk->block_cache[i].next_index;
+				memcpy(buffer, entry->data + offset, length);
+			if (entry->length - offset == length) {
+				*next_block = entry->next_index;
 				*next_offset = 0;
 			} else {
 				*next_block = block;
@@ -374,11 +510,10 @@ SQSH_EXTERN int squashfs_get_cached_block(struct super_block *s, char *buffer,
 			goto finish;
 		} else {
 			if (buffer) {
-				memcpy(buffer, msblk->block_cache[i].data +
-						offset, bytes);
+				memcpy(buffer, entry->data + offset, bytes);
 				buffer += bytes;
 			}
-			block = msblk->block_cache[i].next_index;
+			block = entry->next_index;
 			up(&msblk->block_cache_mutex);
 			length -= bytes;
 			offset = 0;
@@ -438,44 +573,51 @@ SQSH_EXTERN void release_cached_fragment(struct squashfs_sb_info *msblk, struct
 }
 
 
+/*
+ * Fragment blocks use the same LRU scheme as the metadata cache, except
+ * that entries are handed out locked and cannot be replaced until every
+ * user has called release_cached_fragment().
+ */
 SQSH_EXTERN struct squashfs_fragment_cache *get_cached_fragment(struct super_block
 					*s, long long start_block,
 					int length)
 {
-	int i, n;
+	int hit;
 	struct squashfs_sb_info *msblk = s->s_fs_info;
+	struct squashfs_fragment_cache *fragment, *victim;
 
 	while ( 1 ) {
 		down(&msblk->fragment_mutex);
 
-		for (i = 0; i < SQUASHFS_CACHED_FRAGMENTS &&
-				msblk->fragment[i].block != start_block; i++);
+		victim = NULL;
+		list_for_each_entry(fragment, &msblk->fragment_lru, lru) {
+			if (fragment->block == start_block)
+				break;
+			if (!fragment->locked)
+				victim = fragment;
+		}
 
-		if (i == SQUASHFS_CACHED_FRAGMENTS) {
-			for (i = msblk->next_fragment, n =
-				SQUASHFS_CACHED_FRAGMENTS; n &&
-				msblk->fragment[i].locked; n--, i = (i + 1) %
-				SQUASHFS_CACHED_FRAGMENTS);
+		hit = &fragment->lru != &msblk->fragment_lru;
+		if (hit ? fragment->pending : victim == NULL) {
+			wait_queue_t wait;
 
-			if (n == 0) {
-				wait_queue_t wait;
+			init_waitqueue_entry(&wait, current);
+			add_wait_queue(&msblk->fragment_wait_queue,
+								&wait);
+			set_current_state(TASK_UNINTERRUPTIBLE);
+			up(&msblk->fragment_mutex);
+			schedule();
+			set_current_state(TASK_RUNNING);
+			remove_wait_queue(&msblk->fragment_wait_queue,
+								&wait);
+			continue;
+		}
 
-				init_waitqueue_entry(&wait, current);
-				add_wait_queue(&msblk->fragment_wait_queue,
-									&wait);
-				set_current_state(TASK_UNINTERRUPTIBLE);
-				up(&msblk->fragment_mutex);
-				schedule();
-				set_current_state(TASK_RUNNING);
-				remove_wait_queue(&msblk->fragment_wait_queue,
-									&wait);
-				continue;
-			}
-			msblk->next_fragment = (msblk->next_fragment + 1) %
-				SQUASHFS_CACHED_FRAGMENTS;
-			
-			if (msblk->fragment[i].data == NULL)
-				if (!(msblk->fragment[i].data = SQUASHFS_ALLOC
+		if (!hit) {
+			fragment = victim;
+
+			if (fragment->data == NULL)
+				if (!(fragment->data = SQUASHFS_ALLOC
 						(SQUASHFS_FILE_MAX_SIZE))) {
 					ERROR("Failed to allocate fragment "
 							"cache block\n");
@@ -483,35 +625,48 @@ SQSH_EXTERN struct squashfs_fragment_cache *get_cached_fragment(struct super_blo
 					goto out;
 				}
 
-			msblk->fragment[i].block = SQUASHFS_INVALID_BLK;
-			msblk->fragment[i].locked = 1;
+			atomic_inc(&msblk->fragment_misses);
+			fragment->block = start_block;
+			fragment->pending = 1;
+			fragment->locked = 1;
+			list_move(&fragment->lru, &msblk->fragment_lru);
 			up(&msblk->fragment_mutex);
 
-			if (!(msblk->fragment[i].length = squashfs_read_data(s,
-						msblk->fragment[i].data,
-						start_block, length, NULL))) {
+			fragment->length = squashfs_read_data(s, fragment->data,
+						start_block, length, NULL);
+
+			down(&msblk->fragment_mutex);
+			fragment->pending = 0;
+			wake_up(&msblk->fragment_wait_queue);
+			if (!fragment->length) {
 				ERROR("Unable to read fragment cache block "
 							"[%llx]\n", start_block);
-				msblk->fragment[i].locked = 0;
+				fragment->block = SQUASHFS_INVALID_BLK;
+				fragment->locked = 0;
+				list_move_tail(&fragment->lru,
+						&msblk->fragment_lru);
+				up(&msblk->fragment_mutex);
 				goto out;
 			}
+			up(&msblk->fragment_mutex);
 
-			msblk->fragment[i].block = start_block;
-			TRACE("New fragment %d, start block %lld, locked %d\n",
-						i, msblk->fragment[i].block,
-						msblk->fragment[i].locked);
+			TRACE("New fragment, start block %lld, locked %d\n",
+						fragment->block,
+						fragment->locked);
 			break;
 		}
 
-		msblk->fragment[i].locked++;
+		atomic_inc(&msblk->fragment_hits);
+		fragment->locked++;
+		list_move(&fragment->lru, &msblk->fragment_lru);
 		up(&msblk->fragment_mutex);
-		TRACE("Got fragment %d, start block %lld, locked %d\n", i,
-						msblk->fragment[i].block,
-						msblk->fragment[i].locked);
+		TRACE("Got fragment, start block %lld, locked %d\n",
+						fragment->block,
+						fragment->locked);
 		break;
 	}
 
-	return &msblk->fragment[i];
+	return fragment;
 
 out:
 	return NULL;
@@ -949,6 +1104,32 @@ static int supported_squashfs_filesystem(struct squashfs_sb_info *msblk, int sil
 }
 
 
+static void squashfs_free_caches(struct squashfs_sb_info *msblk)
+{
+	int i;
+
+	if (msblk->block_cache)
+		for (i = 0; i < SQUASHFS_CACHED_BLKS; i++)
+			kfree(msblk->block_cache[i].data);
+	if (msblk->fragment)
+		for (i = 0; i < SQUASHFS_CACHED_FRAGMENTS; i++) 
+			SQUASHFS_FREE(msblk->fragment[i].data);
+	kfree(msblk->fragment);
+	kfree(msblk->block_cache);
+}
+
+
+static void squashfs_free_streams(struct squashfs_sb_info *msblk)
+{
+	int i;
+
+	if (msblk->stream)
+		for (i = 0; i < SQUASHFS_DECOMP_STREAMS; i++)
+			vfree(msblk->stream[i].stream.workspace);
+	kfree(msblk->stream);
+}
+
+
 static int squashfs_fill_super(struct super_block *s, void *data, int silent)
 {
 	struct squashfs_sb_info *msblk;
@@ -966,17 +1147,37 @@ static int squashfs_fill_super(struct super_block *s, void *data, int silent)
 	}
 	memset(s->s_fs_info, 0, sizeof(struct squashfs_sb_info));
 	msblk = s->s_fs_info;
-	if (!(msblk->stream.workspace = vmalloc(zlib_inflate_workspacesize()))) {
-		ERROR("Failed to allocate zlib workspace\n");
-		goto failure;
-	}
 	sblk = &msblk->sblk;
+
+	msblk->sb = s;
+	INIT_LIST_HEAD(&msblk->list);
+	INIT_LIST_HEAD(&msblk->free_streams);
+	INIT_LIST_HEAD(&msblk->block_cache_lru);
+	INIT_LIST_HEAD(&msblk->fragment_lru);
+	spin_lock_init(&msblk->stream_lock);
+	sema_init(&msblk->stream_sem, SQUASHFS_DECOMP_STREAMS);
+
+	/* Allocate the pool of zlib streams */
+	if (!(msblk->stream = kmalloc(sizeof(struct squashfs_stream) *
+					SQUASHFS_DECOMP_STREAMS, GFP_KERNEL))) {
+		ERROR("Failed to allocate zlib streams\n");
+		goto failed_mount;
+	}
+	memset(msblk->stream, 0, sizeof(struct squashfs_stream) *
+					SQUASHFS_DECOMP_STREAMS);
+
+	for (i = 0; i < SQUASHFS_DECOMP_STREAMS; i++) {
+		if (!(msblk->stream[i].stream.workspace =
+				vmalloc(zlib_inflate_workspacesize()))) {
+			ERROR("Failed to allocate zlib workspace\n");
+			goto failed_mount;
+		}
+		list_add(&msblk->stream[i].list, &msblk->free_streams);
+	}
 	
 	msblk->devblksize = sb_min_blocksize(s, BLOCK_SIZE);
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
 
-	init_MUTEX(&msblk->read_data_mutex);
-	init_MUTEX(&msblk->read_page_mutex);
 	init_MUTEX(&msblk->block_cache_mutex);
 	init_MUTEX(&msblk->fragment_mutex);
 	init_MUTEX(&msblk->meta_index_mutex);
@@ -1048,24 +1249,24 @@ static int squashfs_fill_super(struct super_block *s, void *data, int silent)
 		goto failed_mount;
 	}
 
-	for (i = 0; i < SQUASHFS_CACHED_BLKS; i++)
+	for (i = 0; i < SQUASHFS_CACHED_BLKS; i++) {
 		msblk->block_cache[i].block = SQUASHFS_INVALID_BLK;
+		msblk->block_cache[i].pending = 0;
+		msblk->block_cache[i].data = NULL;
+		list_add_tail(&msblk->block_cache[i].lru,
+					&msblk->block_cache_lru);
+	}
 
-	msblk->next_cache = 0;
-
-	/* Allocate read_data block */
 	msblk->read_size = (sblk->block_size < SQUASHFS_METADATA_SIZE) ?
 					SQUASHFS_METADATA_SIZE :
 					sblk->block_size;
 
-	if (!(msblk->read_data = kmalloc(msblk->read_size, GFP_KERNEL))) {
-		ERROR("Failed to allocate read_data block\n");
-		goto failed_mount;
-	}
-
-	/* Allocate read_page block */
-	if (!(msblk->read_page = kmalloc(sblk->block_size, GFP_KERNEL))) {
-		ERROR("Failed to allocate read_page block\n");
+	/*
+	 * Data blocks are decompressed straight into the page cache; the
+	 * parts that land on pages we could not take go to the dummy page.
+	 */
+	if (!(msblk->dummy_page = kmalloc(PAGE_CACHE_SIZE, GFP_KERNEL))) {
+		ERROR("Failed to allocate dummy page\n");
 		goto failed_mount;
 	}
 
@@ -1111,12 +1312,12 @@ static int squashfs_fill_super(struct super_block *s, void *data, int silent)
 
 	for (i = 0; i < SQUASHFS_CACHED_FRAGMENTS; i++) {
 		msblk->fragment[i].locked = 0;
+		msblk->fragment[i].pending = 0;
 		msblk->fragment[i].block = SQUASHFS_INVALID_BLK;
 		msblk->fragment[i].data = NULL;
+		list_add_tail(&msblk->fragment[i].lru, &msblk->fragment_lru);
 	}
 
-	msblk->next_fragment = 0;
-
 	/* Allocate fragment index table */
 	if (msblk->read_fragment_index_table(s) == 0)
 		goto failed_mount;
@@ -1131,18 +1332,20 @@ allocate_root:
 		goto failed_mount;
 	}
 
+	spin_lock(&squashfs_mounts_lock);
+	list_add_tail(&msblk->list, &squashfs_mounts);
+	spin_unlock(&squashfs_mounts_lock);
+
 	TRACE("Leaving squashfs_read_super\n");
 	return 0;
 
 failed_mount:
+	squashfs_free_caches(msblk);
 	kfree(msblk->fragment_index);
-	kfree(msblk->fragment);
 	kfree(msblk->uid);
-	kfree(msblk->read_page);
-	kfree(msblk->read_data);
-	kfree(msblk->block_cache);
+	kfree(msblk->dummy_page);
 	kfree(msblk->fragment_index_2);
-	vfree(msblk->stream.workspace);
+	squashfs_free_streams(msblk);
 	kfree(s->s_fs_info);
 	s->s_fs_info = NULL;
 	return -EINVAL;
@@ -1480,18 +1683,96 @@ failure:
 }
 
 
+/* most pages a data block can cover */
+#define SQUASHFS_BLOCK_PAGES	(SQUASHFS_FILE_MAX_SIZE >> PAGE_CACHE_SHIFT)
+
+/*
+ * Decompress data block index of inode straight into the page cache.
+ * push[] holds the locked pages the caller owns, by their offset in the
+ * block.  The rest of the pages the block covers are grabbed without
+ * blocking, and the bytes for any that cannot be grabbed are thrown away
+ * into msblk->dummy_page.  Every page in push[] is unlocked on return.
+ */
+static void squashfs_read_block_pages(struct inode *inode, int index,
+				struct page **push)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	struct squashfs_super_block *sblk = &msblk->sblk;
+	int shift = sblk->block_log > PAGE_CACHE_SHIFT ?
+				sblk->block_log - PAGE_CACHE_SHIFT : 0;
+	int pages = 1 << shift, start_index = index << shift;
+	int file_pages = (i_size_read(inode) + PAGE_CACHE_SIZE - 1) >>
+					PAGE_CACHE_SHIFT;
+	char *buffers[SQUASHFS_BLOCK_PAGES];
+	unsigned int grabbed = 0, bsize, bytes = 0;
+	unsigned char *block_list;
+	long long block = 0;
+	int i;
+
+	TRACE("Entered squashfs_read_block_pages, block index %x, start block "
+					"%llx\n", index,
+					SQUASHFS_I(inode)->start_block);
+
+	if (!(block_list = kmalloc(SIZE, GFP_KERNEL)))
+		ERROR("Failed to allocate block_list\n");
+	else
+		block = (msblk->read_blocklist)(inode, index, 1, block_list,
+					NULL, &bsize);
+
+	for (i = 0; i < pages; i++) {
+		if (block && push[i] == NULL && start_index + i < file_pages &&
+				(push[i] = grab_cache_page_nowait(
+				inode->i_mapping, start_index + i)))
+			grabbed |= 1 << i;
+		buffers[i] = push[i] ? kmap(push[i]) : msblk->dummy_page;
+	}
+
+	if (block && !(bytes = squashfs_read_data_pages(inode->i_sb, buffers,
+					pages, PAGE_CACHE_SIZE, block, bsize,
+					NULL)))
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+					bsize);
+
+	for (i = 0; i < pages; i++) {
+		int available_bytes = bytes > (i << PAGE_CACHE_SHIFT) ?
+					bytes - (i << PAGE_CACHE_SHIFT) : 0;
+
+		if (push[i] == NULL)
+			continue;
+
+		if (available_bytes < PAGE_CACHE_SIZE)
+			memset(buffers[i] + available_bytes, 0,
+					PAGE_CACHE_SIZE - available_bytes);
+		kunmap(push[i]);
+		flush_dcache_page(push[i]);
+
+		/*
+		 * On a read error the pages asked for are flagged and none is
+		 * made uptodate, so the zero fill never reaches the page
+		 * cache; pages we pulled in are left to be read again later.
+		 */
+		if (bytes)
+			SetPageUptodate(push[i]);
+		else if (!(grabbed & (1 << i)))
+			SetPageError(push[i]);
+		unlock_page(push[i]);
+		if (grabbed & (1 << i))
+			page_cache_release(push[i]);
+	}
+
+	kfree(block_list);
+}
+
+
 static int squashfs_readpage(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
 	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
 	struct squashfs_super_block *sblk = &msblk->sblk;
-	unsigned char *block_list;
-	long long block;
-	unsigned int bsize, i = 0, bytes = 0, byte_offset = 0;
+	unsigned int i = 0, bytes = 0, byte_offset = 0;
 	int index = page->index >> (sblk->block_log - PAGE_CACHE_SHIFT);
  	void *pageaddr;
 	struct squashfs_fragment_cache *fragment = NULL;
-	char *data_ptr = msblk->read_page;
 	
 	int mask = (1 << (sblk->block_log - PAGE_CACHE_SHIFT)) - 1;
 	int start_index = page->index & ~mask;
@@ -1501,11 +1782,6 @@ static int squashfs_readpage(struct file *file, struct page *page)
 					page->index,
 					SQUASHFS_I(inode)->start_block);
 
-	if (!(block_list = kmalloc(SIZE, GFP_KERNEL))) {
-		ERROR("Failed to allocate block_list\n");
-		goto skip_read;
-	}
-
 	if (page->index >= ((i_size_read(inode) + PAGE_CACHE_SIZE - 1) >>
 					PAGE_CACHE_SHIFT))
 		goto skip_read;
@@ -1513,38 +1789,30 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	if (SQUASHFS_I(inode)->u.s1.fragment_start_block == SQUASHFS_INVALID_BLK
 					|| index < (i_size_read(inode) >>
 					sblk->block_log)) {
-		if ((block = (msblk->read_blocklist)(inode, index, 1,
-					block_list, NULL, &bsize)) == 0)
-			goto skip_read;
+		struct page *push[SQUASHFS_BLOCK_PAGES];
 
-		down(&msblk->read_page_mutex);
-		
-		if (!(bytes = squashfs_read_data(inode->i_sb, msblk->read_page,
-					block, bsize, NULL))) {
-			ERROR("Unable to read page, block %llx, size %x\n", block,
-					bsize);
-			up(&msblk->read_page_mutex);
-			goto skip_read;
-		}
-	} else {
-		if ((fragment = get_cached_fragment(inode->i_sb,
-					SQUASHFS_I(inode)->
-					u.s1.fragment_start_block,
-					SQUASHFS_I(inode)->u.s1.fragment_size))
-					== NULL) {
-			ERROR("Unable to read page, block %llx, size %x\n",
-					SQUASHFS_I(inode)->
-					u.s1.fragment_start_block,
-					(int) SQUASHFS_I(inode)->
-					u.s1.fragment_size);
-			goto skip_read;
-		}
-		bytes = SQUASHFS_I(inode)->u.s1.fragment_offset +
-					(i_size_read(inode) & (sblk->block_size
-					- 1));
-		byte_offset = SQUASHFS_I(inode)->u.s1.fragment_offset;
-		data_ptr = fragment->data;
+		memset(push, 0, sizeof(push));
+		push[page->index & mask] = page;
+		squashfs_read_block_pages(inode, index, push);
+		return 0;
+	}
+
+	if ((fragment = get_cached_fragment(inode->i_sb,
+				SQUASHFS_I(inode)->
+				u.s1.fragment_start_block,
+				SQUASHFS_I(inode)->u.s1.fragment_size))
+				== NULL) {
+		ERROR("Unable to read page, block %llx, size %x\n",
+				SQUASHFS_I(inode)->
+				u.s1.fragment_start_block,
+				(int) SQUASHFS_I(inode)->
+				u.s1.fragment_size);
+		goto skip_read;
 	}
+	bytes = SQUASHFS_I(inode)->u.s1.fragment_offset +
+				(i_size_read(inode) & (sblk->block_size
+				- 1));
+	byte_offset = SQUASHFS_I(inode)->u.s1.fragment_offset;
 
 	for (i = start_index; i <= end_index && byte_offset < bytes;
 					i++, byte_offset += PAGE_CACHE_SIZE) {
@@ -1557,7 +1825,7 @@ static int squashfs_readpage(struct file *file, struct page *page)
 
 		if (i == page->index)  {
 			pageaddr = kmap_atomic(page, KM_USER0);
-			memcpy(pageaddr, data_ptr + byte_offset,
+			memcpy(pageaddr, fragment->data + byte_offset,
 					available_bytes);
 			memset(pageaddr + available_bytes, 0,
 					PAGE_CACHE_SIZE - available_bytes);
@@ -1569,7 +1837,7 @@ static int squashfs_readpage(struct file *file, struct page *page)
 				grab_cache_page_nowait(page->mapping, i))) {
  			pageaddr = kmap_atomic(push_page, KM_USER0);
 
-			memcpy(pageaddr, data_ptr + byte_offset,
+			memcpy(pageaddr, fragment->data + byte_offset,
 					available_bytes);
 			memset(pageaddr + available_bytes, 0,
 					PAGE_CACHE_SIZE - available_bytes);
@@ -1581,14 +1849,7 @@ static int squashfs_readpage(struct file *file, struct page *page)
 		}
 	}
 
-	if (SQUASHFS_I(inode)->u.s1.fragment_start_block == SQUASHFS_INVALID_BLK
-					|| index < (i_size_read(inode) >>
-					sblk->block_log))
-		up(&msblk->read_page_mutex);
-	else
-		release_cached_fragment(msblk, fragment);
-
-	kfree(block_list);
+	release_cached_fragment(msblk, fragment);
 	return 0;
 
 skip_read:
@@ -1599,7 +1860,68 @@ skip_read:
 	SetPageUptodate(page);
 	unlock_page(page);
 
-	kfree(block_list);
+	return 0;
+}
+
+
+/*
+ * Readahead hands us a list of pages not yet in the page cache.  Insert
+ * them a whole data block at a time and decompress each block once
+ * straight into its pages, instead of once per readpage call.
+ */
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+				struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	struct squashfs_super_block *sblk = &msblk->sblk;
+	int shift = sblk->block_log - PAGE_CACHE_SHIFT;
+	int mask = (1 << shift) - 1;
+	struct page *push[SQUASHFS_BLOCK_PAGES];
+	struct page *page, *next;
+	int index, i, added;
+
+	TRACE("Entered squashfs_readpages, %u pages, start block %llx\n",
+					nr_pages,
+					SQUASHFS_I(inode)->start_block);
+
+	while (!list_empty(pages)) {
+		index = list_entry(pages->prev, struct page, lru)->index >>
+					shift;
+		memset(push, 0, sizeof(push));
+		added = 0;
+
+		list_for_each_entry_safe(page, next, pages, lru) {
+			if (page->index >> shift != index)
+				continue;
+			list_del(&page->lru);
+			if (add_to_page_cache_lru(page, mapping, page->index,
+						GFP_KERNEL)) {
+				page_cache_release(page);
+				continue;
+			}
+			push[page->index & mask] = page;
+			added++;
+		}
+
+		if (!added)
+			continue;
+
+		if (SQUASHFS_I(inode)->u.s1.fragment_start_block ==
+					SQUASHFS_INVALID_BLK || index <
+					(i_size_read(inode) >> sblk->block_log)) {
+			squashfs_read_block_pages(inode, index, push);
+			for (i = 0; i <= mask; i++)
+				if (push[i])
+					page_cache_release(push[i]);
+		} else
+			for (i = 0; i <= mask; i++)
+				if (push[i]) {
+					squashfs_readpage(file, push[i]);
+					page_cache_release(push[i]);
+				}
+	}
+
 	return 0;
 }
 
@@ -1609,9 +1931,7 @@ static int squashfs_readpage4K(struct file *file, struct page *page)
 	struct inode *inode = page->mapping->host;
 	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
 	struct squashfs_super_block *sblk = &msblk->sblk;
-	unsigned char *block_list;
-	long long block;
-	unsigned int bsize, bytes = 0;
+	unsigned int bytes = 0;
  	void *pageaddr;
 	
 	TRACE("Entered squashfs_readpage4K, page index %lx, start block %llx\n",
@@ -1621,33 +1941,14 @@ static int squashfs_readpage4K(struct file *file, struct page *page)
 	if (page->index >= ((i_size_read(inode) + PAGE_CACHE_SIZE - 1) >>
 					PAGE_CACHE_SHIFT)) {
 		pageaddr = kmap_atomic(page, KM_USER0);
-		block_list = NULL;
-		goto skip_read;
-	}
-
-	if (!(block_list = kmalloc(SIZE, GFP_KERNEL))) {
-		ERROR("Failed to allocate block_list\n");
-		pageaddr = kmap_atomic(page, KM_USER0);
-		block_list = NULL;
 		goto skip_read;
 	}
 
 	if (SQUASHFS_I(inode)->u.s1.fragment_start_block == SQUASHFS_INVALID_BLK
 					|| page->index < (i_size_read(inode) >>
 					sblk->block_log)) {
-		block = (msblk->read_blocklist)(inode, page->index, 1,
-					block_list, NULL, &bsize);
-
-		down(&msblk->read_page_mutex);
-		bytes = squashfs_read_data(inode->i_sb, msblk->read_page, block,
-					bsize, NULL);
-		pageaddr = kmap_atomic(page, KM_USER0);
-		if (bytes)
-			memcpy(pageaddr, msblk->read_page, bytes);
-		else
-			ERROR("Unable to read page, block %llx, size %x\n",
-					block, bsize);
-		up(&msblk->read_page_mutex);
+		squashfs_read_block_pages(inode, page->index, &page);
+		return 0;
 	} else {
 		struct squashfs_fragment_cache *fragment =
 			get_cached_fragment(inode->i_sb,
@@ -1674,7 +1975,6 @@ skip_read:
 	SetPageUptodate(page);
 	unlock_page(page);
 
-	kfree(block_list);
 	return 0;
 }
 
@@ -2043,27 +2343,20 @@ failed_read:
 
 static void squashfs_put_super(struct super_block *s)
 {
-	int i;
-
 	if (s->s_fs_info) {
 		struct squashfs_sb_info *sbi = s->s_fs_info;
-		if (sbi->block_cache)
-			for (i = 0; i < SQUASHFS_CACHED_BLKS; i++)
-				if (sbi->block_cache[i].block !=
-							SQUASHFS_INVALID_BLK)
-					kfree(sbi->block_cache[i].data);
-		if (sbi->fragment)
-			for (i = 0; i < SQUASHFS_CACHED_FRAGMENTS; i++) 
-				SQUASHFS_FREE(sbi->fragment[i].data);
-		kfree(sbi->fragment);
-		kfree(sbi->block_cache);
-		kfree(sbi->read_data);
-		kfree(sbi->read_page);
+
+		spin_lock(&squashfs_mounts_lock);
+		list_del(&sbi->list);
+		spin_unlock(&squashfs_mounts_lock);
+
+		squashfs_free_caches(sbi);
+		kfree(sbi->dummy_page);
 		kfree(sbi->uid);
 		kfree(sbi->fragment_index);
 		kfree(sbi->fragment_index_2);
 		kfree(sbi->meta_index);
-		vfree(sbi->stream.workspace);
+		squashfs_free_streams(sbi);
 		kfree(s->s_fs_info);
 		s->s_fs_info = NULL;
 	}
@@ -2077,6 +2370,44 @@ static struct super_block *squashfs_get_sb(struct file_system_type *fs_type,
 }
 
 
+#ifdef CONFIG_PROC_FS
+/*
+ * /proc/fs/squashfs: one line per mounted filesystem giving the cache
+ * sizes, hits and misses, and how often a reader had to wait for a free
+ * zlib stream.
+ */
+static int squashfs_proc_read(char *page, char **start, off_t off,
+				int count, int *eof, void *data)
+{
+	struct squashfs_sb_info *msblk;
+	char b[BDEVNAME_SIZE];
+	char *buf = page;
+
+	buf += sprintf(buf, "device     meta hits misses  frag hits misses"
+				"  streams waits\n");
+
+	spin_lock(&squashfs_mounts_lock);
+	list_for_each_entry(msblk, &squashfs_mounts, list) {
+		if (buf - page > PAGE_SIZE - 80)
+			break;
+		buf += sprintf(buf, "%-10s %4d %4u %6u  %4d %4u %6u  %7d %5u\n",
+				bdevname(msblk->sb->s_bdev, b),
+				SQUASHFS_CACHED_BLKS,
+				atomic_read(&msblk->block_cache_hits),
+				atomic_read(&msblk->block_cache_misses),
+				msblk->fragment ? SQUASHFS_CACHED_FRAGMENTS : 0,
+				atomic_read(&msblk->fragment_hits),
+				atomic_read(&msblk->fragment_misses),
+				SQUASHFS_DECOMP_STREAMS, msblk->stream_waits);
+	}
+	spin_unlock(&squashfs_mounts_lock);
+
+	*eof = 1;
+	return buf - page;
+}
+#endif
+
+
 static int __init init_squashfs_fs(void)
 {
 	int err = init_inodecache();
@@ -2086,8 +2417,15 @@ static int __init init_squashfs_fs(void)
 	printk(KERN_INFO "squashfs: version 3.1 (2006/08/15) "
 		"Phillip Lougher\n");
 
-	if ((err = register_filesystem(&squashfs_fs_type)))
+	if ((err = register_filesystem(&squashfs_fs_type))) {
 		destroy_inodecache();
+		goto out;
+	}
+
+#ifdef CONFIG_PROC_FS
+	create_proc_read_entry("squashfs", 0, proc_root_fs,
+				squashfs_proc_read, NULL);
+#endif
 
 out:
 	return err;
@@ -2096,6 +2434,9 @@ out:
 
 static void __exit exit_squashfs_fs(void)
 {
+#ifdef CONFIG_PROC_FS
+	remove_proc_entry("squashfs", proc_root_fs);
+#endif
 	unregister_filesystem(&squashfs_fs_type);
 	destroy_inodecache();
 }
@@ -0,0 +1,410 @@
+/*
+ * YAFFS: Yet another FFS. A NAND-flash specific file system.
+ * yaffs_checkptrw.c: Checkpoint stream access
+ *
+ * Copyright (C) 2026 Motorola Inc.
+ * Copyright (C) 2002 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ */
+
+/* ChangeLog:
+ * (mm-dd-yyyy) Author    Comment
+ * 10-17-2026   Motorola  Ported from yaffs2_lp for checkpointed mount.
+ *                        Added block offsets, a stream checksum and
+ *                        ECC checking on read.
+ */
+
+const char *yaffs_checkptrw_c_version =
+    "$Id: yaffs_checkptrw.c,v 1.5 2006/10/03 10:13:03 charles Exp $";
+
+#include "yaffs_checkptrw.h"
+
+/*
+ * The checkpoint is a byte stream spread over otherwise empty blocks. Each
+ * chunk is tagged with YAFFS_SEQUENCE_CHECKPOINT_DATA as its sequence number,
+ * its position in the stream (+1) as its chunkId and the block to start
+ * looking for the next checkpoint block from as its objectId.
+ *
+ * We go straight to the NAND functions here rather than through the guts
+ * wrappers: the wrappers would stamp the current sequence number into the
+ * tags and drop the locks while the flash is busy.
+ */
+
+static int yaffs_CheckpointSpaceOk(yaffs_Device * dev)
+{
+	int blocksAvailable = dev->nErasedBlocks - dev->nReservedBlocks;
+
+	T(YAFFS_TRACE_CHECKPOINT,
+	  (TSTR("checkpt blocks available = %d" TENDSTR), blocksAvailable));
+
+	return (blocksAvailable <= 0) ? 0 : 1;
+}
+
+static int yaffs_CheckpointErase(yaffs_Device * dev)
+{
+	int i;
+
+	if (!dev->eraseBlockInNAND)
+		return 0;
+
+	T(YAFFS_TRACE_CHECKPOINT, (TSTR("checking blocks %d to %d" TENDSTR),
+				   dev->internalStartBlock,
+				   dev->internalEndBlock));
+
+	for (i = dev->internalStartBlock; i <= dev->internalEndBlock; i++) {
+		yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev, i);
+		if (bi->blockState == YAFFS_BLOCK_STATE_CHECKPOINT) {
+			T(YAFFS_TRACE_CHECKPOINT,
+			  (TSTR("erasing checkpt block %d" TENDSTR), i));
+			dev->nBlockErasures++;
+			if (dev->eraseBlockInNAND(dev, i - dev->blockOffset)) {
+				bi->blockState = YAFFS_BLOCK_STATE_EMPTY;
+				bi->sequenceNumber = 0;
+				dev->nErasedBlocks++;
+				dev->nFreeChunks += dev->nChunksPerBlock;
+			} else {
+				dev->nErasureFailures++;
+				dev->markNANDBlockBad(dev, i - dev->blockOffset);
+				bi->blockState = YAFFS_BLOCK_STATE_DEAD;
+			}
+		}
+	}
+
+	dev->blocksInCheckpoint = 0;
+
+	return 1;
+}
+
+static void yaffs_CheckpointFindNextErasedBlock(yaffs_Device * dev)
+{
+	int i;
+
+	/* nErasedBlocks is only brought up to date at close */
+	int blocksAvailable = dev->nErasedBlocks - dev->nReservedBlocks -
+	    dev->blocksInCheckpoint;
+
+	if (dev->checkpointNextBlock >= 0 &&
+	    dev->checkpointNextBlock <= dev->internalEndBlock &&
+	    blocksAvailable > 0) {
+
+		for (i = dev->checkpointNextBlock; i <= dev->internalEndBlock;
+		     i++) {
+			yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev, i);
+			if (bi->blockState == YAFFS_BLOCK_STATE_EMPTY) {
+				dev->checkpointNextBlock = i + 1;
+				dev->checkpointCurrentBlock = i;
+				T(YAFFS_TRACE_CHECKPOINT,
+				  (TSTR("allocating checkpt block %d" TENDSTR),
+				   i));
+				return;
+			}
+		}
+	}
+	T(YAFFS_TRACE_CHECKPOINT, (TSTR("out of checkpt blocks" TENDSTR)));
+
+	dev->checkpointNextBlock = -1;
+	dev->checkpointCurrentBlock = -1;
+}
+
+static void yaffs_CheckpointFindNextCheckpointBlock(yaffs_Device * dev)
+{
+	int i;
+	yaffs_ExtendedTags tags;
+
+	if (dev->blocksInCheckpoint < dev->checkpointMaxBlocks &&
+	    dev->checkpointNextBlock >= dev->internalStartBlock)
+		for (i = dev->checkpointNextBlock; i <= dev->internalEndBlock;
+		     i++) {
+			int chunk = i * dev->nChunksPerBlock;
+
+			dev->readChunkWithTagsFromNAND(dev,
+						       chunk - dev->chunkOffset,
+						       NULL, &tags);
+
+			if (tags.sequenceNumber ==
+			    YAFFS_SEQUENCE_CHECKPOINT_DATA) {
+				/* Right kind of block */
+				dev->checkpointNextBlock = tags.objectId;
+				dev->checkpointCurrentBlock = i;
+				dev->checkpointBlockList[dev->
+							 blocksInCheckpoint] =
+				    i;
+				dev->blocksInCheckpoint++;
+				T(YAFFS_TRACE_CHECKPOINT,
+				  (TSTR("found checkpt block %d" TENDSTR), i));
+				return;
+			}
+		}
+
+	T(YAFFS_TRACE_CHECKPOINT, (TSTR("found no more checkpt blocks" TENDSTR)));
+
+	dev->checkpointNextBlock = -1;
+	dev->checkpointCurrentBlock = -1;
+}
+
+int yaffs_CheckpointOpen(yaffs_Device * dev, int forWriting)
+{
+	/* Got the functions we need? */
+	if (!dev->writeChunkWithTagsToNAND ||
+	    !dev->readChunkWithTagsFromNAND ||
+	    !dev->eraseBlockInNAND || !dev->markNANDBlockBad)
+		return 0;
+
+	/* Erase all the blocks in the checkpoint area */
+	if (forWriting &&
+	    (!yaffs_CheckpointErase(dev) || !yaffs_CheckpointSpaceOk(dev)))
+		return 0;
+
+	if (!dev->checkpointBuffer)
+		dev->checkpointBuffer = YMALLOC(dev->nBytesPerChunk);
+	if (!dev->checkpointBuffer)
+		return 0;
+
+	dev->checkpointPageSequence = 0;
+
+	dev->checkpointOpenForWrite = forWriting;
+
+	dev->checkpointByteCount = 0;
+	dev->checkpointSum = 0;
+	dev->checkpointXor = 0;
+	dev->checkpointCurrentBlock = -1;
+	dev->checkpointCurrentChunk = -1;
+	dev->checkpointNextBlock = dev->internalStartBlock;
+
+	if (forWriting) {
+		memset(dev->checkpointBuffer, 0, dev->nBytesPerChunk);
+		dev->checkpointByteOffset = 0;
+	} else {
+		int i;
+		/* Set to a value that will kick off a read */
+		dev->checkpointByteOffset = dev->nBytesPerChunk;
+		/* A checkpoint block list of 1 checkpoint block per 16 block is (hopefully)
+		 * going to be way more than we need */
+		dev->blocksInCheckpoint = 0;
+		dev->checkpointMaxBlocks =
+		    (dev->internalEndBlock - dev->internalStartBlock) / 16 + 2;
+		dev->checkpointBlockList =
+		    YMALLOC(sizeof(int) * dev->checkpointMaxBlocks);
+		if (!dev->checkpointBlockList)
+			return 0;
+		for (i = 0; i < dev->checkpointMaxBlocks; i++)
+			dev->checkpointBlockList[i] = -1;
+	}
+
+	return 1;
+}
+
+static int yaffs_CheckpointFlushBuffer(yaffs_Device * dev)
+{
+	int chunk;
+	yaffs_ExtendedTags tags;
+
+	if (dev->checkpointCurrentBlock < 0) {
+		yaffs_CheckpointFindNextErasedBlock(dev);
+		dev->checkpointCurrentChunk = 0;
+	}
+
+	if (dev->checkpointCurrentBlock < 0)
+		return 0;
+
+	yaffs_InitialiseTags(&tags);
+	tags.chunkUsed = 1;
+	tags.objectId = dev->checkpointNextBlock;	/* Hint to next place to look */
+	tags.chunkId = dev->checkpointPageSequence + 1;
+	tags.sequenceNumber = YAFFS_SEQUENCE_CHECKPOINT_DATA;
+	tags.byteCount = dev->nBytesPerChunk;
+	if (dev->checkpointCurrentChunk == 0) {
+		/* First chunk we write for the block? Set block state to
+		   checkpoint */
+		yaffs_BlockInfo *bi =
+		    yaffs_GetBlockInfo(dev, dev->checkpointCurrentBlock);
+		bi->blockState = YAFFS_BLOCK_STATE_CHECKPOINT;
+		dev->blocksInCheckpoint++;
+	}
+
+	chunk = dev->checkpointCurrentBlock * dev->nChunksPerBlock +
+	    dev->checkpointCurrentChunk;
+
+	dev->nPageWrites++;
+	if (!dev->writeChunkWithTagsToNAND(dev, chunk - dev->chunkOffset,
+					   dev->checkpointBuffer, &tags))
+		return 0;
+
+	dev->checkpointByteOffset = 0;
+	dev->checkpointPageSequence++;
+	dev->checkpointCurrentChunk++;
+	if (dev->checkpointCurrentChunk >= dev->nChunksPerBlock) {
+		dev->checkpointCurrentChunk = 0;
+		dev->checkpointCurrentBlock = -1;
+	}
+	memset(dev->checkpointBuffer, 0, dev->nBytesPerChunk);
+
+	return 1;
+}
+
+int yaffs_CheckpointWrite(yaffs_Device * dev, const void *data, int nBytes)
+{
+	int i = 0;
+	int ok = 1;
+
+	__u8 *dataBytes = (__u8 *) data;
+
+	if (!dev->checkpointBuffer)
+		return 0;
+
+	while (i < nBytes && ok) {
+		dev->checkpointBuffer[dev->checkpointByteOffset] = *dataBytes;
+		dev->checkpointSum += *dataBytes;
+		dev->checkpointXor ^= *dataBytes;
+
+		dev->checkpointByteOffset++;
+		i++;
+		dataBytes++;
+		dev->checkpointByteCount++;
+
+		if (dev->checkpointByteOffset < 0 ||
+		    dev->checkpointByteOffset >= dev->nBytesPerChunk)
+			ok = yaffs_CheckpointFlushBuffer(dev);
+	}
+
+	return ok ? i : 0;
+}
+
+int yaffs_CheckpointRead(yaffs_Device * dev, void *data, int nBytes)
+{
+	int i = 0;
+	int ok = 1;
+	yaffs_ExtendedTags tags;
+
+	int chunk;
+
+	__u8 *dataBytes = (__u8 *) data;
+
+	if (!dev->checkpointBuffer)
+		return 0;
+
+	while (i < nBytes && ok) {
+
+		if (dev->checkpointByteOffset < 0 ||
+		    dev->checkpointByteOffset >= dev->nBytesPerChunk) {
+
+			if (dev->checkpointCurrentBlock < 0) {
+				yaffs_CheckpointFindNextCheckpointBlock(dev);
+				dev->checkpointCurrentChunk = 0;
+			}
+
+			if (dev->checkpointCurrentBlock < 0)
+				ok = 0;
+			else {
+				chunk =
+				    dev->checkpointCurrentBlock *
+				    dev->nChunksPerBlock +
+				    dev->checkpointCurrentChunk;
+
+				/* read in the next chunk */
+				dev->nPageReads++;
+				dev->readChunkWithTagsFromNAND(dev,
+							       chunk -
+							       dev->chunkOffset,
+							       dev->
+							       checkpointBuffer,
+							       &tags);
+
+				if (tags.chunkId !=
+				    (dev->checkpointPageSequence + 1)
+				    || tags.sequenceNumber !=
+				    YAFFS_SEQUENCE_CHECKPOINT_DATA
+				    || tags.eccResult ==
+				    YAFFS_ECC_RESULT_UNFIXED)
+					ok = 0;
+
+				dev->checkpointByteOffset = 0;
+				dev->checkpointPageSequence++;
+				dev->checkpointCurrentChunk++;
+
+				if (dev->checkpointCurrentChunk >=
+				    dev->nChunksPerBlock)
+					dev->checkpointCurrentBlock = -1;
+			}
+		}
+
+		if (ok) {
+			*dataBytes =
+			    dev->checkpointBuffer[dev->checkpointByteOffset];
+			dev->checkpointSum += *dataBytes;
+			dev->checkpointXor ^= *dataBytes;
+			dev->checkpointByteOffset++;
+			i++;
+			dataBytes++;
+			dev->checkpointByteCount++;
+		}
+	}
+
+	return i;
+}
+
+/* Checksum of the bytes written or read so far */
+__u32 yaffs_GetCheckpointSum(yaffs_Device * dev)
+{
+	return (dev->checkpointSum << 8) | (dev->checkpointXor & 0xFF);
+}
+
+int yaffs_CheckpointClose(yaffs_Device * dev)
+{
+	int ok = 1;
+
+	if (dev->checkpointOpenForWrite) {
+		if (dev->checkpointByteOffset != 0)
+			ok = yaffs_CheckpointFlushBuffer(dev);
+	} else if (dev->checkpointBlockList) {
+		int i;
+		for (i = 0;
+		     i < dev->blocksInCheckpoint
+		     && dev->checkpointBlockList[i] >= 0; i++) {
+			yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev,
+								 dev->
+								 checkpointBlockList
+								 [i]);
+			/* The block info was saved as the first checkpoint
+			 * blocks were being filled, so they may still show
+			 * as empty.
+			 */
+			if (bi->blockState == YAFFS_BLOCK_STATE_EMPTY)
+				bi->blockState = YAFFS_BLOCK_STATE_CHECKPOINT;
+		}
+		YFREE(dev->checkpointBlockList);
+		dev->checkpointBlockList = NULL;
+	}
+
+	dev->nFreeChunks -= dev->blocksInCheckpoint * dev->nChunksPerBlock;
+	dev->nErasedBlocks -= dev->blocksInCheckpoint;
+
+	T(YAFFS_TRACE_CHECKPOINT, (TSTR("checkpoint byte count %d" TENDSTR),
+				   dev->checkpointByteCount));
+
+	if (dev->checkpointBuffer) {
+		/* free the buffer */
+		YFREE(dev->checkpointBuffer);
+		dev->checkpointBuffer = NULL;
+		return ok;
+	} else
+		return 0;
+}
+
+int yaffs_CheckpointInvalidateStream(yaffs_Device * dev)
+{
+	/* Erase the checkpoint blocks so that a stale checkpoint can't be
+	 * mounted.
+	 */
+
+	T(YAFFS_TRACE_CHECKPOINT, (TSTR("checkpoint invalidate" TENDSTR)));
+
+	return yaffs_CheckpointErase(dev);
+}
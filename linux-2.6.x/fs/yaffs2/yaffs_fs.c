@@ -29,6 +29,17 @@
  *			  Added BBT support to YAFFS2
  * 12-15-2006   Motorola  Added the middleOfMouting flag
  * 01-19-2007   Motorola  Added the showOptions functionality
+ * 10-17-2026   Motorola  Split the gross lock into a writer lock and a
+ *                        shared state lock for lookup/readdir/readpage
+ * 10-17-2026   Motorola  Added the background GC thread
+ * 10-17-2026   Motorola  Added the cache= mount option and cache statistics
+ * 10-17-2026   Motorola  Write a checkpoint on unmount and sync, added the
+ *                        nochkpoint mount option and mount time statistics
+ * 10-17-2026   Motorola  Slab caches and a shrinker for tnodes and objects,
+ *                        the nocompact mount option and memory statistics
+ * 10-17-2026   Motorola  statfs reads the free chunk counters without locking
+ * 10-17-2026   Motorola  Queue dirty block erases to the NAND erase thread,
+ *                        erase and allocation wait statistics
  */
 
 /*
@@ -70,6 +81,11 @@ extern const char *yaffs_guts_c_version;
 #include <linux/interrupt.h>
 #include <linux/string.h>
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_BACKGROUND_GC
+#include <linux/kthread.h>
+#include <linux/suspend.h>
+#endif
+
 #ifdef CONFIG_MOT_FEAT_YAFFS_PARSE_MOUNT_OPTIONS
 #include <linux/parser.h>
 #include <linux/mount.h>
@@ -117,6 +133,9 @@ unsigned yaffs_traceMask = YAFFS_TRACE_ALWAYS | YAFFS_TRACE_BAD_BLOCKS /* | 0xFF
 #endif
 
 static void yaffs_put_super(struct super_block *sb);
+#ifdef CONFIG_MOT_FEAT_YAFFS_SYNC
+static int yaffs_sync_fs(struct super_block *sb, int wait);
+#endif
 
 static ssize_t yaffs_file_write(struct file *f, const char *buf, size_t n,
 				loff_t * pos);
@@ -243,6 +262,9 @@ static struct super_operations yaffs_super_ops = {
 	.read_inode = yaffs_read_inode,
 	.put_inode = yaffs_put_inode,
 	.put_super = yaffs_put_super,
+#ifdef CONFIG_MOT_FEAT_YAFFS_SYNC
+	.sync_fs = yaffs_sync_fs,
+#endif
 	.delete_inode = yaffs_delete_inode,
 	.clear_inode = yaffs_clear_inode,
 #ifdef CONFIG_MOT_FEAT_YAFFS_PARSE_MOUNT_OPTIONS
@@ -250,20 +272,161 @@ static struct super_operations yaffs_super_ops = {
 #endif
 };
 
+/*
+ * Locking:
+ * Anything that modifies the file system takes the gross lock, which
+ * serialises the writers, and then takes the state lock for write.
+ * Operations that only look at the in-RAM state (lookup, readdir,
+ * readpage, readlink, statfs) take the state lock for read and never
+ * touch the gross lock, so they run alongside each other.
+ * While the writer is waiting on a NAND program or erase the guts tell
+ * us via nandBusyCallback and we drop the state lock, letting readers in
+ * until the operation completes.
+ */
 static void yaffs_GrossLock(yaffs_Device * dev)
 {
 	T(YAFFS_TRACE_OS, (KERN_DEBUG "yaffs locking\n"));
 
 	down(&dev->grossLock);
+	down_write(&dev->stateLock);
 }
 
 static void yaffs_GrossUnlock(yaffs_Device * dev)
 {
 	T(YAFFS_TRACE_OS, (KERN_DEBUG "yaffs unlocking\n"));
+	up_write(&dev->stateLock);
 	up(&dev->grossLock);
 
 }
 
+static void yaffs_ReadLock(yaffs_Device * dev)
+{
+	T(YAFFS_TRACE_OS, (KERN_DEBUG "yaffs read locking\n"));
+
+	down_read(&dev->stateLock);
+}
+
+static void yaffs_ReadUnlock(yaffs_Device * dev)
+{
+	T(YAFFS_TRACE_OS, (KERN_DEBUG "yaffs read unlocking\n"));
+	up_read(&dev->stateLock);
+}
+
+/* Called by the guts, with the gross lock held, around NAND program/erase */
+static void yaffs_NANDBusy(yaffs_Device * dev, int busy)
+{
+	if (busy)
+		up_write(&dev->stateLock);
+	else
+		down_write(&dev->stateLock);
+}
+
+#ifdef CONFIG_MOT_FEAT_YAFFS_BACKGROUND_GC
+/*
+ * Background GC.
+ * The thread runs at the lowest priority and does passive gc in small
+ * slices, dropping the gross lock between slices so writers are never
+ * held up for more than a few chunk copies. It sleeps while there is
+ * enough erased space and writers kick it when that runs low.
+ */
+#define YAFFS_GC_IDLE_PERIOD	(5 * HZ)
+
+static int yaffs_BackgroundGCThread(void *data)
+{
+	yaffs_Device *dev = (yaffs_Device *) data;
+	int more;
+
+	set_user_nice(current, 19);
+
+	while (!kthread_should_stop()) {
+		if (current->flags & PF_FREEZE) {
+			refrigerator(0);
+			continue;
+		}
+
+		/* Unlocked peek, the guts recheck under the lock. The task
+		 * state is set first so that a wakeup that comes in after
+		 * the peek makes the schedule_timeout() return at once.
+		 */
+		set_current_state(TASK_INTERRUPTIBLE);
+		more = (dev->gcBlock > 0 ||
+			(dev->nErasedBlocks * dev->nChunksPerBlock <
+			 dev->gcWatermark &&
+			 time_after_eq(jiffies, dev->gcRetryTime)));
+
+		if (!more) {
+			if (!kthread_should_stop())
+				schedule_timeout(YAFFS_GC_IDLE_PERIOD);
+			__set_current_state(TASK_RUNNING);
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		yaffs_GrossLock(dev);
+		more = yaffs_BackgroundGarbageCollect(dev);
+		if (!more &&
+		    dev->nErasedBlocks * dev->nChunksPerBlock <
+		    dev->gcWatermark)
+			dev->gcRetryTime = jiffies + HZ;
+		yaffs_GrossUnlock(dev);
+
+		if (more) {
+			cond_resched();
+		} else {
+			/* The pass found nothing worth collecting, hold off
+			 * for a while rather than rescanning on every kick.
+			 */
+			set_current_state(TASK_INTERRUPTIBLE);
+			if (!kthread_should_stop())
+				schedule_timeout(YAFFS_GC_IDLE_PERIOD);
+			__set_current_state(TASK_RUNNING);
+		}
+	}
+
+	return 0;
+}
+
+/* Called by the guts with the gross lock held */
+static void yaffs_WakeBackgroundGC(yaffs_Device * dev)
+{
+	if (dev->gcThread)
+		wake_up_process(dev->gcThread);
+}
+
+static void yaffs_StartBackgroundGC(yaffs_Device * dev)
+{
+	struct task_struct *t;
+
+	t = kthread_run(yaffs_BackgroundGCThread, dev, "yaffs_gcd_%s",
+			dev->name);
+	if (IS_ERR(t)) {
+		T(YAFFS_TRACE_ALWAYS,
+		  ("yaffs: could not start GC thread, gc stays inline\n"));
+		return;
+	}
+
+	yaffs_GrossLock(dev);
+	dev->gcThread = t;
+	dev->gcWakeCallback = yaffs_WakeBackgroundGC;
+	yaffs_GrossUnlock(dev);
+}
+
+static void yaffs_StopBackgroundGC(yaffs_Device * dev)
+{
+	struct task_struct *t = dev->gcThread;
+
+	if (!t)
+		return;
+
+	yaffs_GrossLock(dev);
+	dev->gcWakeCallback = NULL;
+	dev->gcThread = NULL;
+	yaffs_GrossUnlock(dev);
+
+	kthread_stop(t);
+}
+#endif
+
 static int yaffs_readlink(struct dentry *dentry, char __user * buffer,
 			  int buflen)
 {
@@ -272,11 +435,11 @@ static int yaffs_readlink(struct dentry *dentry, char __user * buffer,
 
 	yaffs_Device *dev = yaffs_DentryToObject(dentry)->myDev;
 
-	yaffs_GrossLock(dev);
+	yaffs_ReadLock(dev);
 
 	alias = yaffs_GetSymlinkAlias(yaffs_DentryToObject(dentry));
 
-	yaffs_GrossUnlock(dev);
+	yaffs_ReadUnlock(dev);
 
 	if (!alias)
 		return -ENOMEM;
@@ -296,11 +459,11 @@ static int yaffs_follow_link(struct dentry *dentry, struct nameidata *nd)
 	int ret;
 	yaffs_Device *dev = yaffs_DentryToObject(dentry)->myDev;
 
-	yaffs_GrossLock(dev);
+	yaffs_ReadLock(dev);
 
 	alias = yaffs_GetSymlinkAlias(yaffs_DentryToObject(dentry));
 
-	yaffs_GrossUnlock(dev);
+	yaffs_ReadUnlock(dev);
 
 	if (!alias)
         {
@@ -337,7 +500,7 @@ static struct dentry *yaffs_lookup(struct inode *dir, struct dentry *dentry)
 
 	yaffs_Device *dev = yaffs_InodeToObject(dir)->myDev;
 
-	yaffs_GrossLock(dev);
+	yaffs_ReadLock(dev);
 
 	T(YAFFS_TRACE_OS,
 	  (KERN_DEBUG "yaffs_lookup for %d:%s\n",
@@ -349,8 +512,8 @@ static struct dentry *yaffs_lookup(struct inode *dir, struct dentry *dentry)
 
 	obj = yaffs_GetEquivalentObject(obj);	/* in case it was a hardlink */
 	
-	/* Can't hold gross lock when calling yaffs_get_inode() */
-	yaffs_GrossUnlock(dev);
+	/* Can't hold the state lock when calling yaffs_get_inode() */
+	yaffs_ReadUnlock(dev);
 
 	if (obj) {
 		T(YAFFS_TRACE_OS,
@@ -506,13 +669,13 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	pg_buf = kmap(pg);
 	/* FIXME: Can kmap fail? */
 
-	yaffs_GrossLock(dev);
+	yaffs_ReadLock(dev);
 
 	ret =
 	    yaffs_ReadDataFromFile(obj, pg_buf, pg->index << PAGE_CACHE_SHIFT,
 				   PAGE_CACHE_SIZE);
 
-	yaffs_GrossUnlock(dev);
+	yaffs_ReadUnlock(dev);
 
 	if (ret >= 0)
 		ret = 0;
@@ -685,6 +848,17 @@ static int yaffs_show_options(struct seq_file *seq, struct vfsmount *vfs)
     if (dev->sMountOptions & YAFFS_MOUNT_SHRED)
 		seq_puts(seq, ",shred");
 
+    if (dev->nShortOpCaches != YAFFS_DEFAULT_SHORT_OP_CACHES)
+		seq_printf(seq, ",cache=%d", dev->nShortOpCaches);
+
+    if (dev->isYaffs2 && !dev->useCheckpoint)
+		seq_puts(seq, ",nochkpoint");
+
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+    if (!dev->compactTnodes)
+		seq_puts(seq, ",nocompact");
+#endif
+
     return 0;
 
 }
@@ -866,7 +1040,7 @@ static int yaffs_readdir(struct file *f, void *dirent, filldir_t filldir)
 	obj = yaffs_DentryToObject(f->f_dentry);
 	dev = obj->myDev;
 
-	yaffs_GrossLock(dev);
+	yaffs_ReadLock(dev);
 
 	offset = f->f_pos;
 
@@ -936,7 +1110,7 @@ static int yaffs_readdir(struct file *f, void *dirent, filldir_t filldir)
       up_and_out:
       out:
 
-	yaffs_GrossUnlock(dev);
+	yaffs_ReadUnlock(dev);
 
 	return 0;
 }
@@ -1277,8 +1451,9 @@ static int yaffs_statfs(struct super_block *sb, struct statfs *buf)
 	yaffs_Device *dev = yaffs_SuperToDevice(sb);
 	T(YAFFS_TRACE_OS, (KERN_DEBUG "yaffs_statfs\n"));
 
-	yaffs_GrossLock(dev);
-
+	/* The free count is O(1) from running counters and needs no lock;
+	 * storage monitors poll this, so don't queue them behind writers.
+	 */
 	buf->f_type = YAFFS_MAGIC;
 	buf->f_bsize = sb->s_blocksize;
 	buf->f_namelen = 255;
@@ -1305,7 +1480,6 @@ static int yaffs_statfs(struct super_block *sb, struct statfs *buf)
 	buf->f_ffree = 0;
 	buf->f_bavail = buf->f_bfree;
 
-	yaffs_GrossUnlock(dev);
 	return 0;
 }
 
@@ -1322,31 +1496,148 @@ static void yaffs_read_inode(struct inode *inode)
 	T(YAFFS_TRACE_OS,
 	  (KERN_DEBUG "yaffs_read_inode for %d\n", (int)inode->i_ino));
 
-	yaffs_GrossLock(dev);
+	yaffs_ReadLock(dev);
 	
 	obj = yaffs_FindObjectByNumber(dev, inode->i_ino);
 
 	yaffs_FillInodeFromObject(inode, obj);
 
-	yaffs_GrossUnlock(dev);
+	yaffs_ReadUnlock(dev);
 }
 
 static LIST_HEAD(yaffs_dev_list);
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+/*
+ * Metadata slab caches.
+ * Tnodes and objects for all mounts come from these caches. Each mount
+ * keeps the ones it frees on its free lists for reuse, and the shrinker
+ * hands those back to the slab when the VM runs short of memory.
+ */
+static kmem_cache_t *yaffs_tnode_cache;
+static kmem_cache_t *yaffs_compact_tnode_cache;
+static kmem_cache_t *yaffs_object_cache;
+static struct shrinker *yaffs_shrinker;
+
+static void *yaffs_SlabAllocTnode(yaffs_Device * dev, int compact)
+{
+	return kmem_cache_alloc(compact ? yaffs_compact_tnode_cache :
+				yaffs_tnode_cache, GFP_KERNEL);
+}
+
+static void yaffs_SlabFreeTnode(yaffs_Device * dev, void *tn, int compact)
+{
+	kmem_cache_free(compact ? yaffs_compact_tnode_cache :
+			yaffs_tnode_cache, tn);
+}
+
+static void *yaffs_SlabAllocObject(yaffs_Device * dev)
+{
+	return kmem_cache_alloc(yaffs_object_cache, GFP_KERNEL);
+}
+
+static void yaffs_SlabFreeObject(yaffs_Device * dev, void *obj)
+{
+	kmem_cache_free(yaffs_object_cache, obj);
+}
+
+/* Called by the VM with nr_to_scan 0 just to ask how much we could free.
+ * A mount that is busy is skipped rather than waited for, it may well be
+ * the one whose allocation got us here.
+ */
+static int yaffs_ShrinkMetadata(int nr_to_scan, unsigned int gfp_mask)
+{
+	struct list_head *item;
+	int nFreed = 0;
+	int nSpare = 0;
+
+	/* hold lock_kernel while traversing yaffs_dev_list */
+	lock_kernel();
+	list_for_each(item, &yaffs_dev_list) {
+		yaffs_Device *dev = list_entry(item, yaffs_Device, devList);
+
+		if (nr_to_scan > nFreed && !down_trylock(&dev->grossLock)) {
+			if (down_write_trylock(&dev->stateLock)) {
+				nFreed += yaffs_ShrinkFreeLists(dev,
+								nr_to_scan -
+								nFreed);
+				up_write(&dev->stateLock);
+			}
+			up(&dev->grossLock);
+		}
+		nSpare += dev->nFreeTnodes + dev->nFreeObjects;
+	}
+	unlock_kernel();
+
+	if (nFreed) {
+		kmem_cache_shrink(yaffs_tnode_cache);
+		kmem_cache_shrink(yaffs_object_cache);
+	}
+
+	return nSpare;
+}
+
+static void yaffs_DestroySlabCaches(void)
+{
+	if (yaffs_shrinker)
+		remove_shrinker(yaffs_shrinker);
+	if (yaffs_object_cache)
+		kmem_cache_destroy(yaffs_object_cache);
+	if (yaffs_compact_tnode_cache)
+		kmem_cache_destroy(yaffs_compact_tnode_cache);
+	if (yaffs_tnode_cache)
+		kmem_cache_destroy(yaffs_tnode_cache);
+}
+
+static int yaffs_CreateSlabCaches(void)
+{
+	yaffs_tnode_cache = kmem_cache_create("yaffs_tnode",
+					      sizeof(yaffs_Tnode), 0, 0,
+					      NULL, NULL);
+	yaffs_compact_tnode_cache = kmem_cache_create("yaffs_compact_tnode",
+						      YAFFS_COMPACT_TNODE_SIZE,
+						      0, 0, NULL, NULL);
+	yaffs_object_cache = kmem_cache_create("yaffs_object",
+					       sizeof(yaffs_Object), 0, 0,
+					       NULL, NULL);
+	if (!yaffs_tnode_cache || !yaffs_compact_tnode_cache ||
+	    !yaffs_object_cache) {
+		yaffs_DestroySlabCaches();
+		return -ENOMEM;
+	}
+
+	yaffs_shrinker = set_shrinker(DEFAULT_SEEKS, yaffs_ShrinkMetadata);
+
+	return 0;
+}
+#endif
+
 static void yaffs_put_super(struct super_block *sb)
 {
 	yaffs_Device *dev = yaffs_SuperToDevice(sb);
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_BACKGROUND_GC
+	yaffs_StopBackgroundGC(dev);
+#endif
+
 	yaffs_GrossLock(dev);
 
 	yaffs_FlushEntireDeviceCache(dev);
 
+	/* Lets the next mount skip the scan */
+	yaffs_CheckpointSave(dev);
+
 	if (dev->putSuperFunc) {
 		dev->putSuperFunc(sb);
 	}
 	yaffs_Deinitialise(dev);
 	yaffs_GrossUnlock(dev);
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_ERASE_AHEAD
+	/* yaffs_Deinitialise() has collected every queued erase */
+	nandmtd_DeinitialiseEraseAhead(dev);
+#endif
+
 	/* we assume this is protected by lock_kernel() in mount/umount */
 	list_del(&dev->devList);
 
@@ -1354,6 +1645,29 @@ static void yaffs_put_super(struct super_block *sb)
 }
 
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_SYNC
+static int yaffs_sync_fs(struct super_block *sb, int wait)
+{
+	yaffs_Device *dev = yaffs_SuperToDevice(sb);
+
+	T(YAFFS_TRACE_OS, (KERN_DEBUG "yaffs_sync_fs\n"));
+
+	yaffs_GrossLock(dev);
+
+	yaffs_FlushEntireDeviceCache(dev);
+
+	/* sync(2) calls us first without and then with wait set. One
+	 * checkpoint is enough, so write it on the second pass.
+	 */
+	if (wait)
+		yaffs_CheckpointSave(dev);
+
+	yaffs_GrossUnlock(dev);
+
+	return 0;
+}
+#endif
+
 static void yaffs_MTDPutSuper(struct super_block *sb)
 {
 
@@ -1515,7 +1829,7 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	dev->nChunksPerBlock = YAFFS_CHUNKS_PER_BLOCK;
 	dev->nBytesPerChunk = YAFFS_BYTES_PER_CHUNK;
 	dev->nReservedBlocks = 5;
-	dev->nShortOpCaches = 10;	/* Enable short op caching */
+	dev->nShortOpCaches = YAFFS_DEFAULT_SHORT_OP_CACHES;	/* Enable short op caching */
 
 	/* ... and the functions. */
 	if (yaffsVersion == 2) {
@@ -1527,6 +1841,7 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 		dev->queryNANDBlock = nandmtd2_QueryNANDBlock;
 		dev->spareBuffer = YMALLOC(mtd->oobsize);
 		dev->isYaffs2 = 1;
+		dev->useCheckpoint = 1;
 		dev->nBytesPerChunk = mtd->oobblock;
 		dev->nChunksPerBlock = mtd->erasesize / mtd->oobblock;
 		nBlocks = mtd->size / mtd->erasesize;
@@ -1548,9 +1863,21 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	/* ... and common functions */
 	dev->eraseBlockInNAND = nandmtd_EraseBlockInNAND;
 	dev->initialiseNAND = nandmtd_InitialiseNAND;
+#ifdef CONFIG_MOT_FEAT_YAFFS_ERASE_AHEAD
+	/* Erase dirty blocks in the NAND erase thread if the MTD can */
+	nandmtd_InitialiseEraseAhead(dev);
+#endif
 
 	dev->putSuperFunc = yaffs_MTDPutSuper;
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+	dev->allocTnode = yaffs_SlabAllocTnode;
+	dev->freeTnode = yaffs_SlabFreeTnode;
+	dev->allocObject = yaffs_SlabAllocObject;
+	dev->freeObject = yaffs_SlabFreeObject;
+	dev->compactTnodes = 1;
+#endif
+
 #ifndef CONFIG_YAFFS_DOES_ECC
 	dev->useNANDECC = 1;
 #endif
@@ -1564,6 +1891,10 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 	list_add_tail(&dev->devList, &yaffs_dev_list);
 
 	init_MUTEX(&dev->grossLock);
+	init_rwsem(&dev->stateLock);
+	spin_lock_init(&dev->tempBufferLock);
+	init_MUTEX(&dev->spareLock);
+	dev->nandBusyCallback = yaffs_NANDBusy;
 
 	yaffs_GrossLock(dev);
 
@@ -1590,7 +1921,7 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 					yaffs_Root(dev));
 
 	if (!inode)
-		return NULL;
+		goto fail;
 
 	inode->i_op = &yaffs_dir_inode_operations;
 	inode->i_fop = &yaffs_dir_operations;
@@ -1603,12 +1934,23 @@ static struct super_block *yaffs_internal_read_super(int yaffsVersion,
 
 	if (!root) {
 		iput(inode);
-		return NULL;
+		goto fail;
 	}
 	sb->s_root = root;
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_BACKGROUND_GC
+	yaffs_StartBackgroundGC(dev);
+#endif
+
 	T(YAFFS_TRACE_OS, ("yaffs_read_super: done\n"));
 	return sb;
+
+fail:
+#ifdef CONFIG_MOT_FEAT_YAFFS_ERASE_AHEAD
+	/* yaffs_GutsInitialise() drains its erases, none is in flight */
+	nandmtd_DeinitialiseEraseAhead(dev);
+#endif
+	return NULL;
 }
 
 
@@ -1698,29 +2040,82 @@ static char *yaffs_dump_dev(char *buf, yaffs_Device * dev)
 	buf += sprintf(buf, "nFreeTnodes........ %d\n", dev->nFreeTnodes);
 	buf += sprintf(buf, "nObjectsCreated.... %d\n", dev->nObjectsCreated);
 	buf += sprintf(buf, "nFreeObjects....... %d\n", dev->nFreeObjects);
+	buf += sprintf(buf, "nCompactTnodes..... %d\n", dev->nCompactTnodes);
+	buf += sprintf(buf, "tnodeBytes......... %u\n", dev->tnodeBytes);
+	buf += sprintf(buf, "objectBytes........ %u\n", dev->objectBytes);
+	buf += sprintf(buf, "freeListBytes...... %u\n", dev->freeListBytes);
+	buf += sprintf(buf, "tableBytes......... %u\n", dev->tableBytes);
 	buf += sprintf(buf, "nFreeChunks........ %d\n", dev->nFreeChunks);
+	buf +=
+	    sprintf(buf, "freeVerifyFails.... %d\n", dev->nFreeVerifyFailures);
 	buf += sprintf(buf, "nPageWrites........ %d\n", dev->nPageWrites);
 	buf += sprintf(buf, "nPageReads......... %d\n", dev->nPageReads);
 	buf += sprintf(buf, "nBlockErasures..... %d\n", dev->nBlockErasures);
+	buf += sprintf(buf, "erasesInFlight..... %d\n", dev->nErasesInFlight);
+	buf +=
+	    sprintf(buf, "inlineErase(us).... <64:%u 64:%u 128:%u 256:%u "
+		    "512:%u 1k:%u 2k:%u 4k+:%u\n", dev->eraseStalls[0],
+		    dev->eraseStalls[1], dev->eraseStalls[2],
+		    dev->eraseStalls[3], dev->eraseStalls[4],
+		    dev->eraseStalls[5], dev->eraseStalls[6],
+		    dev->eraseStalls[7]);
+	buf +=
+	    sprintf(buf, "allocWait(us)...... <64:%u 64:%u 128:%u 256:%u "
+		    "512:%u 1k:%u 2k:%u 4k+:%u\n", dev->allocStalls[0],
+		    dev->allocStalls[1], dev->allocStalls[2],
+		    dev->allocStalls[3], dev->allocStalls[4],
+		    dev->allocStalls[5], dev->allocStalls[6],
+		    dev->allocStalls[7]);
 	buf += sprintf(buf, "nGCCopies.......... %d\n", dev->nGCCopies);
 	buf +=
 	    sprintf(buf, "garbageCollections. %d\n", dev->garbageCollections);
 	buf +=
 	    sprintf(buf, "passiveGCs......... %d\n",
 		    dev->passiveGarbageCollections);
+	buf +=
+	    sprintf(buf, "bgGCSlices......... %d\n", dev->nBackgroundGCSlices);
+	buf +=
+	    sprintf(buf, "bgGCCopies......... %u\n", dev->nBackgroundGCCopies);
+	buf +=
+	    sprintf(buf, "bgGCTime(us)....... %u\n", dev->gcTimeBackground);
+	buf +=
+	    sprintf(buf, "fgGCCopies......... %u\n",
+		    dev->nGCCopies - dev->nBackgroundGCCopies);
+	buf +=
+	    sprintf(buf, "fgGCTime(us)....... %u\n", dev->gcTimeForeground);
+	buf += sprintf(buf, "fgGCMaxStall(us)... %u\n", dev->gcMaxStall);
+	buf +=
+	    sprintf(buf, "fgGCStalls(ms)..... <1:%u 1:%u 2:%u 4:%u 8:%u 16:%u "
+		    "32:%u 64+:%u\n", dev->gcStalls[0], dev->gcStalls[1],
+		    dev->gcStalls[2], dev->gcStalls[3], dev->gcStalls[4],
+		    dev->gcStalls[5], dev->gcStalls[6], dev->gcStalls[7]);
+	buf += sprintf(buf, "gcWatermark........ %d\n", dev->gcWatermark);
 	buf += sprintf(buf, "nRetriedWrites..... %d\n", dev->nRetriedWrites);
 	buf += sprintf(buf, "nRetireBlocks...... %d\n", dev->nRetiredBlocks);
 	buf += sprintf(buf, "eccFixed........... %d\n", dev->eccFixed);
 	buf += sprintf(buf, "eccUnfixed......... %d\n", dev->eccUnfixed);
 	buf += sprintf(buf, "tagsEccFixed....... %d\n", dev->tagsEccFixed);
 	buf += sprintf(buf, "tagsEccUnfixed..... %d\n", dev->tagsEccUnfixed);
-	buf += sprintf(buf, "cacheHits.......... %d\n", dev->cacheHits);
+	buf += sprintf(buf, "nShortOpCaches..... %d\n", dev->nShortOpCaches);
+	buf += sprintf(buf, "cacheHits.......... %d\n", Y_ATOMIC_READ(&dev->cacheHits));
+	buf += sprintf(buf, "cacheMisses........ %d\n", Y_ATOMIC_READ(&dev->cacheMisses));
+	buf += sprintf(buf, "cacheEvictions..... %d\n", dev->cacheEvictions);
+	buf += sprintf(buf, "cacheWritebacks.... %d\n", dev->cacheWritebacks);
+	buf += sprintf(buf, "cacheDirty......... %d\n", dev->srDirty);
 	buf += sprintf(buf, "nDeletedFiles...... %d\n", dev->nDeletedFiles);
 	buf += sprintf(buf, "nUnlinkedFiles..... %d\n", dev->nUnlinkedFiles);
 	buf +=
 	    sprintf(buf, "nBackgroudDeletions %d\n", dev->nBackgroundDeletions);
 	buf += sprintf(buf, "useNANDECC......... %d\n", dev->useNANDECC);
 	buf += sprintf(buf, "isYaffs2........... %d\n", dev->isYaffs2);
+	buf += sprintf(buf, "mountedFrom........ %s\n",
+		       dev->mountFromCheckpoint ? "checkpoint" : "scan");
+	buf += sprintf(buf, "mountTime.......... %u us\n", dev->mountTime);
+	buf += sprintf(buf, "isCheckpointed..... %d\n", dev->isCheckpointed);
+	buf += sprintf(buf, "blocksInCheckpoint. %d\n", dev->blocksInCheckpoint);
+	buf += sprintf(buf, "nCheckpointSaves... %d\n", dev->nCheckpointSaves);
+	buf += sprintf(buf, "checkpointSaveTime. %u us\n",
+		       dev->checkpointSaveTime);
 
 	return buf;
 }
@@ -1803,12 +2198,22 @@ static int __init init_yaffs_fs(void)
 	  ("yaffs " __DATE__ " " __TIME__ " Installing. \n"));
 #endif
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+	error = yaffs_CreateSlabCaches();
+	if (error) {
+		return error;
+	}
+#endif
+
 	/* Install the proc_fs entry */
 	my_proc_entry = create_proc_read_entry("yaffs",
 					       S_IRUGO | S_IFREG,
 					       &proc_root,
 					       yaffs_proc_read, NULL);
 	if (!my_proc_entry) {
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+		yaffs_DestroySlabCaches();
+#endif
 		return -ENOMEM;
 	}
 
@@ -1835,6 +2240,9 @@ static int __init init_yaffs_fs(void)
 			}
 			fsinst++;
 		}
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+		yaffs_DestroySlabCaches();
+#endif
 	}
 
 	return error;
@@ -1864,6 +2272,9 @@ static void __exit exit_yaffs_fs(void)
 		fsinst++;
 	}
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+	yaffs_DestroySlabCaches();
+#endif
 }
 
 /*-------------------------- YAFFS specific option parser -----------------------*/
@@ -1872,6 +2283,11 @@ static void __exit exit_yaffs_fs(void)
 enum { 
 #ifdef CONFIG_MOT_FEAT_YAFFS_SHREDDER
         OptShred,
+#endif
+        OptCache,
+        OptNoChkPoint,
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+        OptNoCompact,
 #endif
         OptErr
 };
@@ -1879,6 +2295,11 @@ enum {
 static match_table_t tokens = {
 #ifdef CONFIG_MOT_FEAT_YAFFS_SHREDDER
         {OptShred, "shred"},
+#endif
+        {OptCache, "cache=%u"},
+        {OptNoChkPoint, "nochkpoint"},
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+        {OptNoCompact, "nocompact"},
 #endif
         {OptErr, NULL}
 };
@@ -1888,6 +2309,7 @@ static int parse_options (char * options,
 
         char * p;
         substring_t args[MAX_OPT_ARGS];
+        int option;
 
         if (!options) {
                 return 1;
@@ -1905,6 +2327,24 @@ static int parse_options (char * options,
                 case OptShred:
                         set_opt (yaffsDevice->sMountOptions, SHRED);
                         break; 
+#endif
+                case OptCache:
+                        /* Number of short op cache chunks, 0 turns it off */
+                        if (match_int(&args[0], &option) || option < 0)
+                                return 0;
+                        if (option > YAFFS_MAX_SHORT_OP_CACHES)
+                                option = YAFFS_MAX_SHORT_OP_CACHES;
+                        yaffsDevice->nShortOpCaches = option;
+                        break;
+                case OptNoChkPoint:
+                        /* Always scan, and don't write checkpoints */
+                        yaffsDevice->useCheckpoint = 0;
+                        break;
+#ifdef CONFIG_MOT_FEAT_YAFFS_SLAB
+                case OptNoCompact:
+                        /* Full size tnodes even for small files */
+                        yaffsDevice->compactTnodes = 0;
+                        break;
 #endif
                 default:
                         T(YAFFS_TRACE_ALWAYS,("WARNING: Ignoring Invalid YAFFS option: %s \n", p));
@@ -28,6 +28,15 @@
  *              Added BBT support to YAFFS2
  * 12-15-2006   Motorola  Do not shred during mount
  * 01-23-2007   Do not shred Object Header pages
+ * 10-17-2026   Motorola  Hashed per-directory name index for lookups
+ * 10-17-2026   Motorola  Let readers run while the writer waits on NAND
+ * 10-17-2026   Motorola  Incremental background GC and GC statistics
+ * 10-17-2026   Motorola  Index GC candidate blocks by live chunk count
+ * 10-17-2026   Motorola  Hashed LRU short op cache with sorted write back
+ * 10-17-2026   Motorola  Checkpointed mount
+ * 10-17-2026   Motorola  Pluggable tnode/object allocator, compact tnodes
+ * 10-17-2026   Motorola  Lock free statfs, optional free chunk verification
+ * 10-17-2026   Motorola  Asynchronous erase of dirty blocks, erase wait histograms
  */
 
 
@@ -41,6 +50,7 @@ const char *yaffs_guts_c_version =
 #include "yaffs_tagsvalidity.h"
 
 #include "yaffs_tagscompat.h"
+#include "yaffs_checkptrw.h"
 
 #ifdef CONFIG_YAFFS_WINCE
 void yfsd_LockYAFFS(BOOL fsLockOnly);
@@ -49,6 +59,10 @@ void yfsd_UnlockYAFFS(BOOL fsLockOnly);
 
 #define YAFFS_PASSIVE_GC_CHUNKS 2
 
+#ifndef Y_CLOCK_US
+#define Y_CLOCK_US() 0
+#endif
+
 #include "yaffs_ecc.h"
 
 
@@ -76,6 +90,7 @@ static Y_INLINE int yaffs_QueryInitialBlockState(yaffs_Device * dev,
 						 unsigned *sequenceNumber);
 /* Robustification (if it ever comes about...) */
 static void yaffs_RetireBlock(yaffs_Device * dev, int blockInNAND);
+static void yaffs_UpdateGCIndex(yaffs_Device * dev, int blockNo);
 static void yaffs_HandleWriteChunkError(yaffs_Device * dev, int chunkInNAND);
 static void yaffs_HandleWriteChunkOk(yaffs_Device * dev, int chunkInNAND,
 				     const __u8 * data,
@@ -100,6 +115,8 @@ static void yaffs_AddObjectToDirectory(yaffs_Object * directory,
 static int yaffs_UpdateObjectHeader(yaffs_Object * in, const YCHAR * name,
 				    int force, int isShrink, int shadows);
 static void yaffs_RemoveObjectFromDirectory(yaffs_Object * obj);
+static void yaffs_IndexObjectName(yaffs_Object * obj);
+static void yaffs_FreeNameIndex(yaffs_Object * directory);
 static int yaffs_CheckStructures(void);
 static int yaffs_DeleteWorker(yaffs_Object * in, yaffs_Tnode * tn, __u32 level,
 			      int chunkOffset, int *limit);
@@ -126,6 +143,16 @@ static int yaffs_AllocateChunk(yaffs_Device * dev, int useReserve);
 
 static void yaffs_VerifyFreeChunks(yaffs_Device * dev);
 
+/* The full block scan cross-check is only run when asked for */
+#define yaffs_CheckFreeChunks(dev) \
+	do { \
+		if (yaffs_traceMask & YAFFS_TRACE_VERIFY) \
+			yaffs_VerifyFreeChunks(dev); \
+	} while (0)
+
+static void yaffs_InvalidateCheckpoint(yaffs_Device * dev);
+static int yaffs_CheckpointBlocksReserved(yaffs_Device * dev);
+
 #ifdef YAFFS_PARANOID
 static int yaffs_CheckFileSanity(yaffs_Object * in);
 #else
@@ -167,6 +194,8 @@ static Y_INLINE int yaffs_WriteChunkWithTagsToNAND(yaffs_Device * dev,
 						   const __u8 * buffer,
 						   yaffs_ExtendedTags * tags)
 {
+	int result;
+
 	chunkInNAND -= dev->chunkOffset;
 
 	if (tags) {
@@ -185,14 +214,22 @@ static Y_INLINE int yaffs_WriteChunkWithTagsToNAND(yaffs_Device * dev,
 		YBUG();
 	}
 
+	if (dev->nandBusyCallback)
+		dev->nandBusyCallback(dev, 1);
+
 	if (dev->writeChunkWithTagsToNAND)
-		return dev->writeChunkWithTagsToNAND(dev, chunkInNAND, buffer,
-						     tags);
+		result = dev->writeChunkWithTagsToNAND(dev, chunkInNAND, buffer,
+						       tags);
 	else
-		return yaffs_TagsCompatabilityWriteChunkWithTagsToNAND(dev,
-								       chunkInNAND,
-								       buffer,
-								       tags);
+		result = yaffs_TagsCompatabilityWriteChunkWithTagsToNAND(dev,
+									 chunkInNAND,
+									 buffer,
+									 tags);
+
+	if (dev->nandBusyCallback)
+		dev->nandBusyCallback(dev, 0);
+
+	return result;
 }
 
 static Y_INLINE int yaffs_MarkBlockBad(yaffs_Device * dev, int blockNo)
@@ -227,11 +264,19 @@ static int yaffs_EraseBlockInNAND(struct yaffs_DeviceStruct *dev,
 	blockInNAND -= dev->blockOffset;
 
 	dev->nBlockErasures++;
+
+	if (dev->nandBusyCallback)
+		dev->nandBusyCallback(dev, 1);
+
 	result = dev->eraseBlockInNAND(dev, blockInNAND);
 
 	/* If at first we don't succeed, try again *once*.*/
 	if (!result)
 		result = dev->eraseBlockInNAND(dev, blockInNAND);	
+
+	if (dev->nandBusyCallback)
+		dev->nandBusyCallback(dev, 0);
+
 	return result;
 }
 
@@ -247,6 +292,11 @@ static int yaffs_InitialiseNAND(struct yaffs_DeviceStruct *dev)
 static __u8 *yaffs_GetTempBuffer(yaffs_Device * dev, int lineNo)
 {
 	int i, j;
+
+	/* Readers can hold temp buffers while the writer is busy on NAND */
+#ifdef __KERNEL__
+	spin_lock(&dev->tempBufferLock);
+#endif
 	for (i = 0; i < YAFFS_N_TEMP_BUFFERS; i++) {
 		if (dev->tempBuffer[i].line == 0) {
 			dev->tempBuffer[i].line = lineNo;
@@ -256,10 +306,16 @@ static __u8 *yaffs_GetTempBuffer(yaffs_Device * dev, int lineNo)
 					dev->tempBuffer[j].maxLine =
 					    dev->tempBuffer[j].line;
 			}
+#ifdef __KERNEL__
+			spin_unlock(&dev->tempBufferLock);
+#endif
 
 			return dev->tempBuffer[i].buffer;
 		}
 	}
+#ifdef __KERNEL__
+	spin_unlock(&dev->tempBufferLock);
+#endif
 
 	T(YAFFS_TRACE_BUFFERS,
 	  (TSTR("Out of temp buffers at line %d, other held by lines:"),
@@ -285,7 +341,13 @@ static void yaffs_ReleaseTempBuffer(yaffs_Device * dev, __u8 * buffer,
 	int i;
 	for (i = 0; i < YAFFS_N_TEMP_BUFFERS; i++) {
 		if (dev->tempBuffer[i].buffer == buffer) {
+#ifdef __KERNEL__
+			spin_lock(&dev->tempBufferLock);
+			dev->tempBuffer[i].line = 0;
+			spin_unlock(&dev->tempBufferLock);
+#else
 			dev->tempBuffer[i].line = 0;
+#endif
 			return;
 		}
 	}
@@ -427,6 +489,8 @@ static int yaffs_WriteNewChunkWithTagsToNAND(struct yaffs_DeviceStruct *dev,
 	int writeOk = 1;
 	int attempts = 0;
 
+	yaffs_InvalidateCheckpoint(dev);
+
 	do {
 		chunk = yaffs_AllocateChunk(dev, useReserve);
 
@@ -479,10 +543,13 @@ static int yaffs_WriteNewChunkWithTagsToNAND(struct yaffs_DeviceStruct *dev,
 static void yaffs_RetireBlock(yaffs_Device * dev, int blockInNAND)
 {
 
+	yaffs_InvalidateCheckpoint(dev);
+
 	yaffs_MarkBlockBad(dev, blockInNAND);
 
 	yaffs_GetBlockInfo(dev, blockInNAND)->blockState =
 	    YAFFS_BLOCK_STATE_DEAD;
+	yaffs_UpdateGCIndex(dev, blockInNAND);
 
 	dev->nRetiredBlocks++;
 }
@@ -537,8 +604,36 @@ static __u16 yaffs_CalcNameSum(const YCHAR * name)
 	return sum;
 }
 
+/* A 32 bit FNV-1a hash of the name. Unlike the sum it is not stored on NAND,
+ * it only lets name look-ups skip reading the object header of children
+ * whose sum happens to match.
+ */
+static __u32 yaffs_CalcNameHash(const YCHAR * name)
+{
+	__u32 hash = 2166136261U;
+	int i = 0;
+
+	YUCHAR *bname = (YUCHAR *) name;
+	if (bname) {
+		while ((*bname) && (i < YAFFS_MAX_NAME_LENGTH)) {
+#ifdef CONFIG_YAFFS_CASE_INSENSITIVE
+			hash ^= yaffs_toupper(*bname);
+#else
+			hash ^= *bname;
+#endif
+			hash *= 16777619U;
+			i++;
+			bname++;
+		}
+	}
+	return hash;
+}
+
 static void yaffs_SetObjectName(yaffs_Object * obj, const YCHAR * name)
 {
+	/* The sum is the name index key, so take it out while it changes */
+	list_del_init(&obj->nameLink);
+
 #ifdef CONFIG_YAFFS_SHORT_NAMES_IN_RAM
 	if (name && yaffs_strlen(name) <= YAFFS_SHORT_NAME_LENGTH) {
 		yaffs_strcpy(obj->shortName, name);
@@ -547,6 +642,9 @@ static void yaffs_SetObjectName(yaffs_Object * obj, const YCHAR * name)
 	}
 #endif
 	obj->sum = yaffs_CalcNameSum(name);
+	obj->nameHash = yaffs_CalcNameHash(name);
+
+	yaffs_IndexObjectName(obj);
 }
 
 /*-------------------- TNODES -------------------
@@ -595,6 +693,7 @@ static int yaffs_CreateTnodes(yaffs_Device * dev, int nTnodes)
 	dev->freeTnodes = newTnodes;
 	dev->nFreeTnodes += nTnodes;
 	dev->nTnodesCreated += nTnodes;
+	dev->freeListBytes += nTnodes * sizeof(yaffs_Tnode);
 
 	/* Now add this bunch of tnodes to a list for freeing up.
 	 * NB If we can't add this to the management list it isn't fatal
@@ -625,6 +724,16 @@ static yaffs_Tnode *yaffs_GetTnode(yaffs_Device * dev)
 	yaffs_Tnode *tn = NULL;
 
 	/* If there are none left make more */
+	if (!dev->freeTnodes && dev->allocTnode) {
+		tn = dev->allocTnode(dev, 0);
+		if (tn) {
+			dev->nTnodesCreated++;
+			dev->tnodeBytes += sizeof(yaffs_Tnode);
+			memset(tn, 0, sizeof(yaffs_Tnode));
+		}
+		return tn;
+	}
+
 	if (!dev->freeTnodes) {
 		yaffs_CreateTnodes(dev, YAFFS_ALLOCATION_NTNODES);
 	}
@@ -640,6 +749,8 @@ static yaffs_Tnode *yaffs_GetTnode(yaffs_Device * dev)
 #endif
 		dev->freeTnodes = dev->freeTnodes->internal[0];
 		dev->nFreeTnodes--;
+		dev->freeListBytes -= sizeof(yaffs_Tnode);
+		dev->tnodeBytes += sizeof(yaffs_Tnode);
 		/* zero out */
 		memset(tn, 0, sizeof(yaffs_Tnode));
 	}
@@ -662,7 +773,81 @@ static void yaffs_FreeTnode(yaffs_Device * dev, yaffs_Tnode * tn)
 		tn->internal[0] = dev->freeTnodes;
 		dev->freeTnodes = tn;
 		dev->nFreeTnodes++;
+		dev->tnodeBytes -= sizeof(yaffs_Tnode);
+		dev->freeListBytes += sizeof(yaffs_Tnode);
+	}
+}
+
+/* GetCompactTnode gets a clean compact tnode, only possible with allocTnode */
+static yaffs_Tnode *yaffs_GetCompactTnode(yaffs_Device * dev)
+{
+	yaffs_Tnode *tn = dev->allocTnode(dev, 1);
+
+	if (tn) {
+		dev->nCompactTnodes++;
+		dev->tnodeBytes += YAFFS_COMPACT_TNODE_SIZE;
+		memset(tn, 0, YAFFS_COMPACT_TNODE_SIZE);
+	}
+	return tn;
+}
+
+static void yaffs_FreeCompactTnode(yaffs_Device * dev, yaffs_Tnode * tn)
+{
+	dev->freeTnode(dev, tn, 1);
+	dev->nCompactTnodes--;
+	dev->tnodeBytes -= YAFFS_COMPACT_TNODE_SIZE;
+}
+
+/* FreeTnodeTree frees a file's whole tnode tree. Used when the file has no
+ * data chunks left, so there are no chunks to clean up.
+ */
+static void yaffs_FreeTnodeWorker(yaffs_Device * dev, yaffs_Tnode * tn,
+				  int level)
+{
+	int i;
+
+	if (tn && level > 0) {
+		for (i = 0; i < YAFFS_NTNODES_INTERNAL; i++) {
+			yaffs_FreeTnodeWorker(dev, tn->internal[i], level - 1);
+		}
+	}
+	yaffs_FreeTnode(dev, tn);
+}
+
+static void yaffs_FreeTnodeTree(yaffs_Device * dev,
+				yaffs_FileStructure * fStruct)
+{
+	if (fStruct->compactTop) {
+		yaffs_FreeCompactTnode(dev, fStruct->top);
+	} else {
+		yaffs_FreeTnodeWorker(dev, fStruct->top, fStruct->topLevel);
+	}
+	fStruct->top = NULL;
+	fStruct->topLevel = 0;
+	fStruct->compactTop = 0;
+}
+
+/* ShrinkFreeTnodes hands up to nToFree spare tnodes back to freeTnode */
+static int yaffs_ShrinkFreeTnodes(yaffs_Device * dev, int nToFree)
+{
+	yaffs_Tnode *tn;
+	int n = 0;
+
+	if (!dev->freeTnode) {
+		return 0;
+	}
+
+	while (n < nToFree && dev->freeTnodes) {
+		tn = dev->freeTnodes;
+		dev->freeTnodes = tn->internal[0];
+		dev->nFreeTnodes--;
+		dev->nTnodesCreated--;
+		dev->freeListBytes -= sizeof(yaffs_Tnode);
+		dev->freeTnode(dev, tn, 0);
+		n++;
 	}
+
+	return n;
 }
 
 static void yaffs_DeinitialiseTnodes(yaffs_Device * dev)
@@ -670,6 +855,11 @@ static void yaffs_DeinitialiseTnodes(yaffs_Device * dev)
 	/* Free the list of allocated tnodes */
 	yaffs_TnodeList *tmp;
 
+	/* With an allocator, the objects have already put the tnodes
+	 * in their files back on the free list.
+	 */
+	yaffs_ShrinkFreeTnodes(dev, dev->nFreeTnodes);
+
 	while (dev->allocatedTnodeList) {
 		tmp = dev->allocatedTnodeList->next;
 
@@ -679,6 +869,7 @@ static void yaffs_DeinitialiseTnodes(yaffs_Device * dev)
 
 	}
 
+	dev->freeListBytes -= dev->nFreeTnodes * sizeof(yaffs_Tnode);
 	dev->freeTnodes = NULL;
 	dev->nFreeTnodes = 0;
 }
@@ -689,7 +880,16 @@ static void yaffs_InitialiseTnodes(yaffs_Device * dev)
 	dev->freeTnodes = NULL;
 	dev->nFreeTnodes = 0;
 	dev->nTnodesCreated = 0;
+	dev->nCompactTnodes = 0;
+	dev->tnodeBytes = 0;
+
+}
 
+/* Level0Entries is how many entries the file's level 0 tnodes have */
+static Y_INLINE int yaffs_Level0Entries(yaffs_FileStructure * fStruct)
+{
+	return fStruct->compactTop ? YAFFS_NTNODES_COMPACT :
+	    YAFFS_NTNODES_LEVEL0;
 }
 
 /* ------------------- End of individual tnode manipulation -----------------*/
@@ -733,6 +933,11 @@ static yaffs_Tnode *yaffs_FindLevel0Tnode(yaffs_Device * dev,
 		return NULL;
 	}
 
+	/* A compact top only covers the first few chunks */
+	if (fStruct->compactTop && chunkId >= YAFFS_NTNODES_COMPACT) {
+		return NULL;
+	}
+
 	/* Traverse down to level 0 */
 	while (level > 0 && tn) {
 		tn = tn->
@@ -789,6 +994,35 @@ static yaffs_Tnode *yaffs_AddOrFindLevel0Tnode(yaffs_Device * dev,
 		requiredTallness++;
 	}
 
+	if (fStruct->compactTop && chunkId >= YAFFS_NTNODES_COMPACT) {
+		/* Outgrown the compact top, swap it for a full tnode */
+		tn = yaffs_GetTnode(dev);
+		if (!tn) {
+			return NULL;
+		}
+		memcpy(tn->level0, fStruct->top->level0,
+		       YAFFS_COMPACT_TNODE_SIZE);
+		yaffs_FreeCompactTnode(dev, fStruct->top);
+		fStruct->top = tn;
+		fStruct->compactTop = 0;
+	}
+
+	if (!fStruct->top && requiredTallness == 0) {
+		/* First chunk in a small file. The top is only made now so
+		 * empty files cost no tnodes.
+		 */
+		if (dev->compactTnodes && dev->allocTnode &&
+		    chunkId < YAFFS_NTNODES_COMPACT) {
+			fStruct->top = yaffs_GetCompactTnode(dev);
+			fStruct->compactTop = (fStruct->top != NULL);
+		} else {
+			fStruct->top = yaffs_GetTnode(dev);
+		}
+		if (!fStruct->top) {
+			return NULL;
+		}
+		fStruct->topLevel = 0;
+	}
 
 	if (requiredTallness > fStruct->topLevel) {
 		/* Not tall enough,gotta make the tree taller */
@@ -907,8 +1141,8 @@ static int yaffs_DeleteWorker(yaffs_Object * in, yaffs_Tnode * tn, __u32 level,
 		} else if (level == 0) {
 			int hitLimit = 0;
 
-			for (i = YAFFS_NTNODES_LEVEL0 - 1; i >= 0 && !hitLimit;
-			     i--) {
+			for (i = yaffs_Level0Entries(&in->variant.fileVariant) - 1;
+			     i >= 0 && !hitLimit; i--) {
 				if (tn->level0[i]) {
 
 					chunkInInode =
@@ -926,6 +1160,12 @@ static int yaffs_DeleteWorker(yaffs_Object * in, yaffs_Tnode * tn, __u32 level,
 								   in->objectId,
 								   chunkInInode);
 
+					/* Unhook the chunk before deleting it, the
+					 * delete may erase the block and readers
+					 * can run while that happens.
+					 */
+					tn->level0[i] = 0;
+
 					if (foundChunk > 0) {
 						yaffs_DeleteChunk(dev,
 								  foundChunk, 1,
@@ -939,8 +1179,6 @@ static int yaffs_DeleteWorker(yaffs_Object * in, yaffs_Tnode * tn, __u32 level,
 						}
 
 					}
-
-					tn->level0[i] = 0;
 				}
 
 			}
@@ -962,10 +1200,14 @@ static void yaffs_SoftDeleteChunk(yaffs_Device * dev, int chunk)
 	T(YAFFS_TRACE_DELETION, (TSTR("soft delete chunk %d" TENDSTR), chunk));
 
 	theBlock = yaffs_GetBlockInfo(dev, chunk / dev->nChunksPerBlock);
-	if (theBlock) {
+	if (theBlock && theBlock->blockState != YAFFS_BLOCK_STATE_COLLECTING) {
 		theBlock->softDeletions++;
 		dev->nFreeChunks++;
+		yaffs_UpdateGCIndex(dev, chunk / dev->nChunksPerBlock);
 	}
+	/* A block part way through an incremental GC has already had its
+	 * soft deletions taken off. The GC counts this chunk when it drops it.
+	 */
 }
 
 /* SoftDeleteWorker scans backwards through the tnode tree and soft deletes all the chunks in the file.
@@ -1010,7 +1252,8 @@ static int yaffs_SoftDeleteWorker(yaffs_Object * in, yaffs_Tnode * tn,
 			return (allDone) ? 1 : 0;
 		} else if (level == 0) {
 
-			for (i = YAFFS_NTNODES_LEVEL0 - 1; i >= 0; i--) {
+			for (i = yaffs_Level0Entries(&in->variant.fileVariant) - 1;
+			     i >= 0; i--) {
 				if (tn->level0[i]) {
 					/* Note this does not find the real chunk, only the chunk group.
 					 * We make an assumption that a chunk group is not larger than 
@@ -1041,9 +1284,8 @@ static void yaffs_SoftDeleteFile(yaffs_Object * obj)
 	    obj->variantType == YAFFS_OBJECT_TYPE_FILE && !obj->softDeleted) {
 		if (obj->nDataChunks <= 0) {
 			/* Empty file with no duplicate object headers, just delete it immediately */
-			yaffs_FreeTnode(obj->myDev,
-					obj->variant.fileVariant.top);
-			obj->variant.fileVariant.top = NULL;
+			yaffs_FreeTnodeTree(obj->myDev,
+					    &obj->variant.fileVariant);
 			T(YAFFS_TRACE_TRACING,
 			  (TSTR("yaffs: Deleting empty file %d" TENDSTR),
 			   obj->objectId));
@@ -1143,6 +1385,23 @@ static int yaffs_PruneFileStructure(yaffs_Device * dev,
 		}
 	}
 
+	/* If the file has shrunk back into the compact range, swap the top */
+	if (dev->compactTnodes && fStruct->topLevel == 0 && fStruct->top &&
+	    !fStruct->compactTop) {
+		for (i = YAFFS_NTNODES_COMPACT;
+		     i < YAFFS_NTNODES_LEVEL0 && !fStruct->top->level0[i]; i++) {
+		}
+
+		if (i == YAFFS_NTNODES_LEVEL0 &&
+		    (tn = yaffs_GetCompactTnode(dev)) != NULL) {
+			memcpy(tn->level0, fStruct->top->level0,
+			       YAFFS_COMPACT_TNODE_SIZE);
+			yaffs_FreeTnode(dev, fStruct->top);
+			fStruct->top = tn;
+			fStruct->compactTop = 1;
+		}
+	}
+
 	return YAFFS_OK;
 }
 
@@ -1179,6 +1438,7 @@ static int yaffs_CreateFreeObjects(yaffs_Device * dev, int nObjects)
 	dev->freeObjects = newObjects;
 	dev->nFreeObjects += nObjects;
 	dev->nObjectsCreated += nObjects;
+	dev->freeListBytes += nObjects * sizeof(yaffs_Object);
 
 	/* Now add this bunch of Objects to a list for freeing up. */
 
@@ -1202,7 +1462,16 @@ static yaffs_Object *yaffs_AllocateEmptyObject(yaffs_Device * dev)
 	yaffs_Object *tn = NULL;
 
 	/* If there are none left make more */
-	if (!dev->freeObjects) {
+	if (!dev->freeObjects && dev->allocObject) {
+		tn = dev->allocObject(dev);
+		if (tn) {
+			dev->nObjectsCreated++;
+			dev->freeListBytes += sizeof(yaffs_Object);
+			tn->siblings.next = NULL;
+			dev->freeObjects = tn;
+			dev->nFreeObjects++;
+		}
+	} else if (!dev->freeObjects) {
 		yaffs_CreateFreeObjects(dev, YAFFS_ALLOCATION_NOBJECTS);
 	}
 
@@ -1211,6 +1480,8 @@ static yaffs_Object *yaffs_AllocateEmptyObject(yaffs_Device * dev)
 		dev->freeObjects =
 		    (yaffs_Object *) (dev->freeObjects->siblings.next);
 		dev->nFreeObjects--;
+		dev->freeListBytes -= sizeof(yaffs_Object);
+		dev->objectBytes += sizeof(yaffs_Object);
 
 		/* Now sweeten it up... */
 
@@ -1221,6 +1492,8 @@ static yaffs_Object *yaffs_AllocateEmptyObject(yaffs_Device * dev)
 		INIT_LIST_HEAD(&(tn->hardLinks));
 		INIT_LIST_HEAD(&(tn->hashLink));
 		INIT_LIST_HEAD(&tn->siblings);
+		INIT_LIST_HEAD(&tn->nameLink);
+		INIT_LIST_HEAD(&tn->dirtyCache);
 
 		/* Add it to the lost and found directory.
 		 * NB Can't put root or lostNFound in lostNFound so
@@ -1291,6 +1564,41 @@ static void yaffs_FreeObject(yaffs_Object * tn)
 	tn->siblings.next = (struct list_head *)(dev->freeObjects);
 	dev->freeObjects = tn;
 	dev->nFreeObjects++;
+	dev->objectBytes -= sizeof(yaffs_Object);
+	dev->freeListBytes += sizeof(yaffs_Object);
+}
+
+/* ShrinkFreeObjects hands up to nToFree spare objects back to freeObject */
+static int yaffs_ShrinkFreeObjects(yaffs_Device * dev, int nToFree)
+{
+	yaffs_Object *obj;
+	int n = 0;
+
+	if (!dev->freeObject) {
+		return 0;
+	}
+
+	while (n < nToFree && dev->freeObjects) {
+		obj = dev->freeObjects;
+		dev->freeObjects = (yaffs_Object *) (obj->siblings.next);
+		dev->nFreeObjects--;
+		dev->nObjectsCreated--;
+		dev->freeListBytes -= sizeof(yaffs_Object);
+		dev->freeObject(dev, obj);
+		n++;
+	}
+
+	return n;
+}
+
+/* ShrinkFreeLists hands up to nToFree spare tnodes and objects back to the
+ * OS allocator. Returns how many were freed. Does nothing without one.
+ */
+int yaffs_ShrinkFreeLists(yaffs_Device * dev, int nToFree)
+{
+	int n = yaffs_ShrinkFreeTnodes(dev, nToFree);
+
+	return n + yaffs_ShrinkFreeObjects(dev, nToFree - n);
 }
 
 #ifdef __KERNEL__
@@ -1309,6 +1617,36 @@ static void yaffs_DeinitialiseObjects(yaffs_Device * dev)
 	/* Free the list of allocated Objects */
 
 	yaffs_ObjectList *tmp;
+	yaffs_Object *obj;
+	struct list_head *i;
+	struct list_head *n;
+	int bucket;
+
+	/* Directory name indexes and symlink aliases are allocated separately.
+	 * With an OS allocator the objects and their tnodes are too.
+	 */
+	for (bucket = 0; bucket < YAFFS_NOBJECT_BUCKETS; bucket++) {
+		list_for_each_safe(i, n, &dev->objectBucket[bucket].list) {
+			obj = list_entry(i, yaffs_Object, hashLink);
+			yaffs_FreeNameIndex(obj);
+			if (obj->variantType == YAFFS_OBJECT_TYPE_SYMLINK &&
+			    obj->variant.symLinkVariant.alias) {
+				YFREE(obj->variant.symLinkVariant.alias);
+				obj->variant.symLinkVariant.alias = NULL;
+			}
+			if (dev->allocTnode &&
+			    obj->variantType == YAFFS_OBJECT_TYPE_FILE) {
+				yaffs_FreeTnodeTree(dev,
+						    &obj->variant.fileVariant);
+			}
+			if (dev->allocObject) {
+				list_del_init(&obj->hashLink);
+				dev->freeObject(dev, obj);
+				dev->nObjectsCreated--;
+			}
+		}
+	}
+	yaffs_ShrinkFreeObjects(dev, dev->nFreeObjects);
 
 	while (dev->allocatedObjectList) {
 		tmp = dev->allocatedObjectList->next;
@@ -1318,6 +1656,7 @@ static void yaffs_DeinitialiseObjects(yaffs_Device * dev)
 		dev->allocatedObjectList = tmp;
 	}
 
+	dev->freeListBytes -= dev->nFreeObjects * sizeof(yaffs_Object);
 	dev->freeObjects = NULL;
 	dev->nFreeObjects = 0;
 }
@@ -1329,6 +1668,8 @@ static void yaffs_InitialiseObjects(yaffs_Device * dev)
 	dev->allocatedObjectList = NULL;
 	dev->freeObjects = NULL;
 	dev->nFreeObjects = 0;
+	dev->nObjectsCreated = 0;
+	dev->objectBytes = 0;
 
 	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++) {
 		INIT_LIST_HEAD(&dev->objectBucket[i].list);
@@ -1479,8 +1820,8 @@ yaffs_Object *yaffs_CreateNewObject(yaffs_Device * dev, int number,
 			theObject->variant.fileVariant.scannedFileSize = 0;
 			theObject->variant.fileVariant.shrinkSize = 0xFFFFFFFF;	/* max __u32 */
 			theObject->variant.fileVariant.topLevel = 0;
-			theObject->variant.fileVariant.top =
-			    yaffs_GetTnode(dev);
+			theObject->variant.fileVariant.compactTop = 0;
+			theObject->variant.fileVariant.top = NULL;
 			break;
 		case YAFFS_OBJECT_TYPE_DIRECTORY:
 			INIT_LIST_HEAD(&theObject->variant.directoryVariant.
@@ -1789,10 +2130,30 @@ static int yaffs_InitialiseBlocks(yaffs_Device * dev, int nBlocks)
 	}
 	else
 		dev->chunkBitsAlt = 0;
+
+	dev->gcLinks = YMALLOC(nBlocks * sizeof(yaffs_GCLink));
+	if(!dev->gcLinks){
+		dev->gcLinks = YMALLOC_ALT(nBlocks * sizeof(yaffs_GCLink));
+		dev->gcLinksAlt = 1;
+	}
+	else
+		dev->gcLinksAlt = 0;
+	dev->gcBuckets = YMALLOC(dev->nChunksPerBlock * sizeof(int));
 	
-	if (dev->blockInfo && dev->chunkBits) {
+	if (dev->blockInfo && dev->chunkBits &&
+	    dev->gcLinks && dev->gcBuckets) {
+		int i;
+
 		memset(dev->blockInfo, 0, nBlocks * sizeof(yaffs_BlockInfo));
 		memset(dev->chunkBits, 0, dev->chunkBitmapStride * nBlocks);
+		for (i = 0; i < nBlocks; i++) {
+			dev->gcLinks[i].next = -1;
+			dev->gcLinks[i].prev = -1;
+			dev->gcLinks[i].bucket = -1;
+		}
+		for (i = 0; i < dev->nChunksPerBlock; i++) {
+			dev->gcBuckets[i] = -1;
+		}
 		return YAFFS_OK;
 	}
 
@@ -1816,12 +2177,108 @@ static void yaffs_DeinitialiseBlocks(yaffs_Device * dev)
 		YFREE(dev->chunkBits);
 	dev->chunkBitsAlt = 0;
 	dev->chunkBits = NULL;
+
+	if(dev->gcLinksAlt)
+		YFREE_ALT(dev->gcLinks);
+	else
+		YFREE(dev->gcLinks);
+	dev->gcLinksAlt = 0;
+	dev->gcLinks = NULL;
+
+	YFREE(dev->gcBuckets);
+	dev->gcBuckets = NULL;
+}
+
+/*
+ * GC candidate index.
+ * Every FULL block with fewer than nChunksPerBlock live chunks sits on the
+ * list for its live count (pagesInUse - softDeletions), so the dirtiest
+ * block is found by looking at the list heads rather than every block.
+ * yaffs_UpdateGCIndex() must be called whenever a block's state,
+ * pagesInUse or softDeletions changes once the device has been scanned.
+ * It also keeps dev->oldestDirtySequence, the lowest sequence number in the
+ * index, up to date; zero means it has to be worked out again.
+ */
+
+static Y_INLINE yaffs_GCLink *yaffs_GetGCLink(yaffs_Device * dev, int blk)
+{
+	return &dev->gcLinks[blk - dev->internalStartBlock];
+}
+
+static void yaffs_UpdateGCIndex(yaffs_Device * dev, int blockNo)
+{
+	yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev, blockNo);
+	yaffs_GCLink *link;
+	int live = bi->pagesInUse - bi->softDeletions;
+	int bucket = -1;
+
+	if (!dev->gcLinks) {
+		return;
+	}
+
+	link = yaffs_GetGCLink(dev, blockNo);
+
+	if (bi->blockState == YAFFS_BLOCK_STATE_FULL &&
+	    live >= 0 && live < dev->nChunksPerBlock) {
+		bucket = live;
+	}
+
+	if (bucket == link->bucket) {
+		return;
+	}
+
+	if (dev->oldestDirtySequence) {
+		if (link->bucket < 0 &&
+		    bi->sequenceNumber < dev->oldestDirtySequence) {
+			dev->oldestDirtySequence = bi->sequenceNumber;
+		} else if (bucket < 0 &&
+			   bi->sequenceNumber == dev->oldestDirtySequence) {
+			dev->oldestDirtySequence = 0;
+		}
+	}
+
+	/* Take it off its old list */
+	if (link->bucket >= 0) {
+		if (link->prev >= 0) {
+			yaffs_GetGCLink(dev, link->prev)->next = link->next;
+		} else {
+			dev->gcBuckets[link->bucket] = link->next;
+		}
+		if (link->next >= 0) {
+			yaffs_GetGCLink(dev, link->next)->prev = link->prev;
+		}
+	}
+
+	/* and put it on the head of the new one */
+	link->bucket = bucket;
+	link->prev = -1;
+	link->next = -1;
+	if (bucket >= 0) {
+		link->next = dev->gcBuckets[bucket];
+		if (link->next >= 0) {
+			yaffs_GetGCLink(dev, link->next)->prev = blockNo;
+		}
+		dev->gcBuckets[bucket] = blockNo;
+	}
+}
+
+/* The scan sets block states directly, so file everything once it is done. */
+static void yaffs_RebuildGCIndex(yaffs_Device * dev)
+{
+	int i;
+
+	dev->oldestDirtySequence = 0;
+
+	for (i = dev->internalStartBlock; i <= dev->internalEndBlock; i++) {
+		yaffs_UpdateGCIndex(dev, i);
+	}
 }
 
 static int yaffs_BlockNotDisqualifiedFromGC(yaffs_Device * dev,
 					    yaffs_BlockInfo * bi)
 {
 	int i;
+	int live;
 	__u32 seq;
 	yaffs_BlockInfo *b;
 
@@ -1832,20 +2289,32 @@ static int yaffs_BlockNotDisqualifiedFromGC(yaffs_Device * dev,
 		return 1;	/* can gc */
 
 	/* Find the oldest dirty sequence number if we don't know it and save it
-	 * so we don't have to keep recomputing it.
+	 * so we don't have to keep recomputing it. yaffs_UpdateGCIndex() keeps
+	 * the saved value right as blocks come and go from the index.
 	 */
 	if (!dev->oldestDirtySequence) {
-		seq = dev->sequenceNumber;
-
-		for (i = dev->internalStartBlock; i <= dev->internalEndBlock;
-		     i++) {
-			b = yaffs_GetBlockInfo(dev, i);
-			if (b->blockState == YAFFS_BLOCK_STATE_FULL &&
-			    (b->pagesInUse - b->softDeletions) <
-			    dev->nChunksPerBlock && b->sequenceNumber < seq) {
-				seq = b->sequenceNumber;
+		seq = 0;
+
+		/* The GC index holds exactly the FULL blocks with discarded
+		 * pages, so only those need looking at.
+		 */
+		for (live = 0; live < dev->nChunksPerBlock; live++) {
+			for (i = dev->gcBuckets[live]; i >= 0;
+			     i = yaffs_GetGCLink(dev, i)->next) {
+				b = yaffs_GetBlockInfo(dev, i);
+				if (!seq || b->sequenceNumber < seq) {
+					seq = b->sequenceNumber;
+				}
 			}
 		}
+
+		/* An empty index is not saved: a zero would read as unknown
+		 * and a block filled later could be newer than any value
+		 * picked here.
+		 */
+		if (!seq) {
+			return 1;
+		}
 		dev->oldestDirtySequence = seq;
 	}
 
@@ -1863,103 +2332,81 @@ static int yaffs_BlockNotDisqualifiedFromGC(yaffs_Device * dev,
  */
 
 static int yaffs_FindBlockForGarbageCollection(yaffs_Device * dev,
-					       int aggressive)
+					       int aggressive, int background)
 {
 
-	int b = dev->currentDirtyChecker;
-
-	int i;
-	int iterations;
+	int b;
+	int live;
 	int dirtiest = -1;
 	int pagesInUse;
 	yaffs_BlockInfo *bi;
-	static int nonAggressiveSkip = 0;
 
-	/* If we're doing aggressive GC then we are happy to take a less-dirty block, and
-	 * search harder.
+	/* If we're doing aggressive GC then we are happy to take a less-dirty block.
 	 * else (we're doing a leasurely gc), then we only bother to do this if the
 	 * block has only a few pages in use.
+	 * The background thread has time to spare, so it takes blocks up to half
+	 * full, or three quarters when it is falling behind.
 	 */
 
-	nonAggressiveSkip--;
+	dev->nonAggressiveSkip--;
 
-	if (!aggressive && (nonAggressiveSkip > 0)) {
+	if (!aggressive && !background && (dev->nonAggressiveSkip > 0)) {
 		return -1;
 	}
 
-	pagesInUse =
-	    (aggressive) ? dev->nChunksPerBlock : YAFFS_PASSIVE_GC_CHUNKS + 1;
-
-	if (aggressive) {
-		iterations =
-		    dev->internalEndBlock - dev->internalStartBlock + 1;
+	if (background) {
+		pagesInUse = (background > 1) ?
+		    (dev->nChunksPerBlock * 3) / 4 : dev->nChunksPerBlock / 2;
 	} else {
-		iterations =
-		    dev->internalEndBlock - dev->internalStartBlock + 1;
-		iterations = iterations / 16;
-		if (iterations > 200) {
-			iterations = 200;
-		}
+		pagesInUse =
+		    (aggressive) ? dev->nChunksPerBlock : YAFFS_PASSIVE_GC_CHUNKS + 1;
 	}
 
-	for (i = 0; i <= iterations && pagesInUse > 0; i++) {
-		b++;
-		if (b < dev->internalStartBlock || b > dev->internalEndBlock) {
-			b = dev->internalStartBlock;
-		}
-
-		if (b < dev->internalStartBlock || b > dev->internalEndBlock) {
-			T(YAFFS_TRACE_ERROR,
-			  (TSTR("**>> Block %d is not valid" TENDSTR), b));
-			YBUG();
-		}
-
-		bi = yaffs_GetBlockInfo(dev, b);
-
-		if (bi->blockState == YAFFS_BLOCK_STATE_FULL &&
-		    (bi->pagesInUse - bi->softDeletions) < pagesInUse &&
-		    yaffs_BlockNotDisqualifiedFromGC(dev, bi)) {
-			dirtiest = b;
-			pagesInUse = (bi->pagesInUse - bi->softDeletions);
+	/* Walk the GC index from the emptiest bucket up. Blocks that may not be
+	 * collected yet because of older dirty blocks are passed over.
+	 */
+	for (live = 0; live < pagesInUse && dirtiest < 0; live++) {
+		for (b = dev->gcBuckets[live]; b >= 0;
+		     b = yaffs_GetGCLink(dev, b)->next) {
+			bi = yaffs_GetBlockInfo(dev, b);
+			if (yaffs_BlockNotDisqualifiedFromGC(dev, bi)) {
+				dirtiest = b;
+				pagesInUse = live;
+				break;
+			}
 		}
 	}
 
-	dev->currentDirtyChecker = b;
-
 	if (dirtiest > 0) {
 		T(YAFFS_TRACE_GC,
 		  (TSTR("GC Selected block %d with %d free" TENDSTR), dirtiest,
 		   dev->nChunksPerBlock - pagesInUse));
 	}
 
-	dev->oldestDirtySequence = 0;
-
 	if (dirtiest > 0) {
-		nonAggressiveSkip = 4;
+		dev->nonAggressiveSkip = 4;
 	}
 
 	return dirtiest;
 }
 
-static void yaffs_BlockBecameDirty(yaffs_Device * dev, int blockNo)
+/* Bin a writer's wait in log2(us) buckets, the first one being <64us */
+static void yaffs_RecordEraseWait(__u32 * hist, __u32 us)
 {
-	yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev, blockNo);
-
-	int erasedOk = 0;
-
-	/* If the block is still healthy erase it and mark as clean.
-	 * If the block has had a data failure, then retire it.
-	 */
-	bi->blockState = YAFFS_BLOCK_STATE_DIRTY;
+	int bucket = 0;
 
-	if (!bi->needsRetiring) {
-		erasedOk = yaffs_EraseBlockInNAND(dev, blockNo);
-		if (!erasedOk) {
-			dev->nErasureFailures++;
-			T(YAFFS_TRACE_ERROR | YAFFS_TRACE_BAD_BLOCKS,
-			  (TSTR("**>> Erasure failed %d" TENDSTR), blockNo));
-		}
+	us >>= 6;
+	while (us && bucket < YAFFS_ERASE_STALL_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
 	}
+	hist[bucket]++;
+}
+
+/* The erase of a DIRTY block is over: mark it clean, or retire it */
+static void yaffs_FinishErase(yaffs_Device * dev, int blockNo, int erasedOk)
+{
+	yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev, blockNo);
 
 	if (erasedOk && (yaffs_traceMask & YAFFS_TRACE_ERASE)) {
 		int i;
@@ -1994,25 +2441,138 @@ static void yaffs_BlockBecameDirty(yaffs_Device * dev, int blockNo)
 	}
 }
 
-static int yaffs_FindBlockForAllocation(yaffs_Device * dev)
+static void yaffs_BlockBecameDirty(yaffs_Device * dev, int blockNo)
 {
-	int i;
+	yaffs_BlockInfo *bi = yaffs_GetBlockInfo(dev, blockNo);
 
-	yaffs_BlockInfo *bi;
+	int erasedOk = 0;
+	__u32 start;
 
-	if (dev->nErasedBlocks < 1) {
-		/* Hoosterman we've got a problem.
-		 * Can't get space to gc
-		 */
-		T(YAFFS_TRACE_ERROR,
-		  (TSTR("yaffs tragedy: no more eraased blocks" TENDSTR)));
+	yaffs_InvalidateCheckpoint(dev);
 
-		return -1;
-	}
-	
-	/* Find an empty block. */
+	/* If the block is still healthy erase it and mark as clean.
+	 * If the block has had a data failure, then retire it.
+	 */
+	bi->blockState = YAFFS_BLOCK_STATE_DIRTY;
+	yaffs_UpdateGCIndex(dev, blockNo);
 
-	for (i = dev->internalStartBlock; i <= dev->internalEndBlock; i++) {
+	if (!bi->needsRetiring) {
+		if (dev->eraseBlockAsync &&
+		    dev->eraseBlockAsync(dev,
+					 blockNo - dev->blockOffset) == YAFFS_OK) {
+			/* yaffs_ReapErasedBlocks() finishes it off */
+			dev->nBlockErasures++;
+			dev->nErasesInFlight++;
+			return;
+		}
+
+		start = Y_CLOCK_US();
+		erasedOk = yaffs_EraseBlockInNAND(dev, blockNo);
+		yaffs_RecordEraseWait(dev->eraseStalls, Y_CLOCK_US() - start);
+		if (!erasedOk) {
+			dev->nErasureFailures++;
+			T(YAFFS_TRACE_ERROR | YAFFS_TRACE_BAD_BLOCKS,
+			  (TSTR("**>> Erasure failed %d" TENDSTR), blockNo));
+		}
+	}
+
+	yaffs_FinishErase(dev, blockNo, erasedOk);
+}
+
+/* Take back the blocks whose queued erase has finished. With wait set,
+ * sleep for the first one if none has. A failed erase gets the inline
+ * retries before the block is retired.
+ * Returns the number of blocks taken back.
+ */
+static int yaffs_ReapErasedBlocks(yaffs_Device * dev, int wait)
+{
+	int blockInNAND;
+	int blockNo;
+	int erasedOk;
+	int sleep;
+	int n = 0;
+
+	while (dev->nErasesInFlight > 0) {
+		sleep = wait && !n;
+
+		if (sleep && dev->nandBusyCallback)
+			dev->nandBusyCallback(dev, 1);
+
+		blockInNAND = dev->eraseDone(dev, sleep, &erasedOk);
+
+		if (sleep && dev->nandBusyCallback)
+			dev->nandBusyCallback(dev, 0);
+
+		if (blockInNAND < 0)
+			break;
+
+		blockNo = blockInNAND + dev->blockOffset;
+		dev->nErasesInFlight--;
+		n++;
+
+		if (!erasedOk) {
+			erasedOk = yaffs_EraseBlockInNAND(dev, blockNo);
+			if (!erasedOk) {
+				dev->nErasureFailures++;
+				T(YAFFS_TRACE_ERROR | YAFFS_TRACE_BAD_BLOCKS,
+				  (TSTR("**>> Erasure failed %d" TENDSTR),
+				   blockNo));
+			}
+		}
+
+		yaffs_FinishErase(dev, blockNo, erasedOk);
+	}
+
+	return n;
+}
+
+/* Take back finished erases, then wait for queued ones while fewer than
+ * nBlocks blocks are erased.
+ */
+static void yaffs_WaitForErasedBlocks(yaffs_Device * dev, int nBlocks)
+{
+	yaffs_ReapErasedBlocks(dev, 0);
+
+	while (dev->nErasedBlocks < nBlocks && dev->nErasesInFlight > 0) {
+		if (!yaffs_ReapErasedBlocks(dev, 1))
+			break;
+	}
+}
+
+/* Wait for every queued erase, eg. before the block states are saved */
+static void yaffs_DrainErases(yaffs_Device * dev)
+{
+	while (dev->nErasesInFlight > 0) {
+		if (!yaffs_ReapErasedBlocks(dev, 1))
+			break;
+	}
+}
+
+static int yaffs_FindBlockForAllocation(yaffs_Device * dev)
+{
+	int i;
+
+	yaffs_BlockInfo *bi;
+	__u32 start;
+
+	/* Only wait for a queued erase if nothing is erased */
+	start = Y_CLOCK_US();
+	yaffs_WaitForErasedBlocks(dev, 1);
+	yaffs_RecordEraseWait(dev->allocStalls, Y_CLOCK_US() - start);
+
+	if (dev->nErasedBlocks < 1) {
+		/* Hoosterman we've got a problem.
+		 * Can't get space to gc
+		 */
+		T(YAFFS_TRACE_ERROR,
+		  (TSTR("yaffs tragedy: no more eraased blocks" TENDSTR)));
+
+		return -1;
+	}
+	
+	/* Find an empty block. */
+
+	for (i = dev->internalStartBlock; i <= dev->internalEndBlock; i++) {
 		dev->allocationBlockFinder++;
 		if (dev->allocationBlockFinder < dev->internalStartBlock
 		    || dev->allocationBlockFinder > dev->internalEndBlock) {
@@ -2046,7 +2606,9 @@ static int yaffs_FindBlockForAllocation(yaffs_Device * dev)
 
 static int yaffs_CheckSpaceForAllocation(yaffs_Device * dev)
 {
-	int reservedChunks = (dev->nReservedBlocks * dev->nChunksPerBlock);
+	int reservedChunks =
+	    ((dev->nReservedBlocks + yaffs_CheckpointBlocksReserved(dev)) *
+	     dev->nChunksPerBlock);
 	return (dev->nFreeChunks > reservedChunks);
 }
 
@@ -2088,6 +2650,7 @@ static int yaffs_AllocateChunk(yaffs_Device * dev, int useReserve)
 		/* If the block is full set the state to full */
 		if (dev->allocationPage >= dev->nChunksPerBlock) {
 			bi->blockState = YAFFS_BLOCK_STATE_FULL;
+			yaffs_UpdateGCIndex(dev, dev->allocationBlock);
 			dev->allocationBlock = -1;
 		}
 
@@ -2114,14 +2677,18 @@ static int yaffs_GetErasedChunks(yaffs_Device * dev)
 
 }
 
-static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block)
+/* Collect a block. With wholeBlock clear this only copies off
+ * YAFFS_GC_SLICE_CHUNKS chunks and leaves the block COLLECTING, with
+ * dev->gcBlock/gcChunk recording where to carry on next time.
+ */
+static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block,
+				     int wholeBlock)
 {
 	int oldChunk;
 	int newChunk;
-	int chunkInBlock;
 	int markNAND;
 	int retVal = YAFFS_OK;
-	int cleanups = 0;
+	int maxCopies;
 	int i;
 
 	int chunksBefore = yaffs_GetErasedChunks(dev);
@@ -2133,20 +2700,36 @@ static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block)
 
 	yaffs_Object *object;
 
-	bi->blockState = YAFFS_BLOCK_STATE_COLLECTING;
+	if (block == dev->gcBlock &&
+	    bi->blockState != YAFFS_BLOCK_STATE_COLLECTING) {
+		/* Everything left in the part collected block was deleted
+		 * between slices and it has already been erased.
+		 */
+		goto finished;
+	}
+
+	if (bi->blockState != YAFFS_BLOCK_STATE_COLLECTING) {
+		/* Starting on a new block */
+		bi->blockState = YAFFS_BLOCK_STATE_COLLECTING;
+		yaffs_UpdateGCIndex(dev, block);
 
-	T(YAFFS_TRACE_TRACING,
-	  (TSTR("Collecting block %d, in use %d, shrink %d, " TENDSTR), block,
-	   bi->pagesInUse, bi->hasShrinkHeader));
+		T(YAFFS_TRACE_TRACING,
+		  (TSTR("Collecting block %d, in use %d, shrink %d, " TENDSTR),
+		   block, bi->pagesInUse, bi->hasShrinkHeader));
 
-	/*yaffs_VerifyFreeChunks(dev); */
+		yaffs_CheckFreeChunks(dev);
 
-	bi->hasShrinkHeader = 0;	/* clear the flag so that the block can erase */
+		bi->hasShrinkHeader = 0;	/* clear the flag so that the block can erase */
 
-	/* Take off the number of soft deleted entries because
-	 * they're going to get really deleted during GC.
-	 */
-	dev->nFreeChunks -= bi->softDeletions;
+		/* Take off the number of soft deleted entries because
+		 * they're going to get really deleted during GC.
+		 */
+		dev->nFreeChunks -= bi->softDeletions;
+
+		dev->gcBlock = block;
+		dev->gcChunk = 0;
+		dev->nCleanups = 0;
+	}
 
 	dev->isDoingGC = 1;
 
@@ -2160,14 +2743,19 @@ static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block)
 
 		__u8 *buffer = yaffs_GetTempBuffer(dev, __LINE__);
 
-		for (chunkInBlock = 0, oldChunk = block * dev->nChunksPerBlock;
-		     chunkInBlock < dev->nChunksPerBlock
-		     && yaffs_StillSomeChunkBits(dev, block);
-		     chunkInBlock++, oldChunk++) {
-			if (yaffs_CheckChunkBit(dev, block, chunkInBlock)) {
+		maxCopies = wholeBlock ? dev->nChunksPerBlock : YAFFS_GC_SLICE_CHUNKS;
+
+		for (oldChunk = block * dev->nChunksPerBlock + dev->gcChunk;
+		     dev->gcChunk < dev->nChunksPerBlock
+		     && bi->blockState == YAFFS_BLOCK_STATE_COLLECTING
+		     && yaffs_StillSomeChunkBits(dev, block)
+		     && maxCopies > 0;
+		     dev->gcChunk++, oldChunk++) {
+			if (yaffs_CheckChunkBit(dev, block, dev->gcChunk)) {
 
 				/* This page is in use and might need to be copied off */
 
+				maxCopies--;
 				markNAND = 1;
 
 				yaffs_InitialiseTags(&tags);
@@ -2182,7 +2770,7 @@ static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block)
 				T(YAFFS_TRACE_GC_DETAIL,
 				  (TSTR
 				   ("Collecting page %d, %d %d %d " TENDSTR),
-				   chunkInBlock, tags.objectId, tags.chunkId,
+				   dev->gcChunk, tags.objectId, tags.chunkId,
 				   tags.byteCount));
 
 				if (!object) {
@@ -2204,9 +2792,9 @@ static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block)
 
 					if (object->nDataChunks <= 0) {
 						/* remeber to clean up the object */
-						dev->gcCleanupList[cleanups] =
+						dev->gcCleanupList[dev->nCleanups] =
 						    tags.objectId;
-						cleanups++;
+						dev->nCleanups++;
 					}
 					markNAND = 0;
 				} else if (0
@@ -2216,10 +2804,9 @@ static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block)
 					 * Can be discarded and the file deleted.
 					 */
 					object->chunkId = 0;
-					yaffs_FreeTnode(object->myDev,
-							object->variant.
-							fileVariant.top);
-					object->variant.fileVariant.top = NULL;
+					yaffs_FreeTnodeTree(object->myDev,
+							    &object->variant.
+							    fileVariant);
 					yaffs_DoGenericObjectDeletion(object);
 
 				} else if (object) {
@@ -2278,25 +2865,31 @@ static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block)
 
 		yaffs_ReleaseTempBuffer(dev, buffer, __LINE__);
 
+	}
 
-		/* Do any required cleanups */
-		for (i = 0; i < cleanups; i++) {
-			/* Time to delete the file too */
-			object =
-			    yaffs_FindObjectByNumber(dev,
-						     dev->gcCleanupList[i]);
-			if (object) {
-				yaffs_FreeTnode(dev,
-						object->variant.fileVariant.
-						top);
-				object->variant.fileVariant.top = NULL;
-				T(YAFFS_TRACE_GC,
-				  (TSTR
-				   ("yaffs: About to finally delete object %d"
-				    TENDSTR), object->objectId));
-				yaffs_DoGenericObjectDeletion(object);
-			}
+	if (bi->blockState == YAFFS_BLOCK_STATE_COLLECTING &&
+	    dev->gcChunk < dev->nChunksPerBlock &&
+	    yaffs_StillSomeChunkBits(dev, block)) {
+		/* Slice done, more to copy next time */
+		dev->isDoingGC = 0;
+		return YAFFS_OK;
+	}
 
+      finished:
+	/* Do any required cleanups. Recheck the objects since an incremental
+	 * collection lets other operations run between slices.
+	 */
+	for (i = 0; i < dev->nCleanups; i++) {
+		/* Time to delete the file too */
+		object =
+		    yaffs_FindObjectByNumber(dev, dev->gcCleanupList[i]);
+		if (object && object->deleted && object->nDataChunks <= 0) {
+			yaffs_FreeTnodeTree(dev, &object->variant.fileVariant);
+			T(YAFFS_TRACE_GC,
+			  (TSTR
+			   ("yaffs: About to finally delete object %d"
+			    TENDSTR), object->objectId));
+			yaffs_DoGenericObjectDeletion(object);
 		}
 
 	}
@@ -2308,8 +2901,14 @@ static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block)
 		    TENDSTR), chunksBefore, chunksAfter));
 	}
 
+	dev->gcBlock = 0;
+	dev->gcChunk = 0;
+	dev->nCleanups = 0;
+
 	dev->isDoingGC = 0;
 
+	yaffs_CheckFreeChunks(dev);
+
 	return YAFFS_OK;
 }
 
@@ -2321,13 +2920,33 @@ static int yaffs_GarbageCollectBlock(yaffs_Device * dev, int block)
  *
  * The idea is to help clear out space in a more spread-out manner.
  * Dunno if it really does anything useful.
+ *
+ * If the OS runs a background GC thread then writers leave passive gc
+ * to it and only collect here when the reserve is threatened. A block
+ * the thread has part collected is finished off first.
  */
+static void yaffs_RecordGCStall(yaffs_Device * dev, __u32 us)
+{
+	__u32 ms = us / 1000;
+	int bucket = 0;
+
+	while (ms && bucket < YAFFS_GC_STALL_BUCKETS - 1) {
+		ms >>= 1;
+		bucket++;
+	}
+	dev->gcStalls[bucket]++;
+	dev->gcTimeForeground += us;
+	if (us > dev->gcMaxStall)
+		dev->gcMaxStall = us;
+}
+
 static int yaffs_CheckGarbageCollection(yaffs_Device * dev)
 {
 	int block;
 	int aggressive;
 	int gcOk = YAFFS_OK;
 	int maxTries = 0;
+	__u32 start;
 
 	if (dev->isDoingGC) {
 		/* Bail out so we don't get recursive gc */
@@ -2340,7 +2959,13 @@ static int yaffs_CheckGarbageCollection(yaffs_Device * dev)
 
 	do {
 		maxTries++;
-		if (dev->nErasedBlocks < dev->nReservedBlocks) {
+
+		/* Erases already queued are cheaper than collecting more */
+		yaffs_WaitForErasedBlocks(dev, dev->nReservedBlocks +
+					  yaffs_CheckpointBlocksReserved(dev));
+
+		if (dev->nErasedBlocks <
+		    dev->nReservedBlocks + yaffs_CheckpointBlocksReserved(dev)) {
 			/* We need a block soon...*/
 			aggressive = 1;
 		} else {
@@ -2348,20 +2973,36 @@ static int yaffs_CheckGarbageCollection(yaffs_Device * dev)
 			aggressive = 0;
 		}
 
-		block = yaffs_FindBlockForGarbageCollection(dev, aggressive);
+		if (!aggressive && dev->gcWakeCallback) {
+			/* Leave it to the background thread */
+			if (dev->nErasedBlocks * dev->nChunksPerBlock <
+			    dev->gcWatermark)
+				dev->gcWakeCallback(dev);
+			return YAFFS_OK;
+		}
 
-		if (block > 0) {
-			dev->garbageCollections++;
-			if (!aggressive) {
-				dev->passiveGarbageCollections++;
+		block = dev->gcBlock;
+		if (block <= 0) {
+			block =
+			    yaffs_FindBlockForGarbageCollection(dev, aggressive, 0);
+			if (block > 0) {
+				dev->garbageCollections++;
+				if (!aggressive) {
+					dev->passiveGarbageCollections++;
+				}
 			}
+		}
 
+		if (block > 0) {
 			T(YAFFS_TRACE_GC,
 			  (TSTR
 			   ("yaffs: GC erasedBlocks %d aggressive %d" TENDSTR),
 			   dev->nErasedBlocks, aggressive));
 
-			gcOk = yaffs_GarbageCollectBlock(dev, block);
+			start = Y_CLOCK_US();
+			gcOk = yaffs_GarbageCollectBlock(dev, block, 1);
+			yaffs_RecordGCStall(dev, Y_CLOCK_US() - start);
+			yaffs_WaitForErasedBlocks(dev, dev->nReservedBlocks);
 		}
 
 		if (dev->nErasedBlocks < (dev->nReservedBlocks) && block > 0) {
@@ -2376,6 +3017,63 @@ static int yaffs_CheckGarbageCollection(yaffs_Device * dev)
 	return aggressive ? gcOk : YAFFS_OK;
 }
 
+/* Do one slice of passive gc for an OS background thread. The caller must
+ * hold whatever lock it uses to serialise the writers.
+ * Returns 1 if there is more gc worth doing straight away, 0 if the
+ * caller can sleep.
+ */
+int yaffs_BackgroundGarbageCollect(yaffs_Device * dev)
+{
+	int erasedChunks;
+	int block = dev->gcBlock;
+	int copies;
+	__u32 start;
+
+	if (dev->isDoingGC || !dev->isMounted) {
+		return 0;
+	}
+
+	yaffs_ReapErasedBlocks(dev, 0);
+	erasedChunks = dev->nErasedBlocks * dev->nChunksPerBlock;
+
+	if (block <= 0) {
+		if (erasedChunks >= dev->gcWatermark) {
+			return 0;
+		}
+
+		block =
+		    yaffs_FindBlockForGarbageCollection(dev, 0,
+							(erasedChunks <
+							 dev->gcWatermark / 2) ?
+							2 : 1);
+		if (block <= 0) {
+			/* Nothing dirty enough to be worth it */
+			return 0;
+		}
+
+		dev->garbageCollections++;
+		dev->passiveGarbageCollections++;
+
+		T(YAFFS_TRACE_GC,
+		  (TSTR("yaffs: background GC erasedBlocks %d block %d" TENDSTR),
+		   dev->nErasedBlocks, block));
+	}
+
+	start = Y_CLOCK_US();
+	copies = dev->nGCCopies;
+
+	/* yaffs1 marks deletions in NAND and skips that on a COLLECTING
+	 * block, so it must not leave one part collected.
+	 */
+	yaffs_GarbageCollectBlock(dev, block, !dev->isYaffs2);
+
+	dev->nBackgroundGCSlices++;
+	dev->nBackgroundGCCopies += dev->nGCCopies - copies;
+	dev->gcTimeBackground += Y_CLOCK_US() - start;
+
+	return 1;
+}
+
 /*-------------------------  TAGS --------------------------------*/
 
 static int yaffs_TagsMatch(const yaffs_ExtendedTags * tags, int objectId,
@@ -2778,6 +3476,7 @@ void yaffs_DeleteChunk(yaffs_Device * dev, int chunkId, int markNAND, int lyn)
 		yaffs_ClearChunkBit(dev, block, page);
 
 		bi->pagesInUse--;
+		yaffs_UpdateGCIndex(dev, block);
 
 		if (bi->pagesInUse == 0 &&
 		    !bi->hasShrinkHeader &&
@@ -3006,52 +3705,72 @@ int yaffs_UpdateObjectHeader(yaffs_Object * in, const YCHAR * name, int force,
  *   In Linux, the page cache provides read buffering aand the short op cache provides write 
  *   buffering.
  *
- *   There are a limited number (~10) of cache chunks per device so that we don't
- *   need a very intelligent search.
+ *   The cache is a hashed LRU. Entries in use are on a hash chain keyed by
+ *   object and chunk, and on the device LRU list, most recently used first.
+ *   Dirty entries are also on their object's dirtyCache list in chunkId order
+ *   so that a flush writes them out as one ascending run.
+ *   In Linux readers only hold the state lock shared, so a lookup must not
+ *   change anything but the statistics.
  */
 
+static Y_INLINE struct list_head *yaffs_ChunkCacheChain(yaffs_Device * dev,
+							const yaffs_Object * obj,
+							int chunkId)
+{
+	return &dev->srHash[(obj->objectId * 31 + chunkId) & dev->srHashMask];
+}
+
+/* Mark a cache entry clean, taking it off its object's dirty list */
+static void yaffs_CleanChunkCache(yaffs_Device * dev, yaffs_ChunkCache * cache)
+{
+	if (cache->dirty) {
+		list_del_init(&cache->dirtyLink);
+		cache->dirty = 0;
+		dev->srDirty--;
+	}
+}
+
+/* Drop an entry out of the cache and onto the free list */
+static void yaffs_FreeChunkCache(yaffs_Device * dev, yaffs_ChunkCache * cache)
+{
+	yaffs_CleanChunkCache(dev, cache);
+	list_del_init(&cache->hashLink);
+	list_del(&cache->lruLink);
+	list_add(&cache->lruLink, &dev->srFree);
+	cache->object = NULL;
+}
+
 static void yaffs_FlushFilesChunkCache(yaffs_Object * obj)
 {
 	yaffs_Device *dev = obj->myDev;
-	int lowest = -99;	/* Stop compiler whining. */
-	int i;
 	yaffs_ChunkCache *cache;
-	int chunkWritten = 0;
-	int nCaches = obj->myDev->nShortOpCaches;
-
-	if (nCaches > 0) {
-		do {
-			cache = NULL;
-
-			/* Find the dirty cache for this object with the lowest chunk id. */
-			for (i = 0; i < nCaches; i++) {
-				if (dev->srCache[i].object == obj &&
-				    dev->srCache[i].dirty) {
-					if (!cache
-					    || dev->srCache[i].chunkId <
-					    lowest) {
-						cache = &dev->srCache[i];
-						lowest = cache->chunkId;
-					}
-				}
-			}
+	int chunkWritten = 1;
 
-			if (cache && !cache->locked) {
-				/* Write it out and free it up */
+	if (dev->nShortOpCaches > 0) {
+		/* The dirty list is sorted, so the chunks go out in order and
+		 * land on consecutive pages of the allocation block.
+		 */
+		while (!list_empty(&obj->dirtyCache) && chunkWritten > 0) {
+			cache = list_entry(obj->dirtyCache.next,
+					   yaffs_ChunkCache, dirtyLink);
 
-				chunkWritten =
-				    yaffs_WriteChunkDataToObject(cache->object,
-								 cache->chunkId,
-								 cache->data,
-								 cache->nBytes,
-								 1);
-				cache->dirty = 0;
-				cache->object = NULL;
+			if (cache->locked) {
+				break;
 			}
 
-		} while (cache && chunkWritten > 0);
+			/* Write it out. It stays in the cache, clean. */
+			chunkWritten =
+			    yaffs_WriteChunkDataToObject(cache->object,
+							 cache->chunkId,
+							 cache->data,
+							 cache->nBytes, 1);
+			if (chunkWritten > 0) {
+				yaffs_CleanChunkCache(dev, cache);
+				dev->cacheWritebacks++;
+			}
+		}
 
-		if (cache) {
+		if (chunkWritten <= 0) {
 			/* Hoosterman, disk full while writing cache out. */
 			T(YAFFS_TRACE_ERROR,
 			  (TSTR("yaffs tragedy: no space during cache write" TENDSTR)));
@@ -3070,73 +3789,65 @@ static void yaffs_FlushFilesChunkCache(yaffs_Object * obj)
 void yaffs_FlushEntireDeviceCache(yaffs_Device *dev)
 {
 	yaffs_Object *obj;
-	int nCaches = dev->nShortOpCaches;
-	int i;
+	yaffs_ChunkCache *cache;
+	struct list_head *i;
+	int nDirty;
 	
 	/* Find a dirty object in the cache and flush it...
-	 * until there are no further dirty objects.
+	 * until there are no further dirty objects, or a flush gets
+	 * nowhere because the disk is full.
 	 */
-	do {
+	while (dev->srDirty > 0) {
 		obj = NULL;
-		for( i = 0; i < nCaches && !obj; i++) {
-			if (dev->srCache[i].object &&
-			    dev->srCache[i].dirty)
-				obj = dev->srCache[i].object;
-			    
-		}
-		if(obj)
-			yaffs_FlushFilesChunkCache(obj);
-			
-	} while(obj);
+		list_for_each(i, &dev->srLru) {
+			cache = list_entry(i, yaffs_ChunkCache, lruLink);
+			if (cache->dirty && !cache->locked) {
+				obj = cache->object;
+				break;
+			}
+		}
+		if (!obj)
+			break;
+
+		nDirty = dev->srDirty;
+		yaffs_FlushFilesChunkCache(obj);
+		if (dev->srDirty == nDirty)
+			break;
+	}
 	
 }
 
 /* Grab us a cache chunk for use.
- * First look for an empty one. 
- * Then look for the least recently used non-dirty one.
- * Then look for the least recently used dirty one...., flush and look again.
+ * First look for a free one.
+ * Then take the least recently used clean one.
+ * The entry is returned on the free list.
  */
 static yaffs_ChunkCache *yaffs_GrabChunkCacheWorker(yaffs_Device * dev)
 {
-	int i;
-	int usage;
-	int theOne;
-
-	if (dev->nShortOpCaches > 0) {
-		for (i = 0; i < dev->nShortOpCaches; i++) {
-			if (!dev->srCache[i].object) 
-				return &dev->srCache[i];
-		}
-
-		return NULL;
+	struct list_head *i;
+	yaffs_ChunkCache *cache;
 
-		theOne = -1;
-		usage = 0;	/* just to stop the compiler grizzling */
+	if (!list_empty(&dev->srFree)) {
+		return list_entry(dev->srFree.next, yaffs_ChunkCache, lruLink);
+	}
 
-		for (i = 0; i < dev->nShortOpCaches; i++) {
-			if (!dev->srCache[i].dirty &&
-			    ((dev->srCache[i].lastUse < usage && theOne >= 0) ||
-			     theOne < 0)) {
-				usage = dev->srCache[i].lastUse;
-				theOne = i;
-			}
+	for (i = dev->srLru.prev; i != &dev->srLru; i = i->prev) {
+		cache = list_entry(i, yaffs_ChunkCache, lruLink);
+		if (!cache->dirty && !cache->locked) {
+			yaffs_FreeChunkCache(dev, cache);
+			dev->cacheEvictions++;
+			return cache;
 		}
-
-
-		return theOne >= 0 ? &dev->srCache[theOne] : NULL;
-	} else {
-		return NULL;
 	}
 
+	return NULL;
 }
 
 static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device * dev)
 {
 	yaffs_ChunkCache *cache;
-	yaffs_Object *theObj;
-	int usage;
-	int i;
-	int pushout;
+	yaffs_ChunkCache *lru;
+	struct list_head *i;
 
 	if (dev->nShortOpCaches > 0) {
 		/* Try find a non-dirty one... */
@@ -3144,37 +3855,18 @@ static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device * dev)
 		cache = yaffs_GrabChunkCacheWorker(dev);
 
 		if (!cache) {
-			/* They were all dirty, find the last recently used object and flush
-			 * its cache, then  find again.
-			 * NB what's here is not very accurate, we actually flush the object
-			 * the last recently used page.
+			/* They were all dirty. Flush the object that owns the
+			 * least recently used chunk, then find again.
 			 */
-
-			/* With locking we can't assume we can use entry zero */
-
-			theObj = NULL;
-			usage = -1;
-			cache = NULL;
-			pushout = -1;
-
-			for (i = 0; i < dev->nShortOpCaches; i++) {
-				if (dev->srCache[i].object &&
-				    !dev->srCache[i].locked &&
-				    (dev->srCache[i].lastUse < usage || !cache))
-				{
-					usage = dev->srCache[i].lastUse;
-					theObj = dev->srCache[i].object;
-					cache = &dev->srCache[i];
-					pushout = i;
+			for (i = dev->srLru.prev; i != &dev->srLru; i = i->prev) {
+				lru = list_entry(i, yaffs_ChunkCache, lruLink);
+				if (!lru->locked) {
+					yaffs_FlushFilesChunkCache(lru->object);
+					break;
 				}
 			}
 
-			if (!cache || cache->dirty) {
-				/* Flush and try again */
-				yaffs_FlushFilesChunkCache(theObj);
-				cache = yaffs_GrabChunkCacheWorker(dev);
-			}
-
+			cache = yaffs_GrabChunkCacheWorker(dev);
 		}
 		return cache;
 	} else
@@ -3182,46 +3874,88 @@ static yaffs_ChunkCache *yaffs_GrabChunkCache(yaffs_Device * dev)
 
 }
 
+/* Take a cache entry for a chunk of obj and fill it from NAND */
+static yaffs_ChunkCache *yaffs_LoadChunkCache(yaffs_Object * obj, int chunkId)
+{
+	yaffs_Device *dev = obj->myDev;
+	yaffs_ChunkCache *cache = yaffs_GrabChunkCache(dev);
+
+	if (cache) {
+		yaffs_ReadChunkDataFromObject(obj, chunkId, cache->data);
+		cache->object = obj;
+		cache->chunkId = chunkId;
+		cache->dirty = 0;
+		cache->locked = 0;
+		cache->nBytes = 0;
+		list_add(&cache->hashLink,
+			 yaffs_ChunkCacheChain(dev, obj, chunkId));
+		list_del(&cache->lruLink);
+		list_add(&cache->lruLink, &dev->srLru);
+	}
+
+	return cache;
+}
+
+static yaffs_ChunkCache *yaffs_LookupChunkCache(const yaffs_Object * obj,
+						int chunkId)
+{
+	yaffs_Device *dev = obj->myDev;
+	struct list_head *i;
+	yaffs_ChunkCache *cache;
+
+	list_for_each(i, yaffs_ChunkCacheChain(dev, obj, chunkId)) {
+		cache = list_entry(i, yaffs_ChunkCache, hashLink);
+		if (cache->object == obj && cache->chunkId == chunkId) {
+			return cache;
+		}
+	}
+	return NULL;
+}
+
 /* Find a cached chunk */
 static yaffs_ChunkCache *yaffs_FindChunkCache(const yaffs_Object * obj,
 					      int chunkId)
 {
 	yaffs_Device *dev = obj->myDev;
-	int i;
-	if (dev->nShortOpCaches > 0) {
-		for (i = 0; i < dev->nShortOpCaches; i++) {
-			if (dev->srCache[i].object == obj &&
-			    dev->srCache[i].chunkId == chunkId) {
-				dev->cacheHits++;
+	yaffs_ChunkCache *cache = NULL;
 
-				return &dev->srCache[i];
-			}
+	if (dev->nShortOpCaches > 0) {
+		cache = yaffs_LookupChunkCache(obj, chunkId);
+		if (cache) {
+			Y_ATOMIC_INC(&dev->cacheHits);
+		} else {
+			Y_ATOMIC_INC(&dev->cacheMisses);
 		}
 	}
-	return NULL;
+	return cache;
 }
 
-/* Mark the chunk for the least recently used algorithym */
+/* Mark the chunk for the least recently used algorithym.
+ * A write also puts it on its object's dirty list.
+ */
 static void yaffs_UseChunkCache(yaffs_Device * dev, yaffs_ChunkCache * cache,
 				int isAWrite)
 {
+	struct list_head *dirtyList;
+	struct list_head *i;
 
 	if (dev->nShortOpCaches > 0) {
-		if (dev->srLastUse < 0 || dev->srLastUse > 100000000) {
-			/* Reset the cache usages */
-			int i;
-			for (i = 1; i < dev->nShortOpCaches; i++) {
-				dev->srCache[i].lastUse = 0;
-			}
-			dev->srLastUse = 0;
-		}
-
-		dev->srLastUse++;
-
-		cache->lastUse = dev->srLastUse;
+		list_del(&cache->lruLink);
+		list_add(&cache->lruLink, &dev->srLru);
 
-		if (isAWrite) {
+		if (isAWrite && !cache->dirty) {
+			/* Writes are mostly sequential, so look for the
+			 * place from the end of the list.
+			 */
+			dirtyList = &cache->object->dirtyCache;
+			for (i = dirtyList->prev; i != dirtyList; i = i->prev) {
+				if (list_entry(i, yaffs_ChunkCache, dirtyLink)->
+				    chunkId < cache->chunkId)
+					break;
+			}
+			list_add(&cache->dirtyLink, i);
 			cache->dirty = 1;
+			dev->srDirty++;
 		}
 	}
 }
@@ -3233,10 +3967,10 @@ static void yaffs_UseChunkCache(yaffs_Device * dev, yaffs_ChunkCache * cache,
 static void yaffs_InvalidateChunkCache(yaffs_Object * object, int chunkId)
 {
 	if (object->myDev->nShortOpCaches > 0) {
-		yaffs_ChunkCache *cache = yaffs_FindChunkCache(object, chunkId);
+		yaffs_ChunkCache *cache = yaffs_LookupChunkCache(object, chunkId);
 
 		if (cache) {
-			cache->object = NULL;
+			yaffs_FreeChunkCache(object->myDev, cache);
 		}
 	}
 }
@@ -3246,14 +3980,17 @@ static void yaffs_InvalidateChunkCache(yaffs_Object * object, int chunkId)
  */
 static void yaffs_InvalidateWholeChunkCache(yaffs_Object * in)
 {
-	int i;
+	struct list_head *i;
+	struct list_head *n;
+	yaffs_ChunkCache *cache;
 	yaffs_Device *dev = in->myDev;
 
 	if (dev->nShortOpCaches > 0) {
 		/* Invalidate it. */
-		for (i = 0; i < dev->nShortOpCaches; i++) {
-			if (dev->srCache[i].object == in) {
-				dev->srCache[i].object = NULL;
+		list_for_each_safe(i, n, &dev->srLru) {
+			cache = list_entry(i, yaffs_ChunkCache, lruLink);
+			if (cache->object == in) {
+				yaffs_FreeChunkCache(dev, cache);
 			}
 		}
 	}
@@ -3278,12 +4015,22 @@ int yaffs_ReadDataFromFile(yaffs_Object * in, __u8 * buffer, __u32 offset,
 	int nToCopy;
 	int n = nBytes;
 	int nDone = 0;
+	int loadCache;
 	yaffs_ChunkCache *cache;
 
 	yaffs_Device *dev;
 
 	dev = in->myDev;
 
+#ifdef __KERNEL__
+	/* Readers only hold the state lock shared, so they can copy out of
+	 * a cache hit but must not load or reorder the cache.
+	 */
+	loadCache = 0;
+#else
+	loadCache = (dev->nShortOpCaches > 0);
+#endif
+
 	while (n > 0) {
 		chunk = offset / dev->nBytesPerChunk + 1;   /* The first chunk is 1 */
 		start = offset % dev->nBytesPerChunk;
@@ -3304,22 +4051,14 @@ int yaffs_ReadDataFromFile(yaffs_Object * in, __u8 * buffer, __u32 offset,
 		 * else bypass the cache.
 		 */
 		if (cache || nToCopy != dev->nBytesPerChunk) {
-			if (dev->nShortOpCaches > 0) {
-
+			if (!cache && loadCache) {
 				/* If we can't find the data in the cache, then load it up. */
+				cache = yaffs_LoadChunkCache(in, chunk);
+			}
 
-				if (!cache) {
-					cache = yaffs_GrabChunkCache(in->myDev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
-					yaffs_ReadChunkDataFromObject(in, chunk,
-								      cache->
-								      data);
-					cache->nBytes = 0;
-				}
-
+			if (cache && !loadCache) {
+				memcpy(buffer, &cache->data[start], nToCopy);
+			} else if (cache) {
 				yaffs_UseChunkCache(dev, cache, 0);
 
 				cache->locked = 1;
@@ -3447,14 +4186,7 @@ int yaffs_WriteDataToFile(yaffs_Object * in, const __u8 * buffer, __u32 offset,
 				if (!cache
 				    && yaffs_CheckSpaceForAllocation(in->
 								     myDev)) {
-					cache = yaffs_GrabChunkCache(in->myDev);
-					cache->object = in;
-					cache->chunkId = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
-					yaffs_ReadChunkDataFromObject(in, chunk,
-								      cache->
-								      data);
+					cache = yaffs_LoadChunkCache(in, chunk);
 				}
 
 				if (cache) {
@@ -3480,7 +4212,7 @@ int yaffs_WriteDataToFile(yaffs_Object * in, const __u8 * buffer, __u32 offset,
 						     cache->chunkId,
 						     cache->data, cache->nBytes,
 						     1);
-						cache->dirty = 0;
+						yaffs_CleanChunkCache(dev, cache);
 					}
 
 				} else {
@@ -3796,8 +4528,7 @@ int yaffs_DeleteFile(yaffs_Object * in)
 		return in->deleted ? YAFFS_OK : YAFFS_FAIL;
 	} else {
 		/* The file has no data chunks so we toss it immediately */
-		yaffs_FreeTnode(in->myDev, in->variant.fileVariant.top);
-		in->variant.fileVariant.top = NULL;
+		yaffs_FreeTnodeTree(in->myDev, &in->variant.fileVariant);
 		yaffs_DoGenericObjectDeletion(in);
 
 		return YAFFS_OK;
@@ -3875,17 +4606,19 @@ static int yaffs_UnlinkWorker(yaffs_Object * obj)
 		 */
 
 		yaffs_Object *hl;
+		yaffs_Object *parent;
 		int retVal;
 		YCHAR name[YAFFS_MAX_NAME_LENGTH + 1];
 
 		hl = list_entry(obj->hardLinks.next, yaffs_Object, hardLinks);
+		parent = hl->parent;
 
 		list_del_init(&hl->hardLinks);
-		list_del_init(&hl->siblings);
+		yaffs_RemoveObjectFromDirectory(hl);
 
 		yaffs_GetObjectName(hl, name, YAFFS_MAX_NAME_LENGTH + 1);
 
-		retVal = yaffs_ChangeObjectName(obj, hl->parent, name, 0, 0);
+		retVal = yaffs_ChangeObjectName(obj, parent, name, 0, 0);
 
 		if (retVal == YAFFS_OK) {
 			retVal = yaffs_DoGenericObjectDeletion(hl);
@@ -4472,31 +5205,94 @@ static int yaffs_Scan(yaffs_Device * dev)
 	return YAFFS_OK;
 }
 
-static int yaffs_ScanBackwards(yaffs_Device * dev)
+/* Hook each hardlink on the list (chained through hardLinks.next) up to
+ * the object it is equivalent to. Used once all the objects are known.
+ */
+static void yaffs_HardlinkFixup(yaffs_Device * dev, yaffs_Object * hardList)
 {
-	yaffs_ExtendedTags tags;
-	int blk;
-	int blockIterator;
-	int startIterator;
-	int endIterator;
-	int nBlocksToScan = 0;
-
-	int chunk;
-	int c;
-	int deleted;
-	yaffs_BlockState state;
-	yaffs_Object *hardList = NULL;
 	yaffs_Object *hl;
-	yaffs_BlockInfo *bi;
-	int sequenceNumber;
-	yaffs_ObjectHeader *oh;
 	yaffs_Object *in;
-	yaffs_Object *parent;
-	int nBlocks = dev->internalEndBlock - dev->internalStartBlock + 1;
-
-	__u8 *chunkData;
 
-	yaffs_BlockIndex *blockIndex = NULL;
+	while (hardList) {
+		hl = hardList;
+		hardList = (yaffs_Object *) (hardList->hardLinks.next);
+
+		in = yaffs_FindObjectByNumber(dev,
+					      hl->variant.hardLinkVariant.
+					      equivalentObjectId);
+
+		if (in) {
+			/* Add the hardlink pointers */
+			hl->variant.hardLinkVariant.equivalentObject = in;
+			list_add(&hl->hardLinks, &in->hardLinks);
+		} else {
+			/* Todo Need to report/handle this better.
+			 * Got a problem... hardlink to a non-existant object
+			 */
+			hl->variant.hardLinkVariant.equivalentObject = NULL;
+			INIT_LIST_HEAD(&hl->hardLinks);
+
+		}
+
+	}
+}
+
+/* Objects left in the unlinked and deleted directories at mount time have
+ * nothing referring to them any more, so get rid of them.
+ */
+static void yaffs_StripDeletedObjects(yaffs_Device * dev)
+{
+	struct list_head *i;
+	struct list_head *n;
+
+	yaffs_Object *l;
+
+	/* Soft delete all the unlinked files */
+	list_for_each_safe(i, n,
+			   &dev->unlinkedDir->variant.directoryVariant.
+			   children) {
+		if (i) {
+			l = list_entry(i, yaffs_Object, siblings);
+			yaffs_DestroyObject(l);
+		}
+	}
+
+	/* Soft delete all the deletedDir files */
+	list_for_each_safe(i, n,
+			   &dev->deletedDir->variant.directoryVariant.
+			   children) {
+		if (i) {
+			l = list_entry(i, yaffs_Object, siblings);
+			yaffs_DestroyObject(l);
+
+		}
+	}
+}
+
+static int yaffs_ScanBackwards(yaffs_Device * dev)
+{
+	yaffs_ExtendedTags tags;
+	int blk;
+	int blockIterator;
+	int startIterator;
+	int endIterator;
+	int nBlocksToScan = 0;
+
+	int chunk;
+	int c;
+	int deleted;
+	yaffs_BlockState state;
+	yaffs_Object *hardList = NULL;
+	yaffs_BlockInfo *bi;
+	int sequenceNumber;
+	yaffs_ObjectHeader *oh;
+	yaffs_Object *in;
+	yaffs_Object *parent;
+	int nBlocks = dev->internalEndBlock - dev->internalStartBlock + 1;
+
+	__u8 *chunkData;
+
+	yaffs_BlockIndex *blockIndex = NULL;
 
 	if (!dev->isYaffs2) {
 		T(YAFFS_TRACE_SCAN,
@@ -4554,6 +5350,14 @@ static int yaffs_ScanBackwards(yaffs_Device * dev)
 				if (sequenceNumber >= dev->sequenceNumber) {
 					dev->sequenceNumber = sequenceNumber;
 				}
+			} else if (dev->isYaffs2 &&
+				   sequenceNumber ==
+				   YAFFS_SEQUENCE_CHECKPOINT_DATA) {
+				/* Left by a checkpoint we did not mount from.
+				 * It goes on the first write.
+				 */
+				bi->blockState = YAFFS_BLOCK_STATE_CHECKPOINT;
+				dev->blocksInCheckpoint++;
 			} else if (dev->isYaffs2) {
 				/* TODO: Nasty sequence number! */
 				T(YAFFS_TRACE_SCAN,
@@ -4998,72 +5802,770 @@ static int yaffs_ScanBackwards(yaffs_Device * dev)
 	 * We should now have scanned all the objects, now it's time to add these 
 	 * hardlinks.
 	 */
-	while (hardList) {
-		hl = hardList;
-		hardList = (yaffs_Object *) (hardList->hardLinks.next);
+	yaffs_HardlinkFixup(dev, hardList);
 
-		in = yaffs_FindObjectByNumber(dev,
-					      hl->variant.hardLinkVariant.
-					      equivalentObjectId);
+	yaffs_StripDeletedObjects(dev);
 
-		if (in) {
-			/* Add the hardlink pointers */
-			hl->variant.hardLinkVariant.equivalentObject = in;
-			list_add(&hl->hardLinks, &in->hardLinks);
-		} else {
-			/* Todo Need to report/handle this better.
-			 * Got a problem... hardlink to a non-existant object
-			 */
-			hl->variant.hardLinkVariant.equivalentObject = NULL;
-			INIT_LIST_HEAD(&hl->hardLinks);
+	yaffs_ReleaseTempBuffer(dev, chunkData, __LINE__);
 
-		}
+	T(YAFFS_TRACE_SCAN, (TSTR("yaffs_ScanBackwards ends" TENDSTR)));
 
+	return YAFFS_OK;
+}
+
+/*--------------------- Checkpointing --------------------*/
+
+/* Blocks that still have to be held back so that a checkpoint can always be
+ * written. This is a generous estimate of the stream size from the objects
+ * and tnodes in use, less whatever the current checkpoint already occupies.
+ */
+static int yaffs_CheckpointBlocksReserved(yaffs_Device * dev)
+{
+	int nBlocks = dev->internalEndBlock - dev->internalStartBlock + 1;
+	int nBytes;
+	int needed;
+
+	if (!dev->useCheckpoint || !dev->isYaffs2) {
+		return 0;
 	}
 
-	{
-		struct list_head *i;
-		struct list_head *n;
+	nBytes = 2 * sizeof(yaffs_CheckpointValidity) +
+	    sizeof(yaffs_CheckpointDevice) + sizeof(__u32) +
+	    nBlocks * (sizeof(yaffs_BlockInfo) + dev->chunkBitmapStride) +
+	    (dev->nObjectsCreated - dev->nFreeObjects) *
+	    (sizeof(yaffs_CheckpointObject) + sizeof(__u32)) +
+	    (dev->nTnodesCreated - dev->nFreeTnodes + dev->nCompactTnodes) *
+	    (sizeof(__u32) + YAFFS_NTNODES_LEVEL0 * sizeof(__u16));
 
-		yaffs_Object *l;
+	/* Round up, plus a block for symlink aliases and bad luck */
+	needed = nBytes / (dev->nBytesPerChunk * dev->nChunksPerBlock) + 2 -
+	    dev->blocksInCheckpoint;
 
-		/* Soft delete all the unlinked files */
-		list_for_each_safe(i, n,
-				   &dev->unlinkedDir->variant.directoryVariant.
-				   children) {
-			if (i) {
-				l = list_entry(i, yaffs_Object, siblings);
-				yaffs_DestroyObject(l);
+	return (needed > 0) ? needed : 0;
+}
+
+static int yaffs_WriteCheckpointValidityMarker(yaffs_Device * dev, int head)
+{
+	yaffs_CheckpointValidity cp;
+	cp.structType = sizeof(cp);
+	cp.magic = YAFFS_MAGIC;
+	cp.version = YAFFS_CHECKPOINT_VERSION;
+	cp.head = (head) ? 1 : 0;
+
+	return (yaffs_CheckpointWrite(dev, &cp, sizeof(cp)) == sizeof(cp)) ?
+	    1 : 0;
+}
+
+static int yaffs_ReadCheckpointValidityMarker(yaffs_Device * dev, int head)
+{
+	yaffs_CheckpointValidity cp;
+	int ok;
+
+	ok = (yaffs_CheckpointRead(dev, &cp, sizeof(cp)) == sizeof(cp));
+
+	if (ok)
+		ok = (cp.structType == sizeof(cp)) &&
+		    (cp.magic == YAFFS_MAGIC) &&
+		    (cp.version == YAFFS_CHECKPOINT_VERSION) &&
+		    (cp.head == ((head) ? 1 : 0));
+	return ok ? 1 : 0;
+}
+
+static int yaffs_WriteCheckpointDevice(yaffs_Device * dev)
+{
+	yaffs_CheckpointDevice cp;
+	__u32 nBytes;
+	__u32 nBlocks = (dev->internalEndBlock - dev->internalStartBlock + 1);
+
+	int ok;
+
+	/* Write device runtime values */
+	memset(&cp, 0, sizeof(cp));
+	cp.structType = sizeof(cp);
+	cp.nBytesPerChunk = dev->nBytesPerChunk;
+	cp.nChunksPerBlock = dev->nChunksPerBlock;
+	cp.internalStartBlock = dev->internalStartBlock;
+	cp.internalEndBlock = dev->internalEndBlock;
+	cp.nErasedBlocks = dev->nErasedBlocks;
+	cp.allocationBlock = dev->allocationBlock;
+	cp.allocationPage = dev->allocationPage;
+	cp.allocationBlockFinder = dev->allocationBlockFinder;
+	cp.nFreeChunks = dev->nFreeChunks;
+	cp.sequenceNumber = dev->sequenceNumber;
+
+	ok = (yaffs_CheckpointWrite(dev, &cp, sizeof(cp)) == sizeof(cp));
+
+	/* Write block info */
+	if (ok) {
+		nBytes = nBlocks * sizeof(yaffs_BlockInfo);
+		ok = (yaffs_CheckpointWrite(dev, dev->blockInfo, nBytes) ==
+		      nBytes);
+	}
+
+	/* Write chunk bits */
+	if (ok) {
+		nBytes = nBlocks * dev->chunkBitmapStride;
+		ok = (yaffs_CheckpointWrite(dev, dev->chunkBits, nBytes) ==
+		      nBytes);
+	}
+	return ok ? 1 : 0;
+
+}
+
+static int yaffs_ReadCheckpointDevice(yaffs_Device * dev)
+{
+	yaffs_CheckpointDevice cp;
+	__u32 nBytes;
+	__u32 nBlocks = (dev->internalEndBlock - dev->internalStartBlock + 1);
+
+	int ok;
+
+	ok = (yaffs_CheckpointRead(dev, &cp, sizeof(cp)) == sizeof(cp));
+	if (!ok)
+		return 0;
+
+	/* Don't trust a checkpoint made for a different partition layout */
+	if (cp.structType != sizeof(cp) ||
+	    cp.nBytesPerChunk != dev->nBytesPerChunk ||
+	    cp.nChunksPerBlock != dev->nChunksPerBlock ||
+	    cp.internalStartBlock != dev->internalStartBlock ||
+	    cp.internalEndBlock != dev->internalEndBlock)
+		return 0;
+
+	dev->nErasedBlocks = cp.nErasedBlocks;
+	dev->allocationBlock = cp.allocationBlock;
+	dev->allocationPage = cp.allocationPage;
+	dev->allocationBlockFinder = cp.allocationBlockFinder;
+	dev->nFreeChunks = cp.nFreeChunks;
+	dev->sequenceNumber = cp.sequenceNumber;
+
+	nBytes = nBlocks * sizeof(yaffs_BlockInfo);
+
+	ok = (yaffs_CheckpointRead(dev, dev->blockInfo, nBytes) == nBytes);
+
+	if (!ok)
+		return 0;
+	nBytes = nBlocks * dev->chunkBitmapStride;
+
+	ok = (yaffs_CheckpointRead(dev, dev->chunkBits, nBytes) == nBytes);
+
+	return ok ? 1 : 0;
+}
+
+static void yaffs_ObjectToCheckpointObject(yaffs_CheckpointObject * cp,
+					   yaffs_Object * obj)
+{
+	memset(cp, 0, sizeof(*cp));
+	cp->structType = sizeof(*cp);
+	cp->objectId = obj->objectId;
+	cp->parentId = (obj->parent) ? obj->parent->objectId : 0;
+	cp->chunkId = obj->chunkId;
+	cp->variantType = obj->variantType;
+	cp->deleted = obj->deleted;
+	cp->softDeleted = obj->softDeleted;
+	cp->unlinked = obj->unlinked;
+	cp->renameAllowed = obj->renameAllowed;
+	cp->unlinkAllowed = obj->unlinkAllowed;
+	cp->dirty = obj->dirty;
+	cp->serial = obj->serial;
+	cp->nDataChunks = obj->nDataChunks;
+
+	if (obj->variantType == YAFFS_OBJECT_TYPE_FILE)
+		cp->fileSizeOrEquivalentObjectId =
+		    obj->variant.fileVariant.fileSize;
+	else if (obj->variantType == YAFFS_OBJECT_TYPE_HARDLINK)
+		cp->fileSizeOrEquivalentObjectId =
+		    obj->variant.hardLinkVariant.equivalentObjectId;
+
+	cp->sum = obj->sum;
+	cp->nameHash = obj->nameHash;
+#ifdef CONFIG_YAFFS_SHORT_NAMES_IN_RAM
+	memcpy(cp->shortName, obj->shortName, sizeof(cp->shortName));
+#endif
+
+	cp->yst_mode = obj->yst_mode;
+#ifdef CONFIG_YAFFS_WINCE
+	memcpy(cp->win_ctime, obj->win_ctime, sizeof(cp->win_ctime));
+	memcpy(cp->win_mtime, obj->win_mtime, sizeof(cp->win_mtime));
+	memcpy(cp->win_atime, obj->win_atime, sizeof(cp->win_atime));
+#else
+	cp->yst_uid = obj->yst_uid;
+	cp->yst_gid = obj->yst_gid;
+	cp->yst_atime = obj->yst_atime;
+	cp->yst_mtime = obj->yst_mtime;
+	cp->yst_ctime = obj->yst_ctime;
+#endif
+	cp->yst_rdev = obj->yst_rdev;
+
+	if (obj->variantType == YAFFS_OBJECT_TYPE_SYMLINK &&
+	    obj->variant.symLinkVariant.alias)
+		cp->aliasLength =
+		    (yaffs_strlen(obj->variant.symLinkVariant.alias) +
+		     1) * sizeof(YCHAR);
+}
+
+static void yaffs_CheckpointAttributesToObject(yaffs_Object * obj,
+					       yaffs_CheckpointObject * cp)
+{
+	obj->yst_mode = cp->yst_mode;
+#ifdef CONFIG_YAFFS_WINCE
+	memcpy(obj->win_ctime, cp->win_ctime, sizeof(obj->win_ctime));
+	memcpy(obj->win_mtime, cp->win_mtime, sizeof(obj->win_mtime));
+	memcpy(obj->win_atime, cp->win_atime, sizeof(obj->win_atime));
+#else
+	obj->yst_uid = cp->yst_uid;
+	obj->yst_gid = cp->yst_gid;
+	obj->yst_atime = cp->yst_atime;
+	obj->yst_mtime = cp->yst_mtime;
+	obj->yst_ctime = cp->yst_ctime;
+#endif
+	obj->yst_rdev = cp->yst_rdev;
+}
+
+static int yaffs_CheckpointObjectToObject(yaffs_Object * obj,
+					  yaffs_CheckpointObject * cp)
+{
+	yaffs_Device *dev = obj->myDev;
+	yaffs_Object *parent;
+
+	/* Either a duplicate or a parent that turned out not to be one */
+	if (obj->valid || obj->variantType != cp->variantType)
+		return 0;
+
+	/* Root and lost+found are fake directories that may still have a
+	 * header on NAND. As in the scan, only their attributes are loaded
+	 * and the directory structure is left alone.
+	 */
+	if (obj->fake) {
+		if (obj->objectId != YAFFS_OBJECTID_ROOT &&
+		    obj->objectId != YAFFS_OBJECTID_LOSTNFOUND)
+			return 0;
+		obj->chunkId = cp->chunkId;
+		obj->valid = 1;
+		yaffs_CheckpointAttributesToObject(obj, cp);
+		return 1;
+	}
+
+	/* The name has to be in place before the object goes into its
+	 * parent's name index.
+	 */
+	obj->sum = cp->sum;
+	obj->nameHash = cp->nameHash;
+#ifdef CONFIG_YAFFS_SHORT_NAMES_IN_RAM
+	memcpy(obj->shortName, cp->shortName, sizeof(obj->shortName));
+	obj->shortName[YAFFS_SHORT_NAME_LENGTH] = 0;
+#endif
+
+	if (cp->parentId) {
+		parent = yaffs_FindOrCreateObjectByNumber(dev,
+							  cp->parentId,
+							  YAFFS_OBJECT_TYPE_DIRECTORY);
+		if (!parent ||
+		    parent->variantType != YAFFS_OBJECT_TYPE_DIRECTORY)
+			return 0;
+		yaffs_AddObjectToDirectory(parent, obj);
+	} else {
+		yaffs_RemoveObjectFromDirectory(obj);
+	}
+
+	obj->chunkId = cp->chunkId;
+	obj->deleted = cp->deleted;
+	obj->softDeleted = cp->softDeleted;
+	obj->unlinked = cp->unlinked;
+	obj->renameAllowed = cp->renameAllowed;
+	obj->unlinkAllowed = cp->unlinkAllowed;
+	obj->dirty = cp->dirty;
+	obj->serial = cp->serial;
+	obj->nDataChunks = cp->nDataChunks;
+	obj->valid = 1;
+
+	if (obj->variantType == YAFFS_OBJECT_TYPE_FILE) {
+		obj->variant.fileVariant.fileSize =
+		    cp->fileSizeOrEquivalentObjectId;
+		obj->variant.fileVariant.scannedFileSize =
+		    cp->fileSizeOrEquivalentObjectId;
+	} else if (obj->variantType == YAFFS_OBJECT_TYPE_HARDLINK)
+		obj->variant.hardLinkVariant.equivalentObjectId =
+		    cp->fileSizeOrEquivalentObjectId;
+
+	yaffs_CheckpointAttributesToObject(obj, cp);
+
+	return 1;
+}
+
+static int yaffs_CheckpointTnodeWorker(yaffs_Object * in, yaffs_Tnode * tn,
+				       __u32 level, int chunkOffset)
+{
+	int i;
+	yaffs_Device *dev = in->myDev;
+	int ok = 1;
+
+	if (tn) {
+		if (level > 0) {
+
+			for (i = 0; i < YAFFS_NTNODES_INTERNAL && ok; i++) {
+				if (tn->internal[i]) {
+					ok = yaffs_CheckpointTnodeWorker(in,
+									 tn->
+									 internal
+									 [i],
+									 level -
+									 1,
+									 (chunkOffset
+									  <<
+									  YAFFS_TNODES_INTERNAL_BITS)
+									 + i);
+				}
 			}
+		} else if (level == 0) {
+			__u32 baseOffset =
+			    chunkOffset << YAFFS_TNODES_LEVEL0_BITS;
+			__u16 level0[YAFFS_NTNODES_LEVEL0];
+
+			/* Always written full width, a compact top is padded */
+			memset(level0, 0, sizeof(level0));
+			memcpy(level0, tn->level0,
+			       yaffs_Level0Entries(&in->variant.fileVariant) *
+			       sizeof(__u16));
+			ok = (yaffs_CheckpointWrite
+			      (dev, &baseOffset,
+			       sizeof(baseOffset)) == sizeof(baseOffset));
+			if (ok)
+				ok = (yaffs_CheckpointWrite
+				      (dev, level0,
+				       sizeof(level0)) == sizeof(level0));
 		}
+	}
 
-		/* Soft delete all the deletedDir files */
-		list_for_each_safe(i, n,
-				   &dev->deletedDir->variant.directoryVariant.
-				   children) {
-			if (i) {
-				l = list_entry(i, yaffs_Object, siblings);
-				yaffs_DestroyObject(l);
+	return ok;
+
+}
+
+static int yaffs_WriteCheckpointTnodes(yaffs_Object * obj)
+{
+	__u32 endMarker = ~0;
+	int ok = 1;
+
+	if (obj->variantType == YAFFS_OBJECT_TYPE_FILE) {
+		ok = yaffs_CheckpointTnodeWorker(obj,
+						 obj->variant.fileVariant.top,
+						 obj->variant.fileVariant.
+						 topLevel, 0);
+		if (ok)
+			ok = (yaffs_CheckpointWrite
+			      (obj->myDev, &endMarker,
+			       sizeof(endMarker)) == sizeof(endMarker));
+	}
+
+	return ok ? 1 : 0;
+}
+
+static int yaffs_ReadCheckpointTnodes(yaffs_Object * obj)
+{
+	__u32 baseChunk;
+	int ok = 1;
+	yaffs_Device *dev = obj->myDev;
+	yaffs_FileStructure *fStruct = &obj->variant.fileVariant;
+	yaffs_Tnode *tn;
+	__u16 level0[YAFFS_NTNODES_LEVEL0];
+	int last;
 
+	ok = (yaffs_CheckpointRead(dev, &baseChunk, sizeof(baseChunk)) ==
+	      sizeof(baseChunk));
+
+	while (ok && (~baseChunk)) {
+		ok = (yaffs_CheckpointRead(dev, level0, sizeof(level0)) ==
+		      sizeof(level0));
+
+		/* Asking for the last chunk in use gets a tnode wide
+		 * enough, so small files come back with a compact top.
+		 */
+		for (last = YAFFS_NTNODES_LEVEL0 - 1;
+		     last >= 0 && !level0[last]; last--) {
+		}
+
+		if (ok && last >= 0) {
+			tn = yaffs_AddOrFindLevel0Tnode(dev, fStruct,
+							baseChunk + last);
+			if (tn)
+				memcpy(tn->level0, level0,
+				       yaffs_Level0Entries(fStruct) *
+				       sizeof(__u16));
+			else
+				ok = 0;
+		}
+
+		if (ok)
+			ok = (yaffs_CheckpointRead
+			      (dev, &baseChunk,
+			       sizeof(baseChunk)) == sizeof(baseChunk));
+
+	}
+
+	return ok ? 1 : 0;
+}
+
+static int yaffs_WriteCheckpointObjects(yaffs_Device * dev)
+{
+	yaffs_Object *obj;
+	yaffs_CheckpointObject cp;
+	int i;
+	int ok = 1;
+	struct list_head *lh;
+
+	/* Iterate through the objects in each hash entry,
+	 * dumping them to the checkpointing stream.
+	 * Fake directories are rebuilt at mount, but root and
+	 * lost+found keep their attributes, so those two are
+	 * written. Objects waiting on a defered free are already
+	 * gone from NAND.
+	 */
+
+	for (i = 0; ok && i < YAFFS_NOBJECT_BUCKETS; i++) {
+		list_for_each(lh, &dev->objectBucket[i].list) {
+			obj = list_entry(lh, yaffs_Object, hashLink);
+			if (!ok || obj->deferedFree)
+				continue;
+			if (obj->fake &&
+			    obj->objectId != YAFFS_OBJECTID_ROOT &&
+			    obj->objectId != YAFFS_OBJECTID_LOSTNFOUND)
+				continue;
+
+			yaffs_ObjectToCheckpointObject(&cp, obj);
+			ok = (yaffs_CheckpointWrite(dev, &cp, sizeof(cp)) ==
+			      sizeof(cp));
+
+			if (ok && cp.aliasLength)
+				ok = (yaffs_CheckpointWrite
+				      (dev, obj->variant.symLinkVariant.alias,
+				       cp.aliasLength) == cp.aliasLength);
+
+			if (ok && obj->variantType == YAFFS_OBJECT_TYPE_FILE)
+				ok = yaffs_WriteCheckpointTnodes(obj);
+		}
+	}
+
+	/* Dump end of list */
+	memset(&cp, 0xFF, sizeof(yaffs_CheckpointObject));
+	cp.structType = sizeof(cp);
+
+	if (ok)
+		ok = (yaffs_CheckpointWrite(dev, &cp, sizeof(cp)) == sizeof(cp));
+
+	return ok ? 1 : 0;
+}
+
+static int yaffs_ReadCheckpointObjects(yaffs_Device * dev)
+{
+	yaffs_Object *obj;
+	yaffs_CheckpointObject cp;
+	int ok = 1;
+	int done = 0;
+	int i;
+	struct list_head *lh;
+	yaffs_Object *hardList = NULL;
+
+	while (ok && !done) {
+		ok = (yaffs_CheckpointRead(dev, &cp, sizeof(cp)) == sizeof(cp));
+		if (cp.structType != sizeof(cp))
+			ok = 0;
+
+		if (ok && cp.objectId == ~0)
+			done = 1;
+		else if (ok) {
+			T(YAFFS_TRACE_CHECKPOINT,
+			  (TSTR("Read object %d parent %d type %d" TENDSTR),
+			   cp.objectId, cp.parentId, cp.variantType));
+			obj = yaffs_FindOrCreateObjectByNumber(dev, cp.objectId,
+							      cp.variantType);
+			ok = obj && yaffs_CheckpointObjectToObject(obj, &cp);
+
+			if (ok && cp.aliasLength) {
+				if (obj->variantType !=
+				    YAFFS_OBJECT_TYPE_SYMLINK ||
+				    cp.aliasLength >
+				    (YAFFS_MAX_ALIAS_LENGTH + 1) * sizeof(YCHAR))
+					ok = 0;
+				else
+					obj->variant.symLinkVariant.alias =
+					    YMALLOC(cp.aliasLength);
+				if (ok && obj->variant.symLinkVariant.alias)
+					ok = (yaffs_CheckpointRead
+					      (dev,
+					       obj->variant.symLinkVariant.
+					       alias,
+					       cp.aliasLength) ==
+					      cp.aliasLength);
+				else
+					ok = 0;
+			}
+
+			if (ok && obj->variantType == YAFFS_OBJECT_TYPE_FILE) {
+				ok = yaffs_ReadCheckpointTnodes(obj);
+			} else if (ok &&
+				   obj->variantType ==
+				   YAFFS_OBJECT_TYPE_HARDLINK) {
+				obj->hardLinks.next =
+				    (struct list_head *)hardList;
+				hardList = obj;
 			}
 		}
 	}
 
-	yaffs_ReleaseTempBuffer(dev, chunkData, __LINE__);
+	/* Every directory a record referred to must have had a record too */
+	for (i = 0; ok && i < YAFFS_NOBJECT_BUCKETS; i++) {
+		list_for_each(lh, &dev->objectBucket[i].list) {
+			obj = list_entry(lh, yaffs_Object, hashLink);
+			if (!obj->fake && !obj->valid)
+				ok = 0;
+		}
+	}
 
-	T(YAFFS_TRACE_SCAN, (TSTR("yaffs_ScanBackwards ends" TENDSTR)));
+	if (ok)
+		yaffs_HardlinkFixup(dev, hardList);
 
-	return YAFFS_OK;
+	return ok ? 1 : 0;
+}
+
+static int yaffs_WriteCheckpointSum(yaffs_Device * dev)
+{
+	__u32 checkpointSum = yaffs_GetCheckpointSum(dev);
+
+	return (yaffs_CheckpointWrite(dev, &checkpointSum,
+				      sizeof(checkpointSum)) ==
+		sizeof(checkpointSum)) ? 1 : 0;
+}
+
+static int yaffs_ReadCheckpointSum(yaffs_Device * dev)
+{
+	__u32 checkpointSum0 = yaffs_GetCheckpointSum(dev);
+	__u32 checkpointSum1;
+
+	if (yaffs_CheckpointRead(dev, &checkpointSum1,
+				 sizeof(checkpointSum1)) !=
+	    sizeof(checkpointSum1))
+		return 0;
+
+	return (checkpointSum0 == checkpointSum1) ? 1 : 0;
+}
+
+static int yaffs_WriteCheckpointData(yaffs_Device * dev)
+{
+	int ok;
+
+	ok = yaffs_CheckpointOpen(dev, 1);
+
+	if (ok)
+		ok = yaffs_WriteCheckpointValidityMarker(dev, 1);
+	if (ok)
+		ok = yaffs_WriteCheckpointDevice(dev);
+	if (ok)
+		ok = yaffs_WriteCheckpointObjects(dev);
+	if (ok)
+		ok = yaffs_WriteCheckpointValidityMarker(dev, 0);
+	if (ok)
+		ok = yaffs_WriteCheckpointSum(dev);
+
+	if (!yaffs_CheckpointClose(dev))
+		ok = 0;
+
+	dev->isCheckpointed = ok ? 1 : 0;
+
+	return dev->isCheckpointed;
+}
+
+static int yaffs_ReadCheckpointData(yaffs_Device * dev)
+{
+	int ok;
+
+	ok = yaffs_CheckpointOpen(dev, 0);	/* open for read */
+
+	if (ok)
+		ok = yaffs_ReadCheckpointValidityMarker(dev, 1);
+	if (ok)
+		ok = yaffs_ReadCheckpointDevice(dev);
+	if (ok)
+		ok = yaffs_ReadCheckpointObjects(dev);
+	if (ok)
+		ok = yaffs_ReadCheckpointValidityMarker(dev, 0);
+	if (ok)
+		ok = yaffs_ReadCheckpointSum(dev);
+
+	if (!yaffs_CheckpointClose(dev))
+		ok = 0;
+
+	dev->isCheckpointed = ok ? 1 : 0;
+
+	return dev->isCheckpointed;
+}
+
+/* Called before anything changes on NAND. Once the flash moves on from the
+ * checkpoint it must never be mounted from, so get rid of it.
+ */
+static void yaffs_InvalidateCheckpoint(yaffs_Device * dev)
+{
+	if (dev->isCheckpointed || dev->blocksInCheckpoint > 0) {
+		dev->isCheckpointed = 0;
+		yaffs_CheckpointInvalidateStream(dev);
+	}
+}
+
+/* Write a checkpoint of the current state unless there is one already.
+ * Called on clean unmount and sync.
+ */
+int yaffs_CheckpointSave(yaffs_Device * dev)
+{
+	__u32 start;
+
+	if (!dev->useCheckpoint || !dev->isYaffs2) {
+		return 0;
+	}
+
+	T(YAFFS_TRACE_CHECKPOINT,
+	  (TSTR("save entry: isCheckpointed %d" TENDSTR), dev->isCheckpointed));
+
+	if (!dev->isCheckpointed) {
+		start = Y_CLOCK_US();
+
+		/* Neither cached data nor a part collected block can be
+		 * described by the checkpoint, so get them onto NAND first.
+		 */
+		yaffs_FlushEntireDeviceCache(dev);
+		if (dev->gcBlock > 0 && !dev->isDoingGC) {
+			yaffs_GarbageCollectBlock(dev, dev->gcBlock, 1);
+		}
+		/* Nor can a block that is still being erased */
+		yaffs_DrainErases(dev);
+
+		if (dev->gcBlock <= 0 && yaffs_WriteCheckpointData(dev)) {
+			dev->nCheckpointSaves++;
+		}
+		dev->checkpointSaveTime = Y_CLOCK_US() - start;
+	}
+
+	T(YAFFS_TRACE_CHECKPOINT,
+	  (TSTR("save exit: isCheckpointed %d" TENDSTR), dev->isCheckpointed));
+
+	return dev->isCheckpointed;
+}
+
+int yaffs_CheckpointRestore(yaffs_Device * dev)
+{
+	int retval;
+
+	if (!dev->useCheckpoint || !dev->isYaffs2) {
+		return 0;
+	}
+
+	T(YAFFS_TRACE_CHECKPOINT,
+	  (TSTR("restore entry: isCheckpointed %d" TENDSTR),
+	   dev->isCheckpointed));
+
+	retval = yaffs_ReadCheckpointData(dev);
+
+	if (retval) {
+		/* Same clean up as the scan does */
+		yaffs_StripDeletedObjects(dev);
+	}
+
+	T(YAFFS_TRACE_CHECKPOINT,
+	  (TSTR("restore exit: isCheckpointed %d" TENDSTR),
+	   dev->isCheckpointed));
+
+	return retval;
 }
 
 /*------------------------------  Directory Functions ----------------------------- */
 
+/* The name index hashes a directory's children on their name sum so that
+ * yaffs_FindObjectByName() only has to look at the few children whose sum
+ * matches. Small directories are not indexed and are searched linearly.
+ */
+static Y_INLINE int yaffs_NameBucket(yaffs_Object * directory, __u16 sum)
+{
+	return (sum ^ (sum >> 7)) &
+	    (directory->variant.directoryVariant.nNameBuckets - 1);
+}
+
+static void yaffs_IndexObjectName(yaffs_Object * obj)
+{
+	yaffs_Object *parent = obj->parent;
+	yaffs_DirectoryStructure *dir;
+
+	if (!parent || list_empty(&obj->siblings))
+		return;
+
+	dir = &parent->variant.directoryVariant;
+	if (dir->nameBuckets) {
+		list_add(&obj->nameLink,
+			 &dir->nameBuckets[yaffs_NameBucket(parent, obj->sum)]);
+	}
+}
+
+static void yaffs_FreeNameIndex(yaffs_Object * directory)
+{
+	yaffs_DirectoryStructure *dir = &directory->variant.directoryVariant;
+
+	if (directory->variantType == YAFFS_OBJECT_TYPE_DIRECTORY &&
+	    dir->nameBuckets) {
+		YFREE(dir->nameBuckets);
+		dir->nameBuckets = NULL;
+		dir->nNameBuckets = 0;
+	}
+}
+
+static void yaffs_BuildNameIndex(yaffs_Object * directory, int nBuckets)
+{
+	yaffs_DirectoryStructure *dir = &directory->variant.directoryVariant;
+	struct list_head *buckets;
+	struct list_head *i;
+	yaffs_Object *l;
+	int b;
+
+	buckets = YMALLOC(nBuckets * sizeof(struct list_head));
+	if (!buckets) {
+		/* Not fatal, we just keep using the old index or the list */
+		T(YAFFS_TRACE_ALLOCATE,
+		  (TSTR("yaffs: Could not allocate name index of %d buckets"
+			TENDSTR), nBuckets));
+		return;
+	}
+
+	for (b = 0; b < nBuckets; b++) {
+		INIT_LIST_HEAD(&buckets[b]);
+	}
+
+	/* Every child gets relinked below, so the old buckets can go now */
+	if (dir->nameBuckets) {
+		YFREE(dir->nameBuckets);
+	}
+	dir->nameBuckets = buckets;
+	dir->nNameBuckets = nBuckets;
+
+	list_for_each(i, &dir->children) {
+		l = list_entry(i, yaffs_Object, siblings);
+		list_add(&l->nameLink,
+			 &buckets[yaffs_NameBucket(directory, l->sum)]);
+	}
+}
+
 static void yaffs_RemoveObjectFromDirectory(yaffs_Object * obj)
 {
 	yaffs_Device *dev = obj->myDev;
+	yaffs_Object *parent = obj->parent;
 	
 	if(dev && dev->removeObjectCallback)
 		dev->removeObjectCallback(obj);
+
+	list_del_init(&obj->nameLink);
+
+	if (parent && !list_empty(&obj->siblings)) {
+		parent->variant.directoryVariant.nChildren--;
+		if (parent->variant.directoryVariant.nChildren <= 0) {
+			parent->variant.directoryVariant.nChildren = 0;
+			yaffs_FreeNameIndex(parent);
+		}
+	}
 	   
 	list_del_init(&obj->siblings);
 	obj->parent = NULL;
@@ -5073,6 +6575,7 @@ static void yaffs_RemoveObjectFromDirectory(yaffs_Object * obj)
 static void yaffs_AddObjectToDirectory(yaffs_Object * directory,
 				       yaffs_Object * obj)
 {
+	yaffs_DirectoryStructure *dir;
 
 	if (!directory) {
 		T(YAFFS_TRACE_ALWAYS,
@@ -5092,14 +6595,32 @@ static void yaffs_AddObjectToDirectory(yaffs_Object * directory,
 	if (obj->siblings.prev == NULL) {
 		/* Not initialised */
 		INIT_LIST_HEAD(&obj->siblings);
+		INIT_LIST_HEAD(&obj->nameLink);
 
 	} else if (!list_empty(&obj->siblings)) {
 		/* If it is holed up somewhere else, un hook it */
 		yaffs_RemoveObjectFromDirectory(obj);
 	}
 	/* Now add it */
-	list_add(&obj->siblings, &directory->variant.directoryVariant.children);
+	dir = &directory->variant.directoryVariant;
+	list_add(&obj->siblings, &dir->children);
 	obj->parent = directory;
+	dir->nChildren++;
+
+	if (!dir->nameBuckets) {
+		if (dir->nChildren >= YAFFS_DIR_INDEX_THRESHOLD) {
+			yaffs_BuildNameIndex(directory,
+					     YAFFS_DIR_INDEX_BUCKETS);
+		}
+	} else if (dir->nChildren > dir->nNameBuckets * YAFFS_DIR_INDEX_LOAD &&
+		   dir->nNameBuckets < YAFFS_DIR_INDEX_MAX_BUCKETS) {
+		yaffs_BuildNameIndex(directory, dir->nNameBuckets * 2);
+	}
+
+	/* A freshly built index already holds obj */
+	if (list_empty(&obj->nameLink)) {
+		yaffs_IndexObjectName(obj);
+	}
 
 	if (directory == obj->myDev->unlinkedDir
 	    || directory == obj->myDev->deletedDir) {
@@ -5109,15 +6630,55 @@ static void yaffs_AddObjectToDirectory(yaffs_Object * directory,
 	}
 }
 
+/* Objects that have no object header yet (chunkId <= 0) are not known by
+ * their sum, but by a made up "objNNN" name. Look those up by number.
+ */
+static yaffs_Object *yaffs_FindHeaderlessObject(yaffs_Object * directory,
+						const YCHAR * name)
+{
+	const YCHAR *prefix = YAFFS_LOSTNFOUND_PREFIX;
+	const YCHAR *digits = name;
+	YCHAR buffer[YAFFS_MAX_NAME_LENGTH + 1];
+	yaffs_Object *l;
+	__u32 number = 0;
+
+	while (*prefix) {
+		if (*digits != *prefix)
+			return NULL;
+		digits++;
+		prefix++;
+	}
+
+	if (!*digits)
+		return NULL;
+
+	for (; *digits; digits++) {
+		if (*digits < _Y('0') || *digits > _Y('9'))
+			return NULL;
+		number = number * 10 + (*digits - _Y('0'));
+	}
+
+	l = yaffs_FindObjectByNumber(directory->myDev, number);
+	if (l && l->parent == directory && l->chunkId <= 0) {
+		yaffs_GetObjectName(l, buffer, YAFFS_MAX_NAME_LENGTH);
+		if (yaffs_strcmp(name, buffer) == 0) {
+			return l;
+		}
+	}
+
+	return NULL;
+}
+
 yaffs_Object *yaffs_FindObjectByName(yaffs_Object * directory,
 				     const YCHAR * name)
 {
-	int sum;
+	__u16 sum;
 
 	struct list_head *i;
 	YCHAR buffer[YAFFS_MAX_NAME_LENGTH + 1];
 
 	yaffs_Object *l;
+	yaffs_DirectoryStructure *dir;
 
 	if (!name) {
 		return NULL;
@@ -5138,8 +6699,39 @@ yaffs_Object *yaffs_FindObjectByName(yaffs_Object * directory,
 	}
 
 	sum = yaffs_CalcNameSum(name);
+	dir = &directory->variant.directoryVariant;
+
+	if (dir->nameBuckets) {
+		__u32 hash = yaffs_CalcNameHash(name);
+
+		/* Special case for lost-n-found */
+		l = directory->myDev->lostNFoundDir;
+		if (l && l->parent == directory &&
+		    yaffs_strcmp(name, YAFFS_LOSTNFOUND_NAME) == 0) {
+			return l;
+		}
+
+		list_for_each(i, &dir->nameBuckets[yaffs_NameBucket(directory, sum)]) {
+			l = list_entry(i, yaffs_Object, nameLink);
 
-	list_for_each(i, &directory->variant.directoryVariant.children) {
+			if (yaffs_SumCompare(l->sum, sum) &&
+			    l->nameHash == hash &&
+			    l->objectId != YAFFS_OBJECTID_LOSTNFOUND) {
+				/* Names longer than the short name need a
+				 * NAND read, but only to confirm a match.
+				 */
+				yaffs_GetObjectName(l, buffer,
+						    YAFFS_MAX_NAME_LENGTH);
+				if (yaffs_strcmp(name, buffer) == 0) {
+					return l;
+				}
+			}
+		}
+
+		return yaffs_FindHeaderlessObject(directory, name);
+	}
+
+	list_for_each(i, &dir->children) {
 		if (i) {
 			l = list_entry(i, yaffs_Object, siblings);
 
@@ -5449,12 +7041,35 @@ static int yaffs_CheckDevFunctions(const yaffs_Device * dev)
 	return 0;		/* bad */
 }
 
+/* The unlinked, deleted, root and lost and found directories have no
+ * presence on NAND and are made up at every mount.
+ */
+static void yaffs_CreateInitialDirectories(yaffs_Device * dev)
+{
+	dev->lostNFoundDir = dev->rootDir =  NULL;
+	dev->unlinkedDir = dev->deletedDir = NULL;
+
+	dev->unlinkedDir =
+	    yaffs_CreateFakeDirectory(dev, YAFFS_OBJECTID_UNLINKED, S_IFDIR);
+	dev->deletedDir =
+	    yaffs_CreateFakeDirectory(dev, YAFFS_OBJECTID_DELETED, S_IFDIR);
+
+	dev->rootDir =
+	    yaffs_CreateFakeDirectory(dev, YAFFS_OBJECTID_ROOT,
+				      YAFFS_ROOT_MODE | S_IFDIR);
+	dev->lostNFoundDir =
+	    yaffs_CreateFakeDirectory(dev, YAFFS_OBJECTID_LOSTNFOUND,
+				      YAFFS_LOSTNFOUND_MODE | S_IFDIR);
+	yaffs_AddObjectToDirectory(dev->rootDir, dev->lostNFoundDir);
+}
+
 int yaffs_GutsInitialise(yaffs_Device * dev)
 {
 	unsigned x;
 	int bits;
 	int extraBits;
 	int nBlocks;
+	__u32 start;
 
 	T(YAFFS_TRACE_TRACING, (TSTR("yaffs: yaffs_GutsInitialise()" TENDSTR)));
 
@@ -5470,6 +7085,7 @@ int yaffs_GutsInitialise(yaffs_Device * dev)
 	dev->blockOffset = 0;
 	dev->chunkOffset = 0;
 	dev->nFreeChunks = 0;
+	dev->nErasesInFlight = 0;
 
 	if (dev->startBlock == 0) {
 		dev->internalStartBlock = dev->startBlock + 1;
@@ -5568,7 +7184,6 @@ int yaffs_GutsInitialise(yaffs_Device * dev)
 	/* More device initialisation */
 	dev->garbageCollections = 0;
 	dev->passiveGarbageCollections = 0;
-	dev->currentDirtyChecker = 0;
 	dev->bufferedBlock = -1;
 	dev->doingBufferedBlockRewrite = 0;
 	dev->nDeletedFiles = 0;
@@ -5581,6 +7196,29 @@ int yaffs_GutsInitialise(yaffs_Device * dev)
 	dev->nErasureFailures = 0;
 	dev->nErasedBlocks = 0;
 	dev->isDoingGC = 0;
+	dev->gcBlock = 0;
+	dev->gcChunk = 0;
+	dev->nCleanups = 0;
+	dev->nonAggressiveSkip = 0;
+	dev->isCheckpointed = 0;
+	dev->blocksInCheckpoint = 0;
+	dev->checkpointBuffer = NULL;
+	dev->checkpointBlockList = NULL;
+	dev->mountFromCheckpoint = 0;
+	dev->mountTime = 0;
+	dev->nCheckpointSaves = 0;
+	dev->checkpointSaveTime = 0;
+	dev->freeListBytes = 0;
+
+	if (!dev->compactTnodes || !dev->allocTnode) {
+		dev->compactTnodes = 0;
+	}
+
+	if (!dev->gcWatermark) {
+		dev->gcWatermark =
+		    (dev->nReservedBlocks + YAFFS_GC_WATERMARK_BLOCKS) *
+		    dev->nChunksPerBlock;
+	}
 
 	/* Initialise temporary buffers */
 	{
@@ -5610,43 +7248,92 @@ int yaffs_GutsInitialise(yaffs_Device * dev)
 		dev->srCache =
 		    YMALLOC(dev->nShortOpCaches * sizeof(yaffs_ChunkCache));
 
+		/* Size the hash to the next power of 2 up */
+		for (dev->srHashMask = 1;
+		     dev->srHashMask < dev->nShortOpCaches;
+		     dev->srHashMask <<= 1) {
+		}
+		dev->srHash =
+		    YMALLOC(dev->srHashMask * sizeof(struct list_head));
+		for (i = 0; i < dev->srHashMask; i++) {
+			INIT_LIST_HEAD(&dev->srHash[i]);
+		}
+		dev->srHashMask--;
+
+		INIT_LIST_HEAD(&dev->srLru);
+		INIT_LIST_HEAD(&dev->srFree);
 		for (i = 0; i < dev->nShortOpCaches; i++) {
 			dev->srCache[i].object = NULL;
-			dev->srCache[i].lastUse = 0;
 			dev->srCache[i].dirty = 0;
+			dev->srCache[i].locked = 0;
+			INIT_LIST_HEAD(&dev->srCache[i].hashLink);
+			INIT_LIST_HEAD(&dev->srCache[i].dirtyLink);
+			list_add_tail(&dev->srCache[i].lruLink, &dev->srFree);
 			dev->srCache[i].data = YMALLOC(dev->nBytesPerChunk);
 		}
-		dev->srLastUse = 0;
 	}
+	dev->srDirty = 0;
 
-	dev->cacheHits = 0;
+	dev->tableBytes =
+	    nBlocks * (sizeof(yaffs_BlockInfo) + dev->chunkBitmapStride +
+		       sizeof(yaffs_GCLink)) +
+	    dev->nChunksPerBlock * (sizeof(int) + sizeof(__u32)) +
+	    YAFFS_N_TEMP_BUFFERS * dev->nBytesPerChunk;
+	if (dev->nShortOpCaches > 0) {
+		dev->tableBytes +=
+		    dev->nShortOpCaches * (sizeof(yaffs_ChunkCache) +
+					   dev->nBytesPerChunk) +
+		    (dev->srHashMask + 1) * sizeof(struct list_head);
+	}
 
-	/* Initialise the unlinked, root and lost and found directories */
-	dev->lostNFoundDir = dev->rootDir =  NULL;
-	dev->unlinkedDir = dev->deletedDir = NULL;
+	Y_ATOMIC_SET(&dev->cacheHits, 0);
+	Y_ATOMIC_SET(&dev->cacheMisses, 0);
+	dev->cacheEvictions = 0;
+	dev->cacheWritebacks = 0;
 
-	dev->unlinkedDir =
-	    yaffs_CreateFakeDirectory(dev, YAFFS_OBJECTID_UNLINKED, S_IFDIR);
-	dev->deletedDir =
-	    yaffs_CreateFakeDirectory(dev, YAFFS_OBJECTID_DELETED, S_IFDIR);
-
-	dev->rootDir =
-	    yaffs_CreateFakeDirectory(dev, YAFFS_OBJECTID_ROOT,
-				      YAFFS_ROOT_MODE | S_IFDIR);
-	dev->lostNFoundDir =
-	    yaffs_CreateFakeDirectory(dev, YAFFS_OBJECTID_LOSTNFOUND,
-				      YAFFS_LOSTNFOUND_MODE | S_IFDIR);
-	yaffs_AddObjectToDirectory(dev->rootDir, dev->lostNFoundDir);
+	yaffs_CreateInitialDirectories(dev);
 
 	if (dev->isYaffs2) {
 		dev->useHeaderFileSize = 1;
 	}
 
-	/* Now scan the flash.   */
-	if (dev->isYaffs2)
+	/* Now scan the flash, unless we can restore a checkpoint.  */
+	start = Y_CLOCK_US();
+	if (yaffs_CheckpointRestore(dev)) {
+		dev->mountFromCheckpoint = 1;
+	} else if (dev->isYaffs2) {
+		if (dev->useCheckpoint) {
+			/* Clean up the mess caused by an aborted checkpoint
+			 * load before scanning.
+			 */
+			yaffs_DeinitialiseBlocks(dev);
+			yaffs_DeinitialiseObjects(dev);
+			yaffs_DeinitialiseTnodes(dev);
+
+			dev->nErasedBlocks = 0;
+			dev->nFreeChunks = 0;
+			dev->nUnlinkedFiles = 0;
+			dev->allocationBlockFinder = 0;
+			dev->blocksInCheckpoint = 0;
+
+			yaffs_InitialiseBlocks(dev, nBlocks);
+			yaffs_InitialiseTnodes(dev);
+			yaffs_InitialiseObjects(dev);
+			yaffs_CreateInitialDirectories(dev);
+		}
 		yaffs_ScanBackwards(dev);
-	else
+	} else
 		yaffs_Scan(dev);
+	/* The scan may have queued erases of blocks it found dirty */
+	yaffs_DrainErases(dev);
+	dev->mountTime = Y_CLOCK_US() - start;
+
+	T(YAFFS_TRACE_ALWAYS,
+	  (TSTR("yaffs: %s mounted from %s in %u us" TENDSTR),
+	   dev->name ? dev->name : "",
+	   dev->mountFromCheckpoint ? "checkpoint" : "scan", dev->mountTime));
+
+	yaffs_RebuildGCIndex(dev);
 
 	/* Zero out stats */
 	dev->nPageReads = 0;
@@ -5654,8 +7341,17 @@ int yaffs_GutsInitialise(yaffs_Device * dev)
 	dev->nBlockErasures = 0;
 	dev->nGCCopies = 0;
 	dev->nRetriedWrites = 0;
+	dev->nBackgroundGCSlices = 0;
+	dev->nBackgroundGCCopies = 0;
+	dev->gcTimeForeground = 0;
+	dev->gcTimeBackground = 0;
+	dev->gcMaxStall = 0;
+	memset(dev->gcStalls, 0, sizeof(dev->gcStalls));
+	memset(dev->eraseStalls, 0, sizeof(dev->eraseStalls));
+	memset(dev->allocStalls, 0, sizeof(dev->allocStalls));
 
 	dev->nRetiredBlocks = 0;
+	dev->nFreeVerifyFailures = 0;
 
 	yaffs_VerifyFreeChunks(dev);
 
@@ -5670,9 +7366,11 @@ void yaffs_Deinitialise(yaffs_Device * dev)
 	if (dev->isMounted) {
 		int i;
 
+		yaffs_DrainErases(dev);
 		yaffs_DeinitialiseBlocks(dev);
-		yaffs_DeinitialiseTnodes(dev);
+		/* Objects first, they hand their tnodes back */
 		yaffs_DeinitialiseObjects(dev);
+		yaffs_DeinitialiseTnodes(dev);
 		if (dev->nShortOpCaches > 0) {
 
 			for (i = 0; i < dev->nShortOpCaches; i++) {
@@ -5680,6 +7378,7 @@ void yaffs_Deinitialise(yaffs_Device * dev)
 			}
 
 			YFREE(dev->srCache);
+			YFREE(dev->srHash);
 		}
 
 		YFREE(dev->gcCleanupList);
@@ -5693,22 +7392,30 @@ void yaffs_Deinitialise(yaffs_Device * dev)
 
 }
 
-static int yaffs_CountFreeChunks(yaffs_Device * dev)
+/* Recount the free chunks and erased blocks from the block states. This
+ * walks every block, so it is only used to check the running counters.
+ */
+static int yaffs_CountFreeChunks(yaffs_Device * dev, int *nErased)
 {
 	int nFree;
 	int b;
 
 	yaffs_BlockInfo *blk;
 
+	*nErased = 0;
+
 	for (nFree = 0, b = dev->internalStartBlock; b <= dev->internalEndBlock;
 	     b++) {
 		blk = yaffs_GetBlockInfo(dev, b);
 
 		switch (blk->blockState) {
 		case YAFFS_BLOCK_STATE_EMPTY:
+			(*nErased)++;
+			/* fall through */
 		case YAFFS_BLOCK_STATE_ALLOCATING:
 		case YAFFS_BLOCK_STATE_COLLECTING:
 		case YAFFS_BLOCK_STATE_FULL:
+		case YAFFS_BLOCK_STATE_DIRTY:	/* erase queued */
 			nFree +=
 			    (dev->nChunksPerBlock - blk->pagesInUse +
 			     blk->softDeletions);
@@ -5722,33 +7429,29 @@ static int yaffs_CountFreeChunks(yaffs_Device * dev)
 	return nFree;
 }
 
+/* This is what we report to the outside world. nFreeChunks is kept up to
+ * date by the allocator, yaffs_DeleteChunk() and the erase paths, and the
+ * cache keeps its own dirty count, so this is O(1). Nothing here needs the
+ * gross lock: a caller racing a writer just sees a figure a few chunks old.
+ */
 int yaffs_GetNumberOfFreeChunks(yaffs_Device * dev)
 {
-	/* This is what we report to the outside world */
-
 	int nFree;
 	int nDirtyCacheChunks;
 
-#if 1
 	nFree = dev->nFreeChunks;
-#else
-	nFree = yaffs_CountFreeChunks(dev);
-#endif
 
 	/* Now count the number of dirty chunks in the cache and subtract those */
 
-	{
-		int i;
-		for (nDirtyCacheChunks = 0, i = 0; i < dev->nShortOpCaches; i++) {
-			if (dev->srCache[i].dirty)
-				nDirtyCacheChunks++;
-		}
-	}
+	nDirtyCacheChunks = dev->srDirty;
 
 	nFree -= nDirtyCacheChunks;
 
 	nFree -= ((dev->nReservedBlocks + 1) * dev->nChunksPerBlock);
 
+	/* Keep back enough for the checkpoint too */
+	nFree -= (yaffs_CheckpointBlocksReserved(dev) * dev->nChunksPerBlock);
+
 	if (nFree < 0)
 		nFree = 0;
 
@@ -5756,19 +7459,23 @@ int yaffs_GetNumberOfFreeChunks(yaffs_Device * dev)
 
 }
 
-static int yaffs_freeVerificationFailures;
-
+/* Debug cross-check of the running counters against a full block scan.
+ * Run at mount, and around each collected block with YAFFS_TRACE_VERIFY.
+ */
 static void yaffs_VerifyFreeChunks(yaffs_Device * dev)
 {
-	int counted = yaffs_CountFreeChunks(dev);
+	int erased;
+	int counted = yaffs_CountFreeChunks(dev, &erased);
 
 	int difference = dev->nFreeChunks - counted;
 
-	if (difference) {
+	if (difference || erased != dev->nErasedBlocks) {
 		T(YAFFS_TRACE_ALWAYS,
-		  (TSTR("Freechunks verification failure %d %d %d" TENDSTR),
-		   dev->nFreeChunks, counted, difference));
-		yaffs_freeVerificationFailures++;
+		  (TSTR("Freechunks verification failure %d %d %d, "
+			"erased blocks %d %d" TENDSTR),
+		   dev->nFreeChunks, counted, difference,
+		   dev->nErasedBlocks, erased));
+		dev->nFreeVerifyFailures++;
 	}
 }
 
@@ -27,6 +27,15 @@
  * (mm-dd-yyyy) Author    Comment
  * 08-03-2006   Motorola  Added shredding support to YAFFS2
  * 12-15-2006   Motorola  Added new flag, middleOfMounting
+ * 10-17-2026   Motorola  Added per-directory name index
+ * 10-17-2026   Motorola  Split the gross lock so readers can share state
+ * 10-17-2026   Motorola  Added incremental background GC and GC statistics
+ * 10-17-2026   Motorola  Added GC candidate index
+ * 10-17-2026   Motorola  Made the short op cache a hashed LRU
+ * 10-17-2026   Motorola  Added checkpointed mount
+ * 10-17-2026   Motorola  Added pluggable tnode/object allocator and compact tnodes
+ * 10-17-2026   Motorola  Added free chunk verification failure count
+ * 10-17-2026   Motorola  Added asynchronous block erase hooks and erase/allocation wait histograms
  */
 
 /*
@@ -61,6 +70,12 @@
 #define YAFFS_TNODES_INTERNAL_MASK	0x7
 #define YAFFS_TNODES_MAX_LEVEL		6
 
+/* A compact tnode is a level 0 tnode holding only the first
+ * YAFFS_NTNODES_COMPACT entries. Small files use one as their top.
+ */
+#define YAFFS_NTNODES_COMPACT		(YAFFS_NTNODES_LEVEL0 / 2)
+#define YAFFS_COMPACT_TNODE_SIZE	(YAFFS_NTNODES_COMPACT * sizeof(__u16))
+
 #ifndef CONFIG_YAFFS_NO_YAFFS1
 #define YAFFS_BYTES_PER_SPARE		16
 #define YAFFS_BYTES_PER_CHUNK		512
@@ -100,10 +115,34 @@
 #define YAFFS_OBJECTID_UNLINKED		3
 #define YAFFS_OBJECTID_DELETED		4
 
-#define YAFFS_MAX_SHORT_OP_CACHES	20
+#define YAFFS_DEFAULT_SHORT_OP_CACHES	10
+#define YAFFS_MAX_SHORT_OP_CACHES	128
+
+/* Directories with at least YAFFS_DIR_INDEX_THRESHOLD children get a hashed
+ * name index. It starts with YAFFS_DIR_INDEX_BUCKETS buckets and doubles
+ * (up to YAFFS_DIR_INDEX_MAX_BUCKETS) whenever the average chain exceeds
+ * YAFFS_DIR_INDEX_LOAD entries. Bucket counts must be powers of 2.
+ */
+#define YAFFS_DIR_INDEX_THRESHOLD	32
+#define YAFFS_DIR_INDEX_BUCKETS		16
+#define YAFFS_DIR_INDEX_MAX_BUCKETS	1024
+#define YAFFS_DIR_INDEX_LOAD		4
 
 #define YAFFS_N_TEMP_BUFFERS		4
 
+/* Background GC keeps at least YAFFS_GC_WATERMARK_BLOCKS erased blocks above
+ * the reserve, copying at most YAFFS_GC_SLICE_CHUNKS chunks per call.
+ * Foreground GC stalls are binned in YAFFS_GC_STALL_BUCKETS log2(ms) buckets.
+ */
+#define YAFFS_GC_WATERMARK_BLOCKS	16
+#define YAFFS_GC_SLICE_CHUNKS		4
+#define YAFFS_GC_STALL_BUCKETS		8
+
+/* Inline erases and block allocations are binned by how long the writer
+ * waited, in YAFFS_ERASE_STALL_BUCKETS log2(us) buckets from <64us up.
+ */
+#define YAFFS_ERASE_STALL_BUCKETS	8
+
 /* Sequence numbers are used in YAFFS2 to determine block allocation order.
  * The range is limited slightly to help distinguish bad numbers from good.
  * This also allows us to perhaps in the future use special numbers for
@@ -114,6 +153,13 @@
 #define YAFFS_LOWEST_SEQUENCE_NUMBER	0x00001000
 #define YAFFS_HIGHEST_SEQUENCE_NUMBER	0xEFFFFF00
 
+/* Checkpoint blocks are tagged with a sequence number below the normal range
+ * so the scanner can tell them apart. The version must change whenever the
+ * layout of the checkpoint stream does.
+ */
+#define YAFFS_SEQUENCE_CHECKPOINT_DATA	0x21
+#define YAFFS_CHECKPOINT_VERSION	3
+
 #ifdef CONFIG_MOT_FEAT_YAFFS_PARSE_MOUNT_OPTIONS
 /* 
  * Mount Flags
@@ -131,7 +177,9 @@
 typedef struct {
 	struct yaffs_ObjectStruct *object;
 	int chunkId;
-	int lastUse;
+	struct list_head hashLink;	/* entry in the cache hash chain */
+	struct list_head lruLink;	/* entry in the LRU list or the free list */
+	struct list_head dirtyLink;	/* entry in the object's dirty list */
 	int dirty;
 	int nBytes;		/* Only valid if the cache is dirty */
 	int locked;		/* Can't push out or flush while locked. */
@@ -311,6 +359,9 @@ typedef enum {
 	 * Erase me, reuse me.
 	 */
 
+	YAFFS_BLOCK_STATE_CHECKPOINT,
+	/* This block holds checkpoint data */
+
 	YAFFS_BLOCK_STATE_COLLECTING,	
 	/* This block is being garbage collected */
 
@@ -332,6 +383,15 @@ typedef struct {
 
 } yaffs_BlockInfo;
 
+/* GC candidate index link. FULL blocks that have something to reclaim are
+ * kept on doubly linked lists, one per live chunk count.
+ */
+typedef struct {
+	int next;		/* Next block in the bucket, -1 ends the list */
+	int prev;		/* Previous block, -1 if this is the head */
+	int bucket;		/* Live chunks when filed, -1 if not indexed */
+} yaffs_GCLink;
+
 /* -------------------------- Object structure -------------------------------*/
 /* This is the object structure as stored on NAND */
 
@@ -416,12 +476,16 @@ typedef struct {
 	__u32 fileSize;
 	__u32 scannedFileSize;
 	__u32 shrinkSize;
-	int topLevel;
-	yaffs_Tnode *top;
+	short topLevel;
+	__u16 compactTop;	/* top is a compact tnode, so topLevel is 0 */
+	yaffs_Tnode *top;	/* NULL until the file gets its first chunk */
 } yaffs_FileStructure;
 
 typedef struct {
 	struct list_head children;	/* list of child links */
+	struct list_head *nameBuckets;	/* children hashed by name sum, NULL if not indexed */
+	int nNameBuckets;
+	int nChildren;
 } yaffs_DirectoryStructure;
 
 typedef struct {
@@ -462,6 +526,7 @@ struct yaffs_ObjectStruct {
 	__u8 lazyLoaded;	/* Vital info has been loaded from tags. Not all info available. */
 
 	__u16 sum;		/* sum of the name to speed searching */
+	__u32 nameHash;		/* stronger name hash, saves NAND reads on sum clashes */
 
 	struct yaffs_DeviceStruct *myDev;	/* The device I'm on */
 
@@ -473,6 +538,9 @@ struct yaffs_ObjectStruct {
 	/* also used for linking up the free list */
 	struct yaffs_ObjectStruct *parent; 
 	struct list_head siblings;
+	struct list_head nameLink;	/* entry in the parent's name index */
+
+	struct list_head dirtyCache;	/* dirty short op cache chunks, in chunkId order */
 
 	/* Where's my object header in NAND? */
 	int chunkId;		
@@ -541,6 +609,84 @@ typedef struct {
 	int maxLine;
 } yaffs_TempBuffer;
 
+/*--------------------- Checkpoint ----------------
+ *
+ * A checkpoint is a dump of the in-RAM state, written on clean unmount and
+ * sync so that the next mount can skip the scan. The stream is:
+ * validity marker (head), device, block info, chunk bits, objects (each file
+ * followed by its level 0 tnodes), validity marker (tail), checksum.
+ */
+
+typedef struct {
+	int structType;
+	__u32 magic;
+	__u32 version;
+	__u32 head;
+} yaffs_CheckpointValidity;
+
+typedef struct {
+	int structType;
+
+	/* Geometry, must match the device being mounted */
+	int nBytesPerChunk;
+	int nChunksPerBlock;
+	int internalStartBlock;
+	int internalEndBlock;
+
+	int nErasedBlocks;
+	int allocationBlock;	/* Current block being allocated off */
+	__u32 allocationPage;
+	int allocationBlockFinder;
+	int nFreeChunks;
+
+	/* yaffs2 runtime stuff */
+	unsigned sequenceNumber;	/* Sequence number of currently allocating block */
+} yaffs_CheckpointDevice;
+
+/* yaffs_CheckpointObject holds everything the scan would have built for an
+ * object, so that the object headers need not be read back at mount.
+ */
+typedef struct {
+	int structType;
+	__u32 objectId;
+	__u32 parentId;
+	int chunkId;
+
+	yaffs_ObjectType variantType:3;
+	__u8 deleted:1;
+	__u8 softDeleted:1;
+	__u8 unlinked:1;
+	__u8 renameAllowed:1;
+	__u8 unlinkAllowed:1;
+	__u8 dirty:1;
+	__u8 serial;
+
+	int nDataChunks;
+	__u32 fileSizeOrEquivalentObjectId;
+
+	__u16 sum;
+	__u32 nameHash;
+#ifdef CONFIG_YAFFS_SHORT_NAMES_IN_RAM
+	YCHAR shortName[YAFFS_SHORT_NAME_LENGTH + 1];
+#endif
+
+	__u32 yst_mode;
+#ifdef CONFIG_YAFFS_WINCE
+	__u32 win_ctime[2];
+	__u32 win_mtime[2];
+	__u32 win_atime[2];
+#else
+	__u32 yst_uid;
+	__u32 yst_gid;
+	__u32 yst_atime;
+	__u32 yst_mtime;
+	__u32 yst_ctime;
+#endif
+	__u32 yst_rdev;
+
+	int aliasLength;	/* Symlink alias bytes that follow, including the nul */
+} yaffs_CheckpointObject;
+
 /*----------------- Device ---------------------------------*/
 
 struct yaffs_DeviceStruct {
@@ -598,6 +744,50 @@ struct yaffs_DeviceStruct {
 	 * it to implement the faster readdir
 	 */
 	void (*removeObjectCallback)(struct yaffs_ObjectStruct *obj);
+
+	/* The nandBusyCallback function is optional. If supplied, it is called
+	 * with busy set just before a chunk program or block erase and with
+	 * busy clear once it completes. The in-RAM state is consistent at
+	 * these points, so the Linux kernel uses this to let readers in while
+	 * the writer waits on the flash.
+	 */
+	void (*nandBusyCallback)(struct yaffs_DeviceStruct *dev, int busy);
+
+	/* The gcWakeCallback function is optional. If supplied, passive GC is
+	 * left to an OS thread that calls yaffs_BackgroundGarbageCollect(), and
+	 * writers call this to kick the thread when the erased space drops
+	 * below gcWatermark. Writers still do aggressive GC themselves.
+	 */
+	void (*gcWakeCallback)(struct yaffs_DeviceStruct *dev);
+	int gcWatermark;	/* Erased chunks to keep free. 0 for the default */
+
+	/* The eraseBlockAsync/eraseDone pair is optional. If supplied, blocks
+	 * that become dirty are passed to eraseBlockAsync, which returns
+	 * YAFFS_OK if it has queued the erase. The block stays DIRTY until
+	 * eraseDone hands it back: it returns one finished block (NAND
+	 * numbering) with *ok set to the result, or -1 if none has finished.
+	 * With wait set it sleeps until one finishes. Both are called with
+	 * the writers' lock held.
+	 */
+	int (*eraseBlockAsync) (struct yaffs_DeviceStruct * dev,
+				int blockInNAND);
+	int (*eraseDone) (struct yaffs_DeviceStruct * dev, int wait, int *ok);
+
+	int useCheckpoint;	/* Mount from and write checkpoints (yaffs2 only) */
+
+	/* The allocTnode/freeTnode and allocObject/freeObject pairs are
+	 * optional. If supplied, tnodes and objects are allocated one at a
+	 * time from them (eg. slab caches) and spare ones can be handed back
+	 * with yaffs_ShrinkFreeLists(). Otherwise they are carved out of
+	 * blocks of YAFFS_ALLOCATION_NTNODES/NOBJECTS that are only freed at
+	 * unmount. compact asks for a YAFFS_COMPACT_TNODE_SIZE tnode.
+	 */
+	void *(*allocTnode) (struct yaffs_DeviceStruct * dev, int compact);
+	void (*freeTnode) (struct yaffs_DeviceStruct * dev, void *tn,
+			   int compact);
+	void *(*allocObject) (struct yaffs_DeviceStruct * dev);
+	void (*freeObject) (struct yaffs_DeviceStruct * dev, void *obj);
+	int compactTnodes;	/* Small files use compact tnodes (needs allocTnode) */
 	
 
 	/* End of stuff that must be set before initialisation. */
@@ -609,7 +799,15 @@ struct yaffs_DeviceStruct {
 
 #ifdef __KERNEL__
 
-	struct semaphore grossLock;	/* Gross locking semaphore */
+	struct semaphore grossLock;	/* Serialises everything that modifies the fs */
+	struct rw_semaphore stateLock;	/* Guards the in-RAM state. Readers share it,
+					 * the grossLock holder takes it exclusively.
+					 */
+	spinlock_t tempBufferLock;	/* Guards tempBuffer allocation */
+	struct semaphore spareLock;	/* Guards spareBuffer */
+	struct task_struct *gcThread;	/* Background GC thread, if running */
+	void *eraseAhead;	/* Asynchronous erase slots, see yaffs_mtdif.c */
+	unsigned long gcRetryTime;	/* jiffies before the thread rescans */
 	__u8 *spareBuffer;	/* For mtdif2 use. Don't know the size of the buffer 
 				 * at compile time so we have to allocate it.
 				 */
@@ -628,16 +826,36 @@ struct yaffs_DeviceStruct {
 	int blockOffset;
 	int chunkOffset;
 
+	/* Runtime checkpointing stuff */
+	int isCheckpointed;	/* The checkpoint on NAND matches the RAM state */
+	int blocksInCheckpoint;
+	int checkpointPageSequence;	/* running sequence number of checkpoint pages */
+	int checkpointByteCount;
+	int checkpointByteOffset;
+	__u8 *checkpointBuffer;
+	int checkpointOpenForWrite;
+	int checkpointCurrentChunk;
+	int checkpointCurrentBlock;
+	int checkpointNextBlock;
+	int *checkpointBlockList;
+	int checkpointMaxBlocks;
+	__u32 checkpointSum;	/* running checksum of the stream */
+	__u32 checkpointXor;
+
 	/* Block Info */
 	yaffs_BlockInfo *blockInfo;
 	__u8 *chunkBits;	/* bitmap of chunks in use */
 	unsigned blockInfoAlt:1;	/* was allocated using alternative strategy */
 	unsigned chunkBitsAlt:1;	/* was allocated using alternative strategy */
+	unsigned gcLinksAlt:1;	/* was allocated using alternative strategy */
+	yaffs_GCLink *gcLinks;	/* GC index link for each block */
+	int *gcBuckets;		/* Head block of each live count, -1 if empty */
 	int chunkBitmapStride;	/* Number of bytes of chunkBits per block. 
 				 * Must be consistent with nChunksPerBlock.
 				 */
 
 	int nErasedBlocks;
+	int nErasesInFlight;	/* DIRTY blocks queued with eraseBlockAsync */
 	int allocationBlock;	/* Current block being allocated off */
 	__u32 allocationPage;
 	int allocationBlockFinder;	/* Used to search for next allocation block */
@@ -647,6 +865,7 @@ struct yaffs_DeviceStruct {
 	yaffs_Tnode *freeTnodes;
 	int nFreeTnodes;
 	yaffs_TnodeList *allocatedTnodeList;
+	int nCompactTnodes;	/* compact tnodes in use */
 
 	int isDoingGC;
 
@@ -660,9 +879,11 @@ struct yaffs_DeviceStruct {
 
 	int nFreeChunks;
 
-	int currentDirtyChecker;	/* Used to find current dirtiest block */
-
 	__u32 *gcCleanupList;	/* objects to delete at the end of a GC. */
+	int nCleanups;		/* Entries in gcCleanupList */
+	int gcBlock;		/* Block being collected, 0 if none */
+	int gcChunk;		/* Next chunk in gcBlock to look at */
+	int nonAggressiveSkip;	/* Passive GC back-off */
 
 #ifdef CONFIG_MOT_FEAT_YAFFS_PARSE_MOUNT_OPTIONS
         unsigned long sMountOptions;
@@ -676,8 +897,18 @@ struct yaffs_DeviceStruct {
 	int nGCCopies;
 	int garbageCollections;
 	int passiveGarbageCollections;
+	int nBackgroundGCSlices;
+	__u32 nBackgroundGCCopies;
+	__u32 gcTimeForeground;	/* us spent collecting on behalf of writers */
+	__u32 gcTimeBackground;	/* us spent collecting in the background */
+	__u32 gcMaxStall;	/* Longest single foreground GC, us */
+	__u32 gcStalls[YAFFS_GC_STALL_BUCKETS];	/* Foreground GCs by log2(ms) */
+	__u32 eraseStalls[YAFFS_ERASE_STALL_BUCKETS];	/* Inline erases */
+	__u32 allocStalls[YAFFS_ERASE_STALL_BUCKETS];	/* Waits for an erased block */
 	int nRetriedWrites;
 	int nRetiredBlocks;
+	int nFreeVerifyFailures;	/* Counter mismatches seen by
+					 * yaffs_VerifyFreeChunks() */
 	int eccFixed;
 	int eccUnfixed;
 	int tagsEccFixed;
@@ -698,9 +929,27 @@ struct yaffs_DeviceStruct {
 	int doingBufferedBlockRewrite;
 
 	yaffs_ChunkCache *srCache;
-	int srLastUse;
-
-	int cacheHits;
+	struct list_head *srHash;	/* cache hash chains */
+	int srHashMask;		/* number of chains - 1 */
+	struct list_head srLru;	/* entries in use, most recently used first */
+	struct list_head srFree;	/* entries not in use */
+	int srDirty;		/* number of dirty entries */
+
+	Y_ATOMIC_T cacheHits;	/* bumped by readers too */
+	Y_ATOMIC_T cacheMisses;
+	int cacheEvictions;	/* clean entries reused for another chunk */
+	int cacheWritebacks;	/* dirty entries written to NAND */
+
+	int mountFromCheckpoint;	/* The last mount restored a checkpoint */
+	__u32 mountTime;	/* us the last mount spent scanning or restoring */
+	int nCheckpointSaves;
+	__u32 checkpointSaveTime;	/* us the last checkpoint save took */
+
+	/* Metadata RAM accounting, in bytes */
+	__u32 tnodeBytes;	/* tnodes in use */
+	__u32 objectBytes;	/* objects in use */
+	__u32 freeListBytes;	/* spare tnodes and objects on the free lists */
+	__u32 tableBytes;	/* block tables, cache and buffers set up at mount */
 
 	/* Stuff for background deletion and unlinked files.*/
 	yaffs_Object *unlinkedDir;	/* Directory where unlinked and deleted files live. */
@@ -810,6 +1059,16 @@ void yfsd_WinFileTimeNow(__u32 target[2]);
 void yaffs_HandleDeferedFree(yaffs_Object * obj);
 #endif
 
+/* Background GC */
+int yaffs_BackgroundGarbageCollect(yaffs_Device * dev);
+
+/* Checkpointing */
+int yaffs_CheckpointSave(yaffs_Device * dev);
+int yaffs_CheckpointRestore(yaffs_Device * dev);
+
+/* Hand spare tnodes and objects back to allocTnode/allocObject's owner */
+int yaffs_ShrinkFreeLists(yaffs_Device * dev, int nToFree);
+
 /* Debug dump  */
 int yaffs_DumpObject(yaffs_Object * obj);
 
@@ -26,6 +26,7 @@
 /* ChangeLog:
  * (mm-dd-yyyy) Author    Comment
  * 09-11-2006   Motorola  Make sure eccpos bytes match mxc_nd
+ * 10-17-2026   Motorola  Asynchronous block erase through mtd->erase_async
  */
 
 const char *yaffs_mtdif_c_version =
@@ -181,6 +182,163 @@ int nandmtd_InitialiseNAND(yaffs_Device * dev)
 	return YAFFS_OK;
 }
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_ERASE_AHEAD
+/*
+ * Asynchronous erase.
+ * Each queued erase holds a slot until the guts collect it through
+ * nandmtd_EraseDone(). The completion callback runs in the NAND erase
+ * thread with the chip held, so it only marks the slot and wakes the
+ * writer; it must not take the yaffs locks or touch the MTD.
+ * When all slots are busy the guts erase inline.
+ */
+#define YAFFS_ERASE_SLOTS	8
+
+#define ERASE_SLOT_FREE		0
+#define ERASE_SLOT_QUEUED	1
+#define ERASE_SLOT_DONE		2
+
+typedef struct {
+	struct erase_info ei;
+	int block;
+	int state;
+	int ok;
+} yaffs_EraseSlot;
+
+typedef struct {
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	yaffs_EraseSlot slot[YAFFS_ERASE_SLOTS];
+} yaffs_EraseAhead;
+
+static void nandmtd_EraseCallback(struct erase_info *ei)
+{
+	yaffs_EraseAhead *ahead = (yaffs_EraseAhead *) ei->priv;
+	yaffs_EraseSlot *slot = container_of(ei, yaffs_EraseSlot, ei);
+
+	spin_lock(&ahead->lock);
+	slot->ok = (ei->state == MTD_ERASE_DONE);
+	slot->state = ERASE_SLOT_DONE;
+	spin_unlock(&ahead->lock);
+
+	wake_up(&ahead->wait);
+}
+
+static int nandmtd_EraseBlockAsync(yaffs_Device * dev, int blockNumber)
+{
+	struct mtd_info *mtd = (struct mtd_info *)(dev->genericDevice);
+	yaffs_EraseAhead *ahead = dev->eraseAhead;
+	yaffs_EraseSlot *slot = NULL;
+	int i;
+
+	spin_lock(&ahead->lock);
+	for (i = 0; i < YAFFS_ERASE_SLOTS; i++) {
+		if (ahead->slot[i].state == ERASE_SLOT_FREE) {
+			slot = &ahead->slot[i];
+			slot->state = ERASE_SLOT_QUEUED;
+			break;
+		}
+	}
+	spin_unlock(&ahead->lock);
+
+	if (!slot)
+		return YAFFS_FAIL;
+
+	memset(&slot->ei, 0, sizeof(slot->ei));
+	slot->ei.mtd = mtd;
+	slot->ei.addr =
+	    ((loff_t) blockNumber) * dev->nBytesPerChunk * dev->nChunksPerBlock;
+	slot->ei.len = dev->nBytesPerChunk * dev->nChunksPerBlock;
+	slot->ei.fail_addr = 0xffffffff;
+	slot->ei.callback = nandmtd_EraseCallback;
+	slot->ei.priv = (u_long) ahead;
+	slot->block = blockNumber;
+
+	if (mtd->erase_async(mtd, &slot->ei)) {
+		/* Not queued and no callback coming */
+		spin_lock(&ahead->lock);
+		slot->state = ERASE_SLOT_FREE;
+		spin_unlock(&ahead->lock);
+		return YAFFS_FAIL;
+	}
+
+	return YAFFS_OK;
+}
+
+/* Index of a finished slot, or -1 */
+static int nandmtd_FinishedSlot(yaffs_EraseAhead * ahead)
+{
+	int i;
+	int found = -1;
+
+	spin_lock(&ahead->lock);
+	for (i = 0; i < YAFFS_ERASE_SLOTS; i++) {
+		if (ahead->slot[i].state == ERASE_SLOT_DONE) {
+			found = i;
+			break;
+		}
+	}
+	spin_unlock(&ahead->lock);
+
+	return found;
+}
+
+static int nandmtd_EraseDone(yaffs_Device * dev, int wait, int *ok)
+{
+	yaffs_EraseAhead *ahead = dev->eraseAhead;
+	yaffs_EraseSlot *slot;
+	int i;
+
+	/* Uninterruptible: the guts must get every queued block back */
+	if (wait)
+		wait_event(ahead->wait, nandmtd_FinishedSlot(ahead) >= 0);
+
+	i = nandmtd_FinishedSlot(ahead);
+	if (i < 0)
+		return -1;
+
+	/* Only this side frees a finished slot, so it cannot change now */
+	slot = &ahead->slot[i];
+	*ok = slot->ok ? YAFFS_OK : YAFFS_FAIL;
+
+	spin_lock(&ahead->lock);
+	slot->state = ERASE_SLOT_FREE;
+	spin_unlock(&ahead->lock);
+
+	return slot->block;
+}
+
+int nandmtd_InitialiseEraseAhead(yaffs_Device * dev)
+{
+	struct mtd_info *mtd = (struct mtd_info *)(dev->genericDevice);
+	yaffs_EraseAhead *ahead;
+
+	if (!mtd->erase_async)
+		return YAFFS_FAIL;
+
+	ahead = kmalloc(sizeof(yaffs_EraseAhead), GFP_KERNEL);
+	if (!ahead)
+		return YAFFS_FAIL;
+
+	memset(ahead, 0, sizeof(yaffs_EraseAhead));
+	spin_lock_init(&ahead->lock);
+	init_waitqueue_head(&ahead->wait);
+
+	dev->eraseAhead = ahead;
+	dev->eraseBlockAsync = nandmtd_EraseBlockAsync;
+	dev->eraseDone = nandmtd_EraseDone;
+
+	return YAFFS_OK;
+}
+
+void nandmtd_DeinitialiseEraseAhead(yaffs_Device * dev)
+{
+	dev->eraseBlockAsync = NULL;
+	dev->eraseDone = NULL;
+	kfree(dev->eraseAhead);
+	dev->eraseAhead = NULL;
+}
+#endif
+
 #ifdef CONFIG_MOT_FEAT_MTD_FS
 int nandmtd_QueryNANDBlock(struct yaffs_DeviceStruct *dev, int blockNo,
 			    yaffs_BlockState * state, int *sequenceNumber)
@@ -26,6 +26,7 @@
 /* ChangeLog:
  * (mm-dd-yyyy) Author    Comment
  * 01-05-2006   Motorola  Add BBT support to YAFFS2
+ * 10-17-2026   Motorola  Add asynchronous block erase
  */
 
 /* Note: Only YAFFS headers are LGPL, YAFFS C code is covered by GPL.
@@ -45,6 +46,11 @@ int nandmtd_ReadChunkFromNAND(yaffs_Device * dev, int chunkInNAND, __u8 * data,
 int nandmtd_EraseBlockInNAND(yaffs_Device * dev, int blockNumber);
 int nandmtd_InitialiseNAND(yaffs_Device * dev);
 
+#ifdef CONFIG_MOT_FEAT_YAFFS_ERASE_AHEAD
+int nandmtd_InitialiseEraseAhead(yaffs_Device * dev);
+void nandmtd_DeinitialiseEraseAhead(yaffs_Device * dev);
+#endif
+
 #ifdef CONFIG_MOT_FEAT_MTD_FS
 int nandmtd_QueryNANDBlock(struct yaffs_DeviceStruct *dev, int blockNo,
                             yaffs_BlockState * state, int *sequenceNumber);
@@ -18,6 +18,7 @@
  * (mm-dd-yyyy) Author    Comment
  * 09-11-2006   Motorola  Applied Large Page NAND patch.
  *                        Supported the 'data shred' feature.
+ * 10-17-2026   Motorola  Serialised use of the shared spare buffer
  */
 
 
@@ -147,9 +148,10 @@ void nandmtd2_buf2pt(yaffs_Device *dev, yaffs_PackedTags2 *pt, int is_raw)
 #endif /* CONFIG_MOT_WFN439 */
 
 
-int nandmtd2_WriteChunkWithTagsToNAND(yaffs_Device * dev, int chunkInNAND,
-				      const __u8 * data,
-				      const yaffs_ExtendedTags * tags)
+static int nandmtd2_WriteChunkWithTagsWorker(yaffs_Device * dev,
+					     int chunkInNAND,
+					     const __u8 * data,
+					     const yaffs_ExtendedTags * tags)
 {
 	struct mtd_info *mtd = (struct mtd_info *)(dev->genericDevice);
 	size_t dummy;
@@ -249,8 +251,9 @@ int nandmtd2_WriteChunkWithTagsToNAND(yaffs_Device * dev, int chunkInNAND,
 		return YAFFS_FAIL;
 }
 
-int nandmtd2_ReadChunkWithTagsFromNAND(yaffs_Device * dev, int chunkInNAND,
-				       __u8 * data, yaffs_ExtendedTags * tags)
+static int nandmtd2_ReadChunkWithTagsWorker(yaffs_Device * dev,
+					    int chunkInNAND, __u8 * data,
+					    yaffs_ExtendedTags * tags)
 {
 	struct mtd_info *mtd = (struct mtd_info *)(dev->genericDevice);
 	size_t dummy;
@@ -333,6 +336,34 @@ int nandmtd2_ReadChunkWithTagsFromNAND(yaffs_Device * dev, int chunkInNAND,
 		return YAFFS_FAIL;
 }
 
+/* Readers and the writer can be in here at the same time, so the
+ * spare buffer they share is handed out under spareLock.
+ */
+int nandmtd2_WriteChunkWithTagsToNAND(yaffs_Device * dev, int chunkInNAND,
+				      const __u8 * data,
+				      const yaffs_ExtendedTags * tags)
+{
+	int result;
+
+	down(&dev->spareLock);
+	result = nandmtd2_WriteChunkWithTagsWorker(dev, chunkInNAND, data, tags);
+	up(&dev->spareLock);
+
+	return result;
+}
+
+int nandmtd2_ReadChunkWithTagsFromNAND(yaffs_Device * dev, int chunkInNAND,
+				       __u8 * data, yaffs_ExtendedTags * tags)
+{
+	int result;
+
+	down(&dev->spareLock);
+	result = nandmtd2_ReadChunkWithTagsWorker(dev, chunkInNAND, data, tags);
+	up(&dev->spareLock);
+
+	return result;
+}
+
 int nandmtd2_MarkNANDBlockBad(struct yaffs_DeviceStruct *dev, int blockNo)
 {
 	struct mtd_info *mtd = (struct mtd_info *)(dev->genericDevice);
@@ -34,6 +34,9 @@
  * Date         Author         Comment
  * ==========   ===========    ===================================
  * 06/01/2007   Motorola       Define CONFIG_MOT_FEAT_CHKSUM.
+ * 10/17/2026   Motorola       Define Y_CLOCK_US for GC statistics.
+ * 10/17/2026   Motorola       Added YAFFS_TRACE_CHECKPOINT.
+ * 10/17/2026   Motorola       Added YAFFS_TRACE_VERIFY.
  */
 
 
@@ -56,6 +59,7 @@
 #include <linux/string.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <asm/atomic.h>
 
 #define YCHAR char
 #define YUCHAR unsigned char
@@ -88,6 +92,24 @@
 #define Y_TIME_CONVERT(x) (x)
 #endif
 
+/* Free running microsecond clock, only used for statistics.  It runs
+ * off the monotonic clock so setting the time of day does not skew it.
+ */
+static inline __u32 yaffs_ClockUs(void)
+{
+	struct timespec ts;
+
+	do_posix_clock_monotonic_gettime(&ts);
+	return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#define Y_CLOCK_US() yaffs_ClockUs()
+
+/* Statistics counters bumped by readers that run in parallel */
+#define Y_ATOMIC_T atomic_t
+#define Y_ATOMIC_INC(x) atomic_inc(x)
+#define Y_ATOMIC_READ(x) atomic_read(x)
+#define Y_ATOMIC_SET(x,v) atomic_set(x,v)
+
 #define yaffs_SumCompare(x,y) ((x) == (y))
 #define yaffs_strcmp(a,b) strcmp(a,b)
 
@@ -149,6 +171,14 @@
 
 #endif
 
+#ifndef Y_ATOMIC_T
+/* Single threaded environments */
+#define Y_ATOMIC_T int
+#define Y_ATOMIC_INC(x) ((*(x))++)
+#define Y_ATOMIC_READ(x) (*(x))
+#define Y_ATOMIC_SET(x,v) (*(x) = (v))
+#endif
+
 extern unsigned yaffs_traceMask;
 
 #define YAFFS_TRACE_ERROR		0x00000001
@@ -166,6 +196,8 @@ extern unsigned yaffs_traceMask;
 #define YAFFS_TRACE_GC_DETAIL		0x00001000
 #define YAFFS_TRACE_SCAN_DEBUG		0x00002000
 #define YAFFS_TRACE_MTD			0x00004000
+#define YAFFS_TRACE_CHECKPOINT		0x00008000
+#define YAFFS_TRACE_VERIFY		0x00010000
 #define YAFFS_TRACE_ALWAYS		0x40000000
 #define YAFFS_TRACE_BUG			0x80000000
 
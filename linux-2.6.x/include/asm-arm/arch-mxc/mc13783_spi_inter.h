@@ -1,6 +1,6 @@
 /*
  * Copyright 2006 Freescale Semiconductor, Inc. All Rights Reserved.
- * Copyright 2006 Motorola, Inc.
+ * Copyright 2006, 2026 Motorola, Inc.
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -20,6 +20,7 @@
  * Date     Author    Comment
  * 10/2006  Motorola  Added support for power_ic drivers
  *                    Added SPI timing work-arounds for hardware issues
+ * 10/2026  Motorola  Added burst transfers of several frames
  */
 
 #ifndef __SPI_INTERFACE_H__
@@ -72,4 +73,22 @@ int spi_read_reg(int num_reg, unsigned int *reg_value);
  */
 int spi_send_frame_to_spi(int num_reg, unsigned int *reg_value, int rw);
 
+/*!
+ * Number of frames that fit the CSPI FIFO and go out in one exchange.
+ */
+#define SPI_MC13783_BURST_FRAMES	8
+
+/*!
+ * This function is used to send several frames on SPI bus.
+ *
+ * @param        num_reg    mc13783 register number of each frame
+ * @param        reg_value  value of each frame, replaced by the value read
+ * @param        rw         read (0) or write (1) for each frame
+ * @param        count      number of frames
+ *
+ * @return       This function returns 0 if successful.
+ */
+int spi_send_frames_to_spi(const int *num_reg, unsigned int *reg_value,
+			   const int *rw, int count);
+
 #endif				/* __SPI_INTERFACE_H__ */
@@ -16,6 +16,7 @@
  * DATE          AUTHOR         COMMMENT
  * ----          ------         --------
  * 10/04/2006    Motorola       Added function prototype for mxc_dma_reset
+ * 10/17/2026    Motorola       Added sdma_malloc_multi and sdma_free_multi
  */
 
 #ifndef SDMA_H
@@ -347,7 +348,7 @@ void mxc_free_dma(int channel);
 void mxc_dma_set_callback(int channel, dma_callback_t callback, void *arg);
 
 /*!
- * Allocates uncachable buffer. Uses hash table.
+ * Allocates uncachable buffer of up to PAGE_SIZE bytes.
  *
  * @param   size    size of allocated buffer
  * @return  pointer to buffer
@@ -355,12 +356,31 @@ void mxc_dma_set_callback(int channel, dma_callback_t callback, void *arg);
 void *sdma_malloc(size_t size);
 
 /*!
- * Frees uncachable buffer. Uses hash table.
+ * Frees uncachable buffer.
  */
 void sdma_free(void *buf);
 
 /*!
- * Converts virtual to physical address. Uses hash table.
+ * Allocates count uncachable buffers of size bytes each, all or none.
+ *
+ * @param   size    size of each buffer
+ * @param   count   number of buffers
+ * @param   bufs    array that receives the buffer pointers
+ * @return  0 on success, negative error code on fail
+ */
+int sdma_malloc_multi(size_t size, int count, void **bufs);
+
+/*!
+ * Frees buffers allocated by sdma_malloc_multi.
+ *
+ * @param   bufs    array of buffer pointers
+ * @param   count   number of buffers
+ */
+void sdma_free_multi(void **bufs, int count);
+
+/*!
+ * Converts virtual to physical address. Addresses outside the SDMA
+ * buffers pool are converted with virt_to_phys.
  *
  * @param   buf  virtual address pointer
  * @return  physical address value
@@ -368,7 +388,8 @@ void sdma_free(void *buf);
 unsigned long sdma_virt_to_phys(void *buf);
 
 /*!
- * Converts physical to virtual address. Uses hash table.
+ * Converts physical to virtual address. Addresses outside the SDMA
+ * buffers pool are converted with phys_to_virt.
  *
  * @param   buf  physical address value
  * @return  virtual address pointer
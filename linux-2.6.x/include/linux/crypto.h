@@ -70,6 +70,16 @@ struct cipher_alg {
 	                  unsigned int keylen, u32 *flags);
 	void (*cia_encrypt)(void *ctx, u8 *dst, const u8 *src);
 	void (*cia_decrypt)(void *ctx, u8 *dst, const u8 *src);
+
+	/*
+	 * Optional: process a whole request in one go (e.g. on an offload
+	 * engine).  'iv' is the chaining value for CBC and the counter for
+	 * CTR and must be left updated.  Return -EAGAIN to have the request
+	 * run through cia_encrypt/cia_decrypt one block at a time instead.
+	 */
+	int (*cia_bulk)(void *ctx, struct scatterlist *dst,
+	                struct scatterlist *src, unsigned int nbytes,
+	                u8 *iv, u32 mode, int enc);
 };
 
 struct digest_alg {
@@ -94,12 +104,26 @@ struct compress_alg {
 #define cra_digest	cra_u.digest
 #define cra_compress	cra_u.compress
 
+/*
+ * Several implementations may register under one cra_name; lookups by that
+ * name get the one with the highest cra_priority, while cra_driver_name picks
+ * one exactly.  Implementations that leave cra_driver_name empty are named
+ * "<cra_name>-generic".
+ *
+ * cra_init/cra_exit, if present, are called on the context of every tfm
+ * allocated from the algorithm.
+ */
 struct crypto_alg {
 	struct list_head cra_list;
 	u32 cra_flags;
 	unsigned int cra_blocksize;
 	unsigned int cra_ctxsize;
 	const char cra_name[CRYPTO_MAX_ALG_NAME];
+	char cra_driver_name[CRYPTO_MAX_ALG_NAME];
+	int cra_priority;
+
+	int (*cra_init)(void *ctx);
+	void (*cra_exit)(void *ctx);
 
 	union {
 		struct cipher_alg cipher;
@@ -224,6 +248,16 @@ static inline const char *crypto_tfm_alg_name(struct crypto_tfm *tfm)
 	return tfm->__crt_alg->cra_name;
 }
 
+static inline const char *crypto_tfm_alg_driver_name(struct crypto_tfm *tfm)
+{
+	return tfm->__crt_alg->cra_driver_name;
+}
+
+static inline void *crypto_tfm_ctx(struct crypto_tfm *tfm)
+{
+	return (void *)&tfm[1];
+}
+
 static inline const char *crypto_tfm_alg_modname(struct crypto_tfm *tfm)
 {
 	return module_name(tfm->__crt_alg->cra_module);
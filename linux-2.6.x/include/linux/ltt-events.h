@@ -3,9 +3,14 @@
  *
  * Copyright (C) 1999-2004 Karim Yaghmour (karim@opersys.com)
  * Copyright (C) 2004, 2005 - MontaVista Software, Inc. (source@mvista.com)
+ * Copyright (C) 2026 Motorola, Inc.
  *
  * This contains the event definitions for the Linux Trace Toolkit.
  *
+ * Changelog:
+ *	17/10/26, Motorola: feed the per-CPU flight ring from every probe and
+ *		skip building the event when no trace is active.
+ *
  * This file is released  under the terms of the GNU GPL version 2.
  * This program  is licensed "as is" without any warranty of any kind,
  * whether express or implied.
@@ -15,6 +20,7 @@
 #define _LINUX_TRACE_H
 
 #include <linux/ltt-core.h>
+#include <linux/ltt-ring.h>
 #include <linux/sched.h>
 
 /* Is kernel tracing enabled */
@@ -23,8 +29,13 @@
 extern unsigned int ltt_syscall_entry_trace_active;
 extern unsigned int ltt_syscall_exit_trace_active;
 
+/* Number of trace instances with an allocated handle */
+extern int ltt_traces_armed;
+
 static inline void ltt_ev(u8 event_id, void* data)
 {
+	if (likely(!ltt_traces_armed))
+		return;
 	ltt_log_event(event_id, data);
 }
 
@@ -111,6 +122,9 @@ static inline void ltt_ev_trap_entry(trapid_t trap_id, u32 address)
 {
 	ltt_trap_entry trap_event;
 
+	ltt_ring_ev(LTT_EV_TRAP_ENTRY, 0, address);
+	if (likely(!ltt_traces_armed))
+		return;
 	trap_event.trap_id = trap_id;
 	trap_event.address = address;
 
@@ -120,6 +134,9 @@ static inline void ltt_ev_trap_entry(trapid_t trap_id, u32 address)
 /*  LTT_TRAP_EXIT */
 static inline void ltt_ev_trap_exit(void)
 {
+	ltt_ring_ev(LTT_EV_TRAP_EXIT, 0, 0);
+	if (likely(!ltt_traces_armed))
+		return;
 	ltt_log_event(LTT_EV_TRAP_EXIT, NULL);
 }
 
@@ -132,6 +149,9 @@ static inline void ltt_ev_irq_entry(u16 irq_id, u8 in_kernel)
 {
 	ltt_irq_entry irq_entry;
 
+	ltt_ring_ev(LTT_EV_IRQ_ENTRY, in_kernel, irq_id);
+	if (likely(!ltt_traces_armed))
+		return;
 	irq_entry.irq_id = irq_id;
 	irq_entry.kernel = in_kernel;
 
@@ -141,6 +161,9 @@ static inline void ltt_ev_irq_entry(u16 irq_id, u8 in_kernel)
 /*  LTT_IRQ_EXIT */
 static inline void ltt_ev_irq_exit(void)
 {
+	ltt_ring_ev(LTT_EV_IRQ_EXIT, 0, 0);
+	if (likely(!ltt_traces_armed))
+		return;
 	ltt_log_event(LTT_EV_IRQ_EXIT, NULL);
 }
 
@@ -161,6 +184,12 @@ static inline void ltt_init_sched_event(ltt_schedchange *sched_event,
 
 static inline void ltt_ev_schedchange(ltt_schedchange *sched_event)
 {
+	ltt_ring_ev_long(LTT_EV_SCHEDCHANGE,
+			 LTT_RING_TASK_STATE(sched_event->out_state),
+			 sched_event->out,
+			 ((task_t *) sched_event->in)->pid);
+	if (likely(!ltt_traces_armed))
+		return;
 	ltt_log_event(LTT_EV_SCHEDCHANGE, sched_event);
 }
 
@@ -179,6 +208,9 @@ static inline void ltt_ev_soft_irq(u8 ev_id, ulong data)
 {
 	ltt_soft_irq soft_irq_event;
 
+	ltt_ring_ev(LTT_EV_SOFT_IRQ, ev_id, data);
+	if (likely(!ltt_traces_armed))
+		return;
 	soft_irq_event.event_sub_id = ev_id;
 	soft_irq_event.event_data = data;
 
@@ -203,6 +235,9 @@ static inline void ltt_ev_process(u8 ev_id, u32 data1, ulong data2)
 {
 	ltt_process proc_event;
 
+	ltt_ring_ev_long(LTT_EV_PROCESS, ev_id, data1, data2);
+	if (likely(!ltt_traces_armed))
+		return;
 	proc_event.event_sub_id = ev_id;
 	proc_event.event_data1 = data1;
 	proc_event.event_data2 = data2;
@@ -222,6 +257,9 @@ static inline void ltt_ev_process_exit(u32 data1, ulong data2)
 	ltt_destroy_owners_events(current->pid);
 	ltt_free_all_handles(current);
 
+	ltt_ring_ev_long(LTT_EV_PROCESS, LTT_EV_PROCESS_EXIT, data1, data2);
+	if (likely(!ltt_traces_armed))
+		return;
 	ltt_log_event(LTT_EV_PROCESS, &proc_event);
 }
 
@@ -249,6 +287,9 @@ static inline void ltt_ev_file_system(u8 ev_id, u32 data1, u32 data2, const unsi
 {
 	ltt_file_system fs_event;
 
+	ltt_ring_ev_long(LTT_EV_FILE_SYSTEM, ev_id, data1, data2);
+	if (likely(!ltt_traces_armed))
+		return;
 	fs_event.event_sub_id = ev_id;
 	fs_event.event_data1 = data1;
 	fs_event.event_data2 = data2;
@@ -273,6 +314,9 @@ static inline void ltt_ev_timer(u8 ev_id, u8 sdata, ulong data1, ulong data2)
 {
 	ltt_timer timer_event;
 
+	ltt_ring_ev_long(LTT_EV_TIMER, ev_id, data1, data2);
+	if (likely(!ltt_traces_armed))
+		return;
 	timer_event.event_sub_id = ev_id;
 	timer_event.event_sdata = sdata;
 	timer_event.event_data1 = data1;
@@ -298,6 +342,9 @@ static inline void ltt_ev_memory(u8 ev_id, ulong data)
 {
 	ltt_memory memory_event;
 
+	ltt_ring_ev(LTT_EV_MEMORY, ev_id, data);
+	if (likely(!ltt_traces_armed))
+		return;
 	memory_event.event_sub_id = ev_id;
 	memory_event.event_data = data;
 
@@ -320,6 +367,9 @@ static inline void ltt_ev_socket(u8 ev_id, u32 data1, ulong data2)
 {
 	ltt_socket socket_event;
 
+	ltt_ring_ev_long(LTT_EV_SOCKET, ev_id, data1, data2);
+	if (likely(!ltt_traces_armed))
+		return;
 	socket_event.event_sub_id = ev_id;
 	socket_event.event_data1 = data1;
 	socket_event.event_data2 = data2;
@@ -343,6 +393,9 @@ static inline void ltt_ev_ipc(u8 ev_id, u32 data1, u32 data2)
 {
 	ltt_ipc ipc_event;
 
+	ltt_ring_ev_long(LTT_EV_IPC, ev_id, data1, data2);
+	if (likely(!ltt_traces_armed))
+		return;
 	ipc_event.event_sub_id = ev_id;
 	ipc_event.event_data1 = data1;
 	ipc_event.event_data2 = data2;
@@ -363,6 +416,9 @@ static inline void ltt_ev_network(u8 ev_id, u32 data)
 {
 	ltt_network net_event;
 
+	ltt_ring_ev(LTT_EV_NETWORK, ev_id, data);
+	if (likely(!ltt_traces_armed))
+		return;
 	net_event.event_sub_id = ev_id;
 	net_event.event_data = data;
 
@@ -420,6 +476,8 @@ typedef struct _ltt_change_mask {
 /*  LTT_HEARTBEAT */
 static inline void ltt_ev_heartbeat(void)
 {
+	if (likely(!ltt_traces_armed))
+		return;
 	ltt_log_event(LTT_EV_HEARTBEAT, NULL);
 }
 
@@ -439,6 +497,8 @@ ltt_ev_define_name(u8 event_id, u32 data1, u32 data2, unsigned char *event_name)
 {
 	ltt_define_name define_name_event;
 
+	if (likely(!ltt_traces_armed))
+		return;
 	define_name_event.event_sub_id   = event_id;
 	define_name_event.event_data1    = data1;
 	define_name_event.event_data2    = data2;
@@ -463,6 +523,9 @@ ltt_ev_dpm(u8 event_id, u32 data, const unsigned char *event_name)
 {
 	ltt_dpm dpm_event;
 
+	ltt_ring_ev(LTT_EV_DPM, event_id, data);
+	if (likely(!ltt_traces_armed))
+		return;
 	dpm_event.event_sub_id = event_id;
 	dpm_event.event_data1  = data;
 	dpm_event.event_name   = (char *)event_name;
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026 Motorola, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Revision History:
+ *
+ * Date         Author    Comment
+ * ----------   --------  ----------------------
+ * 10/17/2026   Motorola  Initial version
+ */
+
+/*
+ * Always-on LTT flight ring: fixed size per-CPU rings of compact records
+ */
+#ifndef _LINUX_LTT_RING_H
+#define _LINUX_LTT_RING_H
+
+#include <linux/config.h>
+#include <linux/types.h>
+#include <linux/compiler.h>
+#include <linux/bitops.h>
+
+/*
+ * Every record is one or two 8 byte slots.  The header word packs
+ *
+ *	bits 31-26	LTT event id
+ *	bit  25		record continues in the next slot (16 byte record)
+ *	bits 24-20	event sub id
+ *	bits 19-0	time since the previous record on this CPU
+ *
+ * and the second word carries the first datum.  The continuation slot
+ * of a 16 byte record has LTT_RING_EV_CONT as its id and carries the
+ * second datum.  A delta that does not fit in 20 bits is preceded by an
+ * LTT_RING_EV_TSC record holding the full 32 bit time stamp.
+ */
+struct ltt_ring_slot {
+	u32 hdr;
+	u32 data;
+};
+
+#define LTT_RING_ID_SHIFT	26
+#define LTT_RING_LONG		(1 << 25)
+#define LTT_RING_SUB_SHIFT	20
+#define LTT_RING_SUB_MASK	0x1f
+#define LTT_RING_DELTA_BITS	20
+#define LTT_RING_DELTA_MASK	((1 << LTT_RING_DELTA_BITS) - 1)
+
+/* Ring private ids, clear of the LTT and MontaVista event ids */
+#define LTT_RING_EV_TSC		60
+#define LTT_RING_EV_CONT	61
+
+/*
+ * Task states are bits up to EXIT_DEAD (64), too wide for the sub id, so
+ * a sched record carries the number of the highest state bit plus one:
+ * 0 running, 3 TASK_UNINTERRUPTIBLE, 7 EXIT_DEAD.
+ */
+#define LTT_RING_TASK_STATE(state)	fls(state)
+
+/* Header of the image written to the kpanic partition */
+#define LTT_RING_MAGIC		0x5252544c	/* "LTRR" */
+#define LTT_RING_VERSION	2
+
+struct ltt_ring_dump_cpu {
+	u32 head;		/* slots ever written */
+	u32 stamp;		/* time stamp of the newest record */
+};
+
+struct ltt_ring_dump_hdr {
+	u32 magic;
+	u32 version;
+	u32 cpus;
+	u32 slots;		/* slots per CPU */
+	u32 clock_rate;		/* time stamp ticks per second */
+	struct ltt_ring_dump_cpu cpu[0];
+};
+
+#ifdef CONFIG_LTT_FLIGHT_RING
+
+extern int ltt_ring_on;
+
+extern void __ltt_ring_log(u8 event_id, u8 sub_id, u32 data);
+extern void __ltt_ring_log_long(u8 event_id, u8 sub_id, u32 data1, u32 data2);
+
+/*
+ * Probes cost one load and a not taken branch while the ring is off.
+ */
+#define ltt_ring_ev(ID, SUB, DATA)					\
+	do {								\
+		if (unlikely(ltt_ring_on))				\
+			__ltt_ring_log((ID), (SUB), (u32) (DATA));	\
+	} while (0)
+
+#define ltt_ring_ev_long(ID, SUB, DATA1, DATA2)				\
+	do {								\
+		if (unlikely(ltt_ring_on))				\
+			__ltt_ring_log_long((ID), (SUB), (u32) (DATA1),	\
+					    (u32) (DATA2));		\
+	} while (0)
+
+#ifdef CONFIG_MOT_FEAT_KPANIC
+/* bytes kept free at the end of the kpanic partition for the ring */
+extern int ltt_ring_kpanic_size(void);
+/* freeze the rings and write them to the reserved tail of the partition */
+extern void ltt_ring_dump_kpanic(void);
+#endif /* CONFIG_MOT_FEAT_KPANIC */
+
+#else /* CONFIG_LTT_FLIGHT_RING */
+
+#define ltt_ring_ev(ID, SUB, DATA)
+#define ltt_ring_ev_long(ID, SUB, DATA1, DATA2)
+#define ltt_ring_kpanic_size()			0
+#define ltt_ring_dump_kpanic()
+
+#endif /* CONFIG_LTT_FLIGHT_RING */
+
+#endif /* _LINUX_LTT_RING_H */
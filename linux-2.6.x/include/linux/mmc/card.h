@@ -26,6 +26,7 @@
  * 11/17/2006	Motorola		Support SDA 2.0
  * 11/28/2006   Motorola                Support MMCA 4.1 movinand 4-bit mode
  * 06/25/2008	Motorola		Fix 4bit issue
+ * 10/17/2026	Motorola		Add transfer statistics and pre-erase threshold
  */
 #ifndef LINUX_MMC_CARD_H
 #define LINUX_MMC_CARD_H
@@ -70,6 +71,27 @@ struct sd_switch_caps {
 	unsigned int		hs_max_dtr;
 };
 
+/*
+ * Block transfer statistics of one direction.  lat[] counts requests
+ * by time from issue to card ready: bucket 0 is below 1ms, bucket n
+ * below 2^n ms, and the last one takes everything slower.
+ */
+#define MMC_LAT_BUCKETS		10
+
+struct mmc_xfer_stats {
+	unsigned long		requests;
+	unsigned long		errors;
+	unsigned long long	bytes;
+	unsigned long long	usecs;		/* summed request latency */
+	unsigned long		lat[MMC_LAT_BUCKETS];
+};
+
+/*
+ * Default size, in 512 byte sectors, from which SD writes are preceded
+ * by ACMD23 so the card can erase the target blocks ahead of the data.
+ */
+#define MMC_PRE_ERASE_SECTORS	128
+
 struct mmc_host;
 
 /*
@@ -103,6 +125,10 @@ struct mmc_card {
 #endif
 	struct sd_scr		scr;		/* extra SD information */
 	struct sd_switch_caps	sw_caps;	/* switch (CMD6) caps */
+
+	struct mmc_xfer_stats	stats[2];	/* block reads [0], writes [1] */
+	unsigned int		pre_erase_sectors; /* 0 disables ACMD23 */
+	unsigned long		pre_erases;	/* ACMD23 accepted by the card */
 };
 
 #define mmc_card_present(c)	((c)->state & MMC_STATE_PRESENT)
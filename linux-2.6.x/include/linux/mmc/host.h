@@ -25,6 +25,7 @@
  * Date		Author			Comment
  * 11/17/2006	Motorola		Support SDA 2.0
  * 06/25/2008	Motorola		Fix 4bit issue
+ * 10/17/2026	Motorola		Add pre_req/post_req host operations
  */
 #ifndef LINUX_MMC_HOST_H
 #define LINUX_MMC_HOST_H
@@ -87,6 +88,13 @@ struct mmc_host_ops {
 	void	(*request)(struct mmc_host *host, struct mmc_request *req);
 	void	(*set_ios)(struct mmc_host *host, struct mmc_ios *ios);
 	int	(*get_ro)(struct mmc_host *host);
+	/*
+	 * Optional.  pre_req() may map the data of a request for DMA
+	 * while another request is still on the bus, post_req() undoes
+	 * it once the request is done.  Both run in process context.
+	 */
+	void	(*pre_req)(struct mmc_host *host, struct mmc_request *req);
+	void	(*post_req)(struct mmc_host *host, struct mmc_request *req);
 };
 
 struct mmc_card;
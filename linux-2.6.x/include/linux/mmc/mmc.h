@@ -22,6 +22,7 @@
  *
  * Date		Author			Comment
  * 11/17/2006	Motorola		Support SDA 2.0
+ * 10/17/2026	Motorola		Add mmc_start_req and host_cookie
  */
 #ifndef MMC_H
 #define MMC_H
@@ -95,6 +96,8 @@ struct mmc_data {
 
 	unsigned int		sg_len;		/* size of scatter list */
 	struct scatterlist	*sg;		/* I/O scatter list */
+
+	unsigned int		host_cookie;	/* host private, set by pre_req */
 };
 
 struct mmc_request {
@@ -109,6 +112,10 @@ struct mmc_request {
 struct mmc_host;
 struct mmc_card;
 
+struct completion;
+
+extern int mmc_start_req(struct mmc_host *, struct mmc_request *,
+	struct completion *);
 extern int mmc_wait_for_req(struct mmc_host *, struct mmc_request *);
 extern int mmc_wait_for_cmd(struct mmc_host *, struct mmc_command *, int);
 extern int mmc_wait_for_app_cmd(struct mmc_host *, unsigned int,
@@ -42,6 +42,7 @@
  * 11/28/2006   Motorola                Support MMCA 4.1 movinand 4-bit mode
  * 07/31/2008	Motorola		Fix 4bit issue
  * 09/32/2008   Motorola        	Support erase command
+ * 10/17/2026   Motorola        	Add SD_APP_SET_WR_BLK_ERASE_COUNT
  */
 
 #ifndef MMC_MMC_PROTOCOL_H
@@ -116,6 +117,7 @@
   /* Application commands */
 #define SD_APP_SET_BUS_WIDTH      6   /* ac   [1:0] bus width    R1  */
 #define SD_APP_SEND_NUM_WR_BLKS  22   /* adtc                    R1  */
+#define SD_APP_SET_WR_BLK_ERASE_COUNT 23 /* ac [22:0] blocks      R1  */
 #define SD_APP_OP_COND           41   /* bcr  [31:0] OCR         R3  */
 #define SD_APP_SEND_SCR          51   /* adtc                    R1  */
 #define SD_APP_SD_STATUS         13   /* adtc [31:0]             R1  */
@@ -17,6 +17,9 @@
  * 04-15-2007   Motorola  add reason code to CONFIG_MOT_FEAT_NAND_RDDIST
  *
  * 06-15-2007   Motorola  update read disturb max value for threshold from 2^8 to 2^16.
+ *
+ * 10-17-2026   Motorola  feature CONFIG_MOT_FEAT_NAND_ASYNC_ERASE added.
+ *			  added the erase_async method.
  */
 
 #ifndef __MTD_MTD_H__
@@ -116,6 +119,12 @@ struct mtd_info {
 	u_int32_t bank_size;
 
 	int (*erase) (struct mtd_info *mtd, struct erase_info *instr);
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+	/* Queue an erase and return; instr->callback reports the result.
+	 * instr must stay valid until then, and the callback may run with
+	 * the device held, so it must not call back into the MTD. */
+	int (*erase_async) (struct mtd_info *mtd, struct erase_info *instr);
+#endif
 
 	/* This stuff for eXecute-In-Place */
 	int (*point) (struct mtd_info *mtd, loff_t from, size_t len, size_t *retlen, u_char **mtdbuf);
@@ -66,6 +66,15 @@
  *
  *  01-09-2007 Motorola added FL_RDDIST_FIXING state into chip states, added struct task
  *			*owner into nand_chip structure.
+ *
+ *  10-17-2026 Motorola implemented CONFIG_MOT_FEAT_NAND_STREAM feature.
+ *			added the read_ahead hook and the NAND_STREAM_PROG option.
+ *
+ *  10-17-2026 Motorola	added the CONFIG_MOT_FEAT_NAND_RDDIST background refresh
+ *			interface of nand_rddist.c.
+ *
+ *  10-17-2026 Motorola	implemented CONFIG_MOT_FEAT_NAND_ASYNC_ERASE feature.
+ *			added the erase queue and erase thread to nand_chip.
  */
 #ifndef __LINUX_MTD_NAND_H
 #define __LINUX_MTD_NAND_H
@@ -260,6 +269,12 @@ struct page_layout_item {
  * nand_write_oob. This is needed for some HW ECC generators that need a
  * whole page to be written to generate ECC properly */
 #define NAND_COMPLEX_OOB_WRITE	0x00080000
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+/* The board driver pipelines page programs. NAND_CMD_CACHEDPROG may
+ * return before the program is done; a failure is reported by the
+ * status read after the last NAND_CMD_PAGEPROG of the sequence */
+#define NAND_STREAM_PROG	0x00100000
+#endif
 
 /* Options set by nand scan */
 /* Nand scan has allocated oob_buf */
@@ -363,6 +378,14 @@ struct nand_hw_control {
  * @owner:		[INTERN] pointer to struct task for current task owner
  * @errstat:		[OPTIONAL] hardware specific function to perform additional error status checks 
  *			(determine if errors are correctable)
+ * @read_ahead:		[OPTIONAL] hint that the current multi-page read continues with the given page,
+ *			so the board driver can start the array read while this page is copied out
+ * @erase_head:		[INTERN] first queued asynchronous erase request
+ * @erase_tail:		[INTERN] last queued asynchronous erase request
+ * @erase_lock:		[INTERN] protects the erase queue and erase_busy
+ * @erase_wq:		[INTERN] wait queue of the erase thread and of nand_sync
+ * @erase_thread:	[INTERN] erase thread, NULL if it could not be started
+ * @erase_busy:		[INTERN] the erase thread is working on a dequeued request
  */
  
 struct nand_chip {
@@ -429,6 +452,17 @@ struct nand_chip {
 	struct task 	*owner;
 #endif
 	int		(*errstat)(struct mtd_info *mtd, struct nand_chip *this, int state, int status, int page);
+#ifdef CONFIG_MOT_FEAT_NAND_STREAM
+	void		(*read_ahead)(struct mtd_info *mtd, int page);
+#endif
+#ifdef CONFIG_MOT_FEAT_NAND_ASYNC_ERASE
+	struct erase_info	*erase_head;
+	struct erase_info	*erase_tail;
+	spinlock_t	erase_lock;
+	wait_queue_head_t erase_wq;
+	struct task_struct *erase_thread;
+	int		erase_busy;
+#endif
 };
 
 /*
@@ -587,6 +621,10 @@ struct nand_bbm_descr {
 #ifdef CONFIG_MOT_FEAT_NAND_RDDIST
 extern int get_bbm_index(struct mtd_info *mtd, uint16_t* bbm);
 extern int update_bbm (struct mtd_info *mtd, uint8_t *bbm, int chipsel);
+extern void nand_rddist_register (struct mtd_info *mtd);
+extern void nand_rddist_queue (int block, int reason_code);
+extern void nand_rddist_check_rdcnt (int block, unsigned int count);
+extern void nand_rddist_touch (void);
 #endif
 extern int nand_scan_bbt (struct mtd_info *mtd, struct nand_bbt_descr *bd);
 extern int nand_update_bbt (struct mtd_info *mtd, loff_t offs);
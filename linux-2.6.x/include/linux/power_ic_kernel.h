@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2006-2008 Motorola, Inc.
+ * Copyright (C) 2006-2008, 2026 Motorola, Inc.
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License version 2 as
@@ -15,6 +15,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
  * 02111-1307, USA
  *
+ * Motorola 2026-Oct-17 - Add batched register transfers
  * Motorola 2008-Feb-20 - Remove the public APIs power_ic_atod_current_and_batt_conversion() 
  * Motorola 2008-Feb-18 - Support for external audio amplifier
  * Motorola 2008-Jan-29 - Added function to set morphing mode.
@@ -147,6 +148,27 @@ typedef struct
  */
 typedef int (*POWER_IC_EVENT_CALLBACK_T)(POWER_IC_EVENT_T);
 
+/*!
+ * @brief Operations that can be queued in a power_ic_transfer() batch.
+ */
+typedef enum
+{
+    POWER_IC_XFER_READ,      /* Read the register into value. */
+    POWER_IC_XFER_WRITE,     /* Write value to the whole register. */
+    POWER_IC_XFER_SET_MASK   /* Set the bits in mask to those in value. */
+} POWER_IC_XFER_OP_T;
+
+/*!
+ * @brief One register operation of a power_ic_transfer() batch.
+ */
+typedef struct
+{
+    POWER_IC_XFER_OP_T op;
+    POWER_IC_REGISTER_T reg;
+    unsigned int mask;       /* Bits to change, POWER_IC_XFER_SET_MASK only. */
+    unsigned int value;      /* Value to write, or the value read back. */
+} POWER_IC_XFER_T;
+
 /*==================================================================================================
                                  GLOBAL VARIABLE DECLARATION
 ==================================================================================================*/
@@ -407,6 +429,7 @@ int power_ic_set_reg_value(POWER_IC_REGISTER_T reg, int index, int value, int nb
 int power_ic_get_reg_value(POWER_IC_REGISTER_T reg, int index, int *value, int nb_bits);
 int power_ic_set_reg_mask(POWER_IC_REGISTER_T reg, int mask, int value);
 int power_ic_set_reg_bit(POWER_IC_REGISTER_T reg, int index, int value);
+int power_ic_transfer(POWER_IC_XFER_T *xfer, int count);
 /* @} End of kernel register access functions ----------------------------------------------------*/
 
 /*!
@@ -28,6 +28,7 @@
 /* ChangeLog:
  * (mm-dd-yyyy) Author    Comment
  * 07-22-2005   Motorola  Applied patch to upmerge to version 2.2
+ * 10-17-2026   Motorola  Configurable metadata cache and zlib streams
  */
 
 #ifndef CONFIG_SQUASHFS_2_0_COMPATIBILITY
@@ -42,6 +43,8 @@
 #define SQUASHFS_FREE(a)		kfree(a)
 #endif
 #define SQUASHFS_CACHED_FRAGMENTS	CONFIG_SQUASHFS_FRAGMENT_CACHE_SIZE	
+#define SQUASHFS_CACHED_BLKS		CONFIG_SQUASHFS_METADATA_CACHE_SIZE
+#define SQUASHFS_DECOMP_STREAMS		CONFIG_SQUASHFS_DECOMP_STREAMS
 #define SQUASHFS_MAJOR			3
 #define SQUASHFS_MINOR			0
 #define SQUASHFS_MAGIC			0x73717368
@@ -174,9 +177,6 @@
 #define SQUASHFS_FRAGMENT_INDEX_BYTES(A)	(SQUASHFS_FRAGMENT_INDEXES(A) *\
 						sizeof(long long))
 
-/* cached data constants for filesystem */
-#define SQUASHFS_CACHED_BLKS		8
-
 #define SQUASHFS_MAX_FILE_SIZE_LOG	64
 
 #define SQUASHFS_MAX_FILE_SIZE		((long long) 1 << \
@@ -27,23 +27,34 @@
 /* ChangeLog:
  * (mm-dd-yyyy) Author    Comment
  * 07-22-2005   Motorola  Applied patch to upmerge to version 2.2
+ * 10-17-2026   Motorola  zlib stream pool, LRU block and fragment caches
  */
 
 #include <linux/squashfs_fs.h>
 #include <linux/zlib.h>
+#include <asm/atomic.h>
 
 struct squashfs_cache {
 	long long	block;
 	int		length;
+	int		pending;
 	long long	next_index;
 	char		*data;
+	struct list_head	lru;
 };
 
 struct squashfs_fragment_cache {
 	long long	block;
 	int		length;
+	int		pending;
 	unsigned int	locked;
 	char		*data;
+	struct list_head	lru;
+};
+
+struct squashfs_stream {
+	z_stream		stream;
+	struct list_head	list;
 };
 
 struct squashfs_sb_info {
@@ -53,25 +64,32 @@ struct squashfs_sb_info {
 	int			swap;
 	struct squashfs_cache	*block_cache;
 	struct squashfs_fragment_cache	*fragment;
-	int			next_cache;
-	int			next_fragment;
+	struct list_head	block_cache_lru;
+	struct list_head	fragment_lru;
+	atomic_t		block_cache_hits;
+	atomic_t		block_cache_misses;
+	atomic_t		fragment_hits;
+	atomic_t		fragment_misses;
 	int			next_meta_index;
 	unsigned int		*uid;
 	unsigned int		*guid;
 	long long		*fragment_index;
 	unsigned int		*fragment_index_2;
 	unsigned int		read_size;
-	char			*read_data;
-	char			*read_page;
-	struct semaphore	read_data_mutex;
-	struct semaphore	read_page_mutex;
+	char			*dummy_page;
+	struct squashfs_stream	*stream;
+	struct list_head	free_streams;
+	spinlock_t		stream_lock;
+	struct semaphore	stream_sem;
+	unsigned int		stream_waits;
+	struct super_block	*sb;
+	struct list_head	list;
 	struct semaphore	block_cache_mutex;
 	struct semaphore	fragment_mutex;
 	struct semaphore	meta_index_mutex;
 	wait_queue_head_t	waitq;
 	wait_queue_head_t	fragment_wait_queue;
 	struct meta_index	*meta_index;
-	z_stream		stream;
 	struct inode		*(*iget)(struct super_block *s,  squashfs_inode_t
 				inode);
 	long long		(*read_blocklist)(struct inode *inode, int
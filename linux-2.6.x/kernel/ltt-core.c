@@ -4,6 +4,7 @@
  * (C) Copyright, 1999, 2000, 2001, 2002, 2003, 2004 -
  *              Karim Yaghmour (karim@opersys.com)
  * (C) Copyright 2004, 2005 - MontaVista Software, Inc. (source@mvista.com)
+ * (C) Copyright 2026 Motorola, Inc.
  *
  * Contains the kernel code for the Linux Trace Toolkit.
  *
@@ -15,6 +16,8 @@
  * whether express or implied.
  *
  * Changelog:
+ *	17/10/26, Count armed trace handles so probes can return early when
+ *		nothing is tracing (Motorola).
  *	14/12/04, Renamed trace macros and variables to avoid namespace
  *		pollution (i.e. TRACE_XXX is now ltt_ev_xxx, etc.)
  *	24/01/04, Revamped tracer to rely entirely on relayfs, no sys_trace.
@@ -102,6 +105,7 @@ static int		syscall_eip_depth_set;
 
 /* Data buffer management */
 static struct ltt_trace_struct	current_traces[NR_TRACES];
+int				ltt_traces_armed;	/* handles allocated */
 static u32			start_reserve = LTT_TRACER_FIRST_EVENT_SIZE;
 static u32			end_reserve = LTT_TRACER_LAST_EVENT_SIZE;
 static u32			trace_start_reserve = LTT_TRACER_START_TRACE_EVENT_SIZE;
@@ -1281,6 +1285,7 @@ int ltt_alloc_trace_handle(unsigned int tracer_handle)
 	}
 	if (tracer_handle != NR_TRACES) {
 		trace->active = trace;
+		ltt_traces_armed++;
 		trace->tracer_started = 0;
 		trace->tracer_stopping = 0;
 		if (tracer_handle == TRACE_HANDLE) {
@@ -1383,6 +1388,8 @@ int ltt_free_daemon_handle(struct ltt_trace_struct *trace)
 		trace->daemon_task_struct = NULL;
 	}
 	
+	if (trace->active)
+		ltt_traces_armed--;
 	trace->active = NULL;
 
 	if (!active_traces())
@@ -3131,6 +3138,7 @@ EXPORT_SYMBOL(ltt_destroy_owners_events);
 EXPORT_SYMBOL(ltt_log_std_formatted_event);
 EXPORT_SYMBOL(ltt_log_raw_event);
 EXPORT_SYMBOL(ltt_log_event);
+EXPORT_SYMBOL(ltt_traces_armed);
 EXPORT_SYMBOL(syscall_entry_trace_active);
 EXPORT_SYMBOL(syscall_exit_trace_active);
 EXPORT_SYMBOL(ltt_flight_pause);
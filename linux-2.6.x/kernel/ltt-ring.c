@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2026 Motorola, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Revision History:
+ *
+ * Date         Author    Comment
+ * ----------   --------  -------------------------------------
+ * 10/17/2026   Motorola  Initial version
+ *
+ */
+
+/*
+ * Always-on flight ring for LTT events.
+ *
+ * Each CPU owns a fixed ring of 8 byte slots in BSS.  A record is written
+ * with local interrupts off on the owning CPU only, so no lock and no
+ * atomic operation is needed and the writer never waits.  The oldest
+ * records are simply overwritten.  See include/linux/ltt-ring.h for the
+ * record layout.
+ */
+
+#include <linux/config.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/smp.h>
+#include <linux/cache.h>
+#include <linux/hrtime.h>
+#include <linux/ltt-events.h>
+#include <linux/ltt-ring.h>
+#include <asm/div64.h>
+#ifdef CONFIG_MOT_FEAT_KPANIC
+#include <linux/kpanic.h>
+#endif /* CONFIG_MOT_FEAT_KPANIC */
+
+#define LTT_RING_SLOTS		CONFIG_LTT_FLIGHT_RING_SLOTS
+#define LTT_RING_MASK		(LTT_RING_SLOTS - 1)
+
+#if LTT_RING_SLOTS & LTT_RING_MASK
+#error "CONFIG_LTT_FLIGHT_RING_SLOTS must be a power of 2"
+#endif
+
+#ifdef CONFIG_HIGH_RES_TIMERS
+#define LTT_RING_CLOCK_RATE	CLOCK_TICK_RATE
+#else
+#define LTT_RING_CLOCK_RATE	HZ
+#endif
+
+struct ltt_ring {
+	u32 head;			/* slots ever written */
+	u32 stamp;			/* time stamp of the newest record */
+	struct ltt_ring_slot slot[LTT_RING_SLOTS];
+} ____cacheline_aligned;
+
+static struct ltt_ring ltt_rings[NR_CPUS];
+
+/* the ring is always on unless booted with ltt_ring=off */
+int ltt_ring_on = 1;
+
+static int __init ltt_ring_setup(char *str)
+{
+	if (!strcmp(str, "off") || !strcmp(str, "0"))
+		ltt_ring_on = 0;
+	return 1;
+}
+__setup("ltt_ring=", ltt_ring_setup);
+
+/*
+ * Free running 32 bit time stamp.  get_arch_cycles() only counts from a
+ * jiffy, so the jiffy itself supplies the upper part.
+ */
+static inline u32 ltt_ring_clock(void)
+{
+#ifdef CONFIG_HIGH_RES_TIMERS
+	unsigned long j = jiffies;
+
+	return (u32) j * arch_cycles_per_jiffy + get_arch_cycles(j);
+#else
+	return (u32) jiffies;
+#endif
+}
+
+/* Called with interrupts off; returns the header time field */
+static inline u32 ltt_ring_stamp(struct ltt_ring *ring)
+{
+	struct ltt_ring_slot *s;
+	u32 now = ltt_ring_clock();
+	u32 delta = now - ring->stamp;
+
+	ring->stamp = now;
+	if (likely(delta <= LTT_RING_DELTA_MASK))
+		return delta;
+
+	s = &ring->slot[ring->head++ & LTT_RING_MASK];
+	s->hdr = LTT_RING_EV_TSC << LTT_RING_ID_SHIFT;
+	s->data = now;
+	return 0;
+}
+
+void __ltt_ring_log(u8 event_id, u8 sub_id, u32 data)
+{
+	struct ltt_ring *ring;
+	struct ltt_ring_slot *s;
+	unsigned long flags;
+	u32 delta;
+
+	local_irq_save(flags);
+	ring = &ltt_rings[smp_processor_id()];
+	delta = ltt_ring_stamp(ring);
+	s = &ring->slot[ring->head++ & LTT_RING_MASK];
+	s->hdr = (event_id << LTT_RING_ID_SHIFT) |
+		 ((sub_id & LTT_RING_SUB_MASK) << LTT_RING_SUB_SHIFT) | delta;
+	s->data = data;
+	local_irq_restore(flags);
+}
+
+void __ltt_ring_log_long(u8 event_id, u8 sub_id, u32 data1, u32 data2)
+{
+	struct ltt_ring *ring;
+	struct ltt_ring_slot *s;
+	unsigned long flags;
+	u32 delta;
+
+	local_irq_save(flags);
+	ring = &ltt_rings[smp_processor_id()];
+	delta = ltt_ring_stamp(ring);
+	s = &ring->slot[ring->head++ & LTT_RING_MASK];
+	s->hdr = (event_id << LTT_RING_ID_SHIFT) | LTT_RING_LONG |
+		 ((sub_id & LTT_RING_SUB_MASK) << LTT_RING_SUB_SHIFT) | delta;
+	s->data = data1;
+	s = &ring->slot[ring->head++ & LTT_RING_MASK];
+	s->hdr = LTT_RING_EV_CONT << LTT_RING_ID_SHIFT;
+	s->data = data2;
+	local_irq_restore(flags);
+}
+
+EXPORT_SYMBOL(ltt_ring_on);
+EXPORT_SYMBOL(__ltt_ring_log);
+EXPORT_SYMBOL(__ltt_ring_log_long);
+
+#ifdef CONFIG_MOT_FEAT_KPANIC
+static u_char ltt_ring_page[MAX_KPANIC_PAGE_SIZE];
+
+/*
+ * The rings go at the end of the kpanic partition, a header page first
+ * and then each CPU's slots oldest first.  dump_kpanic() keeps the printk
+ * log out of this area.  Give up rather than take more than half the
+ * partition from the log, or if the board has no kpanic partition.
+ */
+int ltt_ring_kpanic_size(void)
+{
+	int page, size;
+
+	if (kpanic_initialize())
+		return 0;
+
+	page = get_kpanic_partition_page_size();
+	if (page <= 0 || page > MAX_KPANIC_PAGE_SIZE ||
+	    sizeof(ltt_rings[0].slot) % page)
+		return 0;
+
+	size = page + NR_CPUS * sizeof(ltt_rings[0].slot);
+	if (size > get_kpanic_partition_size() / 2)
+		return 0;
+	return size;
+}
+
+void ltt_ring_dump_kpanic(void)
+{
+	struct ltt_ring_dump_hdr *hdr = (struct ltt_ring_dump_hdr *) ltt_ring_page;
+	struct ltt_ring_slot *out = (struct ltt_ring_slot *) ltt_ring_page;
+	int page, size, cpu, n, fill;
+	loff_t offset;
+	u32 i, first, count;
+
+	/* nothing may be recorded behind the dump */
+	ltt_ring_on = 0;
+
+	if (!(size = ltt_ring_kpanic_size()))
+		return;
+	page = get_kpanic_partition_page_size();
+	offset = get_kpanic_partition_size() - size;
+
+	memset(ltt_ring_page, 0xff, page);
+	hdr->magic = LTT_RING_MAGIC;
+	hdr->version = LTT_RING_VERSION;
+	hdr->cpus = NR_CPUS;
+	hdr->slots = LTT_RING_SLOTS;
+	hdr->clock_rate = LTT_RING_CLOCK_RATE;
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		hdr->cpu[cpu].head = ltt_rings[cpu].head;
+		hdr->cpu[cpu].stamp = ltt_rings[cpu].stamp;
+	}
+	if (kpanic_write_page(offset, ltt_ring_page))
+		return;
+	offset += page;
+
+	n = page / sizeof(struct ltt_ring_slot);
+	for (cpu = 0; cpu < NR_CPUS; cpu++) {
+		struct ltt_ring *ring = &ltt_rings[cpu];
+
+		if (ring->head > LTT_RING_SLOTS) {
+			first = ring->head & LTT_RING_MASK;
+			count = LTT_RING_SLOTS;
+		} else {
+			first = 0;
+			count = ring->head;
+		}
+
+		for (i = 0, fill = 0; i < LTT_RING_SLOTS; i++) {
+			if (i < count)
+				out[fill] = ring->slot[(first + i) & LTT_RING_MASK];
+			else
+				memset(&out[fill], 0xff, sizeof(out[fill]));
+			if (++fill < n)
+				continue;
+			if (kpanic_write_page(offset, ltt_ring_page))
+				return;
+			offset += page;
+			fill = 0;
+		}
+	}
+}
+#endif /* CONFIG_MOT_FEAT_KPANIC */
+
+/*
+ * Probe overhead, per event type, with the ring off and on.  No trace
+ * daemon runs this early, so this is the cost a field unit pays.
+ */
+static int ltt_ring_bench_loops;
+
+static int __init ltt_ring_bench_setup(char *str)
+{
+	ltt_ring_bench_loops = simple_strtoul(str, NULL, 0);
+	return 1;
+}
+__setup("ltt_ring_bench=", ltt_ring_bench_setup);
+
+static void ltt_ring_bench_none(void) { }
+static void ltt_ring_bench_trap(void) { ltt_ev_trap_entry(14, 0); }
+static void ltt_ring_bench_irq(void) { ltt_ev_irq_entry(1, 1); }
+static void ltt_ring_bench_softirq(void) { ltt_ev_soft_irq(LTT_EV_SOFT_IRQ_SOFT_IRQ, 0); }
+static void ltt_ring_bench_sched(void)
+{
+	ltt_schedchange ev;
+
+	ltt_init_sched_event(&ev, current, current);
+	ltt_ev_schedchange(&ev);
+}
+static void ltt_ring_bench_process(void) { ltt_ev_process(LTT_EV_PROCESS_WAKEUP, 1, 0); }
+static void ltt_ring_bench_fs(void) { ltt_ev_file_system(LTT_EV_FILE_SYSTEM_READ, 0, 0, NULL); }
+static void ltt_ring_bench_timer(void) { ltt_ev_timer(LTT_EV_TIMER_EXPIRED, 0, 0, 0); }
+static void ltt_ring_bench_memory(void) { ltt_ev_memory(LTT_EV_MEMORY_PAGE_ALLOC, 0); }
+static void ltt_ring_bench_socket(void) { ltt_ev_socket(LTT_EV_SOCKET_SEND, 0, 0); }
+static void ltt_ring_bench_ipc(void) { ltt_ev_ipc(LTT_EV_IPC_CALL, 0, 0); }
+static void ltt_ring_bench_network(void) { ltt_ev_network(LTT_EV_NETWORK_PACKET_IN, 0); }
+
+static struct {
+	const char *name;
+	void (*probe)(void);
+} ltt_ring_bench_tab[] __initdata = {
+	{ "call",	ltt_ring_bench_none },
+	{ "trap",	ltt_ring_bench_trap },
+	{ "irq",	ltt_ring_bench_irq },
+	{ "softirq",	ltt_ring_bench_softirq },
+	{ "sched",	ltt_ring_bench_sched },
+	{ "process",	ltt_ring_bench_process },
+	{ "fs",		ltt_ring_bench_fs },
+	{ "timer",	ltt_ring_bench_timer },
+	{ "memory",	ltt_ring_bench_memory },
+	{ "socket",	ltt_ring_bench_socket },
+	{ "ipc",	ltt_ring_bench_ipc },
+	{ "network",	ltt_ring_bench_network },
+};
+
+/* nanoseconds per probe; interrupts stay on so the jiffy part keeps counting */
+static u32 __init ltt_ring_bench_one(void (*probe)(void), int on)
+{
+	u64 ns;
+	u32 start;
+	int i;
+
+	ltt_ring_on = on;
+	start = ltt_ring_clock();
+	for (i = 0; i < ltt_ring_bench_loops; i++)
+		probe();
+	ns = (u64) (ltt_ring_clock() - start) * NSEC_PER_SEC;
+	do_div(ns, LTT_RING_CLOCK_RATE);
+	do_div(ns, ltt_ring_bench_loops);
+	return (u32) ns;
+}
+
+static int __init ltt_ring_bench(void)
+{
+	unsigned long flags;
+	int i, on = ltt_ring_on;
+
+	if (ltt_ring_bench_loops <= 0)
+		return 0;
+
+	printk(KERN_INFO "ltt_ring: %d loops, ns per probe off/on\n",
+	       ltt_ring_bench_loops);
+	for (i = 0; i < ARRAY_SIZE(ltt_ring_bench_tab); i++)
+		printk(KERN_INFO "ltt_ring: %-8s %5u %5u\n",
+		       ltt_ring_bench_tab[i].name,
+		       ltt_ring_bench_one(ltt_ring_bench_tab[i].probe, 0),
+		       ltt_ring_bench_one(ltt_ring_bench_tab[i].probe, 1));
+
+	/* drop the benchmark records */
+	local_irq_save(flags);
+	for (i = 0; i < NR_CPUS; i++)
+		ltt_rings[i].head = 0;
+	ltt_ring_on = on;
+	local_irq_restore(flags);
+	return 0;
+}
+late_initcall(ltt_ring_bench);
@@ -2,7 +2,7 @@
  *  linux/kernel/panic.c
  *
  *  Copyright (C) 1991, 1992  Linus Torvalds
- *  Copyright (C) 2006-2008 Motorola, Inc.
+ *  Copyright (C) 2006-2008, 2026 Motorola, Inc.
  *
  * Date         Author          Comment
  * 10/2006      Motorola        Added panic block dump support
@@ -14,6 +14,7 @@
  * 05/2007      Motorola        Emit build label in kernel panic text
  * 03/2008	Motorola	Add mem print log in panic
  * 03/2008	Motorola	Make memory log more flexable
+ * 10/2026	Motorola	Dump the LTT flight ring after the printk log
  */
 
 /*
@@ -49,6 +50,8 @@
 #include <linux/mem-log.h>
 #endif /* CONFIG_MOT_FEAT_LOG_SCHEDULE_EVENTS */
 
+#include <linux/ltt-ring.h>
+
 #ifdef CONFIG_MOT_FEAT_KPANIC
 extern int meminfo_read_proc(char *, char **, off_t, int, int *, void *);
 extern void dump_kpanic(char *);
@@ -295,6 +298,9 @@ NORET_TYPE void panic(const char * fmt, ...)
 			
 			/* dump the printk log buffer to flash */
 			dump_kpanic(NULL);
+
+			/* and the LTT flight ring behind it */
+			ltt_ring_dump_kpanic();
 		}
 		/* only dump the timestamp and panic string to flash */
 		else {
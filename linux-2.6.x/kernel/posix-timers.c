@@ -31,6 +31,7 @@
  * POSIX clocks & timers
  */
 #include <linux/mm.h>
+#include <linux/module.h>
 #include <linux/smp_lock.h>
 #include <linux/interrupt.h>
 #include <linux/slab.h>
@@ -1397,6 +1398,7 @@ int do_posix_clock_monotonic_gettime(struct timespec *tp)
 	timespec_norm(tp);
 	return 0;
 }
+EXPORT_SYMBOL(do_posix_clock_monotonic_gettime);
 
 int do_posix_clock_nosettime(struct timespec *tp)
 {